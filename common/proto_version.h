@@ -12,10 +12,13 @@
 #endif
 
 // The current network protocol version.  Changing this makes clients and servers incompatible
-#define PROTOCOL_VERSION    25
+#define PROTOCOL_VERSION    26
 
 #define DEMO_BACKWARDCOMPATABILITY
 
+// For backward compatibility of demo files (game event type bits used to = 3, events had no key slots)
+#define PROTOCOL_VERSION_25		25
+
 // For backward compatibility of demo files (NET_MAX_PAYLOAD_BITS went away)
 #define PROTOCOL_VERSION_23		23
 
@@ -78,6 +78,7 @@ CDataCacheSection::CDataCacheSection( CDataCache *pSharedCache, IDataCacheClient
 	m_options( 0 )
 {
 	memset( &m_status, 0, sizeof(m_status) );
+	memset( &m_stats, 0, sizeof(m_stats) );
 	AssertMsg1( strlen(pszName) <= DC_MAX_CLIENT_NAME, "Cache client name too long \"%s\"", pszName );
 	Q_strncpy( szName, pszName, sizeof(szName) );
 
@@ -345,6 +346,8 @@ void *CDataCacheSection::Lock( DataCacheHandle_t handle )
 {
 	VPROF( "CDataCacheSection::Lock" );
 
+	m_stats.nLocks++;
+
 	if ( mem_force_flush.GetBool() && !g_iDontForceFlush)
 		Flush();
 
@@ -420,13 +423,22 @@ void *CDataCacheSection::Get( DataCacheHandle_t handle, bool bFrameLock )
 {
 	VPROF( "CDataCacheSection::Get" );
 
+	m_stats.nGets++;
+
 	if ( mem_force_flush.GetBool() && !g_iDontForceFlush)
 		Flush();
 
 	if ( handle != DC_INVALID_HANDLE )
 	{
 		if ( bFrameLock && IsFrameLocking() )
-			return FrameLock( handle );
+		{
+			void *pResult = FrameLock( handle );
+			if ( !pResult )
+			{
+				m_stats.nGetMisses++;
+			}
+			return pResult;
+		}
 
 		AUTO_LOCK( m_mutex );
 		DataCacheItem_t *pItem = m_LRU.GetResource_NoLock( (memhandle_t)handle );
@@ -436,6 +448,7 @@ void *CDataCacheSection::Get( DataCacheHandle_t handle, bool bFrameLock )
 		}
 	}
 
+	m_stats.nGetMisses++;
 	return NULL;
 }
 
@@ -447,10 +460,19 @@ void *CDataCacheSection::GetNoTouch( DataCacheHandle_t handle, bool bFrameLock )
 {
 	VPROF( "CDataCacheSection::GetNoTouch" );
 
+	m_stats.nGets++;
+
 	if ( handle != DC_INVALID_HANDLE )
 	{
 		if ( bFrameLock && IsFrameLocking() )
-			return FrameLock( handle );
+		{
+			void *pResult = FrameLock( handle );
+			if ( !pResult )
+			{
+				m_stats.nGetMisses++;
+			}
+			return pResult;
+		}
 
 		AUTO_LOCK( m_mutex );
 		DataCacheItem_t *pItem = m_LRU.GetResource_NoLockNoLRUTouch( (memhandle_t)handle );
@@ -460,6 +482,7 @@ void *CDataCacheSection::GetNoTouch( DataCacheHandle_t handle, bool bFrameLock )
 		}
 	}
 
+	m_stats.nGetMisses++;
 	return NULL;
 }
 
@@ -601,6 +624,8 @@ int CDataCacheSection::BreakLock( DataCacheHandle_t handle )
 //-----------------------------------------------------------------------------
 bool CDataCacheSection::Touch( DataCacheHandle_t handle )
 {
+	// Only sets the item's reference bit, doesn't take the mutex
+	m_stats.nTouches++;
 	m_LRU.TouchResource( (memhandle_t)handle );
 	return true;
 }
@@ -680,20 +705,33 @@ unsigned CDataCacheSection::Purge( unsigned nBytes )
 	unsigned nBytesPurged = 0;
 	unsigned nBytesCurrent = 0;
 
-	memhandle_t hCurrent = GetFirstUnlockedItem();
-	memhandle_t hNext;
-
-	while ( hCurrent != INVALID_MEMHANDLE && nBytes > 0 )
+	// The first pass spares items referenced since they were last looked at,
+	// the same second chance the shared cache's clock gives them
+	for ( int iPass = 0; iPass < 2 && nBytes > 0; iPass++ )
 	{
-		hNext = GetNextItem( hCurrent );
-		nBytesCurrent = AccessItem( hCurrent )->size;
+		memhandle_t hCurrent = GetFirstUnlockedItem();
+		memhandle_t hNext;
 
-		if ( DiscardItem( hCurrent, DC_FLUSH_DISCARD  ) )
+		while ( hCurrent != INVALID_MEMHANDLE && nBytes > 0 )
 		{
-			nBytesPurged += nBytesCurrent;
-			nBytes -= min( nBytesCurrent, nBytes );
+			hNext = GetNextItem( hCurrent );
+
+			if ( iPass == 0 && m_LRU.TestAndClearReferenced( hCurrent ) )
+			{
+				m_stats.nSecondChances++;
+				hCurrent = hNext;
+				continue;
+			}
+
+			nBytesCurrent = AccessItem( hCurrent )->size;
+
+			if ( DiscardItem( hCurrent, DC_FLUSH_DISCARD  ) )
+			{
+				nBytesPurged += nBytesCurrent;
+				nBytes -= min( nBytesCurrent, nBytes );
+			}
+			hCurrent = hNext;
 		}
-		hCurrent = hNext;
 	}
 
 	return nBytesPurged;
@@ -708,19 +746,29 @@ unsigned CDataCacheSection::PurgeItems( unsigned nItems )
 
 	unsigned nPurged = 0;
 
-	memhandle_t hCurrent = GetFirstUnlockedItem();
-	memhandle_t hNext;
-
-	while ( hCurrent != INVALID_MEMHANDLE && nItems )
+	for ( int iPass = 0; iPass < 2 && nItems; iPass++ )
 	{
-		hNext = GetNextItem( hCurrent );
+		memhandle_t hCurrent = GetFirstUnlockedItem();
+		memhandle_t hNext;
 
-		if ( DiscardItem( hCurrent, DC_FLUSH_DISCARD ) )
+		while ( hCurrent != INVALID_MEMHANDLE && nItems )
 		{
-			nItems--;
-			nPurged++;
+			hNext = GetNextItem( hCurrent );
+
+			if ( iPass == 0 && m_LRU.TestAndClearReferenced( hCurrent ) )
+			{
+				m_stats.nSecondChances++;
+				hCurrent = hNext;
+				continue;
+			}
+
+			if ( DiscardItem( hCurrent, DC_FLUSH_DISCARD ) )
+			{
+				nItems--;
+				nPurged++;
+			}
+			hCurrent = hNext;
 		}
-		hCurrent = hNext;
 	}
 
 	return nPurged;
@@ -735,6 +783,19 @@ void CDataCacheSection::OutputReport( DataCacheReportType_t reportType )
 	m_pSharedCache->OutputReport( reportType, GetName() );
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Output the activity counters of the section
+//-----------------------------------------------------------------------------
+void CDataCacheSection::OutputStats()
+{
+	DataCacheSectionStats_t stats = m_stats;
+	float flHitRate = ( stats.nGets ) ? 100.0f * (float)( stats.nGets - stats.nGetMisses ) / (float)stats.nGets : 0.0f;
+
+	Msg( "Section [%s]: %u items, %s (%u locked)\n", GetName(), GetNumItems(), Q_pretifymem( GetNumBytes(), 2, true ), GetNumItemsLocked() );
+	Msg( "    gets %u (%.1f %% hit), locks %u, touches %u\n", stats.nGets, flHitRate, stats.nLocks, stats.nTouches );
+	Msg( "    evicted %u, purged %u, spared %u\n", stats.nAgeDiscards, stats.nFlushDiscards, stats.nSecondChances );
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Updates the size of a specific item
 // Input  : handle - 
@@ -891,6 +952,15 @@ bool CDataCacheSection::DiscardItemData( DataCacheItem_t *pItem, DataCacheNotifi
 			if ( type == DC_AGE_DISCARD && m_pSharedCache->IsInFlush() )
 				type = DC_FLUSH_DISCARD;
 
+			if ( type == DC_AGE_DISCARD )
+			{
+				m_stats.nAgeDiscards++;
+			}
+			else if ( type == DC_FLUSH_DISCARD )
+			{
+				m_stats.nFlushDiscards++;
+			}
+
 			DataCacheNotification_t notification =
 			{
 				type,
@@ -1331,6 +1401,34 @@ void CDataCache::OutputReport( DataCacheReportType_t reportType, const char *psz
 
 //-------------------------------------
 
+void CDataCache::OutputStats( bool bReset )
+{
+	for ( int i = 0; i < m_Sections.Count(); ++i )
+	{
+		m_Sections[i]->OutputStats();
+		if ( bReset )
+		{
+			m_Sections[i]->ResetStats();
+		}
+	}
+
+	AUTO_LOCK( m_mutex );
+	Msg( "Shared cache: %s of %s used, clock evicted %u, spared %u\n", 
+		Q_pretifymem( m_LRU.UsedSize(), 2, true ), Q_pretifymem( m_LRU.TargetSize(), 2, true ), 
+		m_LRU.EvictionCount(), m_LRU.SecondChanceCount() );
+	if ( bReset )
+	{
+		m_LRU.ResetStats();
+	}
+}
+
+CON_COMMAND( datacache_stats, "Print per section gets, hit rate, locks and replacement counts of the data cache. 'datacache_stats reset' clears the counters after printing." )
+{
+	g_DataCache.OutputStats( args.ArgC() > 1 && !Q_stricmp( args[1], "reset" ) );
+}
+
+//-------------------------------------
+
 void CDataCache::OutputItemReport( memhandle_t hItem )
 {
 	AUTO_LOCK( m_mutex );
@@ -67,6 +67,21 @@ struct DataCacheItem_t : DataCacheItemData_t
 
 typedef CDataManager<DataCacheItem_t, DataCacheItemData_t, DataCacheItem_t *, CThreadFastMutex> CDataCacheLRU;
 
+//-------------------------------------
+
+// Per section activity counters for datacache_stats. Bumped without interlocks
+// so that keeping them never costs the hot paths a bus lock; they're approximate.
+struct DataCacheSectionStats_t
+{
+	unsigned nGets;
+	unsigned nGetMisses;
+	unsigned nLocks;
+	unsigned nTouches;
+	unsigned nAgeDiscards;		// evicted by the shared cache's clock
+	unsigned nFlushDiscards;	// dropped by section limits, purges and flushes
+	unsigned nSecondChances;	// spared by a section purge for having been referenced
+};
+
 //-----------------------------------------------------------------------------
 // CDataCacheSection
 //
@@ -151,6 +166,8 @@ public:
 	//--------------------------------------------------------
 
 	virtual void OutputReport( DataCacheReportType_t reportType = DC_SUMMARY_REPORT );
+	void OutputStats();
+	void ResetStats()				{ memset( &m_stats, 0, sizeof(m_stats) ); }
 
 	virtual void UpdateSize( DataCacheHandle_t handle, unsigned int nNewSize );
 
@@ -207,6 +224,7 @@ private:
 	CDataCacheLRU &		m_LRU;
 	CTHREADLOCAL(FrameLock_t*)	m_ThreadFrameLock;
 	DataCacheStatus_t	m_status;
+	DataCacheSectionStats_t m_stats;
 	DataCacheLimits_t	m_limits;
 	IDataCacheClient *	m_pClient;
 	unsigned			m_options;
@@ -289,6 +307,7 @@ public:
 	//--------------------------------------------------------
 
 	virtual void OutputReport( DataCacheReportType_t reportType = DC_SUMMARY_REPORT, const char *pszSection = NULL );
+	void OutputStats( bool bReset );
 
 	//--------------------------------------------------------
 
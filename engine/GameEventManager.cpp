@@ -15,6 +15,8 @@
 #include "server.h"
 #include "client.h"
 #include "tier0/vprof.h"
+#include "proto_version.h"
+#include "tier1/generichash.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
@@ -34,74 +36,470 @@ static const char *s_GameEnventTypeMap[] =
 	"short",	// 4 : signed int 16 bit
 	"byte",		// 5 : unsigned int 8 bit
 	"bool",		// 6 : unsigned int 1 bit
+	"float_array",	// 7 : varint count + float 32 bit values
+	"long_array",	// 8 : varint count + signed int 32 bit values
 	NULL };
 
 static ConVar net_showevents( "net_showevents", "0", FCVAR_CHEAT, "Dump game events to console (1=client only, 2=all)." );
+static ConVar sv_batch_gameevents( "sv_batch_gameevents", "0", 0, "Queue game events for clients and send them once per server frame, instead of as they are fired. Events then arrive after other reliable messages sent in the same frame." );
+
+#define MAX_POOLED_EVENTS	256		// freed events kept for reuse
+
+CON_COMMAND( net_eventstats, "Print how often each game event was fired and how much was sent. Pass 'reset' to clear the counters." )
+{
+	g_GameEventManager.PrintEventStats( args.ArgC() > 1 && !Q_stricmp( args[1], "reset" ) );
+}
 
 // Expose CVEngineServer to the engine.
 
 EXPOSE_SINGLE_INTERFACE_GLOBALVAR( CGameEventManager, IGameEventManager2, INTERFACEVERSION_GAMEEVENTSMANAGER2, s_GameEventManager );
 
+int CGameEventDescriptor::FindSlot( const char *keyName ) const
+{
+	if ( !keyName || !keyName[0] || !slotIndex.Count() )
+		return -1;
+
+	unsigned int hash = HashStringCaseless( keyName );
+	int mask = slotIndex.Count() - 1;
+
+	// the index is at most half full, so there's always an empty entry to stop at
+	for ( int i = hash & mask; slotIndex[i] >= 0; i = ( i + 1 ) & mask )
+	{
+		const GameEventSlot_t &slot = slots[ slotIndex[i] ];
+
+		if ( slot.hash == hash && !Q_stricmp( slot.name, keyName ) )
+			return slotIndex[i];
+	}
+
+	return -1;
+}
+
 CGameEvent::CGameEvent( CGameEventDescriptor *descriptor )
+{
+	m_pExtraKeys = NULL;
+	m_pDataKeys = NULL;
+
+	Init( descriptor );
+}
+
+CGameEvent::~CGameEvent()
+{
+	Release();
+}
+
+void CGameEvent::Init( CGameEventDescriptor *descriptor )
 {
 	Assert( descriptor );
 	m_pDescriptor = descriptor;
-	m_pDataKeys = new KeyValues( descriptor->name );
+	m_bDataKeysDirty = true;
+
+	m_Values.SetCount( descriptor->slots.Count() );
+
+	for ( int i = 0; i < m_Values.Count(); i++ )
+	{
+		m_Values[i].m_nValue = 0;
+		m_Values[i].m_nCount = -1;
+	}
+
+	m_Payload.RemoveAll();
 }
 
-CGameEvent::~CGameEvent()
+void CGameEvent::Release()
+{
+	if ( m_pExtraKeys )
+	{
+		m_pExtraKeys->deleteThis();
+		m_pExtraKeys = NULL;
+	}
+
+	if ( m_pDataKeys )
+	{
+		m_pDataKeys->deleteThis();
+		m_pDataKeys = NULL;
+	}
+
+	// don't let one huge event pin its payload in the pool
+	if ( m_Payload.NumAllocated() > 16 * 1024 )
+	{
+		m_Payload.Purge();
+	}
+}
+
+void CGameEvent::CopyFrom( const CGameEvent *pOther )
+{
+	Assert( m_pDescriptor == pOther->m_pDescriptor );
+
+	m_Values.CopyArray( pOther->m_Values.Base(), pOther->m_Values.Count() );
+	m_Payload.CopyArray( pOther->m_Payload.Base(), pOther->m_Payload.Count() );
+
+	if ( m_pExtraKeys )
+	{
+		m_pExtraKeys->deleteThis();
+		m_pExtraKeys = NULL;
+	}
+
+	if ( pOther->m_pExtraKeys )
+		m_pExtraKeys = pOther->m_pExtraKeys->MakeCopy();
+
+	m_bDataKeysDirty = true;
+}
+
+void CGameEvent::SetDataKeys( KeyValues *keys )
+{
+	// legacy events come in as KeyValues, take over their values and ownership
+	for ( KeyValues *key = keys->GetFirstSubKey(); key; key = key->GetNextKey() )
+	{
+		switch ( key->GetDataType() )
+		{
+		case KeyValues::types_t::TYPE_NONE : break;
+		case KeyValues::types_t::TYPE_INT : SetInt( key->GetName(), key->GetInt() ); break;
+		case KeyValues::types_t::TYPE_FLOAT : SetFloat( key->GetName(), key->GetFloat() ); break;
+		default: SetString( key->GetName(), key->GetString() ); break;
+		}
+	}
+
+	if ( m_pDataKeys )
+		m_pDataKeys->deleteThis();
+
+	m_pDataKeys = keys;
+	m_bDataKeysDirty = true;
+}
+
+KeyValues *CGameEvent::GetExtraKeys( bool bCreate )
+{
+	if ( !m_pExtraKeys && bCreate )
+		m_pExtraKeys = new KeyValues( m_pDescriptor->name );
+
+	if ( bCreate )
+		m_bDataKeysDirty = true;
+
+	return m_pExtraKeys;
+}
+
+int CGameEvent::AllocPayload( int nBytes )
+{
+	// keep arrays 4 byte aligned
+	int offset = AlignValue( m_Payload.Count(), 4 );
+	m_Payload.AddMultipleToTail( offset - m_Payload.Count() + nBytes );
+	return offset;
+}
+
+int CGameEvent::GetKeySlot( const char *keyName ) const
+{
+	return m_pDescriptor->FindSlot( keyName );
+}
+
+int CGameEvent::GetIntBySlot( int slot, int defaultValue )
+{
+	if ( !IsValidSlot( slot ) || !IsSlotSet( slot ) )
+		return defaultValue;
+
+	const GameEventValue_t &value = m_Values[slot];
+
+	switch ( m_pDescriptor->slots[slot].type )
+	{
+	case CGameEventManager::TYPE_STRING : return Q_atoi( (const char*)&m_Payload[value.m_nOffset] );
+	case CGameEventManager::TYPE_FLOAT : return (int)value.m_flValue;
+	case CGameEventManager::TYPE_FLOAT_ARRAY :
+	case CGameEventManager::TYPE_LONG_ARRAY : return defaultValue;
+	default: return value.m_nValue;
+	}
+}
+
+float CGameEvent::GetFloatBySlot( int slot, float defaultValue )
+{
+	if ( !IsValidSlot( slot ) || !IsSlotSet( slot ) )
+		return defaultValue;
+
+	const GameEventValue_t &value = m_Values[slot];
+
+	switch ( m_pDescriptor->slots[slot].type )
+	{
+	case CGameEventManager::TYPE_STRING : return Q_atof( (const char*)&m_Payload[value.m_nOffset] );
+	case CGameEventManager::TYPE_FLOAT : return value.m_flValue;
+	case CGameEventManager::TYPE_FLOAT_ARRAY :
+	case CGameEventManager::TYPE_LONG_ARRAY : return defaultValue;
+	default: return (float)value.m_nValue;
+	}
+}
+
+const char *CGameEvent::GetStringBySlot( int slot, const char *defaultValue )
+{
+	if ( !IsValidSlot( slot ) || !IsSlotSet( slot ) )
+		return defaultValue;
+
+	const GameEventValue_t &value = m_Values[slot];
+
+	switch ( m_pDescriptor->slots[slot].type )
+	{
+	case CGameEventManager::TYPE_STRING : return (const char*)&m_Payload[value.m_nOffset];
+	case CGameEventManager::TYPE_FLOAT : Q_snprintf( m_szConvert, sizeof( m_szConvert ), "%f", value.m_flValue ); return m_szConvert;
+	case CGameEventManager::TYPE_FLOAT_ARRAY :
+	case CGameEventManager::TYPE_LONG_ARRAY : return defaultValue;
+	default: Q_snprintf( m_szConvert, sizeof( m_szConvert ), "%d", value.m_nValue ); return m_szConvert;
+	}
+}
+
+void CGameEvent::SetIntBySlot( int slot, int value )
+{
+	if ( !IsValidSlot( slot ) )
+		return;
+
+	switch ( m_pDescriptor->slots[slot].type )
+	{
+	case CGameEventManager::TYPE_STRING :
+		{
+			char buf[16];
+			Q_snprintf( buf, sizeof( buf ), "%d", value );
+			SetStringBySlot( slot, buf );
+			return;
+		}
+	case CGameEventManager::TYPE_FLOAT : m_Values[slot].m_flValue = (float)value; break;
+	case CGameEventManager::TYPE_FLOAT_ARRAY :
+	case CGameEventManager::TYPE_LONG_ARRAY : DevMsg( "CGameEvent::SetInt: key '%s' is an array.\n", m_pDescriptor->slots[slot].name ); return;
+	default: m_Values[slot].m_nValue = value; break;
+	}
+
+	m_Values[slot].m_nCount = 1;
+	m_bDataKeysDirty = true;
+}
+
+void CGameEvent::SetFloatBySlot( int slot, float value )
+{
+	if ( !IsValidSlot( slot ) )
+		return;
+
+	switch ( m_pDescriptor->slots[slot].type )
+	{
+	case CGameEventManager::TYPE_STRING :
+		{
+			char buf[32];
+			Q_snprintf( buf, sizeof( buf ), "%f", value );
+			SetStringBySlot( slot, buf );
+			return;
+		}
+	case CGameEventManager::TYPE_FLOAT : m_Values[slot].m_flValue = value; break;
+	case CGameEventManager::TYPE_FLOAT_ARRAY :
+	case CGameEventManager::TYPE_LONG_ARRAY : DevMsg( "CGameEvent::SetFloat: key '%s' is an array.\n", m_pDescriptor->slots[slot].name ); return;
+	default: m_Values[slot].m_nValue = (int)value; break;
+	}
+
+	m_Values[slot].m_nCount = 1;
+	m_bDataKeysDirty = true;
+}
+
+void CGameEvent::SetStringBySlot( int slot, const char *value )
 {
-	m_pDataKeys->deleteThis();
+	if ( !IsValidSlot( slot ) )
+		return;
+
+	switch ( m_pDescriptor->slots[slot].type )
+	{
+	case CGameEventManager::TYPE_STRING :
+		{
+			int len = Q_strlen( value ) + 1;
+			int offset = AllocPayload( len );
+			Q_memcpy( &m_Payload[offset], value, len );
+			m_Values[slot].m_nOffset = offset;
+			m_Values[slot].m_nCount = 1;
+			m_bDataKeysDirty = true;
+			break;
+		}
+	case CGameEventManager::TYPE_FLOAT : SetFloatBySlot( slot, Q_atof( value ) ); break;
+	case CGameEventManager::TYPE_FLOAT_ARRAY :
+	case CGameEventManager::TYPE_LONG_ARRAY : DevMsg( "CGameEvent::SetString: key '%s' is an array.\n", m_pDescriptor->slots[slot].name ); break;
+	default: SetIntBySlot( slot, Q_atoi( value ) ); break;
+	}
+}
+
+void CGameEvent::SetArrayBySlot( int slot, const void *values, int count, bool bFloat )
+{
+	if ( !IsValidSlot( slot ) )
+		return;
+
+	int type = m_pDescriptor->slots[slot].type;
+
+	if ( type != CGameEventManager::TYPE_FLOAT_ARRAY && type != CGameEventManager::TYPE_LONG_ARRAY )
+	{
+		DevMsg( "CGameEvent::SetArray: key '%s' isn't an array.\n", m_pDescriptor->slots[slot].name );
+		return;
+	}
+
+	count = MAX( count, 0 );
+
+	int offset = AllocPayload( count * sizeof( int ) );
+	bool bStoreFloat = ( type == CGameEventManager::TYPE_FLOAT_ARRAY );
+
+	if ( bStoreFloat == bFloat )
+	{
+		Q_memcpy( &m_Payload[offset], values, count * sizeof( int ) );
+	}
+	else
+	{
+		for ( int i = 0; i < count; i++ )
+		{
+			if ( bFloat )
+				((int*)&m_Payload[offset])[i] = (int)((const float*)values)[i];
+			else
+				((float*)&m_Payload[offset])[i] = (float)((const int*)values)[i];
+		}
+	}
+
+	m_Values[slot].m_nOffset = offset;
+	m_Values[slot].m_nCount = count;
+	m_bDataKeysDirty = true;
+}
+
+int CGameEvent::GetArrayBySlot( int slot, void *values, int maxCount, bool bFloat )
+{
+	if ( !IsValidSlot( slot ) || !IsSlotSet( slot ) )
+		return 0;
+
+	int type = m_pDescriptor->slots[slot].type;
+
+	if ( type != CGameEventManager::TYPE_FLOAT_ARRAY && type != CGameEventManager::TYPE_LONG_ARRAY )
+		return 0;
+
+	const GameEventValue_t &value = m_Values[slot];
+	int count = MIN( value.m_nCount, maxCount );
+
+	if ( values && count > 0 )
+	{
+		bool bStoredFloat = ( type == CGameEventManager::TYPE_FLOAT_ARRAY );
+
+		if ( bStoredFloat == bFloat )
+		{
+			Q_memcpy( values, &m_Payload[value.m_nOffset], count * sizeof( int ) );
+		}
+		else
+		{
+			for ( int i = 0; i < count; i++ )
+			{
+				if ( bFloat )
+					((float*)values)[i] = (float)((const int*)&m_Payload[value.m_nOffset])[i];
+				else
+					((int*)values)[i] = (int)((const float*)&m_Payload[value.m_nOffset])[i];
+			}
+		}
+	}
+
+	return count;
 }
 
 bool CGameEvent::GetBool( const char *keyName, bool defaultValue)
 {
-	return m_pDataKeys->GetInt( keyName, defaultValue ) != 0;
+	return GetInt( keyName, defaultValue ) != 0;
 }
 
 int CGameEvent::GetInt( const char *keyName, int defaultValue)
 {
-	return m_pDataKeys->GetInt( keyName, defaultValue );
+	int slot = m_pDescriptor->FindSlot( keyName );
+
+	if ( slot >= 0 )
+		return GetIntBySlot( slot, defaultValue );
+
+	return m_pExtraKeys ? m_pExtraKeys->GetInt( keyName, defaultValue ) : defaultValue;
 }
 
 float CGameEvent::GetFloat( const char *keyName, float defaultValue )
 {
-	return m_pDataKeys->GetFloat( keyName, defaultValue );
+	int slot = m_pDescriptor->FindSlot( keyName );
+
+	if ( slot >= 0 )
+		return GetFloatBySlot( slot, defaultValue );
+
+	return m_pExtraKeys ? m_pExtraKeys->GetFloat( keyName, defaultValue ) : defaultValue;
 }
 
 const char *CGameEvent::GetString( const char *keyName, const char *defaultValue )
 {
-	return m_pDataKeys->GetString( keyName, defaultValue );
+	int slot = m_pDescriptor->FindSlot( keyName );
+
+	if ( slot >= 0 )
+		return GetStringBySlot( slot, defaultValue );
+
+	return m_pExtraKeys ? m_pExtraKeys->GetString( keyName, defaultValue ) : defaultValue;
 }
 
 void CGameEvent::SetBool( const char *keyName, bool value )
 {
-	m_pDataKeys->SetInt( keyName, value?1:0 );
+	SetInt( keyName, value?1:0 );
 }
 
 void CGameEvent::SetInt( const char *keyName, int value )
 {
-	m_pDataKeys->SetInt( keyName, value );
+	int slot = m_pDescriptor->FindSlot( keyName );
+
+	if ( slot >= 0 )
+		SetIntBySlot( slot, value );
+	else
+		GetExtraKeys( true )->SetInt( keyName, value );
 }
 
 void CGameEvent::SetFloat( const char *keyName, float value )
 {
-	m_pDataKeys->SetFloat( keyName, value );
+	int slot = m_pDescriptor->FindSlot( keyName );
+
+	if ( slot >= 0 )
+		SetFloatBySlot( slot, value );
+	else
+		GetExtraKeys( true )->SetFloat( keyName, value );
 }
 
 void CGameEvent::SetString( const char *keyName, const char *value )
 {
-	m_pDataKeys->SetString( keyName, value );
+	int slot = m_pDescriptor->FindSlot( keyName );
+
+	if ( slot >= 0 )
+		SetStringBySlot( slot, value );
+	else
+		GetExtraKeys( true )->SetString( keyName, value );
+}
+
+void CGameEvent::SetFloatArray( const char *keyName, const float *values, int count )
+{
+	SetArrayBySlot( m_pDescriptor->FindSlot( keyName ), values, count, true );
+}
+
+void CGameEvent::SetIntArray( const char *keyName, const int *values, int count )
+{
+	SetArrayBySlot( m_pDescriptor->FindSlot( keyName ), values, count, false );
+}
+
+int CGameEvent::GetFloatArray( const char *keyName, float *values, int maxCount )
+{
+	return GetArrayBySlot( m_pDescriptor->FindSlot( keyName ), values, maxCount, true );
+}
+
+int CGameEvent::GetIntArray( const char *keyName, int *values, int maxCount )
+{
+	return GetArrayBySlot( m_pDescriptor->FindSlot( keyName ), values, maxCount, false );
 }
 
 bool CGameEvent::IsEmpty( const char *keyName )
 {
-	return m_pDataKeys->IsEmpty( keyName );
+	if ( keyName )
+	{
+		int slot = m_pDescriptor->FindSlot( keyName );
+
+		if ( slot >= 0 )
+			return !IsSlotSet( slot );
+
+		return m_pExtraKeys ? m_pExtraKeys->IsEmpty( keyName ) : true;
+	}
+
+	for ( int i = 0; i < m_Values.Count(); i++ )
+	{
+		if ( IsSlotSet( i ) )
+			return false;
+	}
+
+	return m_pExtraKeys ? m_pExtraKeys->IsEmpty() : true;
 }
 
 const char *CGameEvent::GetName() const
 {
-	return m_pDataKeys->GetName();
+	return m_pDescriptor->name;
 }
 
 bool CGameEvent::IsLocal() const
@@ -116,7 +514,65 @@ bool CGameEvent::IsReliable() const
 
 KeyValues* CGameEvent::GetDataKeys()
 {
-    return m_pDataKeys;
+	// the slots are only mirrored into KeyValues for legacy listeners and debug output
+	if ( !m_pDataKeys )
+	{
+		m_pDataKeys = new KeyValues( m_pDescriptor->name );
+	}
+	else if ( !m_bDataKeysDirty )
+	{
+		return m_pDataKeys;
+	}
+	else
+	{
+		m_pDataKeys->Clear();
+	}
+
+	for ( int i = 0; i < m_Values.Count(); i++ )
+	{
+		if ( !IsSlotSet( i ) )
+			continue;
+
+		const GameEventSlot_t &slot = m_pDescriptor->slots[i];
+
+		switch ( slot.type )
+		{
+		case CGameEventManager::TYPE_STRING : m_pDataKeys->SetString( slot.name, GetStringBySlot( i ) ); break;
+		case CGameEventManager::TYPE_FLOAT : m_pDataKeys->SetFloat( slot.name, m_Values[i].m_flValue ); break;
+		case CGameEventManager::TYPE_FLOAT_ARRAY :
+		case CGameEventManager::TYPE_LONG_ARRAY :
+			{
+				KeyValues *pArray = m_pDataKeys->FindKey( slot.name, true );
+
+				for ( int j = 0; j < m_Values[i].m_nCount; j++ )
+				{
+					char szIndex[16];
+					Q_snprintf( szIndex, sizeof( szIndex ), "%d", j );
+
+					const void *pValue = &m_Payload[m_Values[i].m_nOffset + j * sizeof( int )];
+
+					if ( slot.type == CGameEventManager::TYPE_FLOAT_ARRAY )
+						pArray->SetFloat( szIndex, *(const float*)pValue );
+					else
+						pArray->SetInt( szIndex, *(const int*)pValue );
+				}
+				break;
+			}
+		default: m_pDataKeys->SetInt( slot.name, m_Values[i].m_nValue ); break;
+		}
+	}
+
+	if ( m_pExtraKeys )
+	{
+		for ( KeyValues *pKey = m_pExtraKeys->GetFirstSubKey(); pKey; pKey = pKey->GetNextKey() )
+		{
+			m_pDataKeys->AddSubKey( pKey->MakeCopy() );
+		}
+	}
+
+	m_bDataKeysDirty = false;
+
+	return m_pDataKeys;
 }
 
 CGameEventManager::CGameEventManager()
@@ -138,12 +594,51 @@ bool CGameEventManager::Init()
     // TODO_ENHANCED: write this into a res file.
     static auto bullet_impact_kv = new KeyValues("bullet_impact");
 	RegisterEvent(bullet_impact_kv);
-	static auto bullet_hit_player_kv = new KeyValues("bullet_hit_player");
-	RegisterEvent(bullet_hit_player_kv);
-	static auto bullet_player_hitboxes_kv = new KeyValues("bullet_player_hitboxes");
-	RegisterEvent(bullet_player_hitboxes_kv);
-	static auto player_lag_hitboxes_kv = new KeyValues("player_lag_hitboxes");
-    RegisterEvent(player_lag_hitboxes_kv);
+
+	// the hitbox events are fired per player per bullet, declare their keys so they
+	// get compiled into slots and the per bone data goes into arrays
+	static const char *s_PlayerHitboxEventKeys[][2] =
+	{
+		{ "userid", "short" },
+		{ "player_index", "short" },
+		{ "tickbase", "long" },
+		{ "bullet", "short" },
+		{ "simtime", "float" },
+		{ "animtime", "float" },
+		{ "position_x", "float" },
+		{ "position_y", "float" },
+		{ "position_z", "float" },
+		{ "angle_x", "float" },
+		{ "angle_y", "float" },
+		{ "angle_z", "float" },
+		{ "cycle", "float" },
+		{ "sequence", "long" },
+		{ "hitbox_indexes", "long_array" },
+		{ "hitbox_positions", "float_array" },	// x, y, z per hitbox
+		{ "hitbox_angles", "float_array" },		// x, y, z per hitbox
+		{ "pose_params", "float_array" },
+		{ "bone_controllers", "float_array" },
+		{ "anim_overlay_cycles", "float_array" },
+		{ "anim_overlay_sequences", "long_array" },
+		{ "anim_overlay_weights", "float_array" },
+		{ "anim_overlay_orders", "long_array" },
+		{ "anim_overlay_flags", "long_array" },
+	};
+
+	static const char *s_PlayerHitboxEvents[] = { "bullet_hit_player", "bullet_player_hitboxes", "player_lag_hitboxes" };
+
+	for ( int i = 0; i < (int)ARRAYSIZE( s_PlayerHitboxEvents ); i++ )
+	{
+		KeyValues *pEvent = new KeyValues( s_PlayerHitboxEvents[i] );
+		KeyValues::AutoDelete autodelete_event( pEvent );
+
+		for ( int j = 0; j < (int)ARRAYSIZE( s_PlayerHitboxEventKeys ); j++ )
+		{
+			pEvent->SetString( s_PlayerHitboxEventKeys[j][0], s_PlayerHitboxEventKeys[j][1] );
+		}
+
+		RegisterEvent( pEvent );
+	}
     
 	return true;
 }
@@ -151,6 +646,10 @@ bool CGameEventManager::Init()
 void CGameEventManager::Shutdown()
 {
 	Reset();
+
+	AUTO_LOCK( m_EventPoolMutex );
+	m_EventPool.PurgeAndDeleteElements();
+	m_SerializeBuffer.Purge();
 }
 
 void CGameEventManager::Reset()
@@ -170,11 +669,14 @@ void CGameEventManager::Reset()
 		e.listeners.Purge();	// remove listeners
 	}
 
+	DiscardClientEvents();
+
 	m_GameEvents.Purge();
 	m_Listeners.PurgeAndDeleteElements();
 	m_EventFiles.RemoveAll();
 	m_EventFileNames.RemoveAll();
 	m_bClientListenersChanged = true;
+	m_bLegacyEventFormat = false;
 	
 	Assert( m_GameEvents.Count() == 0 );
 }
@@ -216,23 +718,32 @@ void CGameEventManager::WriteEventList(SVC_GameEventList *msg)
 
 			if ( type != TYPE_LOCAL )
 			{
-				msg->m_DataOut.WriteUBitLong( type, 3 );
+				msg->m_DataOut.WriteUBitLong( type, EVENT_TYPE_BITS );
 				msg->m_DataOut.WriteString( key->GetName() );
 			}
 
 			key = key->GetNextKey();
 		}
 
-		msg->m_DataOut.WriteUBitLong( TYPE_LOCAL, 3 ); // end marker
+		msg->m_DataOut.WriteUBitLong( TYPE_LOCAL, EVENT_TYPE_BITS ); // end marker
 	
 		msg->m_nNumEvents++;
 	}
 }
 
-bool CGameEventManager::ParseEventList(SVC_GameEventList *msg)
+bool CGameEventManager::IsLegacyEventFormat( int nProtocolVersion )
+{
+	return nProtocolVersion <= PROTOCOL_VERSION_25;
+}
+
+bool CGameEventManager::ParseEventList(SVC_GameEventList *msg, bool bRegisterUnknown)
 {
 	int i;
 
+	// old demos have 3 bit types and no key slots in their events
+	m_bLegacyEventFormat = msg->m_pMessageHandler && IsLegacyEventFormat( msg->m_pMessageHandler->GetDemoProtocolVersion() );
+	int nTypeBits = m_bLegacyEventFormat ? EVENT_TYPE_BITS_LEGACY : EVENT_TYPE_BITS;
+
 	// reset eventids to -1 first
 	for ( i=0; i < m_GameEvents.Count(); i++ )
 	{
@@ -249,10 +760,16 @@ bool CGameEventManager::ParseEventList(SVC_GameEventList *msg)
         		
 		CGameEventDescriptor *descriptor = GetEventDescriptor( name );
 
+		if ( !descriptor && bRegisterUnknown && m_GameEvents.Count() < MAX_EVENT_NUMBER )
+		{
+			descriptor = &m_GameEvents[ m_GameEvents.AddToTail() ];
+			Q_strncpy( descriptor->name, name, MAX_EVENT_NAME_LENGTH );
+		}
+
 		if ( !descriptor )
 		{
 			// event unknown to client, skip data
-			while ( msg->m_DataIn.ReadUBitLong( 3 ) )
+			while ( msg->m_DataIn.ReadUBitLong( nTypeBits ) )
 				msg->m_DataIn.ReadString( name, sizeof(name) );
 
 			continue;
@@ -264,16 +781,18 @@ bool CGameEventManager::ParseEventList(SVC_GameEventList *msg)
 
 		descriptor->keys = new KeyValues("descriptor");
 
-		int datatype = msg->m_DataIn.ReadUBitLong( 3 );
+		int datatype = msg->m_DataIn.ReadUBitLong( nTypeBits );
 
 		while ( datatype != TYPE_LOCAL )
 		{
 			msg->m_DataIn.ReadString( name, sizeof(name) );
-			descriptor->keys->SetInt( name, datatype );
+			descriptor->keys->SetInt( name, datatype < TYPE_COUNT ? datatype : TYPE_LOCAL );
 
-			datatype = msg->m_DataIn.ReadUBitLong( 3 );
+			datatype = msg->m_DataIn.ReadUBitLong( nTypeBits );
 		}
 
+		CompileEventKeys( descriptor );
+
 		descriptor->eventid = id;
 	}
 
@@ -322,6 +841,24 @@ void CGameEventManager::WriteListenEventList(CLC_ListenEvents *msg)
 
 IGameEvent *CGameEventManager::CreateEvent( CGameEventDescriptor *descriptor )
 {
+	CGameEvent *event = NULL;
+
+	{
+		AUTO_LOCK( m_EventPoolMutex );
+
+		if ( m_EventPool.Count() )
+		{
+			event = m_EventPool.Tail();
+			m_EventPool.RemoveMultipleFromTail( 1 );
+		}
+	}
+
+	if ( event )
+	{
+		event->Init( descriptor );
+		return event;
+	}
+
 	return new CGameEvent ( descriptor );
 }
 
@@ -346,7 +883,7 @@ IGameEvent *CGameEventManager::CreateEvent( const char *name, bool bForce )
 	}
 
 	// create & return the new event 
-	return new CGameEvent ( descriptor );
+	return CreateEvent( descriptor );
 }
 
 bool CGameEventManager::FireEvent( IGameEvent *event, bool bServerOnly )
@@ -366,14 +903,10 @@ IGameEvent *CGameEventManager::DuplicateEvent( IGameEvent *event )
 	if ( !gameEvent )
 		return NULL;
 
-	// create new instance
-	CGameEvent *newEvent = new CGameEvent ( gameEvent->m_pDescriptor );
+	// create new instance and copy values
+	CGameEvent *newEvent = static_cast<CGameEvent*>( CreateEvent( gameEvent->m_pDescriptor ) );
 
-	// free keys
-	newEvent->m_pDataKeys->deleteThis();
-
-	// and make copy
-	newEvent->m_pDataKeys = gameEvent->m_pDataKeys->MakeCopy();
+	newEvent->CopyFrom( gameEvent );
 
 	return newEvent;
 }
@@ -397,6 +930,7 @@ void CGameEventManager::ConPrintEvent( IGameEvent *event)
 		{
 		case KeyValues::types_t::TYPE_STRING : ConMsg( "- \"%s\" = \"%s\"\n", keyName, event->GetString(keyName) ); break;
 		case KeyValues::types_t::TYPE_FLOAT : ConMsg( "- \"%s\" = \"%.2f\"\n", keyName, event->GetFloat(keyName) ); break;
+		case KeyValues::types_t::TYPE_NONE : ConMsg( "- \"%s\" = array\n", keyName ); break;
 		default: ConMsg( "- \"%s\" = \"%i\"\n", keyName, event->GetInt(keyName) ); break;
 		}
 		key = key->GetNextKey();
@@ -424,6 +958,11 @@ bool CGameEventManager::FireEventIntern( IGameEvent *event, bool bServerOnly, bo
 
 	tmZoneFiltered( TELEMETRY_LEVEL0, 50, TMZF_NONE, "%s (name: %s listeners: %d)", __FUNCTION__, tmDynamicString( TELEMETRY_LEVEL0, event->GetName() ), descriptor->listeners.Count() );
 
+	descriptor->numFired++;
+
+	// client stubs get the event serialized once after the other listeners ran
+	CUtlVectorFixedGrowable<IGameEventClientStub*, 64> stubs;
+
 	// show game events in console
 	if ( net_showevents.GetInt() > 0 )
 	{
@@ -461,7 +1000,11 @@ bool CGameEventManager::FireEventIntern( IGameEvent *event, bool bServerOnly, bo
 		if ( listener->m_nListenerType == CLIENTSTUB && (bServerOnly || bClientOnly) )
 			continue;
 
-		// TODO optimized the serialize event for clients, call only once and not per client
+		if ( listener->m_nListenerType == CLIENTSTUB && listener->m_pStub )
+		{
+			stubs.AddToTail( listener->m_pStub );
+			continue;
+		}
 
 		// fire event in this listener module
 		if ( listener->m_nListenerType == CLIENTSIDE_OLD ||
@@ -471,9 +1014,8 @@ bool CGameEventManager::FireEventIntern( IGameEvent *event, bool bServerOnly, bo
 
 			// legacy support for old system
 			IGameEventListener *pCallback = static_cast<IGameEventListener*>(listener->m_pCallback);
-			CGameEvent *pEvent = static_cast<CGameEvent*>(event);
 
-			pCallback->FireGameEvent( pEvent->m_pDataKeys );
+			pCallback->FireGameEvent( event->GetDataKeys() );
 		}
 		else
 		{
@@ -486,6 +1028,11 @@ bool CGameEventManager::FireEventIntern( IGameEvent *event, bool bServerOnly, bo
 		}	 
 	}
 
+	if ( stubs.Count() )
+	{
+		SendEventToStubs( event, descriptor, stubs.Base(), stubs.Count() );
+	}
+
 	// free event resources
 	FreeEvent( event );
 
@@ -497,19 +1044,67 @@ bool CGameEventManager::SerializeEvent( IGameEvent *event, bf_write* buf )
 	CGameEventDescriptor *descriptor = GetEventDescriptor( event );
 
 	Assert( descriptor );
+
+	CGameEvent *gameEvent = static_cast<CGameEvent*>( event );
     
 	buf->WriteUBitLong( descriptor->eventid, MAX_EVENT_BITS );
 
-    // TODO_ENHANCED: this now gets directly from event keys,
-    // because they can be different (bullet_impact), or not enumerated at all. (bullet_hit_player)
-
-	KeyValues * key = event->GetDataKeys()->GetFirstSubKey();
-
 	if ( net_showevents.GetInt() > 2 )
 	{
 		DevMsg("Serializing event '%s' (%i):\n", descriptor->name, descriptor->eventid );
 	}
 
+	// declared keys, in slot order: a set bit followed by the value
+	for ( int i = 0; i < descriptor->slots.Count(); i++ )
+	{
+		const GameEventSlot_t &slot = descriptor->slots[i];
+
+		if ( !gameEvent->IsSlotSet( i ) )
+		{
+			buf->WriteOneBit( 0 );
+			continue;
+		}
+
+		buf->WriteOneBit( 1 );
+
+		if ( net_showevents.GetInt() > 2 )
+		{
+			DevMsg(" - %s (%s)\n", slot.name, s_GameEnventTypeMap[slot.type] );
+		}
+
+		// see s_GameEnventTypeMap for index
+		switch ( slot.type )
+		{
+			case TYPE_STRING: buf->WriteString( gameEvent->GetStringBySlot( i ) ); break;
+			case TYPE_FLOAT	: buf->WriteFloat( gameEvent->GetFloatBySlot( i ) ); break;
+			case TYPE_LONG	: buf->WriteLong( gameEvent->GetIntBySlot( i ) ); break;
+			case TYPE_SHORT	: buf->WriteShort( gameEvent->GetIntBySlot( i ) ); break;
+			case TYPE_BYTE	: buf->WriteByte( gameEvent->GetIntBySlot( i ) ); break;
+			case TYPE_BOOL	: buf->WriteOneBit( gameEvent->GetIntBySlot( i ) ); break;
+			case TYPE_FLOAT_ARRAY :
+			case TYPE_LONG_ARRAY :
+				{
+					// both are 32 bit, copy them raw
+					int count = gameEvent->GetArrayBySlot( i, NULL, 0, false );
+					CUtlVectorFixedGrowable<int, 256> values;
+					values.SetCount( count );
+					gameEvent->GetArrayBySlot( i, values.Base(), count, slot.type == TYPE_FLOAT_ARRAY );
+
+					buf->WriteVarInt32( count );
+					buf->WriteBits( values.Base(), count * 32 );
+					break;
+				}
+			default: DevMsg(1, "CGameEventManager::SerializeEvent: unknown type %i for key '%s'.\n", slot.type, slot.name ); break;
+		}
+	}
+
+	// keys that aren't declared, these carry their name and type
+
+    // TODO_ENHANCED: events like bullet_impact don't enumerate their keys at all.
+
+	KeyValues *extraKeys = gameEvent->GetExtraKeys( false );
+	KeyValues *key = extraKeys ? extraKeys->GetFirstSubKey() : NULL;
+
     uint32 keyCount = 0;
     while ( key )
     {
@@ -519,7 +1114,7 @@ bool CGameEventManager::SerializeEvent( IGameEvent *event, bf_write* buf )
 
     buf->WriteVarInt32(keyCount);
 
-    key = event->GetDataKeys()->GetFirstSubKey();
+    key = extraKeys ? extraKeys->GetFirstSubKey() : NULL;
     
 	while ( key )
 	{
@@ -535,15 +1130,11 @@ bool CGameEventManager::SerializeEvent( IGameEvent *event, bf_write* buf )
         buf->WriteString(keyName);
         buf->WriteByte(type);
 
-		//Make sure every key is used in the event
-		// Assert( event->FindKey(keyName) && "GameEvent field not found in passed KeyValues" );
-
-		// see s_GameEnventTypeMap for index
 		switch ( type )
 		{
-			case KeyValues::types_t::TYPE_STRING : buf->WriteString( event->GetString( keyName, "") ); break;
-			case KeyValues::types_t::TYPE_FLOAT  : buf->WriteFloat( event->GetFloat( keyName, 0.0f) ); break;
-			case KeyValues::types_t::TYPE_INT	 : buf->WriteLong( event->GetInt( keyName, 0) ); break;
+			case KeyValues::types_t::TYPE_STRING : buf->WriteString( key->GetString() ); break;
+			case KeyValues::types_t::TYPE_FLOAT  : buf->WriteFloat( key->GetFloat() ); break;
+			case KeyValues::types_t::TYPE_INT	 : buf->WriteLong( key->GetInt() ); break;
 			default: DevMsg(1, "CGameEventManager::SerializeEvent: can't serialize type %i yet for key '%s'.\n", type, keyName ); break;
 		}
 
@@ -571,7 +1162,7 @@ IGameEvent *CGameEventManager::UnserializeEvent( bf_read *buf)
 	}
 
 	// create new event
-	IGameEvent *event = CreateEvent( descriptor );
+	CGameEvent *event = static_cast<CGameEvent*>( CreateEvent( descriptor ) );
 
 	if ( !event )
 	{
@@ -579,10 +1170,55 @@ IGameEvent *CGameEventManager::UnserializeEvent( bf_read *buf)
 		return NULL;
 	}
 
-	KeyValues * key = event->GetDataKeys()->GetFirstSubKey();
+	// old events send all keys by name below, SetInt() etc. still route them to their slots
+	int numSlots = m_bLegacyEventFormat ? 0 : descriptor->slots.Count();
+
+	for ( int i = 0; i < numSlots; i++ )
+	{
+		if ( !buf->ReadOneBit() )
+			continue;
+
+		int type = descriptor->slots[i].type;
+
+		switch ( type )
+		{
+			case TYPE_STRING:
+				if ( buf->ReadString( databuf, sizeof(databuf) ) )
+				{
+					event->SetStringBySlot( i, databuf );
+				}
+				break;
+			case TYPE_FLOAT	: event->SetFloatBySlot( i, buf->ReadFloat() ); break;
+			case TYPE_LONG	: event->SetIntBySlot( i, buf->ReadLong() ); break;
+			case TYPE_SHORT	: event->SetIntBySlot( i, buf->ReadShort() ); break;
+			case TYPE_BYTE	: event->SetIntBySlot( i, buf->ReadByte() ); break;
+			case TYPE_BOOL	: event->SetIntBySlot( i, buf->ReadOneBit() ); break;
+			case TYPE_FLOAT_ARRAY :
+			case TYPE_LONG_ARRAY :
+				{
+					uint32 count = buf->ReadVarInt32();
+
+					if ( (int64)count * 32 > buf->GetNumBitsLeft() )
+					{
+						DevMsg( "CGameEventManager::UnserializeEvent: array '%s' overflows the message.\n", descriptor->slots[i].name );
+						FreeEvent( event );
+						return NULL;
+					}
+
+					CUtlVectorFixedGrowable<int, 256> values;
+					values.SetCount( count );
+					buf->ReadBits( values.Base(), count * 32 );
+
+					event->SetArrayBySlot( i, values.Base(), count, type == TYPE_FLOAT_ARRAY );
+					break;
+				}
+			default: DevMsg(1, "CGameEventManager::UnserializeEvent: unknown type %i for key '%s'.\n", type, descriptor->slots[i].name ); break;
+		}
+	}
+
 	uint32 keyCount = buf->ReadVarInt32(); 
 
-	while ( keyCount > 0 )
+	while ( keyCount > 0 && !buf->IsOverflowed() )
     {
         char keyName[256];
 		buf->ReadString(keyName, sizeof(keyName));
@@ -664,6 +1300,16 @@ void CGameEventManager::RemoveListener(IGameEventListener2 *listener)
 		m_bClientListenersChanged = true;
 	}
 
+	// don't send queued events to a stub that is going away
+	if ( pCallback->m_pStub )
+	{
+		for ( int i = 0; i < m_QueuedEventStubs.Count(); i++ )
+		{
+			if ( m_QueuedEventStubs[i] == pCallback->m_pStub )
+				m_QueuedEventStubs[i] = NULL;
+		}
+	}
+
 	delete pCallback;
 }
 
@@ -704,6 +1350,9 @@ int CGameEventManager::LoadEventsFromFile( const char * filename )
 
 void CGameEventManager::ReloadEventDefinitions()
 {
+	// event ids are reassigned, queued events can't be sent anymore
+	DiscardClientEvents();
+
 	for ( int i=0; i< m_EventFileNames.Count(); i++ )
 	{
 		const char *filename = m_EventFiles.String( m_EventFileNames[i] );
@@ -752,6 +1401,7 @@ bool CGameEventManager::AddListener( void *listener, CGameEventDescriptor *descr
 
 		pCallback->m_nListenerType = nListenerType;
 		pCallback->m_pCallback = listener;
+		pCallback->m_pStub = NULL;
 	}
 	else
 	{
@@ -829,7 +1479,7 @@ bool CGameEventManager::RegisterEvent( KeyValues * event)
 		{
 			int i;
 
-			for (i = TYPE_LOCAL; i <= TYPE_BOOL; i++  )
+			for (i = TYPE_LOCAL; i < TYPE_COUNT; i++  )
 			{
 				if ( !Q_strcmp( type, s_GameEnventTypeMap[i]) )
 				{
@@ -839,7 +1489,7 @@ bool CGameEventManager::RegisterEvent( KeyValues * event)
 				}
 			}
 
-			if ( i > TYPE_BOOL )
+			if ( i >= TYPE_COUNT )
 			{
 				descriptor->keys->SetInt( keyName, 0 );	// unknown
 				DevMsg( "CGameEventManager:: unknown type '%s' for key '%s'.\n", type, subkey->GetName() );
@@ -848,10 +1498,61 @@ bool CGameEventManager::RegisterEvent( KeyValues * event)
 		
 		subkey = subkey->GetNextKey();
 	}
+
+	CompileEventKeys( descriptor );
 	
 	return true;
 }
 
+void CGameEventManager::CompileEventKeys( CGameEventDescriptor *descriptor )
+{
+	descriptor->slots.RemoveAll();
+	descriptor->slotIndex.RemoveAll();
+
+	if ( !descriptor->keys )
+		return;
+
+	// local keys aren't part of the network schema, they're stored like undeclared ones
+	for ( KeyValues *key = descriptor->keys->GetFirstSubKey(); key; key = key->GetNextKey() )
+	{
+		int type = key->GetInt();
+
+		if ( type == TYPE_LOCAL )
+			continue;
+
+		GameEventSlot_t &slot = descriptor->slots[ descriptor->slots.AddToTail() ];
+		slot.name = key->GetName();
+		slot.type = type;
+		slot.hash = HashStringCaseless( slot.name );
+	}
+
+	if ( !descriptor->slots.Count() )
+		return;
+
+	// hash index for FindSlot, which SetInt() etc. call with the key name
+	int size = 4;
+	while ( size < descriptor->slots.Count() * 2 )
+	{
+		size <<= 1;
+	}
+
+	descriptor->slotIndex.SetCount( size );
+	for ( int i = 0; i < size; i++ )
+	{
+		descriptor->slotIndex[i] = -1;
+	}
+
+	for ( int iSlot = 0; iSlot < descriptor->slots.Count(); iSlot++ )
+	{
+		int i = descriptor->slots[iSlot].hash & ( size - 1 );
+		while ( descriptor->slotIndex[i] >= 0 )
+		{
+			i = ( i + 1 ) & ( size - 1 );
+		}
+		descriptor->slotIndex[i] = iSlot;
+	}
+}
+
 CGameEventDescriptor *CGameEventManager::GetEventDescriptor(IGameEvent *event)
 {
 	CGameEvent *gameevent = dynamic_cast<CGameEvent*>(event);
@@ -883,6 +1584,21 @@ void CGameEventManager::FreeEvent( IGameEvent *event )
 	if ( !event )
 		return;
 
+	CGameEvent *gameEvent = dynamic_cast<CGameEvent*>( event );
+
+	if ( gameEvent )
+	{
+		gameEvent->Release();
+
+		AUTO_LOCK( m_EventPoolMutex );
+
+		if ( m_EventPool.Count() < MAX_POOLED_EVENTS )
+		{
+			m_EventPool.AddToTail( gameEvent );
+			return;
+		}
+	}
+
 	delete event;
 }
 
@@ -946,3 +1662,138 @@ void CGameEventManager::RemoveListenerOld( void *listener)
 
 	delete pCallback;
 }
+
+bool CGameEventManager::AddClientStub( IGameEventListener2 *listener, IGameEventClientStub *stub, CGameEventDescriptor *descriptor )
+{
+	if ( !AddListener( listener, descriptor, CLIENTSTUB ) )
+		return false;
+
+	CGameEventCallback *pCallback = FindEventListener( listener );
+	Assert( pCallback && pCallback->m_nListenerType == CLIENTSTUB );
+
+	pCallback->m_pStub = stub;
+
+	return true;
+}
+
+void CGameEventManager::SendEventToStubs( IGameEvent *event, CGameEventDescriptor *descriptor, IGameEventClientStub **stubs, int numStubs )
+{
+	VPROF_BUDGET( "CGameEventManager::SendEventToStubs", VPROF_BUDGETGROUP_OTHER_NETWORKING );
+
+	m_SerializeBuffer.EnsureCapacity( MAX_EVENT_BYTES );
+
+	bf_write buf( "CGameEventManager::SendEventToStubs", m_SerializeBuffer.Base(), m_SerializeBuffer.Count() );
+
+	if ( !SerializeEvent( event, &buf ) )
+	{
+		DevMsg( "GameEventManager: failed to serialize event '%s'.\n", event->GetName() );
+		return;
+	}
+
+	int nBits = buf.GetNumBitsWritten();
+
+	descriptor->numSent += numStubs;
+	descriptor->numBits += nBits;
+	descriptor->numBitsSent += (int64)nBits * numStubs;
+
+	if ( sv_batch_gameevents.GetBool() )
+	{
+		// the queue isn't locked, events for clients are fired from the server frame
+		Assert( ThreadInMainThread() );
+
+		QueuedEvent_t &queued = m_QueuedEvents[ m_QueuedEvents.AddToTail() ];
+
+		queued.nDataOffset = m_QueuedEventData.Count();
+		queued.nBits = nBits;
+		queued.nFirstStub = m_QueuedEventStubs.Count();
+		queued.nStubs = numStubs;
+
+		m_QueuedEventData.AddMultipleToTail( buf.GetNumBytesWritten(), buf.GetBasePointer() );
+		m_QueuedEventStubs.AddMultipleToTail( numStubs, stubs );
+		return;
+	}
+
+	SVC_GameEvent eventMsg;
+	eventMsg.m_DataOut.StartWriting( m_SerializeBuffer.Base(), m_SerializeBuffer.Count(), nBits );
+
+	for ( int i = 0; i < numStubs; i++ )
+	{
+		stubs[i]->SendGameEvent( eventMsg );
+	}
+}
+
+void CGameEventManager::FlushClientEvents()
+{
+	if ( !m_QueuedEvents.Count() )
+		return;
+
+	VPROF_BUDGET( "CGameEventManager::FlushClientEvents", VPROF_BUDGETGROUP_OTHER_NETWORKING );
+
+	Assert( ThreadInMainThread() );
+
+	for ( int i = 0; i < m_QueuedEvents.Count(); i++ )
+	{
+		const QueuedEvent_t &queued = m_QueuedEvents[i];
+
+		SVC_GameEvent eventMsg;
+		eventMsg.m_DataOut.StartWriting( &m_QueuedEventData[queued.nDataOffset], PAD_NUMBER( queued.nBits, 8 ) / 8, queued.nBits );
+
+		for ( int j = 0; j < queued.nStubs; j++ )
+		{
+			IGameEventClientStub *stub = m_QueuedEventStubs[queued.nFirstStub + j];
+
+			if ( stub )
+				stub->SendGameEvent( eventMsg );
+		}
+	}
+
+	DiscardClientEvents();
+}
+
+void CGameEventManager::DiscardClientEvents()
+{
+	m_QueuedEvents.RemoveAll();
+	m_QueuedEventData.RemoveAll();
+	m_QueuedEventStubs.RemoveAll();
+}
+
+void CGameEventManager::PrintEventStats( bool bReset )
+{
+	CUtlVector<CGameEventDescriptor*> sorted;
+
+	for ( int i = 0; i < m_GameEvents.Count(); i++ )
+	{
+		if ( m_GameEvents[i].numFired )
+			sorted.AddToTail( &m_GameEvents[i] );
+	}
+
+	struct Sort_t
+	{
+		static int Compare( CGameEventDescriptor * const *a, CGameEventDescriptor * const *b )
+		{
+			return (*b)->numFired - (*a)->numFired;
+		}
+	};
+
+	sorted.Sort( Sort_t::Compare );
+
+	ConMsg( "%-32s %10s %10s %12s %12s\n", "event", "fired", "sent", "bytes", "bytes sent" );
+
+	for ( int i = 0; i < sorted.Count(); i++ )
+	{
+		CGameEventDescriptor *descriptor = sorted[i];
+
+		ConMsg( "%-32s %10d %10d %12lld %12lld\n", descriptor->name, descriptor->numFired, descriptor->numSent,
+			( descriptor->numBits + 7 ) / 8, ( descriptor->numBitsSent + 7 ) / 8 );
+
+		if ( bReset )
+		{
+			descriptor->numFired = 0;
+			descriptor->numSent = 0;
+			descriptor->numBits = 0;
+			descriptor->numBitsSent = 0;
+		}
+	}
+
+	ConMsg( "%d event types fired, %d events pooled, %d queued\n", sorted.Count(), m_EventPool.Count(), m_QueuedEvents.Count() );
+}
@@ -18,15 +18,34 @@
 #include <KeyValues.h>
 #include <networkstringtabledefs.h>
 #include <utlsymbol.h>
+#include "tier0/threadtools.h"
 
+class SVC_GameEvent;
 class SVC_GameEventList;
 class CLC_ListenEvents;
 
+// Server side stub of a remote listener (client, SourceTV) that takes events
+// already serialized, so an event is only serialized once for all of them
+abstract_class IGameEventClientStub
+{
+public:
+	virtual void SendGameEvent( SVC_GameEvent &eventMsg ) = 0;
+};
+
 class CGameEventCallback
 {
 public:
 	void				*m_pCallback;		// callback pointer
 	int					m_nListenerType;	// client or server side ?
+	IGameEventClientStub *m_pStub;			// CLIENTSTUB listeners that take serialized events
+};
+
+// A declared event key compiled into a value slot
+struct GameEventSlot_t
+{
+	const char	*name;		// points into the descriptor keys
+	int			type;		// CGameEventManager::TYPE_*
+	unsigned int hash;		// HashStringCaseless( name )
 };
 
 class CGameEventDescriptor
@@ -39,6 +58,10 @@ public:
 		keys = NULL;
 		local = false;
 		reliable = true;
+		numFired = 0;
+		numSent = 0;
+		numBits = 0;
+		numBitsSent = 0;
 	}
 
 public:
@@ -48,6 +71,28 @@ public:
 	bool		local;		// local event, never tell clients about that
 	bool		reliable;	// send this event as reliable message
     CUtlVector<CGameEventCallback*>	listeners;	// registered listeners
+	CUtlVector<GameEventSlot_t>		slots;		// networked keys in wire order, built from keys
+	CUtlVector<short>				slotIndex;	// open addressing hash of slots by name, -1 = empty
+
+	// net_eventstats counters
+	int			numFired;	// times fired
+	int			numSent;	// messages sent to client stubs
+	int64		numBits;	// serialized size, counted once per event
+	int64		numBitsSent;	// serialized size times receivers
+
+	int FindSlot( const char *keyName ) const;
+};
+
+// Value of a slot, arrays and strings live in the event payload
+struct GameEventValue_t
+{
+	union
+	{
+		int		m_nValue;
+		float	m_flValue;
+		int		m_nOffset;	// payload offset of strings and arrays
+	};
+	int			m_nCount;	// -1 if unset, number of elements for arrays
 };
 
 class CGameEvent : public IGameEvent
@@ -57,6 +102,9 @@ public:
 	CGameEvent( CGameEventDescriptor *descriptor );
 	virtual ~CGameEvent();
 
+	void Init( CGameEventDescriptor *descriptor );
+	void Release();		// frees values before the event goes back into the pool
+
 	const char *GetName() const;
 	bool  IsEmpty(const char *keyName = NULL);
 	bool  IsLocal() const;
@@ -72,9 +120,40 @@ public:
 	void SetFloat( const char *keyName, float value );
 	void SetString( const char *keyName, const char *value );
 	KeyValues* GetDataKeys();
+
+	void SetFloatArray( const char *keyName, const float *values, int count );
+	void SetIntArray( const char *keyName, const int *values, int count );
+	int  GetFloatArray( const char *keyName, float *values, int maxCount );
+	int  GetIntArray( const char *keyName, int *values, int maxCount );
+
+	int   GetKeySlot( const char *keyName ) const;
+	int   GetIntBySlot( int slot, int defaultValue = 0 );
+	float GetFloatBySlot( int slot, float defaultValue = 0.0f );
+	void  SetIntBySlot( int slot, int value );
+	void  SetFloatBySlot( int slot, float value );
+
+	const char *GetStringBySlot( int slot, const char *defaultValue = "" );
+	void  SetStringBySlot( int slot, const char *value );
+	void  SetArrayBySlot( int slot, const void *values, int count, bool bFloat );
+	int	  GetArrayBySlot( int slot, void *values, int maxCount, bool bFloat );
+	bool  IsSlotSet( int slot ) const { return m_Values[slot].m_nCount >= 0; }
+
+	void  CopyFrom( const CGameEvent *pOther );
+	void  SetDataKeys( KeyValues *keys );		// takes ownership
+	KeyValues *GetExtraKeys( bool bCreate );	// keys that aren't declared by the descriptor
 	
 	CGameEventDescriptor	*m_pDescriptor;
-	KeyValues				*m_pDataKeys;
+
+private:
+	bool  IsValidSlot( int slot ) const { return slot >= 0 && slot < m_Values.Count(); }
+	int   AllocPayload( int nBytes );
+
+	CUtlVectorFixedGrowable<GameEventValue_t, 32>	m_Values;	// one per descriptor slot
+	CUtlVectorFixedGrowable<byte, 512>				m_Payload;	// string and array data
+	KeyValues				*m_pExtraKeys;
+	KeyValues				*m_pDataKeys;		// built on demand for GetDataKeys()
+	bool					m_bDataKeysDirty;
+	char					m_szConvert[32];	// GetString() of a numeric slot
 };
 
 class CGameEventManager : public IGameEventManager2
@@ -100,9 +179,22 @@ public:	// IGameEventManager functions
 		TYPE_LONG,		// signed int 32 bit
 		TYPE_SHORT,		// signed int 16 bit
 		TYPE_BYTE,		// unsigned int 8 bit
-		TYPE_BOOL		// unsigned int 1 bit
+		TYPE_BOOL,		// unsigned int 1 bit
+		TYPE_FLOAT_ARRAY,	// varint count + float 32 bit values
+		TYPE_LONG_ARRAY,	// varint count + signed int 32 bit values
+
+		TYPE_COUNT
 	};
 
+	enum
+	{
+		EVENT_TYPE_BITS = 4,		// bits needed for a TYPE_* in the event list
+		EVENT_TYPE_BITS_LEGACY = 3	// up to PROTOCOL_VERSION_25, see IsLegacyEventFormat
+	};
+
+	// events written up to PROTOCOL_VERSION_25 have 3 bit key types and send every key by name
+	static bool IsLegacyEventFormat( int nProtocolVersion );
+
 	CGameEventManager();
 	virtual ~CGameEventManager();
 	
@@ -133,7 +225,7 @@ public:
 	CGameEventDescriptor *GetEventDescriptor( int eventid );
 
 	void WriteEventList(SVC_GameEventList *msg);
-	bool ParseEventList(SVC_GameEventList *msg);
+	bool ParseEventList(SVC_GameEventList *msg, bool bRegisterUnknown = false);	// bRegisterUnknown adds events that weren't loaded from a file
 
 	void WriteListenEventList(CLC_ListenEvents *msg);
 	bool HasClientListenersChanged( bool bReset = true );
@@ -142,13 +234,23 @@ public:
 	// legacy support 
 	bool AddListenerAll( void *listener, int nListenerType );
 	void RemoveListenerOld( void *listener);
+
+	bool AddClientStub( IGameEventListener2 *listener, IGameEventClientStub *stub, CGameEventDescriptor *descriptor );
+
+	// sends the events queued for client stubs since the last call, once per server frame
+	void FlushClientEvents();
+	void DiscardClientEvents();
+
+	void PrintEventStats( bool bReset );
 	
 	
 protected:
 
 	IGameEvent *CreateEvent( CGameEventDescriptor *descriptor );
+	void SendEventToStubs( IGameEvent *event, CGameEventDescriptor *descriptor, IGameEventClientStub **stubs, int numStubs );
 	bool RegisterEvent( KeyValues * keys );
 	void UnregisterEvent(int index);
+	void CompileEventKeys( CGameEventDescriptor *descriptor );
 	bool FireEventIntern( IGameEvent *event, bool bServerSide, bool bClientOnly );
 	CGameEventCallback* FindEventListener( void* listener );
 	
@@ -158,6 +260,25 @@ protected:
 	CUtlVector<CUtlSymbol>				m_EventFileNames; 
 
 	bool	m_bClientListenersChanged;	// true every time client changed listeners
+	bool	m_bLegacyEventFormat;		// event list was parsed from an old demo, see IsLegacyEventFormat
+
+	// freed events are recycled instead of deleted
+	CUtlVector<CGameEvent*>				m_EventPool;
+	CThreadFastMutex					m_EventPoolMutex;
+
+	// events for client stubs, serialized once and sent by FlushClientEvents
+	struct QueuedEvent_t
+	{
+		int		nDataOffset;	// into m_QueuedEventData
+		int		nBits;
+		int		nFirstStub;		// into m_QueuedEventStubs
+		int		nStubs;
+	};
+
+	CUtlVector<QueuedEvent_t>			m_QueuedEvents;
+	CUtlVector<byte>					m_QueuedEventData;
+	CUtlVector<IGameEventClientStub*>	m_QueuedEventStubs;	// NULL once a stub was removed
+	CUtlMemory<byte>					m_SerializeBuffer;
 };
 
 extern CGameEventManager &g_GameEventManager;
@@ -670,6 +670,15 @@ void CBaseClient::FireGameEvent( IGameEvent *event )
 	}
 }
 
+void CBaseClient::SendGameEvent( SVC_GameEvent &eventMsg )
+{
+	if ( m_NetChannel )
+	{
+		if ( !m_NetChannel->SendNetMsg( eventMsg ) )
+			DevMsg("GameEventManager: failed to send event to %s.\n", GetClientName() );
+	}
+}
+
 bool CBaseClient::SendServerInfo( void )
 {
 	COM_TimestampedLog( " CBaseClient::SendServerInfo" );
@@ -1024,7 +1033,7 @@ bool CBaseClient::ProcessListenEvents( CLC_ListenEvents *msg )
 
 			if ( descriptor )
 			{
-				g_GameEventManager.AddListener( this, descriptor, CGameEventManager::CLIENTSTUB );
+				g_GameEventManager.AddClientStub( this, this, descriptor );
 			}
 			else
 			{
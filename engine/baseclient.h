@@ -19,6 +19,7 @@
 #include <KeyValues.h>
 #include <bitvec.h>
 #include <igameevents.h>
+#include "GameEventManager.h"
 #include "smartptr.h"
 #include "userid.h"
 #include "tier1/bitbuf.h"
@@ -58,7 +59,7 @@ public:
 };
 
 
-class CBaseClient : public IGameEventListener2, public IClient, public IClientMessageHandler
+class CBaseClient : public IGameEventListener2, public IClient, public IClientMessageHandler, public IGameEventClientStub
 {
 	typedef struct CustomFile_s
 	{
@@ -145,6 +146,9 @@ public: // IClientMessageHandlers
 public: // IGameEventListener
 	virtual void	FireGameEvent( IGameEvent *event );
 
+public: // IGameEventClientStub
+	virtual void	SendGameEvent( SVC_GameEvent &eventMsg );
+
 public:
 
 	virtual	bool	UpdateAcknowledgedFramecount(int tick);
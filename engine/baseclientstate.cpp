@@ -1365,49 +1365,9 @@ bool CBaseClientState::ProcessCreateStringTable( SVC_CreateStringTable *msg )
 
 	HookClientStringTable( msg->m_szTableName );
 
-	if ( msg->m_bDataCompressed )
-	{
-		unsigned int msgUncompressedSize = msg->m_DataIn.ReadLong();
-		unsigned int msgCompressedSize = msg->m_DataIn.ReadLong();
-		unsigned int uncompressedSize = msgUncompressedSize;
-		/// XXX(JohnS): 11/08/2016 - The PAD_NUMBER() call below was overflowing on UINT32_MAX-3 values.  Enforcing
-		//              resource-usage limits at this level is a lost cause without a massive overhaul, but clamp these
-		//              to somewhat reasonable ranges to prevent overflows with less-audited code in the engine.
-		bool bSuccess = false;
-		if ( msg->m_DataIn.TotalBytesAvailable() > 0 &&
-		     msgCompressedSize <= (unsigned int)msg->m_DataIn.TotalBytesAvailable() &&
-		     msgCompressedSize < UINT_MAX/2 &&
-		     msgUncompressedSize < UINT_MAX/2 )
-		{
-			// allocate buffer for uncompressed data, align to 4 bytes boundary
-			char *uncompressedBuffer = new char[PAD_NUMBER( msgUncompressedSize, 4 )];
-			char *compressedBuffer = new char[PAD_NUMBER( msgCompressedSize, 4 )];
-
-			msg->m_DataIn.ReadBits( compressedBuffer, msgCompressedSize * 8 );
-
-			// uncompress data
-			bSuccess = COM_BufferToBufferDecompress( uncompressedBuffer, &uncompressedSize, compressedBuffer, msgCompressedSize );
-			bSuccess &= ( uncompressedSize == msgUncompressedSize );
-
-			if ( bSuccess )
-			{
-				bf_read data( uncompressedBuffer, uncompressedSize );
-				table->ParseUpdate( data, msg->m_nNumEntries );
-			}
-
-			delete[] uncompressedBuffer;
-			delete[] compressedBuffer;
-		}
-
-		if ( !bSuccess )
-		{
-			Assert( false );
-			Warning("Malformed message in CBaseClientState::ProcessCreateStringTable\n");
-		}
-	}
-	else
+	if ( !table->ParseCreate( msg->m_DataIn, msg->m_nNumEntries, msg->m_bDataCompressed ) )
 	{
-		table->ParseUpdate( msg->m_DataIn, msg->m_nNumEntries );
+		Host_Error( "Malformed message in CBaseClientState::ProcessCreateStringTable\n" );
 	}
 
 #endif
@@ -1436,7 +1396,10 @@ bool CBaseClientState::ProcessUpdateStringTable( SVC_UpdateStringTable *msg )
 		CNetworkStringTable *table = (CNetworkStringTable*)
 			m_StringTableContainer->GetTable( msg->m_nTableID );
 
-		table->ParseUpdate( msg->m_DataIn, msg->m_nChangedEntries );
+		if ( !table->ParseUpdate( msg->m_DataIn, msg->m_nChangedEntries ) )
+		{
+			Host_Error( "Malformed message in CBaseClientState::ProcessUpdateStringTable\n" );
+		}
 	}
 	else
 	{
@@ -1496,10 +1459,8 @@ bool CBaseClientState::ProcessPacketEntities( SVC_PacketEntities *msg )
 	return true;
 }
 
-void CBaseClientState::ReadPacketEntities( CEntityReadInfo &u )
+void CL_ReadPacketEntities( CEntityReadInfo &u, IEntityReadHandler *pHandler )
 {
-	VPROF( "ReadPacketEntities" );
-
 	// Loop until there are no more entities to read
 	
 	u.NextOldEntity();
@@ -1524,16 +1485,16 @@ void CBaseClientState::ReadPacketEntities( CEntityReadInfo &u )
 			{
 				switch( u.m_UpdateType )
 				{
-					case EnterPVS:		ReadEnterPVS( u );
+					case EnterPVS:		pHandler->ReadEnterPVS( u );
 										break;
 
-					case LeavePVS:		ReadLeavePVS( u );
+					case LeavePVS:		pHandler->ReadLeavePVS( u );
 										break;
 
-					case DeltaEnt:		ReadDeltaEnt( u );
+					case DeltaEnt:		pHandler->ReadDeltaEnt( u );
 										break;
 
-					case PreserveEnt:	ReadPreserveEnt( u );
+					case PreserveEnt:	pHandler->ReadPreserveEnt( u );
 										break;
 
 					default:			DevMsg(1, "ReadPacketEntities: unknown updatetype %i\n", u.m_UpdateType );
@@ -1546,8 +1507,15 @@ void CBaseClientState::ReadPacketEntities( CEntityReadInfo &u )
 	// Now process explicit deletes 
 	if ( u.m_bAsDelta && u.m_UpdateType == Finished )
 	{
-		ReadDeletions( u );
+		pHandler->ReadDeletions( u );
 	}
+}
+
+void CBaseClientState::ReadPacketEntities( CEntityReadInfo &u )
+{
+	VPROF( "ReadPacketEntities" );
+
+	CL_ReadPacketEntities( u, this );
 
 	// Something didn't parse...
 	if ( u.m_pBuf->IsOverflowed() )							
@@ -62,8 +62,23 @@ class PackedEntity;
 class INetworkStringTable;
 class CEntityReadInfo;	
 
+// Receives the entities of a packet read by CL_ReadPacketEntities. A handler
+// stops the read by setting u.m_UpdateType to Failed.
+abstract_class IEntityReadHandler
+{
+public:
+	virtual void ReadEnterPVS( CEntityReadInfo &u ) = 0;
+	virtual void ReadLeavePVS( CEntityReadInfo &u ) = 0;
+	virtual void ReadDeltaEnt( CEntityReadInfo &u ) = 0;
+	virtual void ReadPreserveEnt( CEntityReadInfo &u ) = 0;
+	virtual void ReadDeletions( CEntityReadInfo &u ) = 0;
+};
 
-abstract_class CBaseClientState : public INetChannelHandler, public IConnectionlessPacketHandler, public IServerMessageHandler
+// Walks the entity headers of a packet and hands each entity to pHandler
+void CL_ReadPacketEntities( CEntityReadInfo &u, IEntityReadHandler *pHandler );
+
+
+abstract_class CBaseClientState : public INetChannelHandler, public IConnectionlessPacketHandler, public IServerMessageHandler, public IEntityReadHandler
 {
 	
 public:
@@ -158,12 +173,6 @@ public:
 	
 	void ReadPacketEntities( CEntityReadInfo &u );
 
-	virtual void ReadEnterPVS( CEntityReadInfo &u ) = 0;
-	virtual void ReadLeavePVS( CEntityReadInfo &u ) = 0;
-	virtual void ReadDeltaEnt( CEntityReadInfo &u ) = 0;
-	virtual void ReadPreserveEnt( CEntityReadInfo &u ) = 0;
-	virtual void ReadDeletions( CEntityReadInfo &u ) = 0;
-
 	bool IsClientConnectionViaMatchMaking( void );
 
 	static bool ConnectMethodAllowsRedirects( void );
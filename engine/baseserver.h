@@ -103,6 +103,7 @@ public: // IServer implementation
 	virtual void	DisconnectClient(IClient *client, const char *reason );
 	
 	virtual void	WriteDeltaEntities( CBaseClient *client, CClientFrame *to, CClientFrame *from,	bf_write &pBuf );
+	void			WriteDeltaEntities( CBaseClient *client, CClientFrame *to, CClientFrame *from,	bf_write &pBuf, int *pEnterPVSCount );
 	virtual void	WriteTempEntities( CBaseClient *client, CFrameSnapshot *to, CFrameSnapshot *from, bf_write &pBuf, int nMaxEnts );
 	
 public: // IConnectionlessPacketHandler implementation
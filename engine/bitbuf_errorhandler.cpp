@@ -8,6 +8,7 @@
 #include "bitbuf.h"
 #include "bitbuf_errorhandler.h"
 #include "tier0/dbg.h"
+#include "tier0/threadtools.h"
 #include "utlsymbol.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
@@ -22,6 +23,10 @@ void EngineBitBufErrorHandler( BitBufErrorType errorType, const char *pDebugName
 
 	static CUtlSymbolTable errorNames[ BITBUFERROR_NUM_ERRORS ];
 
+	// demo_analyze reads on worker threads
+	static CThreadFastMutex s_Mutex;
+	AUTO_LOCK( s_Mutex );
+
 	// Only print an error a couple times.
 	CUtlSymbol sym = errorNames[ errorType ].Find( pDebugName );
 	if ( UTL_INVAL_SYMBOL == sym )
@@ -45,6 +45,7 @@ static ConVar demo_quitafterplayback( "demo_quitafterplayback", "0", 0, "Quits g
 static ConVar demo_debug( "demo_debug", "0", 0, "Demo debug info." );
 static ConVar demo_interpolateview( "demo_interpolateview", "1", 0, "Do view interpolation during dem playback." );
 static ConVar demo_pauseatservertick( "demo_pauseatservertick", "0", 0, "Pauses demo playback at server tick" );
+static ConVar demo_usekeyframes( "demo_usekeyframes", "1", 0, "Jump to the nearest keyframe when skipping in demos that have them." );
 static ConVar timedemo_runcount( "timedemo_runcount", "0", 0, "Runs time demo X number of times." );
 
 // singeltons:
@@ -565,7 +566,7 @@ void CDemoRecorder::StartupDemoFile( void )
 		return;
 	}
 
-	if ( !m_DemoFile.Open( demoFileName, false ) )
+	if ( !m_DemoFile.Open( demoFileName, false, false, 0, true, demo_compress.GetBool() ) )
 		return;
 
 	// open demo header file containing sigondata
@@ -924,7 +925,12 @@ void CDemoPlayer::SkipToTick( int tick, bool bRelative, bool bPause )
 	if ( tick < 0 )
 		return;
 
-	if ( tick < GetPlaybackTick() )
+	if ( JumpToKeyframe( tick ) )
+	{
+		// skip on from the keyframe, the demo clock is set by its packet
+		tick |= SKIP_TO_TICK_FLAG;
+	}
+	else if ( tick < GetPlaybackTick() )
 	{
 		// we have to reload the whole demo file
 		// we need to create a temp copy of the filename
@@ -947,6 +953,58 @@ void CDemoPlayer::SkipToTick( int tick, bool bRelative, bool bPause )
 		PausePlayback( -1 );
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Moves the read position to the last keyframe at or before tick, 
+//			unless playing on from the current position gets there sooner
+// Output : true if playback continues from a keyframe
+//-----------------------------------------------------------------------------
+bool CDemoPlayer::JumpToKeyframe( int tick )
+{
+	const CUtlVector< demokeyframe_t > &keyframes = m_DemoFile.m_Keyframes;
+
+	// the keyframe is a full update, which needs a signed on client
+	if ( !demo_usekeyframes.GetBool() || !keyframes.Count() || !cl.IsActive() )
+		return false;
+
+	int iKeyframe = keyframes.Count() - 1;
+	while ( iKeyframe >= 0 && keyframes[iKeyframe].tick > tick )
+	{
+		iKeyframe--;
+	}
+
+	if ( iKeyframe < 0 )
+		return false;
+
+	int nPlaybackTick = GetPlaybackTick();
+	if ( tick >= nPlaybackTick && keyframes[iKeyframe].tick <= nPlaybackTick )
+		return false;
+
+	ETWMark1I( "DemoPlayer: JumpToKeyframe", keyframes[iKeyframe].tick );
+
+	m_DemoFile.SeekTo( keyframes[iKeyframe].keyframeOffset, true );
+	m_nPlayingKeyframe = iKeyframe;
+	m_bResetInterpolation = true;
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Keyframes are stored after dem_stop and only read after a jump. Once
+//			the keyframe jumped to is read, playback goes on at the packet after
+//			the one of its tick, which is delta compressed against the keyframe.
+//-----------------------------------------------------------------------------
+void CDemoPlayer::ReturnFromKeyframe( void )
+{
+	if ( m_nPlayingKeyframe < 0 )
+		return;
+
+	const demokeyframe_t &keyframe = m_DemoFile.m_Keyframes[ m_nPlayingKeyframe ];
+	if ( m_DemoFile.GetCurPos( true ) < keyframe.keyframeEndOffset )
+		return;
+
+	m_DemoFile.SeekTo( keyframe.frameOffset, true );
+	m_nPlayingKeyframe = -1;
+}
+
 void CDemoPlayer::SetEndTick( int tick )
 {
 	if ( tick < 0 )
@@ -1126,6 +1184,8 @@ netpacket_t *CDemoPlayer::ReadPacket( void )
 	
 	while ( !bStopReading )
 	{
+		ReturnFromKeyframe();
+
 		curpos = m_DemoFile.GetCurPos( true );
 
 		m_DemoFile.ReadCmdHeader( cmd, tick );
@@ -1304,6 +1364,12 @@ netpacket_t *CDemoPlayer::ReadPacket( void )
 				{
 					// adjust playback host_tickcount when skipping
 					m_nStartTick = host_tickcount - tick;
+
+					// after a jump to a keyframe the clock is right from its packet on
+					if ( m_nPlayingKeyframe >= 0 )
+					{
+						m_nSkipToTick &= ~SKIP_TO_TICK_FLAG;
+					}
 				}
 			}
 			break;
@@ -1626,6 +1692,7 @@ CDemoPlayer::CDemoPlayer()
 	m_bResetInterpolation = false;
 	m_nPreviousTick = 0;
 	m_nEndTick = 0;
+	m_nPlayingKeyframe = -1;
 }
 
 CDemoPlayer::~CDemoPlayer()
@@ -1672,6 +1739,9 @@ bool CDemoPlayer::StartPlayback( const char *filename, bool bAsTimeDemo )
 	
 	ConMsg ("Playing demo from %s.\n", filename);
 
+	m_DemoFile.ReadKeyframeIndex();
+	m_nPlayingKeyframe = -1;
+
 	// Now read in the directory structure.
 	m_bPlayingBack = true;
 	cl.m_nSignonState= SIGNONSTATE_CONNECTED;
@@ -2021,7 +2091,7 @@ void CL_ListDemo_f( const CCommand &args )
 		return;
 	}
 	
-	if ( Q_strcmp ( header->demofilestamp, DEMO_HEADER_ID ) )
+	if ( Q_strcmp ( header->demofilestamp, DEMO_HEADER_ID ) && Q_strcmp ( header->demofilestamp, DEMO_HEADER_ID_ZSTD ) )
 	{
 		ConMsg( "%s is not a valid demo file\n", name);
 		return;
@@ -78,6 +78,8 @@ public:	// other public functions
 	void	WriteTimeDemoResults( void );
 	bool	ParseAheadForInterval( int curtick, int intervalticks );
 	void	InterpolateDemoCommand( int targettick, DemoCommandQueue& prev, DemoCommandQueue& next );
+	bool	JumpToKeyframe( int tick );
+	void	ReturnFromKeyframe( void );
 
 protected:
 	bool	OverrideView( democmdinfo_t& info );
@@ -96,6 +98,7 @@ public:
 	float			m_flPlaybackRateModifier;
 	int				m_nSkipToTick;	// skip to tick ASAP, -1 = off
 	int				m_nEndTick; // if nonzero, stop playback once we reach this tick
+	int				m_nPlayingKeyframe;	// keyframe jumped to, -1 = none
 	bool			m_bLoading; // true if demo is loading
 
 	unsigned		m_nSkipPacketsPlayed; // Track consecutive skip packets returned to avoid excess
@@ -7,6 +7,7 @@
 
 #include "cmodel_engine.h"
 #include "cmodel_private.h"
+#include "cmodel_mapcache.h"
 #include "dispcoll_common.h"
 #include "coordsize.h"
 
@@ -299,6 +300,8 @@ void CM_FreeMap(void)
 
 	// free the collision bsp data
 	CollisionBSPData_Destroy( pBSPData );
+
+	MapCache_Close();
 }
 
 
@@ -336,6 +339,7 @@ cmodel_t *CM_LoadMap( const char *name, bool allowReusePrevious, unsigned *check
 
 	// only pre-load if the map doesn't already exist
 	CollisionBSPData_PreLoad( pBSPData );
+	MapCache_Close();
 
 	if ( !name || !name[0] )
 	{
@@ -345,6 +349,7 @@ cmodel_t *CM_LoadMap( const char *name, bool allowReusePrevious, unsigned *check
 
 	// read in the collision model data
 	CMapLoadHelper::Init( 0, name );
+	MapCache_Open( name );
 	CollisionBSPData_Load( name, pBSPData );
 	CMapLoadHelper::Shutdown( );
 
@@ -354,6 +359,8 @@ cmodel_t *CM_LoadMap( const char *name, bool allowReusePrevious, unsigned *check
 	CM_InitPortalOpenState( pBSPData );
 	FloodAreaConnections(pBSPData);
 
+	MapCache_FinishLoad( pBSPData );
+
 #ifdef COUNT_COLLISIONS
 	// initialize counters
 	CollisionCounts_Init( &g_CollisionCounts );
@@ -2410,7 +2417,15 @@ const byte *CM_Vis( byte *dest, int destlen, int cluster, int visType )
 	}
 	else
 	{
-		CM_DecompressVis( pBSPData, cluster, visType, dest );
+		const byte *pCachedRow = MapCache_GetVisRow( cluster, visType );
+		if ( pCachedRow )
+		{
+			memcpy( dest, pCachedRow, (pBSPData->numclusters+7)>>3 );
+		}
+		else
+		{
+			CM_DecompressVis( pBSPData, cluster, visType, dest );
+		}
 	}
 
 	return dest;
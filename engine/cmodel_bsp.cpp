@@ -10,6 +10,7 @@
 #include "cmodel_engine.h"
 #include "dispcoll_common.h"
 #include "modelloader.h"
+#include "cmodel_mapcache.h"
 #include "common.h"
 #include "zone.h"
 
@@ -1073,6 +1074,36 @@ void CollisionBSPData_LoadPhysics( CCollisionBSPData *pBSPData )
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Pick up the surface props of a displacement from its material
+//-----------------------------------------------------------------------------
+static void CollisionBSPData_SetDispSurfaceProps( CCollisionBSPData *pBSPData, CDispCollTree *pDispTree, texinfo_t *pTex )
+{
+	if ( pTex->texdata < 0 )
+		return;
+
+	IMaterial *pMaterial = materials->FindMaterial( pBSPData->map_surfaces[pTex->texdata].name, TEXTURE_GROUP_WORLD, true );
+	if ( IsErrorMaterial( pMaterial ) )
+		return;
+
+	IMaterialVar *pVar;
+	bool bVarFound;
+	pVar = pMaterial->FindVar( "$surfaceprop", &bVarFound, false );
+	if ( bVarFound )
+	{
+		const char *pProps = pVar->GetStringValue();
+		pDispTree->SetSurfaceProps( 0, physprop->GetSurfaceIndex( pProps ) );
+		pDispTree->SetSurfaceProps( 1, physprop->GetSurfaceIndex( pProps ) );
+	}
+
+	pVar = pMaterial->FindVar( "$surfaceprop2", &bVarFound, false );
+	if ( bVarFound )
+	{
+		const char *pProps = pVar->GetStringValue();
+		pDispTree->SetSurfaceProps( 1, physprop->GetSurfaceIndex( pProps ) );
+	}
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 void CollisionBSPData_LoadDispInfo( CCollisionBSPData *pBSPData )
@@ -1157,127 +1188,120 @@ void CollisionBSPData_LoadDispInfo( CCollisionBSPData *pBSPData )
 		pDispIndexToFaceIndex[pFaces->dispinfo] = (unsigned short)i;
     }
 
-	// Load one dispinfo from disk at a time and set it up.
-	int iCurVert = 0;
-	int iCurTri = 0;
-	CDispVert tempVerts[MAX_DISPVERTS];
-	CDispTri  tempTris[MAX_DISPTRIS];
-
-	int nSize = 0;
-	int nCacheSize = 0;
-	int nPowerCount[3] = { 0, 0, 0 };
-
-	CMapLoadHelper lhDispInfo( LUMP_DISPINFO );
-	CMapLoadHelper lhDispVerts( LUMP_DISP_VERTS );
-	CMapLoadHelper lhDispTris( LUMP_DISP_TRIS );
-
-	for ( i = 0; i < coreDispCount; ++i )
+	// The trees only depend on the bsp, so they can usually come straight out of the map cache
+	bool *pDispBuilt = (bool *)stackalloc( coreDispCount * sizeof( bool ) );
+	memset( pDispBuilt, 0, coreDispCount * sizeof( bool ) );
+	if ( !MapCache_LoadDispCollTrees( g_pDispCollTrees, g_pDispBounds, pDispBuilt, coreDispCount ) )
 	{
-		// Find the face associated with this dispinfo
-		unsigned short nFaceIndex = pDispIndexToFaceIndex[i];
-		if ( nFaceIndex == 0xFFFF )
-			continue;
+		// Load one dispinfo from disk at a time and set it up.
+		int iCurVert = 0;
+		int iCurTri = 0;
+		CDispVert tempVerts[MAX_DISPVERTS];
+		CDispTri  tempTris[MAX_DISPTRIS];
+
+		int nSize = 0;
+		int nCacheSize = 0;
+		int nPowerCount[3] = { 0, 0, 0 };
 
-		// Load up the dispinfo and create the CCoreDispInfo from it.
-		ddispinfo_t dispInfo;
-		lhDispInfo.LoadLumpElement( i, sizeof(ddispinfo_t), &dispInfo );
+		CMapLoadHelper lhDispInfo( LUMP_DISPINFO );
+		CMapLoadHelper lhDispVerts( LUMP_DISP_VERTS );
+		CMapLoadHelper lhDispTris( LUMP_DISP_TRIS );
 
-		// Read in the vertices.
-		int nVerts = NUM_DISP_POWER_VERTS( dispInfo.power );
-		lhDispVerts.LoadLumpData( iCurVert * sizeof(CDispVert), nVerts*sizeof(CDispVert), tempVerts );
-		iCurVert += nVerts;
+		for ( i = 0; i < coreDispCount; ++i )
+		{
+			// Find the face associated with this dispinfo
+			unsigned short nFaceIndex = pDispIndexToFaceIndex[i];
+			if ( nFaceIndex == 0xFFFF )
+				continue;
+
+			// Load up the dispinfo and create the CCoreDispInfo from it.
+			ddispinfo_t dispInfo;
+			lhDispInfo.LoadLumpElement( i, sizeof(ddispinfo_t), &dispInfo );
+
+			// Read in the vertices.
+			int nVerts = NUM_DISP_POWER_VERTS( dispInfo.power );
+			lhDispVerts.LoadLumpData( iCurVert * sizeof(CDispVert), nVerts*sizeof(CDispVert), tempVerts );
+			iCurVert += nVerts;
 		
-		// Read in the tris.
-		int nTris = NUM_DISP_POWER_TRIS( dispInfo.power );
-		lhDispTris.LoadLumpData( iCurTri * sizeof( CDispTri ), nTris*sizeof( CDispTri), tempTris );
-		iCurTri += nTris;
-
-		CCoreDispInfo coreDisp;
-		CCoreDispSurface *pDispSurf = coreDisp.GetSurface();
-		pDispSurf->SetPointStart( dispInfo.startPosition );
-		pDispSurf->SetContents( dispInfo.contents );
+			// Read in the tris.
+			int nTris = NUM_DISP_POWER_TRIS( dispInfo.power );
+			lhDispTris.LoadLumpData( iCurTri * sizeof( CDispTri ), nTris*sizeof( CDispTri), tempTris );
+			iCurTri += nTris;
+
+			CCoreDispInfo coreDisp;
+			CCoreDispSurface *pDispSurf = coreDisp.GetSurface();
+			pDispSurf->SetPointStart( dispInfo.startPosition );
+			pDispSurf->SetContents( dispInfo.contents );
 	
-		coreDisp.InitDispInfo( dispInfo.power, dispInfo.minTess, dispInfo.smoothingAngle, tempVerts, tempTris );
+			coreDisp.InitDispInfo( dispInfo.power, dispInfo.minTess, dispInfo.smoothingAngle, tempVerts, tempTris );
 
-		// Hook the disp surface to the face
-		pFaces = &pFaceList[ nFaceIndex ];
-		pDispSurf->SetHandle( nFaceIndex );
+			// Hook the disp surface to the face
+			pFaces = &pFaceList[ nFaceIndex ];
+			pDispSurf->SetHandle( nFaceIndex );
 
-		// get points
-		if ( pFaces->numedges > 4 )
-			continue;
+			// get points
+			if ( pFaces->numedges > 4 )
+				continue;
 
-		Vector surfPoints[4];
-		pDispSurf->SetPointCount( pFaces->numedges );
-		int j;
-		for ( j = 0; j < pFaces->numedges; j++ )
-		{
-			int eIndex = pSurfEdges[pFaces->firstedge+j];
-			if ( eIndex < 0 )
+			Vector surfPoints[4];
+			pDispSurf->SetPointCount( pFaces->numedges );
+			int j;
+			for ( j = 0; j < pFaces->numedges; j++ )
 			{
-				VectorCopy( pVerts[pEdges[-eIndex].v[1]].point, surfPoints[j] );
+				int eIndex = pSurfEdges[pFaces->firstedge+j];
+				if ( eIndex < 0 )
+				{
+					VectorCopy( pVerts[pEdges[-eIndex].v[1]].point, surfPoints[j] );
+				}
+				else
+				{
+					VectorCopy( pVerts[pEdges[eIndex].v[0]].point, surfPoints[j] );
+				}
 			}
-			else
+
+			for ( j = 0; j < 4; j++ )
 			{
-				VectorCopy( pVerts[pEdges[eIndex].v[0]].point, surfPoints[j] );
+				pDispSurf->SetPoint( j, surfPoints[j] );
 			}
-		}
 
-		for ( j = 0; j < 4; j++ )
-		{
-			pDispSurf->SetPoint( j, surfPoints[j] );
+			pDispSurf->FindSurfPointStartIndex();
+			pDispSurf->AdjustSurfPointData();
+
+			//
+			// generate the collision displacement surfaces
+			//
+			CDispCollTree *pDispTree = &g_pDispCollTrees[i];
+			pDispTree->SetPower( 0 );
+
+			//
+			// check for null faces, should have been taken care of in vbsp!!!
+			//
+			int pointCount = pDispSurf->GetPointCount();
+			if ( pointCount != 4 )
+				continue;
+
+			coreDisp.Create();
+
+			// new collision
+			pDispTree->Create( &coreDisp );
+			g_pDispBounds[i].Init(pDispTree->m_mins, pDispTree->m_maxs, pDispTree->m_iCounter, pDispTree->GetContents());
+			nSize += pDispTree->GetMemorySize();
+			nCacheSize += pDispTree->GetCacheMemorySize();
+			nPowerCount[pDispTree->GetPower()-2]++;
+			pDispBuilt[i] = true;
 		}
 
-		pDispSurf->FindSurfPointStartIndex();
-		pDispSurf->AdjustSurfPointData();
-
-		//
-		// generate the collision displacement surfaces
-		//
-		CDispCollTree *pDispTree = &g_pDispCollTrees[i];
-		pDispTree->SetPower( 0 );
+		MapCache_StoreDispCollTrees( g_pDispCollTrees, pDispBuilt, coreDispCount );
+	}
 
-		//
-		// check for null faces, should have been taken care of in vbsp!!!
-		//
-		int pointCount = pDispSurf->GetPointCount();
-		if ( pointCount != 4 )
+	// Surface props come from the materials, which can change without the map changing
+	for ( i = 0; i < coreDispCount; ++i )
+	{
+		if ( !pDispBuilt[i] )
 			continue;
 
-		coreDisp.Create();
-
-		// new collision
-		pDispTree->Create( &coreDisp );
-		g_pDispBounds[i].Init(pDispTree->m_mins, pDispTree->m_maxs, pDispTree->m_iCounter, pDispTree->GetContents());
-		nSize += pDispTree->GetMemorySize();
-		nCacheSize += pDispTree->GetCacheMemorySize();
-		nPowerCount[pDispTree->GetPower()-2]++;
-
-		// Surface props.
-		texinfo_t *pTex = &pTexinfoList[pFaces->texinfo];
-		if ( pTex->texdata >= 0 )
-		{
-			IMaterial *pMaterial = materials->FindMaterial( pBSPData->map_surfaces[pTex->texdata].name, TEXTURE_GROUP_WORLD, true );
-			if ( !IsErrorMaterial( pMaterial ) )
-			{
-				IMaterialVar *pVar;
-				bool bVarFound;
-				pVar = pMaterial->FindVar( "$surfaceprop", &bVarFound, false );
-				if ( bVarFound )
-				{
-					const char *pProps = pVar->GetStringValue();
-					pDispTree->SetSurfaceProps( 0, physprop->GetSurfaceIndex( pProps ) );
-					pDispTree->SetSurfaceProps( 1, physprop->GetSurfaceIndex( pProps ) );
-				}
-
-				pVar = pMaterial->FindVar( "$surfaceprop2", &bVarFound, false );
-				if ( bVarFound )
-				{
-					const char *pProps = pVar->GetStringValue();
-					pDispTree->SetSurfaceProps( 1, physprop->GetSurfaceIndex( pProps ) );
-				}
-			}
-		}
+		texinfo_t *pTex = &pTexinfoList[pFaceList[pDispIndexToFaceIndex[i]].texinfo];
+		CollisionBSPData_SetDispSurfaceProps( pBSPData, &g_pDispCollTrees[i], pTex );
 	}
 
 	CMapLoadHelper lhDispPhys( LUMP_PHYSDISP );
@@ -0,0 +1,410 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Persistent per-map cache of post-processed collision data
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#include "cmodel_engine.h"
+#include "cmodel_private.h"
+#include "cmodel_mapcache.h"
+#include "dispcoll_common.h"
+#include "modelloader.h"
+#include "filesystem.h"
+#include "filesystem_engine.h"
+#include "tier0/icommandline.h"
+#include "tier0/threadtools.h"
+#include "tier1/checksum_crc.h"
+#include "tier1/convar.h"
+#include "tier1/memorymappedfile.h"
+#include "tier1/strtools.h"
+#include "tier1/utlbuffer.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+// in cmodel.cpp
+void CM_DecompressVis( CCollisionBSPData *pBSPData, int cluster, int visType, byte *out );
+
+static ConVar map_cache( "map_cache", "1", 0, "Keep the displacement collision trees and decompressed visibility of each map in cache/maps and reuse them while the map is unchanged." );
+
+#define MAPCACHE_IDENT			(('H'<<24)+('C'<<16)+('P'<<8)+'M')		// little-endian "MPCH"
+#define MAPCACHE_VERSION		2
+#define MAPCACHE_DIRECTORY		"cache/maps"
+
+// Maps with more visibility than this keep decompressing rows on demand
+#define MAPCACHE_MAX_VIS_SIZE	( 32 * 1024 * 1024 )
+
+enum
+{
+	MAPCACHE_LUMP_DISPCOLL = 0,
+	MAPCACHE_LUMP_VIS,
+
+	MAPCACHE_LUMP_COUNT
+};
+
+struct mapcachelump_t
+{
+	int		fileofs;
+	int		filelen;
+};
+
+struct mapcacheheader_t
+{
+	int				ident;
+	int				version;
+	CRC32_t			layoutCRC;		// of the native struct layouts written verbatim
+	CRC32_t			sourceCRC;		// of the bsp lumps the data below depends on
+	int64			bspTime;		// the .bsp the lumps came from, the lumps aren't CRCed again
+	unsigned int	bspSize;		// while these match
+	mapcachelump_t	lumps[MAPCACHE_LUMP_COUNT];
+};
+
+struct mapcachevis_t
+{
+	int		numclusters;			// 0 if the map's visibility isn't cached
+	int		rowbytes;
+	// numclusters PVS rows follow, then numclusters PAS rows
+};
+
+// Everything cached is derived from these
+static const int s_MapCacheSourceLumps[] =
+{
+	LUMP_VISIBILITY,
+	LUMP_DISPINFO,
+	LUMP_DISP_VERTS,
+	LUMP_DISP_TRIS,
+	LUMP_VERTEXES,
+	LUMP_EDGES,
+	LUMP_SURFEDGES,
+	LUMP_FACES,
+	LUMP_FACES_HDR,
+};
+
+static CMemoryMappedFile	s_MapCacheFile;
+static char					s_szMapCachePath[MAX_PATH];
+static CRC32_t				s_MapCacheCRC;
+static bool					s_bMapCacheCRCValid;	// s_MapCacheCRC has been computed for the map being loaded
+static int64				s_nMapCacheBSPTime;
+static unsigned int			s_nMapCacheBSPSize;
+static bool					s_bMapCacheActive;		// caching is on for the map being loaded
+static bool					s_bMapCacheValid;		// s_MapCacheFile belongs to the map being loaded
+static CUtlBuffer			s_PendingDispColl;		// built this load, goes into the next cache file
+
+static const byte			*s_pVisRows;
+static int					s_nVisClusters;
+static int					s_nVisRowBytes;
+
+
+//-----------------------------------------------------------------------------
+// The tree layouts are native, so the sizes of what gets written verbatim are
+// part of the key too.
+//-----------------------------------------------------------------------------
+static CRC32_t MapCache_LayoutCRC()
+{
+	int layout[] = { MAPCACHE_VERSION, (int)sizeof( void * ), (int)sizeof( CDispCollTree ), (int)sizeof( Vector ), (int)sizeof( CDispCollTri ) };
+	return CRC32_ProcessSingleBuffer( layout, sizeof( layout ) );
+}
+
+//-----------------------------------------------------------------------------
+// CRC of the lumps the cache is built from, CMapLoadHelper has to be initialized
+//-----------------------------------------------------------------------------
+static CRC32_t MapCache_SourceCRC()
+{
+	if ( s_bMapCacheCRCValid )
+		return s_MapCacheCRC;
+
+	CRC32_t crc;
+	CRC32_Init( &crc );
+
+	for ( int i = 0; i < (int)ARRAYSIZE( s_MapCacheSourceLumps ); i++ )
+	{
+		CMapLoadHelper lh( s_MapCacheSourceLumps[i] );
+		int nSize = lh.LumpSize();
+		CRC32_ProcessBuffer( &crc, &nSize, sizeof( nSize ) );
+		if ( nSize && lh.LumpBase() )
+		{
+			CRC32_ProcessBuffer( &crc, lh.LumpBase(), nSize );
+		}
+	}
+
+	CRC32_Final( &crc );
+
+	s_MapCacheCRC = crc;
+	s_bMapCacheCRCValid = true;
+	return crc;
+}
+
+static CMemoryMappedFileView MapCache_LumpView( int nLump )
+{
+	const mapcacheheader_t *pHeader = (const mapcacheheader_t *)s_MapCacheFile.Base();
+	return s_MapCacheFile.View( pHeader->lumps[nLump].fileofs, pHeader->lumps[nLump].filelen );
+}
+
+//-----------------------------------------------------------------------------
+// Maps the cache file for the current map if it's there and matches. The
+// lumps are only CRCed when the .bsp's size or time differ from the header's,
+// so bCanCRC has to be false once CMapLoadHelper is shut down.
+//-----------------------------------------------------------------------------
+static bool MapCache_MapFile( bool bCanCRC )
+{
+	char szFullPath[MAX_PATH];
+	if ( !g_pFileSystem->RelativePathToFullPath_safe( s_szMapCachePath, "DEFAULT_WRITE_PATH", szFullPath ) || !szFullPath[0] )
+		return false;
+
+	if ( !s_MapCacheFile.Open( szFullPath ) )
+		return false;
+
+	const mapcacheheader_t *pHeader = (const mapcacheheader_t *)s_MapCacheFile.Base();
+	if ( s_MapCacheFile.Size() < (int64)sizeof( mapcacheheader_t ) ||
+		 pHeader->ident != MAPCACHE_IDENT || pHeader->version != MAPCACHE_VERSION || pHeader->layoutCRC != MapCache_LayoutCRC() )
+	{
+		s_MapCacheFile.Close();
+		return false;
+	}
+
+	bool bSameBSP = s_nMapCacheBSPTime && pHeader->bspTime == s_nMapCacheBSPTime && pHeader->bspSize == s_nMapCacheBSPSize;
+	if ( !bSameBSP && ( !bCanCRC || pHeader->sourceCRC != MapCache_SourceCRC() ) )
+	{
+		s_MapCacheFile.Close();
+		return false;
+	}
+
+	for ( int i = 0; i < MAPCACHE_LUMP_COUNT; i++ )
+	{
+		if ( !MapCache_LumpView( i ).IsValid() )
+		{
+			s_MapCacheFile.Close();
+			return false;
+		}
+	}
+
+	CMemoryMappedFileView vis = MapCache_LumpView( MAPCACHE_LUMP_VIS );
+	if ( vis.Count() >= (int64)sizeof( mapcachevis_t ) )
+	{
+		const mapcachevis_t *pVis = (const mapcachevis_t *)vis.Base();
+		CMemoryMappedFileView rows = vis.Slice( sizeof( mapcachevis_t ), 2 * (int64)pVis->numclusters * pVis->rowbytes );
+		if ( pVis->numclusters > 0 && pVis->rowbytes == ( ( pVis->numclusters + 7 ) >> 3 ) && rows.IsValid() )
+		{
+			s_pVisRows = rows.Base();
+			s_nVisClusters = pVis->numclusters;
+			s_nVisRowBytes = pVis->rowbytes;
+		}
+	}
+
+	s_bMapCacheValid = true;
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Find the cache file of a map that's starting to load
+//-----------------------------------------------------------------------------
+void MapCache_Open( const char *pMapName )
+{
+	MapCache_Close();
+
+	if ( !map_cache.GetBool() || CommandLine()->FindParm( "-nomapcache" ) )
+		return;
+
+	double flStart = Plat_FloatTime();
+
+	char szBaseName[MAX_PATH];
+	V_FileBase( pMapName, szBaseName, sizeof( szBaseName ) );
+	V_snprintf( s_szMapCachePath, sizeof( s_szMapCachePath ), "%s/%s.mapcache", MAPCACHE_DIRECTORY, szBaseName );
+
+	s_nMapCacheBSPTime = g_pFileSystem->GetFileTime( pMapName, "GAME" );
+	s_nMapCacheBSPSize = g_pFileSystem->Size( pMapName, "GAME" );
+	s_bMapCacheActive = true;
+
+	if ( MapCache_MapFile( true ) )
+	{
+		DevMsg( "Map cache: using %s (%.1f ms)\n", s_szMapCachePath, ( Plat_FloatTime() - flStart ) * 1000.0 );
+	}
+	else
+	{
+		// FinishLoad needs the CRC for the new file, and the lumps are only around until then
+		MapCache_SourceCRC();
+		DevMsg( "Map cache: %s is missing or stale, rebuilding it\n", s_szMapCachePath );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Write out a new cache file if this load had to build anything
+//-----------------------------------------------------------------------------
+void MapCache_FinishLoad( CCollisionBSPData *pBSPData )
+{
+	if ( !s_bMapCacheActive || s_bMapCacheValid || !s_bMapCacheCRCValid )
+		return;
+
+	double flStart = Plat_FloatTime();
+
+	mapcacheheader_t header;
+	memset( &header, 0, sizeof( header ) );
+	header.ident = MAPCACHE_IDENT;
+	header.version = MAPCACHE_VERSION;
+	header.layoutCRC = MapCache_LayoutCRC();
+	header.sourceCRC = s_MapCacheCRC;
+	header.bspTime = s_nMapCacheBSPTime;
+	header.bspSize = s_nMapCacheBSPSize;
+
+	CUtlBuffer buf;
+	buf.Put( &header, sizeof( header ) );
+
+	header.lumps[MAPCACHE_LUMP_DISPCOLL].fileofs = buf.TellPut();
+	buf.Put( s_PendingDispColl.Base(), s_PendingDispColl.TellPut() );
+	header.lumps[MAPCACHE_LUMP_DISPCOLL].filelen = buf.TellPut() - header.lumps[MAPCACHE_LUMP_DISPCOLL].fileofs;
+	s_PendingDispColl.Purge();
+
+	// Maps without vis data get all-visible rows from CM_NullVis, no point caching those
+	mapcachevis_t vis;
+	vis.rowbytes = ( pBSPData->numclusters + 7 ) >> 3;
+	vis.numclusters = 0;
+	if ( pBSPData->numvisibility && pBSPData->map_vis && pBSPData->numclusters > 0 &&
+		 2 * (int64)pBSPData->numclusters * vis.rowbytes <= MAPCACHE_MAX_VIS_SIZE )
+	{
+		vis.numclusters = pBSPData->numclusters;
+	}
+
+	header.lumps[MAPCACHE_LUMP_VIS].fileofs = buf.TellPut();
+	buf.Put( &vis, sizeof( vis ) );
+	if ( vis.numclusters )
+	{
+		CUtlMemory<byte> row( 0, vis.rowbytes );
+		for ( int visType = DVIS_PVS; visType <= DVIS_PAS; visType++ )
+		{
+			for ( int cluster = 0; cluster < vis.numclusters; cluster++ )
+			{
+				CM_DecompressVis( pBSPData, cluster, visType, row.Base() );
+				buf.Put( row.Base(), vis.rowbytes );
+			}
+		}
+	}
+	header.lumps[MAPCACHE_LUMP_VIS].filelen = buf.TellPut() - header.lumps[MAPCACHE_LUMP_VIS].fileofs;
+
+	memcpy( buf.Base(), &header, sizeof( header ) );
+
+	// Other servers sharing the install may have the old file mapped; write a temp file next to it
+	// and rename it over the old one so they never see a partly written cache
+	char szTempPath[MAX_PATH];
+	V_snprintf( szTempPath, sizeof( szTempPath ), "%s.%u.tmp", s_szMapCachePath, (unsigned int)ThreadGetCurrentId() );
+
+	g_pFileSystem->CreateDirHierarchy( MAPCACHE_DIRECTORY, "DEFAULT_WRITE_PATH" );
+	if ( !g_pFileSystem->WriteFile( szTempPath, "DEFAULT_WRITE_PATH", buf ) )
+	{
+		Warning( "Map cache: couldn't write %s\n", szTempPath );
+		g_pFileSystem->RemoveFile( szTempPath, "DEFAULT_WRITE_PATH" );
+		return;
+	}
+
+#ifdef _WIN32
+	// rename() doesn't replace an existing file on Windows
+	g_pFileSystem->RemoveFile( s_szMapCachePath, "DEFAULT_WRITE_PATH" );
+#endif
+	if ( !g_pFileSystem->RenameFile( szTempPath, s_szMapCachePath, "DEFAULT_WRITE_PATH" ) )
+	{
+		g_pFileSystem->RemoveFile( szTempPath, "DEFAULT_WRITE_PATH" );
+		return;
+	}
+
+	// Serve this load's vis rows from the new file as well
+	MapCache_MapFile( false );
+
+	DevMsg( "Map cache: wrote %s (%d bytes, %.1f ms)\n", s_szMapCachePath, buf.TellPut(), ( Plat_FloatTime() - flStart ) * 1000.0 );
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Release the cache of the map that's being unloaded
+//-----------------------------------------------------------------------------
+void MapCache_Close()
+{
+	s_MapCacheFile.Close();
+	s_PendingDispColl.Purge();
+	s_bMapCacheActive = false;
+	s_bMapCacheValid = false;
+	s_bMapCacheCRCValid = false;
+	s_nMapCacheBSPTime = 0;
+	s_nMapCacheBSPSize = 0;
+	s_pVisRows = NULL;
+	s_nVisClusters = 0;
+	s_nVisRowBytes = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Displacement collision trees
+//-----------------------------------------------------------------------------
+bool MapCache_LoadDispCollTrees( CDispCollTree *pTrees, alignedbbox_t *pBounds, bool *pBuilt, int nCount )
+{
+	if ( !s_bMapCacheValid )
+		return false;
+
+	CMemoryMappedFileView view = MapCache_LumpView( MAPCACHE_LUMP_DISPCOLL );
+	CUtlBuffer buf( view.Base(), view.Count(), CUtlBuffer::READ_ONLY );
+	if ( buf.GetInt() != nCount || !buf.IsValid() )
+		return false;
+
+	int i;
+	for ( i = 0; i < nCount; i++ )
+	{
+		pBuilt[i] = ( buf.GetUnsignedChar() != 0 );
+		if ( !buf.IsValid() )
+			break;
+
+		if ( !pBuilt[i] )
+			continue;
+
+		if ( !pTrees[i].Unserialize( buf ) )
+			break;
+
+		pBounds[i].Init( pTrees[i].m_mins, pTrees[i].m_maxs, pTrees[i].m_iCounter, pTrees[i].GetContents() );
+	}
+
+	if ( i == nCount )
+		return true;
+
+	// Damaged file; put back the trees we touched so the caller can build them, and write a new one
+	Warning( "Map cache: %s is damaged, rebuilding it\n", s_szMapCachePath );
+	MapCache_SourceCRC();
+	for ( int j = 0; j <= i && j < nCount; j++ )
+	{
+		Destruct( &pTrees[j] );
+		Construct( &pTrees[j] );
+	}
+	s_MapCacheFile.Close();
+	s_bMapCacheValid = false;
+	s_pVisRows = NULL;
+	s_nVisClusters = 0;
+	return false;
+}
+
+void MapCache_StoreDispCollTrees( const CDispCollTree *pTrees, const bool *pBuilt, int nCount )
+{
+	if ( !s_bMapCacheActive || s_bMapCacheValid )
+		return;
+
+	s_PendingDispColl.Purge();
+	s_PendingDispColl.PutInt( nCount );
+	for ( int i = 0; i < nCount; i++ )
+	{
+		s_PendingDispColl.PutUnsignedChar( pBuilt[i] ? 1 : 0 );
+		if ( pBuilt[i] )
+		{
+			pTrees[i].Serialize( s_PendingDispColl );
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Purpose: Decompressed PVS/PAS
+//-----------------------------------------------------------------------------
+const byte *MapCache_GetVisRow( int cluster, int visType )
+{
+	if ( !s_pVisRows || cluster < 0 || cluster >= s_nVisClusters || visType < DVIS_PVS || visType > DVIS_PAS )
+		return NULL;
+
+	return s_pVisRows + ( visType * s_nVisClusters + cluster ) * s_nVisRowBytes;
+}
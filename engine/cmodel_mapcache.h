@@ -0,0 +1,44 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Persistent per-map cache of post-processed collision data
+//
+// $NoKeywords: $
+//=============================================================================//
+
+#ifndef CMODEL_MAPCACHE_H
+#define CMODEL_MAPCACHE_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+class CCollisionBSPData;
+class CDispCollTree;
+struct alignedbbox_t;
+
+
+//-----------------------------------------------------------------------------
+// The collision loader rebuilds the displacement AABB trees and decompresses
+// the PVS/PAS rows of a map every time it's loaded, even though both only
+// depend on lumps of the .bsp. The map cache keeps that output in
+// cache/maps/<map>.mapcache, keyed by a CRC of the lumps it was derived from,
+// and maps it on the next load of the same map so the work is skipped. The
+// lumps are only CRCed again when the .bsp's size or time changed.
+//
+// Open must be called while CMapLoadHelper is initialized for the map, and
+// FinishLoad once the collision bsp is loaded; it writes a new cache file if
+// the existing one was missing or stale.
+//-----------------------------------------------------------------------------
+void MapCache_Open( const char *pMapName );
+void MapCache_FinishLoad( CCollisionBSPData *pBSPData );
+void MapCache_Close();
+
+// Fills in the trees and bounds from the cache. pBuilt[i] is set for the
+// displacements that have a collision tree. Returns false on a cache miss.
+bool MapCache_LoadDispCollTrees( CDispCollTree *pTrees, alignedbbox_t *pBounds, bool *pBuilt, int nCount );
+void MapCache_StoreDispCollTrees( const CDispCollTree *pTrees, const bool *pBuilt, int nCount );
+
+// Decompressed row for a cluster, or NULL if it isn't cached
+const byte *MapCache_GetVisRow( int cluster, int visType );
+
+
+#endif // CMODEL_MAPCACHE_H
@@ -1451,6 +1451,44 @@ static int zstdTrainingSetCount = 0;
 	return true;
 }
 
+void *COM_CreateCompressContext_ZSTD()
+{
+	// load the dictionary now, rather than on the thread using the context
+	GetZSTD_Dictionary<ZSTD_CDict>();
+
+	return ZSTD_createCCtx();
+}
+
+void COM_DestroyCompressContext_ZSTD( void *pContext )
+{
+	ZSTD_freeCCtx( (ZSTD_CCtx *)pContext );
+}
+
+bool COM_BufferToBufferCompress_ZSTD( void *dest, unsigned int *destLen, const void *source, unsigned int sourceLen, void *pContext )
+{
+	Assert( dest );
+	Assert( destLen );
+	Assert( source );
+	Assert( pContext );
+
+	if ( *destLen < COM_GetIdealDestinationCompressionBufferSize_ZSTD( sourceLen ) )
+		return false;
+
+	*(uint32 *)dest = ZSTD_ID;
+	size_t compressed_length = ZSTD_compress_usingCDict(
+		(ZSTD_CCtx *)pContext,
+		(char *)dest + sizeof(uint32),
+		*destLen - sizeof(uint32),
+		(const char *)source,
+		sourceLen,
+		GetZSTD_Dictionary<ZSTD_CDict>() );
+	if ( ZSTD_isError( compressed_length ) )
+		return false;
+
+	*destLen = compressed_length + sizeof(uint32);
+	return true;
+}
+
 
 //-----------------------------------------------------------------------------
 unsigned COM_GetIdealDestinationCompressionBufferSize_LZSS( unsigned int uncompressedSize )
@@ -1575,10 +1613,15 @@ bool COM_BufferToBufferDecompress( void *dest, unsigned int *destLen, const void
 
     	if ( pHeader->id == ZSTD_ID )
         {
-            static auto g_pZSTDDCtx = ZSTD_createDCtx();
+            // one context per thread, demos and string tables can be decompressed off the main thread
+            static CTHREADLOCALPTR( ZSTD_DCtx ) s_pZSTDDCtx;
+            if ( !s_pZSTDDCtx )
+            {
+                s_pZSTDDCtx = ZSTD_createDCtx();
+            }
 
             if (ZSTD_isError(ZSTD_decompress_usingDDict(
-                  g_pZSTDDCtx,
+                  s_pZSTDDCtx,
                   (char*)dest,
                   *destLen,
                   (const char*)source + 4,
@@ -118,6 +118,12 @@ void *COM_CompressBuffer_ZSTD( const void *source, unsigned int sourceLen, unsig
 bool COM_BufferToBufferCompress_ZSTD( void *dest, unsigned int *destLen, const void *source, unsigned int sourceLen );
 unsigned int COM_GetIdealDestinationCompressionBufferSize_ZSTD( unsigned int uncompressedSize );
 
+// ZSTD compression on other threads, each using a context of its own. destLen must be at
+// least COM_GetIdealDestinationCompressionBufferSize_ZSTD( sourceLen ).
+void *COM_CreateCompressContext_ZSTD();
+void COM_DestroyCompressContext_ZSTD( void *pContext );
+bool COM_BufferToBufferCompress_ZSTD( void *dest, unsigned int *destLen, const void *source, unsigned int sourceLen, void *pContext );
+
 /// Fetch ideal working buffer size.  You should allocate the buffer you wish to compress into
 /// at least this big, in order to get the best performance when using COM_BufferToBufferCompress
 inline unsigned int COM_GetIdealDestinationCompressionBufferSize( unsigned int uncompressedSize )
@@ -0,0 +1,1508 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Decodes a demo without a client, writing the entity state and
+//			game events of every tick to an analysis stream (demo_analyze)
+//
+//===========================================================================//
+
+#include <tier0/dbg.h>
+#include <tier1/strtools.h>
+#include <tier1/KeyValues.h>
+#include <vstdlib/jobthread.h>
+
+#include "demoanalyzer.h"
+#include "demofile/demoformat.h"
+#include "net.h"
+#include "net_chan.h"
+#include "netmessages.h"
+#include "protocol.h"
+#include "dt.h"
+#include "dt_encode.h"
+#include "dt_recv_eng.h"
+#include "iclientnetworkable.h"
+#include "ents_shared.h"
+#include "clientframe.h"
+#include "net_synctags.h"
+#include "GameEventManager.h"
+#include "common.h"
+#include "filesystem_engine.h"
+#include "convar.h"
+
+// NOTE: This has to be the last file included!
+#include "tier0/memdbgon.h"
+
+
+// The analysis stream is written out whenever this much of it is buffered
+#define DEMO_ANALYSIS_FLUSH_SIZE	(256*1024)
+
+
+//-----------------------------------------------------------------------------
+// CDemoAnalyzer
+//-----------------------------------------------------------------------------
+CDemoAnalyzer::CDemoAnalyzer()
+{
+	m_szDemoName[0] = 0;
+	m_szOutputName[0] = 0;
+	m_szError[0] = 0;
+
+	m_nNetworkProtocol = PROTOCOL_VERSION;
+	m_nDemoProtocol = DEMO_PROTOCOL;
+	m_pNetChannel = NULL;
+	m_bAbort = false;
+	m_hOutput = FILESYSTEM_INVALID_HANDLE;
+	m_Output.SetBigEndian( false );
+	m_pPacketData = new char[ NET_MAX_PAYLOAD ];
+
+	m_bClassesLinked = false;
+	m_nServerClasses = 0;
+	m_nServerClassBits = 0;
+
+	m_pEntities = new EntityState_t[ MAX_EDICTS ];
+	for ( int i = 0; i < MAX_EDICTS; i++ )
+	{
+		m_pEntities[i].m_nClass = -1;
+		m_pEntities[i].m_nSerialNum = 0;
+	}
+
+	for ( int i = 0; i < 2; i++ )
+	{
+		m_pBaselines[i] = new EntityBaseline_t[ MAX_EDICTS ];
+		for ( int j = 0; j < MAX_EDICTS; j++ )
+		{
+			m_pBaselines[i][j].m_nClass = -1;
+			m_pBaselines[i][j].m_nBits = 0;
+		}
+	}
+
+	m_nTick = 0;
+	m_nWrittenTick = -1;
+
+	m_nTicks = 0;
+	m_nEntityUpdates = 0;
+	m_nEvents = 0;
+	m_nOutputSize = 0;
+	m_flRunTime = 0.0f;
+}
+
+CDemoAnalyzer::~CDemoAnalyzer()
+{
+	Close();
+
+	DeleteClientFrames( -1 );
+	m_GameEvents.Shutdown();
+
+	// the precalcs point back at their tables, delete them first
+	m_Precalcs.PurgeAndDeleteElements();
+
+	for ( int i = 0; i < m_SendTables.Count(); i++ )
+	{
+		RecvTable_FreeSendTable( m_SendTables[i] );
+	}
+	m_SendTables.Purge();
+
+	delete [] m_pEntities;
+	delete [] m_pBaselines[0];
+	delete [] m_pBaselines[1];
+	delete [] m_pPacketData;
+}
+
+void CDemoAnalyzer::Fail( const char *pFormat, ... )
+{
+	// keep the first error, the rest usually follows from it
+	if ( IsFailed() )
+		return;
+
+	va_list argptr;
+	va_start( argptr, pFormat );
+	Q_vsnprintf( m_szError, sizeof( m_szError ), pFormat, argptr );
+	va_end( argptr );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Opens the demo and the analysis stream, main thread only
+//-----------------------------------------------------------------------------
+bool CDemoAnalyzer::Open( const char *pDemoName )
+{
+	Q_strncpy( m_szDemoName, pDemoName, sizeof( m_szDemoName ) );
+
+	if ( !m_DemoFile.Open( pDemoName, true ) )
+	{
+		Fail( "couldn't open demo" );
+		return false;
+	}
+
+	demoheader_t *pHeader = m_DemoFile.ReadDemoHeader();
+	if ( !pHeader )
+	{
+		Fail( "invalid demo header" );
+		Close();
+		return false;
+	}
+
+	m_nNetworkProtocol = pHeader->networkprotocol;
+	m_nDemoProtocol = pHeader->demoprotocol;
+
+	Q_StripExtension( pDemoName, m_szOutputName, sizeof( m_szOutputName ) );
+	Q_strncat( m_szOutputName, DEMO_ANALYSIS_EXTENSION, sizeof( m_szOutputName ), COPY_ALL_CHARACTERS );
+
+	m_hOutput = g_pFileSystem->Open( m_szOutputName, "wb" );
+	if ( m_hOutput == FILESYSTEM_INVALID_HANDLE )
+	{
+		Fail( "couldn't create %s", m_szOutputName );
+		Close();
+		return false;
+	}
+
+	// a fake channel with a NULL address, like demo playback uses. It's kept out of the
+	// net system's channel list, which only the main thread may touch.
+	m_pNetChannel = new CNetChan();
+	m_pNetChannel->Setup( NS_CLIENT, NULL, "DEMO", this, m_nNetworkProtocol );
+	m_pNetChannel->SetTimeout( -1.0f );	// never timeout
+
+	demoanalysisheader_t header;
+	Q_memset( &header, 0, sizeof( header ) );
+	Q_strncpy( header.id, DEMO_ANALYSIS_ID, sizeof( header.id ) );
+	header.version = LittleDWord( DEMO_ANALYSIS_VERSION );
+	header.networkprotocol = LittleDWord( m_nNetworkProtocol );
+	Q_strncpy( header.mapname, pHeader->mapname, sizeof( header.mapname ) );
+	m_Output.Put( &header, sizeof( header ) );
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads the whole demo, can run on any thread
+//-----------------------------------------------------------------------------
+void CDemoAnalyzer::Run()
+{
+	double flStartTime = Plat_FloatTime();
+
+	netpacket_t demoPacket;
+	Q_memset( &demoPacket, 0, sizeof( demoPacket ) );
+	demoPacket.from.SetType( NA_LOOPBACK );
+
+	bool bFinished = false;
+
+	while ( !bFinished && !IsFailed() )
+	{
+		if ( m_bAbort )
+		{
+			Fail( "aborted" );
+			break;
+		}
+
+		unsigned char cmd;
+		int tick;
+		m_DemoFile.ReadCmdHeader( cmd, tick );
+
+		// a truncated demo reads as dem_stop too
+		if ( !m_DemoFile.IsOpen() )
+		{
+			Fail( "unexpected end of demo" );
+			break;
+		}
+
+		switch ( cmd )
+		{
+		case dem_stop:
+			bFinished = true;
+			break;
+		case dem_synctick:
+			break;
+		case dem_consolecmd:
+			if ( m_DemoFile.ReadRawData( NULL, 0 ) < 0 )
+			{
+				Fail( "invalid console command" );
+			}
+			break;
+		case dem_usercmd:
+			{
+				int nSize = 0;
+				m_DemoFile.ReadUserCmd( NULL, nSize );
+				if ( nSize < 0 )
+				{
+					Fail( "invalid user command" );
+				}
+			}
+			break;
+		case dem_datatables:
+			{
+				int nSize = m_DemoFile.ReadRawData( m_pPacketData, NET_MAX_PAYLOAD );
+				if ( nSize < 0 )
+				{
+					Fail( "network data tables too large" );
+					break;
+				}
+
+				bf_read buf( "dem_datatables", m_pPacketData, nSize );
+				ReadDataTables( buf );
+			}
+			break;
+		case dem_stringtables:
+			{
+				void *data = NULL;
+				int dataLen = 512 * 1024;
+				while ( dataLen <= DEMO_FILE_MAX_STRINGTABLE_SIZE )
+				{
+					data = realloc( data, dataLen );
+					bf_read buf( "dem_stringtables", data, dataLen );
+					// did we successfully read
+					if ( m_DemoFile.ReadStringTables( &buf ) > 0 )
+					{
+						buf.Seek( 0 );
+						if ( !m_StringTables.ReadStringTables( buf ) )
+						{
+							Fail( "error reading string tables" );
+						}
+						break;
+					}
+
+					// Didn't fit.  Try doubling the size of the buffer
+					dataLen *= 2;
+				}
+
+				if ( dataLen > DEMO_FILE_MAX_STRINGTABLE_SIZE )
+				{
+					Fail( "string tables larger than %d bytes", DEMO_FILE_MAX_STRINGTABLE_SIZE );
+				}
+
+				free( data );
+			}
+			break;
+		case dem_signon:
+		case dem_packet:
+			{
+				democmdinfo_t info;
+				int inseq, outseqack;
+
+				m_DemoFile.ReadCmdInfo( info );
+				m_DemoFile.ReadSequenceInfo( inseq, outseqack );
+
+				if ( !m_DemoFile.IsOpen() )
+				{
+					Fail( "unexpected end of demo" );
+					break;
+				}
+
+				int length = m_DemoFile.ReadRawData( m_pPacketData, NET_MAX_PAYLOAD );
+				if ( length < 0 )
+				{
+					Fail( "demo packet too large" );
+					break;
+				}
+
+				if ( length > 0 )
+				{
+					demoPacket.size = length;
+					demoPacket.message.StartReading( m_pPacketData, length );
+
+					m_pNetChannel->ProcessPacket( &demoPacket, false );
+				}
+			}
+			break;
+		}
+
+		if ( m_Output.TellPut() >= DEMO_ANALYSIS_FLUSH_SIZE )
+		{
+			Flush();
+		}
+	}
+
+	// a demo that failed to decode ends without dma_stop
+	if ( !IsFailed() )
+	{
+		m_Output.PutUnsignedChar( dma_stop );
+	}
+
+	Flush();
+
+	m_flRunTime = Plat_FloatTime() - flStartTime;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Closes the demo and the analysis stream, main thread only
+//-----------------------------------------------------------------------------
+void CDemoAnalyzer::Close()
+{
+	if ( m_pNetChannel )
+	{
+		delete m_pNetChannel;
+		m_pNetChannel = NULL;
+	}
+
+	m_DemoFile.Close();
+
+	if ( m_hOutput != FILESYSTEM_INVALID_HANDLE )
+	{
+		Flush();
+		g_pFileSystem->Close( m_hOutput );
+		m_hOutput = FILESYSTEM_INVALID_HANDLE;
+	}
+}
+
+void CDemoAnalyzer::Flush()
+{
+	int nSize = m_Output.TellPut();
+	if ( !nSize || m_hOutput == FILESYSTEM_INVALID_HANDLE )
+		return;
+
+	if ( g_pFileSystem->Write( m_Output.Base(), nSize, m_hOutput ) != nSize )
+	{
+		Fail( "error writing %s", m_szOutputName );
+	}
+
+	m_nOutputSize += nSize;
+	m_Output.Clear();
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads the SendTables and the class list of a dem_datatables command,
+//			see DataTable_LoadDataTablesFromBuffer
+//-----------------------------------------------------------------------------
+bool CDemoAnalyzer::ReadDataTables( bf_read &buf )
+{
+	while ( buf.ReadOneBit() != 0 )
+	{
+		buf.ReadOneBit();	// needs decoder, all tables are decoded here
+
+		SendTable *pTable = RecvTable_ReadInfos( &buf, m_nDemoProtocol );
+		if ( !pTable )
+		{
+			Fail( "failed to read network data tables" );
+			return false;
+		}
+
+		m_SendTables.AddToTail( pTable );
+	}
+
+	int nClasses = buf.ReadShort();
+	if ( nClasses <= 0 || nClasses > MAX_SERVER_CLASSES || m_Classes.Count() )
+	{
+		Fail( "invalid class list (%d classes)", nClasses );
+		return false;
+	}
+
+	m_Classes.SetCount( nClasses );
+	for ( int i = 0; i < nClasses; i++ )
+	{
+		m_Classes[i].m_pPrecalc = NULL;
+	}
+
+	for ( int i = 0; i < nClasses; i++ )
+	{
+		int classID = buf.ReadShort();
+		if ( classID < 0 || classID >= nClasses )
+		{
+			Fail( "invalid class index (%d)", classID );
+			return false;
+		}
+
+		char szName[256];
+		buf.ReadString( szName, sizeof( szName ) );
+		m_Classes[classID].m_ClassName = szName;
+		buf.ReadString( szName, sizeof( szName ) );
+		m_Classes[classID].m_TableName = szName;
+	}
+
+	if ( buf.IsOverflowed() )
+	{
+		Fail( "network data tables overflowed" );
+		return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Links the SendTables into their hierarchy, builds the flat property
+//			list of each class and writes the dma_class records
+//-----------------------------------------------------------------------------
+bool CDemoAnalyzer::LinkClasses()
+{
+	if ( !m_Classes.Count() || !m_SendTables.Count() )
+	{
+		Fail( "entities received before the class list" );
+		return false;
+	}
+
+	// The first table of a name wins if the server sent its tables and the demo has them as well
+	CUtlDict< SendTable *, int > tables;
+	for ( int i = 0; i < m_SendTables.Count(); i++ )
+	{
+		SendTable *pTable = m_SendTables[i];
+		if ( tables.Find( pTable->GetName() ) == tables.InvalidIndex() )
+		{
+			tables.Insert( pTable->GetName(), pTable );
+		}
+	}
+
+	// Find all child datatable properties, like SetupClientSendTableHierarchy
+	for ( int i = 0; i < m_SendTables.Count(); i++ )
+	{
+		SendTable *pTable = m_SendTables[i];
+		for ( int iProp = 0; iProp < pTable->GetNumProps(); iProp++ )
+		{
+			SendProp *pProp = pTable->GetProp( iProp );
+			if ( pProp->GetType() != DPT_DataTable )
+				continue;
+
+			const char *pTableName = pProp->GetExcludeDTName();
+			int iChild = pTableName ? tables.Find( pTableName ) : tables.InvalidIndex();
+			if ( iChild == tables.InvalidIndex() )
+			{
+				Fail( "missing SendTable '%s' (referenced by '%s')", pTableName ? pTableName : "", pTable->GetName() );
+				return false;
+			}
+
+			pProp->SetDataTable( tables[iChild] );
+		}
+	}
+
+	// SetupFlatPropertyArray recurses into the children without a depth limit
+	CUtlVector< unsigned char > visited;
+	visited.SetCount( m_SendTables.Count() );
+	for ( int i = 0; i < visited.Count(); i++ )
+	{
+		visited[i] = 0;
+	}
+
+	for ( int i = 0; i < m_SendTables.Count(); i++ )
+	{
+		if ( IsCyclicTable( i, visited ) )
+		{
+			Fail( "SendTable '%s' contains itself", m_SendTables[i]->GetName() );
+			return false;
+		}
+	}
+
+	for ( int iClass = 0; iClass < m_Classes.Count(); iClass++ )
+	{
+		DemoClass_t &serverClass = m_Classes[iClass];
+
+		int iTable = tables.Find( serverClass.m_TableName.Get() );
+		if ( iTable == tables.InvalidIndex() )
+		{
+			Fail( "missing SendTable '%s' for class %s", serverClass.m_TableName.Get(), serverClass.m_ClassName.Get() );
+			return false;
+		}
+
+		SendTable *pTable = tables[iTable];
+		if ( !pTable->m_pPrecalc )
+		{
+			CSendTablePrecalc *pPrecalc = new CSendTablePrecalc;
+			pPrecalc->m_pSendTable = pTable;
+			pTable->m_pPrecalc = pPrecalc;
+			m_Precalcs.AddToTail( pPrecalc );
+
+			if ( !pPrecalc->SetupFlatPropertyArray() )
+			{
+				Fail( "failed to set up SendTable '%s'", pTable->GetName() );
+				return false;
+			}
+		}
+
+		CSendTablePrecalc *pPrecalc = pTable->m_pPrecalc;
+		serverClass.m_pPrecalc = pPrecalc;
+
+		m_Output.PutUnsignedChar( dma_class );
+		m_Output.PutShort( iClass );
+		m_Output.PutString( serverClass.m_ClassName.Get() );
+		m_Output.PutString( serverClass.m_TableName.Get() );
+		m_Output.PutShort( pPrecalc->GetNumProps() );
+
+		for ( int iProp = 0; iProp < pPrecalc->GetNumProps(); iProp++ )
+		{
+			const SendProp *pProp = pPrecalc->GetProp( iProp );
+			if ( !IsValidProp( pProp, pTable ) )
+				return false;
+
+			int nType = pProp->GetType();
+			const SendProp *pElement = ( nType == DPT_Array ) ? pProp->GetArrayProp() : NULL;
+
+			m_Output.PutUnsignedChar( nType );
+			if ( pElement )
+			{
+				m_Output.PutUnsignedChar( pElement->GetType() );
+			}
+			m_Output.PutString( pProp->GetName() );
+		}
+	}
+
+	m_bClassesLinked = true;
+	return true;
+}
+
+// Depth first search over the child tables, visited is 0 for new tables,
+// 1 while their children are searched and 2 once they are done
+bool CDemoAnalyzer::IsCyclicTable( int iTable, CUtlVector< unsigned char > &visited )
+{
+	if ( visited[iTable] )
+		return visited[iTable] == 1;
+
+	visited[iTable] = 1;
+
+	SendTable *pTable = m_SendTables[iTable];
+	for ( int iProp = 0; iProp < pTable->GetNumProps(); iProp++ )
+	{
+		SendProp *pProp = pTable->GetProp( iProp );
+		if ( pProp->GetType() != DPT_DataTable )
+			continue;
+
+		int iChild = m_SendTables.Find( pProp->GetDataTable() );
+		if ( iChild != m_SendTables.InvalidIndex() && IsCyclicTable( iChild, visited ) )
+			return true;
+	}
+
+	visited[iTable] = 2;
+	return false;
+}
+
+// The decoders index g_PropTypeFns with the type, read m_nBits at once and
+// treat a float range that's upside down as fatal, don't trust any of them
+bool CDemoAnalyzer::IsValidProp( const SendProp *pProp, const SendTable *pTable )
+{
+	int nType = pProp->GetType();
+
+	if ( nType == DPT_Array )
+	{
+		const SendProp *pElement = pProp->GetArrayProp();
+		if ( !pElement || pElement->GetType() == DPT_Array )
+		{
+			Fail( "invalid array %s in SendTable '%s'", pProp->GetName(), pTable->GetName() );
+			return false;
+		}
+
+		return IsValidProp( pElement, pTable );
+	}
+
+	int nMaxBits = 32;
+	switch ( nType )
+	{
+	case DPT_Int:
+	case DPT_Float:
+	case DPT_Vector:
+	case DPT_VectorXY:
+	case DPT_String:
+		break;
+#ifdef SUPPORTS_INT64
+	case DPT_Int64:
+		nMaxBits = 64;
+		break;
+#endif
+	default:
+		Fail( "invalid type %d for %s in SendTable '%s'", nType, pProp->GetName(), pTable->GetName() );
+		return false;
+	}
+
+	if ( nType != DPT_String && ( pProp->m_nBits < 0 || pProp->m_nBits > nMaxBits ) )
+	{
+		Fail( "invalid bit count %d for %s in SendTable '%s'", pProp->m_nBits, pProp->GetName(), pTable->GetName() );
+		return false;
+	}
+
+	bool bFloat = ( nType == DPT_Float || nType == DPT_Vector || nType == DPT_VectorXY );
+	if ( bFloat && !( pProp->m_fLowValue <= pProp->m_fHighValue ) )
+	{
+		Fail( "invalid range for %s in SendTable '%s'", pProp->GetName(), pTable->GetName() );
+		return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Net message handlers
+//-----------------------------------------------------------------------------
+#define REGISTER_NET_MSG( name )				\
+	NET_##name * p##name = new NET_##name();	\
+	p##name->m_pMessageHandler = this;			\
+	chan->RegisterMessage( p##name );			\
+
+#define REGISTER_SVC_MSG( name )				\
+	SVC_##name * p##name = new SVC_##name();	\
+	p##name->m_pMessageHandler = this;			\
+	chan->RegisterMessage( p##name );			\
+
+void CDemoAnalyzer::ConnectionStart( INetChannel *chan )
+{
+	REGISTER_NET_MSG( Tick );
+	REGISTER_NET_MSG( StringCmd );
+	REGISTER_NET_MSG( SetConVar );
+	REGISTER_NET_MSG( SignonState );
+
+	REGISTER_SVC_MSG( Print );
+	REGISTER_SVC_MSG( ServerInfo );
+	REGISTER_SVC_MSG( SendTable );
+	REGISTER_SVC_MSG( ClassInfo );
+	REGISTER_SVC_MSG( SetPause );
+	REGISTER_SVC_MSG( CreateStringTable );
+	REGISTER_SVC_MSG( UpdateStringTable );
+	REGISTER_SVC_MSG( VoiceInit );
+	REGISTER_SVC_MSG( VoiceData );
+	REGISTER_SVC_MSG( Sounds );
+	REGISTER_SVC_MSG( SetView );
+	REGISTER_SVC_MSG( FixAngle );
+	REGISTER_SVC_MSG( CrosshairAngle );
+	REGISTER_SVC_MSG( BSPDecal );
+	REGISTER_SVC_MSG( GameEvent );
+	REGISTER_SVC_MSG( UserMessage );
+	REGISTER_SVC_MSG( EntityMessage );
+	REGISTER_SVC_MSG( PacketEntities );
+	REGISTER_SVC_MSG( TempEntities );
+	REGISTER_SVC_MSG( Prefetch );
+	REGISTER_SVC_MSG( Menu );
+	REGISTER_SVC_MSG( GameEventList );
+	REGISTER_SVC_MSG( GetCvarValue );
+	REGISTER_SVC_MSG( CmdKeyValues );
+	REGISTER_SVC_MSG( SetPauseTimed );
+}
+
+bool CDemoAnalyzer::ProcessTick( NET_Tick *msg )
+{
+	m_nTick = msg->m_nTick;
+	return true;
+}
+
+bool CDemoAnalyzer::ProcessServerInfo( SVC_ServerInfo *msg )
+{
+	// the tables and entities would have to be started over, demos end at a level change anyway
+	if ( m_nServerClasses )
+	{
+		Fail( "server info received twice" );
+		return false;
+	}
+
+	m_nServerClasses = msg->m_nMaxClasses;
+	m_nServerClassBits = Q_log2( m_nServerClasses ) + 1;
+
+	m_Output.PutUnsignedChar( dma_serverinfo );
+	m_Output.PutFloat( msg->m_fTickInterval );
+	m_Output.PutShort( msg->m_nMaxClasses );
+	return true;
+}
+
+bool CDemoAnalyzer::ProcessSendTable( SVC_SendTable *msg )
+{
+	SendTable *pTable = RecvTable_ReadInfos( &msg->m_DataIn, m_nDemoProtocol );
+	if ( !pTable )
+	{
+		Fail( "failed to read SendTable" );
+		return false;
+	}
+
+	m_SendTables.AddToTail( pTable );
+	return true;
+}
+
+bool CDemoAnalyzer::ProcessClassInfo( SVC_ClassInfo *msg )
+{
+	// the classes are in the demo's dem_datatables then
+	if ( msg->m_bCreateOnClient )
+		return true;
+
+	if ( m_Classes.Count() )
+	{
+		Fail( "class list received twice" );
+		return false;
+	}
+
+	int nClasses = msg->m_Classes.Count();
+	m_Classes.SetCount( nClasses );
+	for ( int i = 0; i < nClasses; i++ )
+	{
+		m_Classes[i].m_pPrecalc = NULL;
+	}
+
+	for ( int i = 0; i < nClasses; i++ )
+	{
+		SVC_ClassInfo::class_t *svclass = &msg->m_Classes[ i ];
+
+		if ( svclass->classID < 0 || svclass->classID >= nClasses )
+		{
+			Fail( "invalid class index (%d)", svclass->classID );
+			return false;
+		}
+
+		m_Classes[svclass->classID].m_ClassName = svclass->classname;
+		m_Classes[svclass->classID].m_TableName = svclass->datatablename;
+	}
+
+	return true;
+}
+
+bool CDemoAnalyzer::ProcessCreateStringTable( SVC_CreateStringTable *msg )
+{
+	// CreateStringTableEx and the table constructor treat these as fatal
+	if ( m_StringTables.FindTable( msg->m_szTableName ) || m_StringTables.GetNumTables() >= MAX_TABLES ||
+		!CNetworkStringTable::IsValidSetup( msg->m_nMaxEntries, msg->m_nUserDataSize, msg->m_nUserDataSizeBits ) )
+	{
+		Fail( "invalid string table %s", msg->m_szTableName );
+		return false;
+	}
+
+	int startbit = msg->m_DataIn.GetNumBitsRead();
+
+	m_StringTables.AllowCreation( true );
+
+	CNetworkStringTable *table = (CNetworkStringTable*)
+		m_StringTables.CreateStringTableEx( msg->m_szTableName, msg->m_nMaxEntries, msg->m_nUserDataSize, msg->m_nUserDataSizeBits, msg->m_bIsFilenames );
+
+	m_StringTables.AllowCreation( false );
+
+	table->SetTick( m_nTick ); // set creation tick
+
+	if ( !table->ParseCreate( msg->m_DataIn, msg->m_nNumEntries, msg->m_bDataCompressed ) ||
+		( msg->m_DataIn.GetNumBitsRead() - startbit ) != msg->m_nLength )
+	{
+		Fail( "malformed string table %s", msg->m_szTableName );
+		return false;
+	}
+
+	return true;
+}
+
+bool CDemoAnalyzer::ProcessUpdateStringTable( SVC_UpdateStringTable *msg )
+{
+	int startbit = msg->m_DataIn.GetNumBitsRead();
+
+	CNetworkStringTable *table = (CNetworkStringTable*)m_StringTables.GetTable( msg->m_nTableID );
+	if ( !table )
+	{
+		Fail( "update for unknown string table %d", msg->m_nTableID );
+		return false;
+	}
+
+	if ( !table->ParseUpdate( msg->m_DataIn, msg->m_nChangedEntries ) ||
+		( msg->m_DataIn.GetNumBitsRead() - startbit ) != msg->m_nLength )
+	{
+		Fail( "malformed update for string table %s", table->GetTableName() );
+		return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Registers the events the demo lists with the demo's own event manager
+//			and writes their dma_eventtype records
+//-----------------------------------------------------------------------------
+bool CDemoAnalyzer::ProcessGameEventList( SVC_GameEventList *msg )
+{
+	m_GameEvents.ParseEventList( msg, true );
+
+	if ( msg->m_DataIn.IsOverflowed() )
+	{
+		Fail( "malformed game event list" );
+		return false;
+	}
+
+	for ( int id = 0; id < MAX_EVENT_NUMBER; id++ )
+	{
+		CGameEventDescriptor *descriptor = m_GameEvents.GetEventDescriptor( id );
+		if ( !descriptor )
+			continue;
+
+		m_Output.PutUnsignedChar( dma_eventtype );
+		m_Output.PutShort( id );
+		m_Output.PutString( descriptor->name );
+		m_Output.PutUnsignedChar( descriptor->slots.Count() );
+		for ( int iSlot = 0; iSlot < descriptor->slots.Count(); iSlot++ )
+		{
+			m_Output.PutUnsignedChar( descriptor->slots[iSlot].type );
+			m_Output.PutString( descriptor->slots[iSlot].name );
+		}
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes a game event. Events that don't decode are dropped, the way
+//			the client drops them.
+//-----------------------------------------------------------------------------
+bool CDemoAnalyzer::ProcessGameEvent( SVC_GameEvent *msg )
+{
+	int startbit = msg->m_DataIn.GetNumBitsRead();
+
+	CGameEvent *pEvent = static_cast<CGameEvent*>( m_GameEvents.UnserializeEvent( &msg->m_DataIn ) );
+	if ( !pEvent )
+		return true;
+
+	if ( !msg->m_DataIn.IsOverflowed() && ( msg->m_DataIn.GetNumBitsRead() - startbit ) == msg->m_nLength )
+	{
+		WriteTick();
+
+		m_Output.PutUnsignedChar( dma_event );
+		m_Output.PutShort( pEvent->m_pDescriptor->eventid );
+		WriteEventValues( pEvent );
+
+		m_nEvents++;
+	}
+
+	m_GameEvents.FreeEvent( pEvent );
+	return true;
+}
+//-----------------------------------------------------------------------------
+// Purpose: Reads an entity update, see CHLTVClientState::ProcessPacketEntities
+//-----------------------------------------------------------------------------
+bool CDemoAnalyzer::ProcessPacketEntities( SVC_PacketEntities *entmsg )
+{
+	if ( !m_bClassesLinked && !LinkClasses() )
+		return false;
+
+	CClientFrame *oldFrame = NULL;
+
+	if ( entmsg->m_bIsDelta )
+	{
+		if ( m_nTick == entmsg->m_nDeltaFrom )
+		{
+			Fail( "update self-referencing" );
+			return false;
+		}
+
+		oldFrame = GetClientFrame( entmsg->m_nDeltaFrom );
+		if ( !oldFrame )
+		{
+			Fail( "delta from unknown tick %d", entmsg->m_nDeltaFrom );
+			return false;
+		}
+	}
+
+	if ( entmsg->m_nBaseline < 0 || entmsg->m_nBaseline > 1 )
+	{
+		Fail( "invalid baseline %d", entmsg->m_nBaseline );
+		return false;
+	}
+
+	if ( entmsg->m_bUpdateBaseline )
+	{
+		// server requested to use this snapshot as baseline update
+		int nUpdateBaseline = (entmsg->m_nBaseline == 0) ? 1 : 0;
+		for ( int i = 0; i < MAX_EDICTS; i++ )
+		{
+			m_pBaselines[nUpdateBaseline][i] = m_pBaselines[entmsg->m_nBaseline][i];
+		}
+	}
+
+	CClientFrame *pNewFrame = AllocateFrame();
+	pNewFrame->Init( m_nTick );
+
+	CEntityReadInfo u;
+	u.m_pBuf = &entmsg->m_DataIn;
+	u.m_pFrom = oldFrame;
+	u.m_pTo = pNewFrame;
+	u.m_bAsDelta = entmsg->m_bIsDelta;
+	u.m_nHeaderCount = entmsg->m_nUpdatedEntries;
+	u.m_nBaseline = entmsg->m_nBaseline;
+	u.m_bUpdateBaselines = entmsg->m_bUpdateBaseline;
+
+	CL_ReadPacketEntities( u, this );
+
+	if ( u.m_UpdateType == Failed || u.m_pBuf->IsOverflowed() || IsFailed() )
+	{
+		Fail( "failed to read entities" );
+		AddClientFrame( pNewFrame ); // freed with the other frames
+		return false;
+	}
+
+	// a full update lists every entity there is
+	if ( !entmsg->m_bIsDelta )
+	{
+		for ( int i = 0; i < MAX_EDICTS; i++ )
+		{
+			if ( !pNewFrame->transmit_entity.Get( i ) )
+			{
+				DeleteEntity( i, true );
+			}
+		}
+	}
+
+	// older frames aren't needed anymore, the server deltas from this one or newer ones
+	DeleteClientFrames( entmsg->m_bIsDelta ? entmsg->m_nDeltaFrom : -1 );
+
+	AddClientFrame( pNewFrame );
+	while ( CountClientFrames() > MAX_CLIENT_FRAMES )
+	{
+		RemoveOldestFrame();
+	}
+
+	return true;
+}
+
+void CDemoAnalyzer::ReadEnterPVS( CEntityReadInfo &u )
+{
+	int iClass = u.m_pBuf->ReadUBitLong( m_nServerClassBits );
+
+	int iSerialNum = u.m_pBuf->ReadUBitLong( NUM_NETWORKED_EHANDLE_SERIAL_NUMBER_BITS );
+
+	const int ent = u.m_nNewEntity;
+
+	if ( ent < 0 || ent >= MAX_EDICTS || iClass >= m_Classes.Count() )
+	{
+		Fail( "entity %d of invalid class %d entered", ent, iClass );
+		u.m_UpdateType = Failed;
+		return;
+	}
+
+	const CSendTablePrecalc *pPrecalc = m_Classes[iClass].m_pPrecalc;
+
+	// a different entity in the same slot, the old one is gone
+	EntityState_t &state = m_pEntities[ent];
+	if ( state.m_nClass >= 0 && ( state.m_nClass != iClass || state.m_nSerialNum != iSerialNum ) )
+	{
+		DeleteEntity( ent, true );
+	}
+
+	// Get either the static or instance baseline.
+	const void *pFromData = NULL;
+	int nFromBits = 0;
+
+	const EntityBaseline_t *pBaseline = u.m_bAsDelta ? &m_pBaselines[u.m_nBaseline][ent] : NULL;
+
+	if ( pBaseline && pBaseline->m_nClass == iClass )
+	{
+		pFromData = pBaseline->m_Data.Base();
+		nFromBits = pBaseline->m_nBits;
+	}
+	else if ( !GetClassBaseline( iClass, &pFromData, &nFromBits ) )
+	{
+		Fail( "no baseline for class %d", iClass );
+		u.m_UpdateType = Failed;
+		return;
+	}
+
+	ALIGN4 char packedData[MAX_PACKEDENTITY_DATA] ALIGN4_POST;
+	bf_read fromBuf( "CDemoAnalyzer::ReadEnterPVS1", pFromData, Bits2Bytes( nFromBits ), nFromBits );
+	bf_write writeBuf( "CDemoAnalyzer::ReadEnterPVS2", packedData, sizeof( packedData ) );
+
+	if ( SendTable_MergeDeltas( pPrecalc, &fromBuf, u.m_pBuf, &writeBuf ) < 0 )
+	{
+		Fail( "failed to read entity %d of class %s", ent, m_Classes[iClass].m_ClassName.Get() );
+		u.m_UpdateType = Failed;
+		return;
+	}
+
+	if ( u.m_bUpdateBaselines )
+	{
+		EntityBaseline_t &newBaseline = m_pBaselines[(u.m_nBaseline==0)?1:0][ent];
+		newBaseline.m_nClass = iClass;
+		newBaseline.m_Data.CopyArray( (unsigned char *)packedData, writeBuf.GetNumBytesWritten() );
+		newBaseline.m_nBits = writeBuf.GetNumBitsWritten();
+	}
+
+	state.m_nClass = iClass;
+	state.m_nSerialNum = iSerialNum;
+
+	WriteTick();
+	m_Output.PutUnsignedChar( dma_enter );
+	m_Output.PutShort( ent );
+	m_Output.PutShort( iClass );
+	m_Output.PutShort( iSerialNum );
+
+	bf_read mergedBuf( "CDemoAnalyzer::ReadEnterPVS3", packedData, writeBuf.GetNumBytesWritten() );
+	if ( !WriteProps( pPrecalc, &mergedBuf ) )
+	{
+		u.m_UpdateType = Failed;
+		return;
+	}
+
+	m_nEntityUpdates++;
+
+	u.m_pTo->last_entity = ent;
+	u.m_pTo->transmit_entity.Set( ent );
+
+	if ( u.m_nNewEntity == u.m_nOldEntity ) // that was a recreate
+		u.NextOldEntity();
+}
+
+void CDemoAnalyzer::ReadLeavePVS( CEntityReadInfo &u )
+{
+	if ( !u.m_bAsDelta )  // Should never happen on a full update.
+	{
+		Fail( "LeavePVS on full update" );
+		u.m_UpdateType = Failed;
+		return;
+	}
+
+	DeleteEntity( u.m_nOldEntity, ( u.m_UpdateFlags & FHDR_DELETE ) != 0 );
+
+	u.NextOldEntity();
+}
+
+void CDemoAnalyzer::ReadDeltaEnt( CEntityReadInfo &u )
+{
+	const int ent = u.m_nNewEntity;
+
+	if ( ent < 0 || ent >= MAX_EDICTS || m_pEntities[ent].m_nClass < 0 )
+	{
+		Fail( "delta for entity %d that doesn't exist", ent );
+		u.m_UpdateType = Failed;
+		return;
+	}
+
+	WriteTick();
+	m_Output.PutUnsignedChar( dma_props );
+	m_Output.PutShort( ent );
+
+	if ( !WriteProps( m_Classes[m_pEntities[ent].m_nClass].m_pPrecalc, u.m_pBuf ) )
+	{
+		u.m_UpdateType = Failed;
+		return;
+	}
+
+	m_nEntityUpdates++;
+
+	u.m_pTo->last_entity = ent;
+	u.m_pTo->transmit_entity.Set( ent );
+
+	u.NextOldEntity();
+}
+
+void CDemoAnalyzer::ReadPreserveEnt( CEntityReadInfo &u )
+{
+	// copy one of the old entities over to the new packet unchanged
+	if ( !u.m_bAsDelta )  // Should never happen on a full update.
+	{
+		Fail( "PreserveEnt on full update" );
+		u.m_UpdateType = Failed;
+		return;
+	}
+
+	if ( u.m_nOldEntity >= MAX_EDICTS || u.m_nOldEntity < 0 || u.m_nNewEntity >= MAX_EDICTS )
+	{
+		Fail( "entity out of bounds. Old: %i, New: %i", u.m_nOldEntity, u.m_nNewEntity );
+		u.m_UpdateType = Failed;
+		return;
+	}
+
+	u.m_pTo->last_entity = u.m_nOldEntity;
+	u.m_pTo->transmit_entity.Set( u.m_nOldEntity );
+
+	u.NextOldEntity();
+}
+
+void CDemoAnalyzer::ReadDeletions( CEntityReadInfo &u )
+{
+	while ( u.m_pBuf->ReadOneBit() != 0 && !u.m_pBuf->IsOverflowed() )
+	{
+		int idx = u.m_pBuf->ReadUBitLong( MAX_EDICT_BITS );
+
+		DeleteEntity( idx, true );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Gets the instance baseline of a class, see CBaseClientState::GetClassBaseline
+//-----------------------------------------------------------------------------
+bool CDemoAnalyzer::GetClassBaseline( int iClass, const void **pData, int *pBits )
+{
+	INetworkStringTable *pBaselineTable = m_StringTables.FindTable( INSTANCE_BASELINE_TABLENAME );
+	if ( !pBaselineTable )
+		return false;
+
+	// The key is the class index string.
+	char str[64];
+	Q_snprintf( str, sizeof( str ), "%d", iClass );
+
+	int index = pBaselineTable->FindStringIndex( str );
+	if ( index == INVALID_STRING_INDEX )
+		return false;
+
+	int nBytes = 0;
+	*pData = pBaselineTable->GetStringUserData( index, &nBytes );
+	*pBits = nBytes * 8;
+	return *pData != NULL;
+}
+
+void CDemoAnalyzer::DeleteEntity( int iEntity, bool bDeleted )
+{
+	EntityState_t &state = m_pEntities[iEntity];
+	if ( state.m_nClass < 0 )
+		return;
+
+	WriteTick();
+	m_Output.PutUnsignedChar( dma_leave );
+	m_Output.PutShort( iEntity );
+	m_Output.PutUnsignedChar( bDeleted ? 1 : 0 );
+
+	if ( bDeleted )
+	{
+		state.m_nClass = -1;
+	}
+}
+
+void CDemoAnalyzer::WriteTick()
+{
+	if ( m_nTick == m_nWrittenTick )
+		return;
+
+	m_Output.PutUnsignedChar( dma_tick );
+	m_Output.PutInt( m_nTick );
+
+	m_nWrittenTick = m_nTick;
+	m_nTicks++;
+}
+
+bool CDemoAnalyzer::WriteProps( const CSendTablePrecalc *pPrecalc, bf_read *pIn )
+{
+	const unsigned int nProps = pPrecalc->GetNumProps();
+
+	CDeltaBitsReader reader( pIn );
+
+	for ( unsigned int iProp = reader.ReadNextPropIndex(); iProp != ~0u; iProp = reader.ReadNextPropIndex() )
+	{
+		if ( iProp >= nProps )
+		{
+			reader.ForceFinished();
+			Fail( "invalid prop index %u in SendTable '%s'", iProp, pPrecalc->GetSendTable()->GetName() );
+			return false;
+		}
+
+		m_Output.PutShort( iProp );
+		WritePropValue( pPrecalc->GetProp( iProp ), pIn );
+	}
+
+	m_Output.PutShort( -1 );
+
+	if ( pIn->IsOverflowed() )
+	{
+		Fail( "entity data overflowed in SendTable '%s'", pPrecalc->GetSendTable()->GetName() );
+		return false;
+	}
+
+	return true;
+}
+
+void CDemoAnalyzer::WritePropValue( const SendProp *pProp, bf_read *pIn )
+{
+	switch ( pProp->GetType() )
+	{
+	case DPT_String:
+		{
+			// String_Decode needs a RecvProp to warn about bad lengths, read it here
+			char szString[DT_MAX_STRING_BUFFERSIZE];
+			int nLength = MIN( (int)pIn->ReadUBitLong( DT_MAX_STRING_BITS ), DT_MAX_STRING_BUFFERSIZE - 1 );
+			pIn->ReadBits( szString, nLength * 8 );
+			szString[nLength] = 0;
+			m_Output.PutString( szString );
+		}
+		break;
+
+	case DPT_Array:
+		{
+			const SendProp *pElement = pProp->GetArrayProp();
+			int nElements = pIn->ReadUBitLong( pProp->GetNumArrayLengthBits() );
+
+			m_Output.PutShort( nElements );
+			for ( int i = 0; i < nElements; i++ )
+			{
+				WritePropValue( pElement, pIn );
+			}
+		}
+		break;
+
+	default:
+		{
+			DecodeInfo info;
+			info.m_pStruct = NULL;
+			info.m_pData = NULL;
+			info.m_pRecvProp = NULL;
+			info.m_pProp = pProp;
+			info.m_pIn = pIn;
+			info.m_ObjectID = -1;
+			info.m_Value.m_Type = (SendPropType)pProp->GetType();
+
+			g_PropTypeFns[pProp->GetType()].Decode( &info );
+
+			switch ( pProp->GetType() )
+			{
+			case DPT_Int:
+				m_Output.PutInt( info.m_Value.m_Int );
+				break;
+			case DPT_Float:
+				m_Output.PutFloat( info.m_Value.m_Float );
+				break;
+			case DPT_Vector:
+				m_Output.PutFloat( info.m_Value.m_Vector[0] );
+				m_Output.PutFloat( info.m_Value.m_Vector[1] );
+				m_Output.PutFloat( info.m_Value.m_Vector[2] );
+				break;
+			case DPT_VectorXY:
+				m_Output.PutFloat( info.m_Value.m_Vector[0] );
+				m_Output.PutFloat( info.m_Value.m_Vector[1] );
+				break;
+#ifdef SUPPORTS_INT64
+			case DPT_Int64:
+				m_Output.PutInt64( info.m_Value.m_Int64 );
+				break;
+#endif
+			}
+		}
+		break;
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Writes the slots of an event, then the keys it sent by name
+//-----------------------------------------------------------------------------
+void CDemoAnalyzer::WriteEventValues( CGameEvent *pEvent )
+{
+	const CGameEventDescriptor *descriptor = pEvent->m_pDescriptor;
+
+	for ( int i = 0; i < descriptor->slots.Count(); i++ )
+	{
+		if ( !pEvent->IsSlotSet( i ) )
+		{
+			m_Output.PutUnsignedChar( 0 );
+			continue;
+		}
+
+		m_Output.PutUnsignedChar( 1 );
+
+		int type = descriptor->slots[i].type;
+
+		switch ( type )
+		{
+			case CGameEventManager::TYPE_STRING	: m_Output.PutString( pEvent->GetStringBySlot( i ) ); break;
+			case CGameEventManager::TYPE_FLOAT	: m_Output.PutFloat( pEvent->GetFloatBySlot( i ) ); break;
+			case CGameEventManager::TYPE_LONG	: m_Output.PutInt( pEvent->GetIntBySlot( i ) ); break;
+			case CGameEventManager::TYPE_SHORT	: m_Output.PutShort( pEvent->GetIntBySlot( i ) ); break;
+			case CGameEventManager::TYPE_BYTE	:
+			case CGameEventManager::TYPE_BOOL	: m_Output.PutUnsignedChar( pEvent->GetIntBySlot( i ) ); break;
+			case CGameEventManager::TYPE_FLOAT_ARRAY :
+			case CGameEventManager::TYPE_LONG_ARRAY :
+				{
+					// read back as stored, so floats keep their bits
+					bool bFloat = ( type == CGameEventManager::TYPE_FLOAT_ARRAY );
+					int count = pEvent->GetArrayBySlot( i, NULL, INT_MAX, bFloat );	// the whole array
+
+					CUtlVectorFixedGrowable<int, 256> values;
+					values.SetCount( count );
+					pEvent->GetArrayBySlot( i, values.Base(), count, bFloat );
+
+					m_Output.PutInt( count );
+					for ( int iValue = 0; iValue < count; iValue++ )
+					{
+						m_Output.PutUnsignedInt( values[iValue] );
+					}
+					break;
+				}
+		}
+	}
+
+	KeyValues *pExtraKeys = pEvent->GetExtraKeys( false );
+
+	int keyCount = 0;
+	for ( KeyValues *pKey = pExtraKeys ? pExtraKeys->GetFirstSubKey() : NULL; pKey; pKey = pKey->GetNextKey() )
+	{
+		keyCount++;
+	}
+
+	m_Output.PutInt( keyCount );
+
+	for ( KeyValues *pKey = pExtraKeys ? pExtraKeys->GetFirstSubKey() : NULL; pKey; pKey = pKey->GetNextKey() )
+	{
+		int type = pKey->GetDataType();
+
+		m_Output.PutString( pKey->GetName() );
+		m_Output.PutUnsignedChar( type );
+
+		switch ( type )
+		{
+			case KeyValues::TYPE_STRING	: m_Output.PutString( pKey->GetString() ); break;
+			case KeyValues::TYPE_FLOAT	: m_Output.PutFloat( pKey->GetFloat() ); break;
+			case KeyValues::TYPE_INT	: m_Output.PutInt( pKey->GetInt() ); break;
+			default: break;
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// demo_analyze
+//-----------------------------------------------------------------------------
+// Demos are decoded on a pool of their own, polled by DemoAnalyzer_Frame. Opening,
+// closing and reporting stays on the main thread.
+struct DemoAnalyzeJob_t
+{
+	CDemoAnalyzer	*m_pAnalyzer;
+	CJob			*m_pJob;
+};
+
+static IThreadPool *s_pDemoAnalyzePool = NULL;
+static CUtlVector< CUtlString > s_DemoAnalyzeQueue;
+static CUtlVector< DemoAnalyzeJob_t > s_DemoAnalyzeJobs;
+static int s_nDemoAnalyzeDemos = 0;
+static int s_nDemoAnalyzeFailed = 0;
+static double s_flDemoAnalyzeStartTime = 0.0;
+
+static void DemoAnalyzer_AddDemos( const char *pArg, CUtlVector< CUtlString > &demos )
+{
+	char szName[ MAX_OSPATH ];
+	Q_strncpy( szName, pArg, sizeof( szName ) );
+	Q_DefaultExtension( szName, ".dem", sizeof( szName ) );
+
+	if ( !strchr( szName, '*' ) && !strchr( szName, '?' ) )
+	{
+		demos.AddToTail( szName );
+		return;
+	}
+
+	// the find only returns file names, keep the directory of the wildcard
+	char szPath[ MAX_OSPATH ];
+	V_ExtractFilePath( szName, szPath, sizeof( szPath ) );
+
+	FileFindHandle_t findHandle;
+	for ( const char *pFile = g_pFileSystem->FindFirst( szName, &findHandle ); pFile; pFile = g_pFileSystem->FindNext( findHandle ) )
+	{
+		if ( g_pFileSystem->FindIsDirectory( findHandle ) )
+			continue;
+
+		char szFile[ MAX_OSPATH ];
+		Q_snprintf( szFile, sizeof( szFile ), "%s%s", szPath, pFile );
+		demos.AddToTail( szFile );
+	}
+	g_pFileSystem->FindClose( findHandle );
+}
+
+CON_COMMAND( demo_analyze, "Decode demos into entity state and game event streams (" DEMO_ANALYSIS_EXTENSION "). Arguments: <demo or wildcard> ..." )
+{
+	if ( args.ArgC() < 2 )
+	{
+		ConMsg( "Usage: demo_analyze <demo or wildcard> [<demo or wildcard> ...]\n" );
+		return;
+	}
+
+	CUtlVector< CUtlString > demos;
+	for ( int i = 1; i < args.ArgC(); i++ )
+	{
+		DemoAnalyzer_AddDemos( args[i], demos );
+	}
+
+	if ( !demos.Count() )
+	{
+		ConMsg( "demo_analyze: no demos found.\n" );
+		return;
+	}
+
+	if ( !s_pDemoAnalyzePool )
+	{
+		ThreadPoolStartParams_t params;
+		params.nThreads = MAX( 1, g_pThreadPool ? g_pThreadPool->NumThreads() : 0 );
+		params.fDistribute = TRS_FALSE;
+
+		s_pDemoAnalyzePool = CreateThreadPool();
+		s_pDemoAnalyzePool->Start( params, "DemoAnalyze" );
+	}
+
+	if ( !s_DemoAnalyzeQueue.Count() && !s_DemoAnalyzeJobs.Count() )
+	{
+		s_nDemoAnalyzeDemos = 0;
+		s_nDemoAnalyzeFailed = 0;
+		s_flDemoAnalyzeStartTime = Plat_FloatTime();
+	}
+
+	s_DemoAnalyzeQueue.AddVectorToTail( demos );
+	s_nDemoAnalyzeDemos += demos.Count();
+
+	ConMsg( "demo_analyze: %d demos queued\n", s_DemoAnalyzeQueue.Count() );
+}
+
+static void DemoAnalyzer_Finish( CDemoAnalyzer *pAnalyzer )
+{
+	pAnalyzer->Close();
+
+	if ( pAnalyzer->GetError()[0] )
+	{
+		ConMsg( "%s: failed after %d ticks: %s\n", pAnalyzer->GetDemoName(), pAnalyzer->GetNumTicks(), pAnalyzer->GetError() );
+		s_nDemoAnalyzeFailed++;
+	}
+	else
+	{
+		ConMsg( "%s: %d ticks, %d entity updates, %d events, %d bytes to %s in %.0f ms\n",
+			pAnalyzer->GetDemoName(), pAnalyzer->GetNumTicks(), pAnalyzer->GetNumEntityUpdates(),
+			pAnalyzer->GetNumEvents(), pAnalyzer->GetOutputSize(), pAnalyzer->GetOutputName(),
+			pAnalyzer->GetRunTime() * 1000.0f );
+	}
+
+	delete pAnalyzer;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Reports the demos that are done and starts the queued ones, once per host frame
+//-----------------------------------------------------------------------------
+void DemoAnalyzer_Frame()
+{
+	if ( !s_DemoAnalyzeQueue.Count() && !s_DemoAnalyzeJobs.Count() )
+		return;
+
+	for ( int i = 0; i < s_DemoAnalyzeJobs.Count(); )
+	{
+		DemoAnalyzeJob_t &job = s_DemoAnalyzeJobs[i];
+		if ( !job.m_pJob->IsFinished() )
+		{
+			i++;
+			continue;
+		}
+
+		job.m_pJob->Release();
+		DemoAnalyzer_Finish( job.m_pAnalyzer );
+		s_DemoAnalyzeJobs.Remove( i );
+	}
+
+	// keep every thread busy without opening all demos at once
+	int nMaxJobs = 2 * s_pDemoAnalyzePool->NumThreads();
+
+	while ( s_DemoAnalyzeQueue.Count() && s_DemoAnalyzeJobs.Count() < nMaxJobs )
+	{
+		CUtlString demoName = s_DemoAnalyzeQueue[0];
+		s_DemoAnalyzeQueue.Remove( 0 );
+
+		CDemoAnalyzer *pAnalyzer = new CDemoAnalyzer;
+		if ( !pAnalyzer->Open( demoName.Get() ) )
+		{
+			ConMsg( "%s: %s\n", demoName.Get(), pAnalyzer->GetError() );
+			s_nDemoAnalyzeFailed++;
+			delete pAnalyzer;
+			continue;
+		}
+
+		DemoAnalyzeJob_t &job = s_DemoAnalyzeJobs[ s_DemoAnalyzeJobs.AddToTail() ];
+		job.m_pAnalyzer = pAnalyzer;
+		job.m_pJob = s_pDemoAnalyzePool->QueueCall( pAnalyzer, &CDemoAnalyzer::Run );
+	}
+
+	if ( !s_DemoAnalyzeQueue.Count() && !s_DemoAnalyzeJobs.Count() )
+	{
+		ConMsg( "demo_analyze: %d demos, %d failed, %.2f seconds\n", s_nDemoAnalyzeDemos, s_nDemoAnalyzeFailed, Plat_FloatTime() - s_flDemoAnalyzeStartTime );
+	}
+}
+
+void DemoAnalyzer_Shutdown()
+{
+	s_DemoAnalyzeQueue.Purge();
+
+	for ( int i = 0; i < s_DemoAnalyzeJobs.Count(); i++ )
+	{
+		s_DemoAnalyzeJobs[i].m_pAnalyzer->Abort();
+	}
+
+	for ( int i = 0; i < s_DemoAnalyzeJobs.Count(); i++ )
+	{
+		DemoAnalyzeJob_t &job = s_DemoAnalyzeJobs[i];
+		job.m_pJob->WaitForFinish( TT_INFINITE, s_pDemoAnalyzePool );
+		job.m_pJob->Release();
+
+		job.m_pAnalyzer->Close();
+		delete job.m_pAnalyzer;
+	}
+
+	s_DemoAnalyzeJobs.Purge();
+
+	if ( s_pDemoAnalyzePool )
+	{
+		s_pDemoAnalyzePool->Stop();
+		s_pDemoAnalyzePool->Release();
+		s_pDemoAnalyzePool = NULL;
+	}
+}
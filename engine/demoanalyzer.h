@@ -0,0 +1,193 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Decodes a demo without a client, writing the entity state and
+//			game events of every tick to an analysis stream (demo_analyze)
+//
+//===========================================================================//
+
+#ifndef DEMOANALYZER_H
+#define DEMOANALYZER_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "inetmsghandler.h"
+#include "demofile.h"
+#include "networkstringtable.h"
+#include "baseclientstate.h"
+#include "clientframe.h"
+#include "GameEventManager.h"
+#include "tier1/utlbuffer.h"
+#include "tier1/utlstring.h"
+#include "tier1/utlvector.h"
+#include "filesystem.h"
+
+class CNetChan;
+class SendTable;
+class SendProp;
+class CSendTablePrecalc;
+
+//-----------------------------------------------------------------------------
+// Reads one demo on its own: the demo's SendTables, string tables, entities and
+// game event descriptors are kept here rather than in the client state, so
+// several demos can be analyzed at once on different threads. Open and Close
+// run on the main thread, Run runs as a job on the demo_analyze thread pool.
+// A corrupt demo makes Run stop with an error, it never ends the game.
+//-----------------------------------------------------------------------------
+class CDemoAnalyzer : public INetChannelHandler, public IServerMessageHandler, public IEntityReadHandler, public CClientFrameManager
+{
+public:
+	CDemoAnalyzer();
+	virtual ~CDemoAnalyzer();
+
+	bool	Open( const char *pDemoName );
+	void	Run();
+	void	Abort() { m_bAbort = true; }	// makes Run return early, from any thread
+	void	Close();
+
+	const char *GetDemoName() const { return m_szDemoName; }
+	const char *GetOutputName() const { return m_szOutputName; }
+	const char *GetError() const { return m_szError; }	// empty if the demo was read to its end
+
+	int		GetNumTicks() const { return m_nTicks; }
+	int		GetNumEntityUpdates() const { return m_nEntityUpdates; }
+	int		GetNumEvents() const { return m_nEvents; }
+	int		GetOutputSize() const { return m_nOutputSize; }
+	float	GetRunTime() const { return m_flRunTime; }
+
+public: // INetChannelHandler
+
+	virtual void ConnectionStart( INetChannel *chan );
+	virtual void ConnectionClosing( const char *reason ) {}
+	virtual void ConnectionCrashed( const char *reason ) { Fail( "%s", reason ); }
+	virtual void PacketStart( int incoming_sequence, int outgoing_acknowledged ) {}
+	virtual void PacketEnd( void ) {}
+	virtual void FileRequested( const char *fileName, unsigned int transferID ) {}
+	virtual void FileReceived( const char *fileName, unsigned int transferID ) {}
+	virtual void FileDenied( const char *fileName, unsigned int transferID ) {}
+	virtual void FileSent( const char *fileName, unsigned int transferID ) {}
+
+public: // IServerMessageHandler
+
+	virtual int GetDemoProtocolVersion() const { return m_nNetworkProtocol; }
+
+	PROCESS_NET_MESSAGE( Tick );
+	PROCESS_NET_MESSAGE( StringCmd ) { return true; }
+	PROCESS_NET_MESSAGE( SetConVar ) { return true; }
+	PROCESS_NET_MESSAGE( SignonState ) { return true; }
+
+	PROCESS_SVC_MESSAGE( Print ) { return true; }
+	PROCESS_SVC_MESSAGE( ServerInfo );
+	PROCESS_SVC_MESSAGE( SendTable );
+	PROCESS_SVC_MESSAGE( ClassInfo );
+	PROCESS_SVC_MESSAGE( SetPause ) { return true; }
+	PROCESS_SVC_MESSAGE( CreateStringTable );
+	PROCESS_SVC_MESSAGE( UpdateStringTable );
+	PROCESS_SVC_MESSAGE( VoiceInit ) { return true; }
+	PROCESS_SVC_MESSAGE( VoiceData ) { return true; }
+	PROCESS_SVC_MESSAGE( Sounds ) { return true; }
+	PROCESS_SVC_MESSAGE( SetView ) { return true; }
+	PROCESS_SVC_MESSAGE( FixAngle ) { return true; }
+	PROCESS_SVC_MESSAGE( CrosshairAngle ) { return true; }
+	PROCESS_SVC_MESSAGE( BSPDecal ) { return true; }
+	PROCESS_SVC_MESSAGE( GameEvent );
+	PROCESS_SVC_MESSAGE( UserMessage ) { return true; }
+	PROCESS_SVC_MESSAGE( EntityMessage ) { return true; }
+	PROCESS_SVC_MESSAGE( PacketEntities );
+	PROCESS_SVC_MESSAGE( TempEntities ) { return true; }
+	PROCESS_SVC_MESSAGE( Prefetch ) { return true; }
+	PROCESS_SVC_MESSAGE( Menu ) { return true; }
+	PROCESS_SVC_MESSAGE( GameEventList );
+	PROCESS_SVC_MESSAGE( GetCvarValue ) { return true; }
+	PROCESS_SVC_MESSAGE( CmdKeyValues ) { return true; }
+	PROCESS_SVC_MESSAGE( SetPauseTimed ) { return true; }
+
+public: // IEntityReadHandler
+
+	virtual void ReadEnterPVS( CEntityReadInfo &u );
+	virtual void ReadLeavePVS( CEntityReadInfo &u );
+	virtual void ReadDeltaEnt( CEntityReadInfo &u );
+	virtual void ReadPreserveEnt( CEntityReadInfo &u );
+	virtual void ReadDeletions( CEntityReadInfo &u );
+
+private:
+	struct DemoClass_t
+	{
+		CUtlString			m_ClassName;
+		CUtlString			m_TableName;
+		CSendTablePrecalc	*m_pPrecalc;		// NULL until the tables are linked
+	};
+
+	struct EntityState_t
+	{
+		int		m_nClass;					// -1 if the entity doesn't exist
+		int		m_nSerialNum;
+	};
+
+	struct EntityBaseline_t
+	{
+		int						m_nClass;	// -1 if there is no baseline
+		CUtlVector< unsigned char >	m_Data;
+		int						m_nBits;
+	};
+
+	void	Fail( PRINTF_FORMAT_STRING const char *pFormat, ... ) FMTFUNCTION( 2, 3 );
+	bool	IsFailed() const { return m_szError[0] != 0; }
+
+	bool	ReadDataTables( bf_read &buf );
+	bool	LinkClasses();
+	bool	IsCyclicTable( int iTable, CUtlVector< unsigned char > &visited );
+	bool	IsValidProp( const SendProp *pProp, const SendTable *pTable );
+
+	bool	GetClassBaseline( int iClass, const void **pData, int *pBits );
+	void	DeleteEntity( int iEntity, bool bDeleted );
+
+	// Writing the analysis stream
+	void	WriteTick();
+	bool	WriteProps( const CSendTablePrecalc *pPrecalc, bf_read *pIn );
+	void	WritePropValue( const SendProp *pProp, bf_read *pIn );
+	void	WriteEventValues( CGameEvent *pEvent );
+	void	Flush();
+
+	char					m_szDemoName[ MAX_OSPATH ];
+	char					m_szOutputName[ MAX_OSPATH ];
+	char					m_szError[ 256 ];
+
+	CDemoFile				m_DemoFile;
+	int						m_nNetworkProtocol;
+	int						m_nDemoProtocol;
+	CNetChan				*m_pNetChannel;		// not registered with the net system
+	volatile bool			m_bAbort;
+	FileHandle_t			m_hOutput;
+	CUtlBuffer				m_Output;
+	char					*m_pPacketData;		// NET_MAX_PAYLOAD, dem_packet being processed
+
+	CNetworkStringTableContainer	m_StringTables;
+
+	CUtlVector< SendTable * >	m_SendTables;
+	CUtlVector< DemoClass_t >	m_Classes;
+	CUtlVector< CSendTablePrecalc * >	m_Precalcs;
+	bool					m_bClassesLinked;
+	int						m_nServerClasses;
+	int						m_nServerClassBits;
+
+	EntityState_t			*m_pEntities;		// MAX_EDICTS
+	EntityBaseline_t		*m_pBaselines[2];	// MAX_EDICTS each, see SVC_PacketEntities::m_nBaseline
+
+	CGameEventManager		m_GameEvents;		// only knows the events the demo lists
+
+	int						m_nTick;			// server tick of the packet being read
+	int						m_nWrittenTick;		// tick of the last dma_tick record
+
+	int						m_nTicks;
+	int						m_nEntityUpdates;
+	int						m_nEvents;
+	int						m_nOutputSize;
+	float					m_flRunTime;
+};
+
+// Analyzes the demos queued by demo_analyze in the background, called once per host frame
+void DemoAnalyzer_Frame();
+void DemoAnalyzer_Shutdown();
+
+#endif // DEMOANALYZER_H
@@ -9,6 +9,7 @@
 #include <utlbuffer.h>
 
 #include "demofile.h"
+#include "demostream.h"
 #include "filesystem_engine.h"
 #include "demo.h"
 #include "proto_version.h"
@@ -22,6 +23,12 @@ void Host_EndGame (bool bShowMainMenu, const char *message, ...);
 
 // Debug helpers - this class prints in a nested format
 ConVar dbg_demofile( "dbg_demofile", "0", FCVAR_DEVELOPMENTONLY | FCVAR_HIDDEN );
+
+ConVar demo_writethread( "demo_writethread", "1", 0, "Write recorded demos to disk on a separate thread." );
+ConVar demo_compress( "demo_compress", "0", 0, "Record demos as zstd compressed chunks. Older builds can't play these back." );
+
+// Demo data is handed to the writer thread in blocks of about this size
+#define DEMO_WRITE_BLOCK_SIZE	(64*1024)
 //#define DEMOFILE_DBG_PRINT
 #if defined( DEMOFILE_DBG_PRINT )
 class CDbgPrint
@@ -53,7 +60,10 @@ int CDbgPrint::s_nIndent = 0;
 CDemoFile::CDemoFile() :
 	m_pBuffer( NULL ),
 	m_bAllowHeaderWrite( true ),
-	m_bIsStreamBuffer( false )
+	m_bIsStreamBuffer( false ),
+	m_bIsChunkBuffer( false ),
+	m_pWriter( NULL ),
+	m_nStreamOffset( 0 )
 {
 }
 
@@ -229,7 +239,7 @@ unsigned int CDemoFile::GetCurPos( bool bRead )
 		return 0;
 	if ( bRead )
 		return m_pBuffer->TellGet();
-	return m_pBuffer->TellPut();
+	return m_nStreamOffset + m_pBuffer->TellPut();
 }
 
 //-----------------------------------------------------------------------------
@@ -316,6 +326,13 @@ int CDemoFile::ReadUserCmd( char *buffer, int &size )
 	Assert( m_pBuffer && m_pBuffer->IsValid() );
 	outgoing_sequence = m_pBuffer->GetInt();
 
+	// a truncated demo ends here, the next command header reads as dem_stop
+	if ( !m_pBuffer->IsValid() )
+	{
+		size = 0;
+		return outgoing_sequence;
+	}
+
 	size = ReadRawData( buffer, size );
 	return outgoing_sequence;
 }
@@ -332,7 +349,9 @@ void CDemoFile::SeekTo( int position, bool bRead )
 	}
 	else
 	{
-		m_pBuffer->SeekPut( CUtlBuffer::SEEK_HEAD, position );
+		// data handed to the writer can't be rewritten
+		Assert( position >= m_nStreamOffset );
+		m_pBuffer->SeekPut( CUtlBuffer::SEEK_HEAD, position - m_nStreamOffset );
 	}
 }
 
@@ -353,6 +372,17 @@ int CDemoFile::ReadRawData( char *buffer, int length )
 
 	size = m_pBuffer->GetInt();
 
+	if ( !m_pBuffer->IsValid() )
+		return -1;
+
+	// a corrupt size would seek backwards
+	if ( size < 0 )
+	{
+		DevMsg("CDemoFile::ReadRawData: invalid size (%i).\n", size );
+		m_pBuffer->SeekGet( CUtlBuffer::SEEK_CURRENT, -(int)sizeof( int ) ); // rewind our get pointer
+		return -1;
+	}
+
 	if ( !buffer )
 	{
 		// just skip it
@@ -382,6 +412,26 @@ void CDemoFile::WriteRawData( const char *buffer, int length )
 	Assert( m_pBuffer && m_pBuffer->IsValid() );
 	m_pBuffer->PutInt( length );
 	m_pBuffer->Put( buffer, length );
+
+	FlushToWriter( false );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Hands the buffered demo data to the writer thread, once there is
+//			enough of it or when bForce is set
+//-----------------------------------------------------------------------------
+void CDemoFile::FlushToWriter( bool bForce )
+{
+	if ( !m_pWriter )
+		return;
+
+	int nBytes = m_pBuffer->TellMaxPut();
+	if ( nBytes <= 0 || ( !bForce && nBytes < DEMO_WRITE_BLOCK_SIZE ) )
+		return;
+
+	m_pWriter->Write( m_pBuffer->Base(), nBytes );
+	m_nStreamOffset += nBytes;
+	m_pBuffer->Clear();
 }
 
 void CDemoFile::WriteDemoHeader()
@@ -413,6 +463,15 @@ void CDemoFile::WriteDemoHeader()
 	demoheader_t littleEndianHeader = *((demoheader_t*)&m_DemoHeader);
 	ByteSwap_demoheader_t( littleEndianHeader );
 
+	if ( m_pWriter )
+	{
+		// The writer puts the header at the file start, after all the data handed to it before
+		FlushToWriter( true );
+		m_pWriter->WriteHeader( littleEndianHeader );
+		m_nStreamOffset = MAX( m_nStreamOffset, (int)sizeof( demoheader_t ) );
+		return;
+	}
+
 	// Goto file start
 	m_pBuffer->SeekPut( CUtlBuffer::SEEK_HEAD, 0 );
 
@@ -436,7 +495,7 @@ demoheader_t *CDemoFile::ReadDemoHeader()
 	if ( !bOk )
 		return NULL;  // reading failed
 
-	if ( Q_strcmp( m_DemoHeader.demofilestamp, DEMO_HEADER_ID ) )
+	if ( Q_strcmp( m_DemoHeader.demofilestamp, DEMO_HEADER_ID ) && Q_strcmp( m_DemoHeader.demofilestamp, DEMO_HEADER_ID_ZSTD ) )
 	{
 		ConMsg( "%s has invalid demo header ID.\n", m_szFileName );
 		return NULL;
@@ -477,15 +536,108 @@ void CDemoFile::WriteFileBytes( FileHandle_t fh, int length )
 		g_pFileSystem->Read ( copybuf, COM_COPY_CHUNK_SIZE, fh );
 		m_pBuffer->Put( copybuf, COM_COPY_CHUNK_SIZE );
 		copysize -= COM_COPY_CHUNK_SIZE;
+
+		FlushToWriter( false );
 	}
 
 	g_pFileSystem->Read ( copybuf, copysize, fh );
 	m_pBuffer->Put( copybuf, copysize );
+	FlushToWriter( false );
 	
 	g_pFileSystem->Flush ( fh );
 }
 
-bool CDemoFile::Open(const char *name, bool bReadOnly, bool bMemoryBuffer, int nBufferSize/*=0*/, bool bAllowHeaderWrite/*=true*/)
+//-----------------------------------------------------------------------------
+// Purpose: Appends the keyframe index to the demo, after dem_stop
+//-----------------------------------------------------------------------------
+void CDemoFile::WriteKeyframeIndex()
+{
+	DemoFileDbg( "WriteKeyframeIndex()\n" );
+	if ( !m_Keyframes.Count() )
+		return;
+
+	demokeyframetrailer_t trailer;
+	trailer.id = DEMO_KEYFRAME_INDEX_ID;
+	trailer.indexOffset = GetCurPos( false );
+	trailer.numKeyframes = m_Keyframes.Count();
+
+	FOR_EACH_VEC( m_Keyframes, i )
+	{
+		demokeyframe_t littleEndianKeyframe = m_Keyframes[i];
+		ByteSwap_demokeyframe_t( littleEndianKeyframe );
+		m_pBuffer->Put( &littleEndianKeyframe, sizeof( littleEndianKeyframe ) );
+	}
+
+	ByteSwap_demokeyframetrailer_t( trailer );
+	m_pBuffer->Put( &trailer, sizeof( trailer ) );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Reads the keyframe index from the end of the demo, if it has one,
+//			and goes back to the current read position
+//-----------------------------------------------------------------------------
+void CDemoFile::ReadKeyframeIndex()
+{
+	m_Keyframes.RemoveAll();
+
+	if ( !m_pBuffer || !m_pBuffer->IsValid() )
+		return;
+
+	int nSize = GetSize();
+	if ( nSize < (int)( sizeof( demoheader_t ) + sizeof( demokeyframetrailer_t ) ) )
+		return;
+
+	int nReadPos = m_pBuffer->TellGet();
+
+	demokeyframetrailer_t trailer;
+	m_pBuffer->SeekGet( CUtlBuffer::SEEK_HEAD, nSize - sizeof( trailer ) );
+	m_pBuffer->Get( &trailer, sizeof( trailer ) );
+	ByteSwap_demokeyframetrailer_t( trailer );
+
+	if ( m_pBuffer->IsValid() && trailer.id == DEMO_KEYFRAME_INDEX_ID && trailer.numKeyframes > 0 &&
+		 trailer.indexOffset >= (int)sizeof( demoheader_t ) &&
+		 trailer.indexOffset + trailer.numKeyframes * (int)sizeof( demokeyframe_t ) + (int)sizeof( trailer ) == nSize )
+	{
+		m_Keyframes.SetCount( trailer.numKeyframes );
+		m_pBuffer->SeekGet( CUtlBuffer::SEEK_HEAD, trailer.indexOffset );
+		m_pBuffer->Get( m_Keyframes.Base(), trailer.numKeyframes * sizeof( demokeyframe_t ) );
+
+		// frames go up in the demo, their keyframes follow in the same order behind them
+		int nLastFrameOffset = sizeof( demoheader_t );
+		int nLastKeyframeOffset = 0;
+		FOR_EACH_VEC( m_Keyframes, i )
+		{
+			demokeyframe_t &keyframe = m_Keyframes[i];
+			ByteSwap_demokeyframe_t( keyframe );
+
+			if ( i == 0 )
+			{
+				nLastKeyframeOffset = keyframe.keyframeOffset;
+			}
+
+			if ( keyframe.frameOffset <= nLastFrameOffset || keyframe.frameOffset >= m_Keyframes[0].keyframeOffset ||
+				 keyframe.keyframeOffset < nLastKeyframeOffset || keyframe.keyframeEndOffset <= keyframe.keyframeOffset ||
+				 keyframe.keyframeEndOffset > trailer.indexOffset )
+			{
+				ConMsg( "%s has a broken keyframe index.\n", m_szFileName );
+				m_Keyframes.RemoveAll();
+				break;
+			}
+			nLastFrameOffset = keyframe.frameOffset;
+			nLastKeyframeOffset = keyframe.keyframeEndOffset;
+		}
+
+		if ( !m_pBuffer->IsValid() )
+		{
+			m_Keyframes.RemoveAll();
+		}
+	}
+
+	// also clears the error of a failed read
+	m_pBuffer->SeekGet( CUtlBuffer::SEEK_HEAD, nReadPos );
+}
+
+bool CDemoFile::Open(const char *name, bool bReadOnly, bool bMemoryBuffer, int nBufferSize/*=0*/, bool bAllowHeaderWrite/*=true*/, bool bCompressed/*=false*/)
 {
 	if ( m_pBuffer && m_pBuffer->IsValid() )
 	{
@@ -495,6 +647,7 @@ bool CDemoFile::Open(const char *name, bool bReadOnly, bool bMemoryBuffer, int n
 
 	m_szFileName[0] = 0;  // clear name
 	Q_memset( &m_DemoHeader, 0, sizeof(m_DemoHeader) ); // and demo header
+	m_Keyframes.RemoveAll();
 
 	// This is used by replay, which manually writes a header.
 	m_bAllowHeaderWrite = bAllowHeaderWrite;
@@ -505,11 +658,36 @@ bool CDemoFile::Open(const char *name, bool bReadOnly, bool bMemoryBuffer, int n
 		Assert( nBufferSize > 0 );
 		m_pBuffer = new CUtlBuffer( nBufferSize, nBufferSize, 0 );
 		m_bIsStreamBuffer = false;
+		m_bIsChunkBuffer = false;
+	}
+	else if ( !bReadOnly && ( bCompressed || demo_writethread.GetBool() ) )
+	{
+		m_pWriter = new CDemoFileWriter;
+		if ( !m_pWriter->Open( name, bCompressed, demo_writethread.GetBool() ) )
+		{
+			ConMsg ("CDemoFile::Open: couldn't open file %s for writing.\n", name );
+			delete m_pWriter;
+			m_pWriter = NULL;
+			return false;
+		}
+
+		// a compressed demo keeps the header out of its chunks, the writer has already made room for it
+		m_pBuffer = new CUtlBuffer( DEMO_WRITE_BLOCK_SIZE, DEMO_WRITE_BLOCK_SIZE, 0 );
+		m_nStreamOffset = bCompressed ? sizeof( demoheader_t ) : 0;
+		m_bIsStreamBuffer = false;
+		m_bIsChunkBuffer = false;
+	}
+	else if ( bReadOnly && CDemoChunkReadBuffer::IsChunkedDemo( name ) )
+	{
+		m_pBuffer = new CDemoChunkReadBuffer( name );
+		m_bIsStreamBuffer = false;
+		m_bIsChunkBuffer = true;
 	}
 	else
 	{
 		m_pBuffer = new CUtlStreamBuffer( name, NULL, bReadOnly ? CUtlBuffer::READ_ONLY : 0, false );
 		m_bIsStreamBuffer = true;
+		m_bIsChunkBuffer = false;
 	}
 
 	// Demo files are always little endian
@@ -538,22 +716,43 @@ bool CDemoFile::IsOpen()
 
 void CDemoFile::Close()
 {
+	if ( m_pWriter )
+	{
+		if ( m_pBuffer )
+		{
+			FlushToWriter( true );
+		}
+
+		// Waits for the writer thread to finish the file
+		if ( !m_pWriter->Close() )
+		{
+			ConMsg ("CDemoFile::Close: error writing demo file %s.\n", m_szFileName );
+		}
+		delete m_pWriter;
+		m_pWriter = NULL;
+	}
+
 	// CUtlBuffer base class does NOT have a virtual destructor!
 	if ( m_bIsStreamBuffer )
 	{
 		// Destructor will call Close() as needed
 		delete static_cast<CUtlStreamBuffer*>(m_pBuffer);
 	}
+	else if ( m_bIsChunkBuffer )
+	{
+		delete static_cast<CDemoChunkReadBuffer*>(m_pBuffer);
+	}
 	else
 	{
 		delete m_pBuffer;
 	}
 	m_pBuffer = NULL;
+	m_nStreamOffset = 0;
 }
 
 int CDemoFile::GetSize()
 {
-	return m_pBuffer->TellMaxPut();
+	return m_nStreamOffset + m_pBuffer->TellMaxPut();
 }
 
 // Returns the PROTOCOL_VERSION used when .dem was recorded
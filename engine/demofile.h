@@ -28,6 +28,10 @@
 // Forward declarations
 //-----------------------------------------------------------------------------
 class IDemoBuffer;
+class CDemoFileWriter;
+class ConVar;
+
+extern ConVar demo_compress;
 
 //-----------------------------------------------------------------------------
 // Demo file 
@@ -38,7 +42,7 @@ public:
 	CDemoFile();
 	~CDemoFile();
 
-	bool	Open(const char *name, bool bReadOnly, bool bMemoryBuffer = false, int nBufferSize = 0, bool bAllowHeaderWrite = true);
+	bool	Open(const char *name, bool bReadOnly, bool bMemoryBuffer = false, int nBufferSize = 0, bool bAllowHeaderWrite = true, bool bCompressed = false);
 	bool	IsOpen();
 	void	Close();
 
@@ -75,14 +79,29 @@ public:
 
 	void	WriteFileBytes( FileHandle_t fh, int length );
 
+	// Keyframe index, see demokeyframe_t
+	void	WriteKeyframeIndex();
+	void	ReadKeyframeIndex();
+
 	// Returns the PROTOCOL_VERSION used when .dem was recorded
 	int		GetProtocolVersion();
+
+private:
+	void	FlushToWriter( bool bForce );
+
 public:
 	char			m_szFileName[MAX_PATH];	//name of current demo file
 	demoheader_t    m_DemoHeader;  //general demo info
 	CUtlBuffer		*m_pBuffer;
 	bool			m_bAllowHeaderWrite;
 	bool			m_bIsStreamBuffer;
+	bool			m_bIsChunkBuffer;
+	CUtlVector< demokeyframe_t > m_Keyframes;	// in the order they are in the demo
+
+	// Files being written through a CDemoFileWriter: m_pBuffer only holds the data
+	// not handed to the writer yet, which starts at m_nStreamOffset in the file
+	CDemoFileWriter	*m_pWriter;
+	int				m_nStreamOffset;
 };
 
 #endif // DEMOFILE_H
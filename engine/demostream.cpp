@@ -0,0 +1,463 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Demo file output on a writer thread, and reading of demos
+//			stored as compressed chunks
+//
+//===========================================================================//
+
+#include <tier0/dbg.h>
+#include <tier1/strtools.h>
+
+#include "demostream.h"
+#include "filesystem_engine.h"
+#include "common.h"
+
+// NOTE: This has to be the last file included!
+#include "tier0/memdbgon.h"
+
+
+//-----------------------------------------------------------------------------
+// CDemoFileWriter
+//-----------------------------------------------------------------------------
+CDemoFileWriter::CDemoFileWriter() :
+	m_bThreadShouldExit( false ),
+	m_bThreaded( false ),
+	m_hFile( FILESYSTEM_INVALID_HANDLE ),
+	m_bCompressed( false ),
+	m_bWriteError( false ),
+	m_pCompressContext( NULL ),
+	m_nChunkBytes( 0 ),
+	m_nUncompressedOffset( 0 ),
+	m_nFileOffset( 0 )
+{
+	SetName( "DemoFileWriter" );
+}
+
+CDemoFileWriter::~CDemoFileWriter()
+{
+	if ( m_hFile != FILESYSTEM_INVALID_HANDLE )
+	{
+		Close();
+	}
+}
+
+bool CDemoFileWriter::Open( const char *pFileName, bool bCompressed, bool bThreaded )
+{
+	Assert( m_hFile == FILESYSTEM_INVALID_HANDLE );
+
+	m_hFile = g_pFileSystem->Open( pFileName, "wb" );
+	if ( m_hFile == FILESYSTEM_INVALID_HANDLE )
+		return false;
+
+	m_bCompressed = bCompressed;
+	m_bWriteError = false;
+	m_nChunkBytes = 0;
+	m_nUncompressedOffset = 0;
+	m_nFileOffset = 0;
+	m_ChunkIndex.RemoveAll();
+
+	if ( m_bCompressed )
+	{
+		m_pCompressContext = COM_CreateCompressContext_ZSTD();
+		m_Chunk.EnsureCapacity( DEMO_CHUNK_SIZE );
+		m_Compressed.EnsureCapacity( COM_GetIdealDestinationCompressionBufferSize_ZSTD( DEMO_CHUNK_SIZE ) );
+
+		// leave room for the header, the chunks follow it
+		demoheader_t header;
+		Q_memset( &header, 0, sizeof( header ) );
+		WriteToFile( &header, sizeof( header ) );
+		m_nUncompressedOffset = sizeof( header );
+	}
+
+	// without a thread, blocks are written as they come in
+	m_bThreadShouldExit = false;
+	m_bThreaded = bThreaded && Start();
+
+	return true;
+}
+
+bool CDemoFileWriter::Close()
+{
+	if ( m_hFile == FILESYSTEM_INVALID_HANDLE )
+		return false;
+
+	if ( m_bThreaded )
+	{
+		m_bThreadShouldExit = true;
+		m_hThreadEvent.Set();
+
+		Join(); // Wait for the thread to write everything and exit.
+		m_bThreaded = false;
+	}
+
+	ProcessQueue();
+
+	if ( m_bCompressed )
+	{
+		FlushChunk();
+
+		demochunktrailer_t trailer;
+		trailer.id = DEMO_CHUNK_INDEX_ID;
+		trailer.indexOffset = m_nFileOffset;
+		trailer.numChunks = m_ChunkIndex.Count();
+
+		FOR_EACH_VEC( m_ChunkIndex, i )
+		{
+			demochunk_t littleEndianChunk = m_ChunkIndex[i];
+			ByteSwap_demochunk_t( littleEndianChunk );
+			WriteToFile( &littleEndianChunk, sizeof( littleEndianChunk ) );
+		}
+
+		ByteSwap_demochunktrailer_t( trailer );
+		WriteToFile( &trailer, sizeof( trailer ) );
+
+		COM_DestroyCompressContext_ZSTD( m_pCompressContext );
+		m_pCompressContext = NULL;
+		m_ChunkIndex.Purge();
+		m_Chunk.Purge();
+		m_Compressed.Purge();
+	}
+
+	g_pFileSystem->Close( m_hFile );
+	m_hFile = FILESYSTEM_INVALID_HANDLE;
+
+	return !m_bWriteError;
+}
+
+void CDemoFileWriter::Write( const void *pData, int nSize )
+{
+	Assert( m_hFile != FILESYSTEM_INVALID_HANDLE );
+	if ( nSize <= 0 )
+		return;
+
+	DemoBlock_t *pBlock = (DemoBlock_t *)malloc( sizeof( DemoBlock_t ) + nSize );
+	pBlock->m_nSize = nSize;
+	pBlock->m_bHeader = false;
+	Q_memcpy( pBlock + 1, pData, nSize );
+
+	Queue( pBlock );
+}
+
+void CDemoFileWriter::WriteHeader( const demoheader_t &header )
+{
+	Assert( m_hFile != FILESYSTEM_INVALID_HANDLE );
+
+	DemoBlock_t *pBlock = (DemoBlock_t *)malloc( sizeof( DemoBlock_t ) + sizeof( demoheader_t ) );
+	pBlock->m_nSize = sizeof( demoheader_t );
+	pBlock->m_bHeader = true;
+
+	demoheader_t *pHeader = (demoheader_t *)( pBlock + 1 );
+	Q_memcpy( pHeader, &header, sizeof( demoheader_t ) );
+	if ( m_bCompressed )
+	{
+		Q_strncpy( pHeader->demofilestamp, DEMO_HEADER_ID_ZSTD, sizeof( pHeader->demofilestamp ) );
+	}
+
+	Queue( pBlock );
+}
+
+void CDemoFileWriter::Queue( DemoBlock_t *pBlock )
+{
+	if ( m_bThreaded )
+	{
+		m_Queue.PushItem( pBlock );
+		m_hThreadEvent.Set();
+	}
+	else
+	{
+		ProcessBlock( pBlock );
+		free( pBlock );
+	}
+}
+
+int CDemoFileWriter::Run()
+{
+	while ( 1 )
+	{
+		m_hThreadEvent.Wait();
+
+		// Everything was queued before we were told to exit, so empty the queue first.
+		bool bExit = m_bThreadShouldExit;
+
+		ProcessQueue();
+
+		if ( bExit )
+			return 0;
+	}
+}
+
+void CDemoFileWriter::ProcessQueue()
+{
+	DemoBlock_t *pBlock;
+	while ( m_Queue.PopItem( &pBlock ) )
+	{
+		ProcessBlock( pBlock );
+		free( pBlock );
+	}
+}
+
+void CDemoFileWriter::ProcessBlock( DemoBlock_t *pBlock )
+{
+	const unsigned char *pData = (const unsigned char *)( pBlock + 1 );
+
+	if ( pBlock->m_bHeader )
+	{
+		// the header is rewritten in place, as the demo ends; the file offset of the data stays the same
+		g_pFileSystem->Seek( m_hFile, 0, FILESYSTEM_SEEK_HEAD );
+		if ( g_pFileSystem->Write( pData, pBlock->m_nSize, m_hFile ) != pBlock->m_nSize )
+		{
+			m_bWriteError = true;
+		}
+		g_pFileSystem->Seek( m_hFile, 0, FILESYSTEM_SEEK_TAIL );
+		return;
+	}
+
+	if ( !m_bCompressed )
+	{
+		WriteToFile( pData, pBlock->m_nSize );
+		return;
+	}
+
+	int nLeft = pBlock->m_nSize;
+	while ( nLeft > 0 )
+	{
+		int nCopy = MIN( nLeft, DEMO_CHUNK_SIZE - m_nChunkBytes );
+		Q_memcpy( m_Chunk.Base() + m_nChunkBytes, pData, nCopy );
+		m_nChunkBytes += nCopy;
+		pData += nCopy;
+		nLeft -= nCopy;
+
+		if ( m_nChunkBytes == DEMO_CHUNK_SIZE )
+		{
+			FlushChunk();
+		}
+	}
+}
+
+void CDemoFileWriter::WriteToFile( const void *pData, int nSize )
+{
+	if ( m_bWriteError )
+		return;
+
+	if ( g_pFileSystem->Write( pData, nSize, m_hFile ) != nSize )
+	{
+		m_bWriteError = true;
+		return;
+	}
+
+	m_nFileOffset += nSize;
+}
+
+void CDemoFileWriter::FlushChunk()
+{
+	if ( !m_nChunkBytes )
+		return;
+
+	demochunk_t chunk;
+	chunk.uncompressedOffset = m_nUncompressedOffset;
+	chunk.uncompressedSize = m_nChunkBytes;
+	chunk.fileOffset = m_nFileOffset;
+
+	unsigned int nCompressedSize = m_Compressed.NumAllocated();
+	if ( COM_BufferToBufferCompress_ZSTD( m_Compressed.Base(), &nCompressedSize, m_Chunk.Base(), m_nChunkBytes, m_pCompressContext ) )
+	{
+		chunk.compressedSize = nCompressedSize;
+		WriteToFile( m_Compressed.Base(), nCompressedSize );
+		m_ChunkIndex.AddToTail( chunk );
+	}
+	else
+	{
+		m_bWriteError = true;
+	}
+
+	m_nUncompressedOffset += m_nChunkBytes;
+	m_nChunkBytes = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// CDemoChunkReadBuffer
+//-----------------------------------------------------------------------------
+CDemoChunkReadBuffer::CDemoChunkReadBuffer( const char *pFileName ) :
+	BaseClass( 1, 0, READ_ONLY )	// grow size of 1, so the memory holds exactly the chunks read
+{
+	SetUtlBufferOverflowFuncs( &CDemoChunkReadBuffer::ChunkGetOverflow, &CDemoChunkReadBuffer::ChunkPutOverflow );
+
+	m_Error |= GET_OVERFLOW;	// until the index has been read
+
+	m_hFile = g_pFileSystem->Open( pFileName, "rb" );
+	if ( m_hFile == FILESYSTEM_INVALID_HANDLE )
+		return;
+
+	int nFileSize = g_pFileSystem->Size( m_hFile );
+	if ( nFileSize < (int)( sizeof( demoheader_t ) + sizeof( demochunktrailer_t ) ) )
+		return;
+
+	// the header as it is stored, the demo file byte swaps it when reading it
+	if ( g_pFileSystem->Read( &m_Header, sizeof( m_Header ), m_hFile ) != sizeof( m_Header ) )
+		return;
+
+	demochunktrailer_t trailer;
+	g_pFileSystem->Seek( m_hFile, nFileSize - sizeof( trailer ), FILESYSTEM_SEEK_HEAD );
+	if ( g_pFileSystem->Read( &trailer, sizeof( trailer ), m_hFile ) != sizeof( trailer ) )
+		return;
+
+	ByteSwap_demochunktrailer_t( trailer );
+	if ( trailer.id != DEMO_CHUNK_INDEX_ID || trailer.numChunks < 0 ||
+		 trailer.indexOffset + trailer.numChunks * (int)sizeof( demochunk_t ) + (int)sizeof( trailer ) != nFileSize )
+	{
+		ConMsg( "%s has no valid demo chunk index.\n", pFileName );
+		return;
+	}
+
+	// the header isn't compressed, see LoadChunk
+	demochunk_t header;
+	header.uncompressedOffset = 0;
+	header.uncompressedSize = sizeof( demoheader_t );
+	header.fileOffset = 0;
+	header.compressedSize = 0;
+	m_Chunks.AddToTail( header );
+
+	m_Chunks.AddMultipleToTail( trailer.numChunks );
+	g_pFileSystem->Seek( m_hFile, trailer.indexOffset, FILESYSTEM_SEEK_HEAD );
+	int nIndexSize = trailer.numChunks * sizeof( demochunk_t );
+	if ( g_pFileSystem->Read( m_Chunks.Base() + 1, nIndexSize, m_hFile ) != nIndexSize )
+		return;
+
+	// the chunks must cover the demo without gaps, and lie between the header and the index
+	int nUncompressedSize = sizeof( demoheader_t );
+	int nMaxCompressedSize = 0;
+	for ( int i = 1; i < m_Chunks.Count(); ++i )
+	{
+		demochunk_t &chunk = m_Chunks[i];
+		ByteSwap_demochunk_t( chunk );
+
+		if ( chunk.uncompressedOffset != nUncompressedSize ||
+			 chunk.uncompressedSize <= 0 || chunk.uncompressedSize > DEMO_CHUNK_SIZE ||
+			 chunk.compressedSize <= 0 || chunk.fileOffset < (int)sizeof( demoheader_t ) ||
+			 chunk.fileOffset + chunk.compressedSize > trailer.indexOffset )
+		{
+			ConMsg( "%s has a broken demo chunk index.\n", pFileName );
+			return;
+		}
+
+		nUncompressedSize += chunk.uncompressedSize;
+		nMaxCompressedSize = MAX( nMaxCompressedSize, chunk.compressedSize );
+	}
+
+	m_Compressed.EnsureCapacity( nMaxCompressedSize );
+
+	m_nMaxPut = nUncompressedSize;
+	m_nOffset = m_nMaxPut;	// nothing loaded
+	m_Error = 0;
+}
+
+CDemoChunkReadBuffer::~CDemoChunkReadBuffer()
+{
+	if ( m_hFile != FILESYSTEM_INVALID_HANDLE )
+	{
+		g_pFileSystem->Close( m_hFile );
+	}
+}
+
+bool CDemoChunkReadBuffer::IsChunkedDemo( const char *pFileName )
+{
+	FileHandle_t hFile = g_pFileSystem->Open( pFileName, "rb" );
+	if ( hFile == FILESYSTEM_INVALID_HANDLE )
+		return false;
+
+	char stamp[ sizeof( DEMO_HEADER_ID_ZSTD ) ];
+	bool bChunked = g_pFileSystem->Read( stamp, sizeof( stamp ), hFile ) == sizeof( stamp ) &&
+		!Q_strncmp( stamp, DEMO_HEADER_ID_ZSTD, sizeof( stamp ) );
+
+	g_pFileSystem->Close( hFile );
+	return bChunked;
+}
+
+int CDemoChunkReadBuffer::FindChunk( int nOffset ) const
+{
+	int nLow = 0;
+	int nHigh = m_Chunks.Count() - 1;
+	while ( nLow < nHigh )
+	{
+		int nMid = ( nLow + nHigh + 1 ) / 2;
+		if ( m_Chunks[nMid].uncompressedOffset <= nOffset )
+		{
+			nLow = nMid;
+		}
+		else
+		{
+			nHigh = nMid - 1;
+		}
+	}
+	return nLow;
+}
+
+bool CDemoChunkReadBuffer::LoadChunk( int iChunk, unsigned char *pDest )
+{
+	const demochunk_t &chunk = m_Chunks[iChunk];
+	if ( iChunk == 0 )
+	{
+		Q_memcpy( pDest, &m_Header, sizeof( m_Header ) );
+		return true;
+	}
+
+	g_pFileSystem->Seek( m_hFile, chunk.fileOffset, FILESYSTEM_SEEK_HEAD );
+	if ( g_pFileSystem->Read( m_Compressed.Base(), chunk.compressedSize, m_hFile ) != chunk.compressedSize )
+	{
+		ConMsg( "CDemoChunkReadBuffer: couldn't read demo chunk at %i.\n", chunk.fileOffset );
+		return false;
+	}
+
+	unsigned int nSize = chunk.uncompressedSize;
+	if ( !COM_BufferToBufferDecompress( pDest, &nSize, m_Compressed.Base(), chunk.compressedSize ) ||
+		 nSize != (unsigned int)chunk.uncompressedSize )
+	{
+		ConMsg( "CDemoChunkReadBuffer: couldn't decompress demo chunk at %i.\n", chunk.fileOffset );
+		return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Loads the chunks holding the next nSize bytes, or just the get position
+// when seeking (nSize < 0)
+//-----------------------------------------------------------------------------
+bool CDemoChunkReadBuffer::ChunkGetOverflow( int nSize )
+{
+	if ( m_hFile == FILESYSTEM_INVALID_HANDLE )
+		return false;
+
+	int nGet = TellGet();
+	if ( nGet < 0 || nGet >= m_nMaxPut )
+		return ( nSize <= 0 );
+
+	int nEnd = MIN( nGet + MAX( nSize, 1 ), m_nMaxPut );
+	int iChunk = FindChunk( nGet );
+	int nStart = m_Chunks[iChunk].uncompressedOffset;
+
+	// Keep the memory full of whole chunks, CheckGet trusts everything allocated past m_nOffset
+	int nLoaded = 0;
+	for ( ; iChunk < m_Chunks.Count() && ( nStart + nLoaded < nEnd || nLoaded < m_Memory.NumAllocated() ); ++iChunk )
+	{
+		int nChunkSize = m_Chunks[iChunk].uncompressedSize;
+		m_Memory.EnsureCapacity( nLoaded + nChunkSize );
+
+		if ( !LoadChunk( iChunk, m_Memory.Base() + nLoaded ) )
+		{
+			m_nOffset = m_nMaxPut;	// nothing loaded
+			return false;
+		}
+
+		nLoaded += nChunkSize;
+	}
+
+	m_nOffset = nStart;
+	return true;
+}
+
+bool CDemoChunkReadBuffer::ChunkPutOverflow( int nSize )
+{
+	return false;
+}
@@ -0,0 +1,102 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Demo file output on a writer thread, and reading of demos
+//			stored as compressed chunks
+//
+//===========================================================================//
+
+#ifndef DEMOSTREAM_H
+#define DEMOSTREAM_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "tier0/threadtools.h"
+#include "tier0/tslist.h"
+#include "tier1/utlbuffer.h"
+#include "tier1/utlvector.h"
+#include "filesystem.h"
+#include "demofile/demoformat.h"
+
+//-----------------------------------------------------------------------------
+// Writes a demo file on a thread of its own. The recording thread hands over
+// blocks of demo data, which the writer thread appends to the file, or packs
+// into DEMO_CHUNK_SIZE chunks and compresses when writing a compressed demo.
+//-----------------------------------------------------------------------------
+class CDemoFileWriter : public CThread
+{
+public:
+	CDemoFileWriter();
+	~CDemoFileWriter();
+
+	bool	Open( const char *pFileName, bool bCompressed, bool bThreaded );
+	bool	Close();		// waits for all queued data to be written, false on write errors
+
+	void	Write( const void *pData, int nSize );
+	void	WriteHeader( const demoheader_t &header );	// header goes to the file start
+
+	bool	IsCompressed() const { return m_bCompressed; }
+
+private:
+	struct DemoBlock_t
+	{
+		int		m_nSize;
+		bool	m_bHeader;
+		// followed by m_nSize bytes of data
+	};
+
+	virtual int Run();
+
+	void	Queue( DemoBlock_t *pBlock );
+	void	ProcessQueue();
+	void	ProcessBlock( DemoBlock_t *pBlock );
+	void	WriteToFile( const void *pData, int nSize );
+	void	FlushChunk();
+
+	CTSQueue< DemoBlock_t * >	m_Queue;
+	CThreadEvent				m_hThreadEvent;
+	volatile bool				m_bThreadShouldExit;
+	bool						m_bThreaded;
+
+	FileHandle_t				m_hFile;
+	bool						m_bCompressed;
+	bool						m_bWriteError;
+
+	// compressed demos only, used by the writer thread
+	void						*m_pCompressContext;
+	CUtlMemory< unsigned char >	m_Chunk;
+	int							m_nChunkBytes;
+	CUtlMemory< unsigned char >	m_Compressed;
+	CUtlVector< demochunk_t >	m_ChunkIndex;
+	int							m_nUncompressedOffset;
+	int							m_nFileOffset;
+};
+
+//-----------------------------------------------------------------------------
+// Read only buffer over a compressed demo. Reads look like they are on the
+// uncompressed demo; the chunks covering them are decompressed as needed.
+//-----------------------------------------------------------------------------
+class CDemoChunkReadBuffer : public CUtlBuffer
+{
+	typedef CUtlBuffer BaseClass;
+
+public:
+	CDemoChunkReadBuffer( const char *pFileName );
+	~CDemoChunkReadBuffer();
+
+	static bool IsChunkedDemo( const char *pFileName );
+
+private:
+	bool	ChunkGetOverflow( int nSize );
+	bool	ChunkPutOverflow( int nSize );
+
+	int		FindChunk( int nOffset ) const;
+	bool	LoadChunk( int iChunk, unsigned char *pDest );
+
+	FileHandle_t				m_hFile;
+	demoheader_t				m_Header;
+	CUtlVector< demochunk_t >	m_Chunks;		// the header first, then the chunks in the file index
+	CUtlMemory< unsigned char >	m_Compressed;
+};
+
+#endif // DEMOSTREAM_H
@@ -131,13 +131,17 @@ static bool SendTable_GetPropsExcluded( const SendTable *pTable, ExcludeProp *pE
 		{
 			char const *pName = pProp->GetExcludeDTName();
 
-			ErrorIfNot( pName,
-				("Found an exclude prop missing a name.")
-			);
+			if ( !pName )
+			{
+				Warning( "Found an exclude prop missing a name.\n" );
+				return false;
+			}
 			
-			ErrorIfNot( nExcludeProps < nMaxExcludeProps,
-				("SendTable_GetPropsExcluded: Overflowed max exclude props with %s.", pName)
-			);
+			if ( nExcludeProps >= nMaxExcludeProps )
+			{
+				Warning( "SendTable_GetPropsExcluded: Overflowed max exclude props with %s.\n", pName );
+				return false;
+			}
 
 			pExcludeProps[nExcludeProps].m_pTableName = pName;
 			pExcludeProps[nExcludeProps].m_pPropName = pProp->GetName();
@@ -180,13 +184,16 @@ static void SetDataTableProxyIndices_R(
 }
 
 // Set the datatable proxy indices in all datatable SendProps.
-static void SetRecursiveProxyIndices_R( 
+static bool SetRecursiveProxyIndices_R( 
 	SendTable *pBaseTable,
 	CSendNode *pCurTable,
 	int &iCurProxyIndex )
 {
 	if ( iCurProxyIndex >= CDatatableStack::MAX_PROXY_RESULTS )
-		Error( "Too many proxies for datatable %s.", pBaseTable->GetName() );
+	{
+		Warning( "Too many proxies for datatable %s.\n", pBaseTable->GetName() );
+		return false;
+	}
 
 	pCurTable->SetRecursiveProxyIndex( iCurProxyIndex );
 	iCurProxyIndex++;
@@ -194,19 +201,22 @@ static void SetRecursiveProxyIndices_R(
 	for ( int i=0; i < pCurTable->GetNumChildren(); i++ )
 	{
 		CSendNode *pNode = pCurTable->GetChild( i );
-		SetRecursiveProxyIndices_R( pBaseTable, pNode, iCurProxyIndex );
+		if ( !SetRecursiveProxyIndices_R( pBaseTable, pNode, iCurProxyIndex ) )
+			return false;
 	}
+
+	return true;
 }
 
 
-void SendTable_BuildHierarchy( 
+bool SendTable_BuildHierarchy( 
 	CSendNode *pNode,
 	const SendTable *pTable, 
 	CBuildHierarchyStruct *bhs
 	);
 
 
-void SendTable_BuildHierarchy_IterateProps(
+bool SendTable_BuildHierarchy_IterateProps(
 	CSendNode *pNode,
 	const SendTable *pTable, 
 	CBuildHierarchyStruct *bhs,
@@ -231,12 +241,15 @@ void SendTable_BuildHierarchy_IterateProps(
 			{
 				// This is a base class.. no need to make a new CSendNode (and trigger a bunch of
 				// unnecessary send proxy calls in the datatable stacks).
-				SendTable_BuildHierarchy_IterateProps( 
+				if ( !SendTable_BuildHierarchy_IterateProps( 
 					pNode,
 					pProp->GetDataTable(), 
 					bhs, 
 					pNonDatatableProps, 
-					nNonDatatableProps );
+					nNonDatatableProps ) )
+				{
+					return false;
+				}
 			}
 			else
 			{
@@ -246,7 +259,11 @@ void SendTable_BuildHierarchy_IterateProps(
 				// Setup a datatable prop for this node to reference (so the recursion
 				// routines can get at the proxy).
 				if ( bhs->m_nDatatableProps >= ARRAYSIZE( bhs->m_pDatatableProps ) )
-					Error( "Overflowed datatable prop list in SendTable '%s'.", pTable->GetName() );
+				{
+					Warning( "Overflowed datatable prop list in SendTable '%s'.\n", pTable->GetName() );
+					delete pChild;
+					return false;
+				}
 				
 				bhs->m_pDatatableProps[bhs->m_nDatatableProps] = pProp;
 				pChild->m_iDatatableProp = bhs->m_nDatatableProps;
@@ -255,22 +272,28 @@ void SendTable_BuildHierarchy_IterateProps(
 				pNode->m_Children.AddToTail( pChild );
 
 				// Recurse into the new child datatable.
-				SendTable_BuildHierarchy( pChild, pProp->GetDataTable(), bhs );
+				if ( !SendTable_BuildHierarchy( pChild, pProp->GetDataTable(), bhs ) )
+					return false;
 			}
 		}
 		else
 		{
 			if ( nNonDatatableProps >= MAX_TOTAL_SENDTABLE_PROPS )
-				Error( "SendTable_BuildHierarchy: overflowed non-datatable props with '%s'.", pProp->GetName() );
+			{
+				Warning( "SendTable_BuildHierarchy: overflowed non-datatable props with '%s'.\n", pProp->GetName() );
+				return false;
+			}
 			
 			pNonDatatableProps[nNonDatatableProps] = pProp;
 			++nNonDatatableProps;
 		}
 	}
+
+	return true;
 }
 
 
-void SendTable_BuildHierarchy( 
+bool SendTable_BuildHierarchy( 
 	CSendNode *pNode,
 	const SendTable *pTable, 
 	CBuildHierarchyStruct *bhs
@@ -287,20 +310,25 @@ void SendTable_BuildHierarchy(
 	int nNonDatatableProps = 0;
 	
 	// First add all the child datatables.
-	SendTable_BuildHierarchy_IterateProps(
+	if ( !SendTable_BuildHierarchy_IterateProps(
 		pNode,
 		pTable,
 		bhs,
 		pNonDatatableProps,
-		nNonDatatableProps );
+		nNonDatatableProps ) )
+	{
+		return false;
+	}
 
 	
 	// Now add the properties.
 
 	// Make sure there's room, then just copy the pointers from the loop above.
-	ErrorIfNot( bhs->m_nProps + nNonDatatableProps < ARRAYSIZE( bhs->m_pProps ),
-		("SendTable_BuildHierarchy: overflowed prop buffer.")
-	);
+	if ( bhs->m_nProps + nNonDatatableProps >= (int)ARRAYSIZE( bhs->m_pProps ) )
+	{
+		Warning( "SendTable_BuildHierarchy: overflowed prop buffer.\n" );
+		return false;
+	}
 	
 	for ( int i=0; i < nNonDatatableProps; i++ )
 	{
@@ -310,6 +338,7 @@ void SendTable_BuildHierarchy(
 	}
 
 	pNode->m_nRecursiveProps = bhs->m_nProps - pNode->m_iFirstRecursiveProp;
+	return true;
 }
 
 void SendTable_SortByPriority(CBuildHierarchyStruct *bhs)
@@ -410,7 +439,8 @@ bool CSendTablePrecalc::SetupFlatPropertyArray()
 	SendTable *pTable = GetSendTable();
 
 	// First go through and set SPROP_INSIDEARRAY when appropriate, and set array prop pointers.
-	SetupArrayProps_R<SendTable, SendTable::PropType>( pTable );
+	if ( !SetupArrayProps_R<SendTable, SendTable::PropType>( pTable ) )
+		return false;
 
 	// Make a list of which properties are excluded.
 	ExcludeProp excludeProps[MAX_EXCLUDE_PROPS];
@@ -424,7 +454,8 @@ bool CSendTablePrecalc::SetupFlatPropertyArray()
 	bhs.m_nExcludeProps = nExcludeProps;
 	bhs.m_nProps = bhs.m_nDatatableProps = 0;
 	bhs.m_nPropProxies = 0;
-	SendTable_BuildHierarchy( GetRootNode(), pTable, &bhs );
+	if ( !SendTable_BuildHierarchy( GetRootNode(), pTable, &bhs ) )
+		return false;
 
 	SendTable_SortByPriority( &bhs );
 	
@@ -439,7 +470,8 @@ bool CSendTablePrecalc::SetupFlatPropertyArray()
 	SetDataTableProxyIndices_R( this, GetRootNode(), &bhs );
 	
 	int nProxyIndices = 0;
-	SetRecursiveProxyIndices_R( pTable, GetRootNode(), nProxyIndices );
+	if ( !SetRecursiveProxyIndices_R( pTable, GetRootNode(), nProxyIndices ) )
+		return false;
 
 	SendTable_GenerateProxyPaths( this, nProxyIndices );
 	return true;
@@ -484,13 +484,14 @@ inline void SkipPropData( bf_read *pIn, const SendProp *pProp )
 // on the properties inside arrays.
 // We make the proptype an explicit template parameter because
 // gcc templating cannot deduce typedefs from classes in templates properly
+// Returns false if an array prop has no element prop in front of it.
 
 template< class TableType, class PropType >
-void SetupArrayProps_R( TableType *pTable )
+bool SetupArrayProps_R( TableType *pTable )
 {
 	// If this table has already been initialized in here, then jump out.
 	if ( pTable->IsInitialized() )
-		return;
+		return true;
 
 	pTable->SetInitialized( true );
 
@@ -500,9 +501,11 @@ void SetupArrayProps_R( TableType *pTable )
 
 		if ( pProp->GetType() == DPT_Array )
 		{
-			ErrorIfNot( i >= 1,
-				("SetupArrayProps_R: array prop '%s' is at index zero.", pProp->GetName())
-			);
+			if ( i < 1 )
+			{
+				Warning( "SetupArrayProps_R: array prop '%s' is at index zero.\n", pProp->GetName() );
+				return false;
+			}
 
 			// Get the property defining the elements in the array.
 			PropType *pArrayProp = pTable->GetProp( i-1 );
@@ -512,9 +515,12 @@ void SetupArrayProps_R( TableType *pTable )
 		else if ( pProp->GetType() == DPT_DataTable )
 		{
 			// Recurse into children datatables.
-			SetupArrayProps_R<TableType,PropType>( pProp->GetDataTable() );
+			if ( !SetupArrayProps_R<TableType,PropType>( pProp->GetDataTable() ) )
+				return false;
 		}
 	}
+
+	return true;
 }
 
 
@@ -93,7 +93,8 @@ bool DataTable_SetupReceiveTableFromSendTable( SendTable *sendTable, bool bNeeds
 		pClientSendTable->GetSendTable()->m_pPrecalc = &pDecoder->m_Precalc;
 
 		// Initialize array properties.
-		SetupArrayProps_R<RecvTable, RecvTable::PropType>( pRecvTable );
+		if ( !SetupArrayProps_R<RecvTable, RecvTable::PropType>( pRecvTable ) )
+			return false;
 	}
 
 	// Read the property list.
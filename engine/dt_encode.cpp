@@ -205,7 +205,8 @@ static inline float DecodeNormalizedFloat( const SendProp* pProp, bf_read* pIn )
 
 	if ( !pIn->ReadOneBit() )
 	{
-		const auto fractionPart = pIn->ReadUBitLong( 20 );
+		// The encoder writes at most 6 digits, the 20 bits of a corrupt value can hold 7
+		const auto fractionPart = MIN( pIn->ReadUBitLong( 20 ), 999999u );
 
 		char strNumber[8];
 		V_memset( strNumber, 0, sizeof( strNumber ) );
@@ -219,11 +220,6 @@ static inline float DecodeNormalizedFloat( const SendProp* pProp, bf_read* pIn )
 
 		int digitLeft = 6 - countDigits;
 
-		if ( digitLeft < 0 )
-		{
-			Sys_Error( "DecodeNormalizedFloat: digitLeft < 0\n" );
-		}
-
 		char strFraction[16];
 		strFraction[0] = '0';
 		strFraction[1] = '.';
@@ -576,27 +576,21 @@ void RecvTable_DecodeZeros( RecvTable *pTable, void *pStruct, int objectID )
 
 
 
-int RecvTable_MergeDeltas(
-	RecvTable *pTable,
-
-	bf_read *pOldState,		// this can be null
+// Writes all pNewState properties into pOut, along with the pOldState properties that
+// pNewState doesn't have. pDTIDecoder is only set for instrumented merges. Returns the
+// number of changed props, or -1 if a prop index is outside of the table.
+static int DataTable_MergeDeltas(
+	const CSendTablePrecalc *pPrecalc,
+	CRecvDecoder *pDTIDecoder,
+	bf_read *pOldState,
 	bf_read *pNewState,
-
 	bf_write *pOut,
-
-	int objectID,
-	int *pChangedProps,
-	bool updateDTI
+	int *pChangedProps
 	)
 {
-	ErrorIfNot( pTable && pNewState && pOut,
-		("RecvTable_MergeDeltas: invalid parameters passed.")
-	);
-
-	CRecvDecoder *pDecoder = pTable->m_pDecoder;
-	ErrorIfNot( pDecoder, ("RecvTable_MergeDeltas: table '%s' is missing its decoder.", pTable->GetName()) );
-
+	const unsigned int nProps = pPrecalc->GetNumProps();
 	int nChanged = 0;
+	bool bValid = true;
 	
 	// Setup to read the delta bits from each buffer.
 	CDeltaBitsReader oldStateReader( pOldState );
@@ -613,30 +607,43 @@ int RecvTable_MergeDeltas(
 
 	unsigned int iNewProp = newStateReader.ReadNextPropIndex();
 	
-	while ( 1 )
+	while ( bValid )
 	{
 		// Write any properties in the previous state that aren't in the new state.
 		while ( iOldProp < iNewProp )
 		{
+			if ( iOldProp >= nProps )
+			{
+				bValid = false;
+				break;
+			}
+
 			deltaBitsWriter.WritePropIndex( iOldProp );
-			oldStateReader.CopyPropData( deltaBitsWriter.GetBitBuf(), pDecoder->GetSendProp( iOldProp ) );
+			oldStateReader.CopyPropData( deltaBitsWriter.GetBitBuf(), pPrecalc->GetProp( iOldProp ) );
 			iOldProp = oldStateReader.ReadNextPropIndex();
 		}
 
 		// Check if we're at the end here so the while() statement above can seek the old buffer
 		// to its end too.
-		if ( iNewProp >= MAX_DATATABLE_PROPS )
+		if ( !bValid || iNewProp == ~0u )
 			break;
+
+		// Prop indices only ever grow, a corrupt delta can wrap them around
+		if ( iNewProp >= nProps || nChanged >= MAX_DATATABLE_PROPS )
+		{
+			bValid = false;
+			break;
+		}
 		
 		// If the old state has this property too, then just skip over its data.
 		if ( iOldProp == iNewProp )
 		{
-			oldStateReader.SkipPropData( pDecoder->GetSendProp( iOldProp ) );
+			oldStateReader.SkipPropData( pPrecalc->GetProp( iOldProp ) );
 			iOldProp = oldStateReader.ReadNextPropIndex();
 		}
 
 		// Instrumentation (store the # bits for the prop index).
-		if ( updateDTI && g_bDTIEnabled )
+		if ( pDTIDecoder && g_bDTIEnabled )
 		{
 			iStartBit = pNewState->GetNumBitsRead();
 			nIndexBits = iStartBit - iLastBit;
@@ -644,7 +651,7 @@ int RecvTable_MergeDeltas(
 
 		// Now write the new state's value.
 		deltaBitsWriter.WritePropIndex( iNewProp );
-		newStateReader.CopyPropData( deltaBitsWriter.GetBitBuf(), pDecoder->GetSendProp( iNewProp ) );
+		newStateReader.CopyPropData( deltaBitsWriter.GetBitBuf(), pPrecalc->GetProp( iNewProp ) );
 	
 		if ( pChangedProps )
 		{
@@ -654,17 +661,54 @@ int RecvTable_MergeDeltas(
 		nChanged++;
 
 		// Instrumentation (store # bits for the encoded property).
-		if ( updateDTI && g_bDTIEnabled )
+		if ( pDTIDecoder && g_bDTIEnabled )
 		{
 			iLastBit = pNewState->GetNumBitsRead();
-			DTI_HookDeltaBits( pDecoder, iNewProp, iLastBit - iStartBit, nIndexBits );
+			DTI_HookDeltaBits( pDTIDecoder, iNewProp, iLastBit - iStartBit, nIndexBits );
 		}
 
 		iNewProp = newStateReader.ReadNextPropIndex();
 	}
 
+	if ( !bValid )
+	{
+		oldStateReader.ForceFinished();
+		newStateReader.ForceFinished();
+		return -1;
+	}
+
 	Assert( nChanged <= MAX_DATATABLE_PROPS );
 
+	return nChanged;
+}
+
+
+int RecvTable_MergeDeltas(
+	RecvTable *pTable,
+
+	bf_read *pOldState,		// this can be null
+	bf_read *pNewState,
+
+	bf_write *pOut,
+
+	int objectID,
+	int *pChangedProps,
+	bool updateDTI
+	)
+{
+	ErrorIfNot( pTable && pNewState && pOut,
+		("RecvTable_MergeDeltas: invalid parameters passed.")
+	);
+
+	CRecvDecoder *pDecoder = pTable->m_pDecoder;
+	ErrorIfNot( pDecoder, ("RecvTable_MergeDeltas: table '%s' is missing its decoder.", pTable->GetName()) );
+
+	int nChanged = DataTable_MergeDeltas( &pDecoder->m_Precalc, updateDTI ? pDecoder : NULL, pOldState, pNewState, pOut, pChangedProps );
+
+	ErrorIfNot( nChanged >= 0,
+		("RecvTable_MergeDeltas: invalid prop index in RecvTable '%s'.", pTable->GetName())
+		);
+
 	ErrorIfNot( 
 		!(pOldState && pOldState->IsOverflowed()) && !pNewState->IsOverflowed() && !pOut->IsOverflowed(),
 		("RecvTable_MergeDeltas: overflowed in RecvTable '%s'.", pTable->GetName())
@@ -674,6 +718,17 @@ int RecvTable_MergeDeltas(
 }
 
 
+int SendTable_MergeDeltas( const CSendTablePrecalc *pPrecalc, bf_read *pOldState, bf_read *pNewState, bf_write *pOut )
+{
+	int nChanged = DataTable_MergeDeltas( pPrecalc, NULL, pOldState, pNewState, pOut, NULL );
+
+	if ( ( pOldState && pOldState->IsOverflowed() ) || pNewState->IsOverflowed() || pOut->IsOverflowed() )
+		return -1;
+
+	return nChanged;
+}
+
+
 void RecvTable_CopyEncoding( RecvTable *pTable, bf_read *pIn, bf_write *pOut, int objectID )
 {
 	RecvTable_MergeDeltas( pTable, NULL, pIn, pOut, objectID );
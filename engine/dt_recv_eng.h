@@ -17,6 +17,8 @@
 #include "dt.h"
 
 class CStandardSendProxies;
+class SendTable;
+class CSendTablePrecalc;
 
 // ------------------------------------------------------------------------------------------ //
 // RecvTable functions.
@@ -32,6 +34,11 @@ void		RecvTable_Term( bool clearall = true );
 // SendTable from the server. nDemoProtocol = 0 means current version.
 bool		RecvTable_RecvClassInfos( bf_read *pBuf, bool bNeedsDecoder, int nDemoProtocol = 0);
 
+// Reads one SendTable as sent by the server, without registering it anywhere. Datatable
+// props keep the name of their table in m_pExcludeDTName. Free it with RecvTable_FreeSendTable.
+SendTable	*RecvTable_ReadInfos( bf_read *pBuf, int nDemoProtocol );
+void		RecvTable_FreeSendTable( SendTable *pTable );
+
 
 // After ALL the SendTables have been received, call this and it will create CRecvDecoders
 // for all the SendTable->RecvTable matches it finds.
@@ -75,6 +82,16 @@ int RecvTable_MergeDeltas(
 	);
 
 
+// RecvTable_MergeDeltas for a SendTable with no RecvTable, a demo read without a client.
+// Returns -1 instead of failing fatally on a prop index outside of the table or an overflow.
+int SendTable_MergeDeltas(
+	const CSendTablePrecalc *pPrecalc,
+	bf_read *pOldState,		// this can be null
+	bf_read *pNewState,
+	bf_write *pOut
+	);
+
+
 // Just copies the bits from the bf_read into the bf_write (this function is used
 // when you don't know the length of the encoded data).
 void RecvTable_CopyEncoding( 
@@ -832,6 +832,12 @@ int CHLTVClientState::GetConnectionRetryNumber() const
 	}
 }
 
+// Returns the protocol of the demo SourceTV plays back, or PROTOCOL_VERSION when relaying
+int CHLTVClientState::GetDemoProtocolVersion() const
+{
+	return m_pHLTV ? m_pHLTV->GetProtocolVersion() : PROTOCOL_VERSION;
+}
+
 void CHLTVClientState::ConnectionCrashed(const char *reason)
 {
 	CBaseClientState::ConnectionCrashed( reason );
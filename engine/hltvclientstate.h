@@ -41,6 +41,7 @@ public:
 	void ConnectionCrashed( const char * reason );
 	void ConnectionClosing( const char * reason );
 	int GetConnectionRetryNumber() const;
+	int GetDemoProtocolVersion() const;
 
 	void ReadEnterPVS( CEntityReadInfo &u );
 	void ReadLeavePVS( CEntityReadInfo &u );
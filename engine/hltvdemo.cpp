@@ -30,6 +30,8 @@
 
 extern CNetworkStringTableContainer *networkStringTableContainerServer;
 
+static ConVar tv_keyframeinterval( "tv_keyframeinterval", "30", 0, "Seconds between keyframes in SourceTV demos, which let playback jump to any tick quickly. 0 = off", true, 0, false, 0 );
+
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
 //////////////////////////////////////////////////////////////////////
@@ -62,7 +64,7 @@ void CHLTVDemoRecorder::StartRecording( const char *filename, bool bContinuously
 {
 	StopRecording();	// stop if we're already recording
 	
-	if ( !m_DemoFile.Open( filename, false ) )
+	if ( !m_DemoFile.Open( filename, false, false, 0, true, demo_compress.GetBool() ) )
 	{
 		ConMsg ("StartRecording: couldn't open demo file %s.\n", filename );
 		return;
@@ -107,6 +109,21 @@ void CHLTVDemoRecorder::StartRecording( const char *filename, bool bContinuously
 
 	m_SequenceInfo = 1;
 	m_nDeltaTick = -1;
+
+	// the demo starts with a full update, like a keyframe
+	m_nNextKeyframeTick = (int)( tv_keyframeinterval.GetFloat() / host_state.interval_per_tick );
+
+	// keyframes are collected next to the demo, StopRecording moves them behind dem_stop
+	if ( tv_keyframeinterval.GetFloat() > 0 )
+	{
+		char szKeyframeFile[MAX_OSPATH];
+		Q_snprintf( szKeyframeFile, sizeof( szKeyframeFile ), "%s.keyframes", filename );
+
+		if ( !m_KeyframeFile.Open( szKeyframeFile, false ) )
+		{
+			ConMsg( "StartRecording: couldn't open %s, recording without keyframes.\n", szKeyframeFile );
+		}
+	}
 }
 
 bool CHLTVDemoRecorder::IsRecording()
@@ -122,6 +139,8 @@ void CHLTVDemoRecorder::StopRecording()
 	// Demo playback should read this as an incoming message.
 	m_DemoFile.WriteCmdHeader( dem_stop, GetRecordingTick() );
 
+	WriteKeyframes();
+
 	// update demo header info
 	m_DemoFile.m_DemoHeader.playback_ticks = GetRecordingTick();
 	m_DemoFile.m_DemoHeader.playback_time =  host_state.interval_per_tick *	GetRecordingTick();
@@ -250,6 +269,11 @@ void CHLTVDemoRecorder::RecordServerClasses( ServerClass *pClasses )
 }
 
 void CHLTVDemoRecorder::RecordStringTables()
+{
+	WriteStringTables( m_DemoFile );
+}
+
+void CHLTVDemoRecorder::WriteStringTables( CDemoFile &demoFile )
 {
 
 	// !KLUDGE! It would be nice if the bit buffer could write into a stream
@@ -270,7 +294,7 @@ void CHLTVDemoRecorder::RecordStringTables()
 		{
 
 			// Now write the buffer into the demo file
-			m_DemoFile.WriteStringTables( &buf, GetRecordingTick() );
+			demoFile.WriteStringTables( &buf, GetRecordingTick() );
 			break;
 		}
 
@@ -331,6 +355,89 @@ int CHLTVDemoRecorder::WriteSignonData()
 }
 
 
+//-----------------------------------------------------------------------------
+// Purpose: Writes the full state of the frame just written to the keyframe
+//			file, for playback to jump to, see demokeyframe_t
+//-----------------------------------------------------------------------------
+void CHLTVDemoRecorder::WriteKeyframe( CHLTVFrame *pFrame )
+{
+	ALIGN4 byte		buffer[ NET_MAX_PAYLOAD ] ALIGN4_POST;
+	bf_write	msg( "CHLTVDemo::WriteKeyframe", buffer, sizeof( buffer ) );
+
+	demokeyframe_t keyframe;
+	keyframe.tick = GetRecordingTick();
+	keyframe.frameOffset = m_DemoFile.GetCurPos( false );
+	keyframe.keyframeOffset = m_KeyframeFile.GetCurPos( false );
+
+	WriteStringTables( m_KeyframeFile );
+
+	NET_Tick tickmsg( pFrame->tick_count, m_nClientTick, host_frametime_unbounded, host_frametime_stddeviation );
+	tickmsg.WriteToBuffer( msg );
+
+	// Entities entering with an uncompressed update are read from the instance baselines, so the keyframe
+	// doesn't depend on earlier packets. It mustn't start a baseline update either, since sequential
+	// playback never reads it.
+	CGameClient *pClient = hltv->m_MasterClient;
+	int nBaselineUpdateTick = pClient->m_nBaselineUpdateTick;
+	pClient->m_nBaselineUpdateTick = pFrame->tick_count;
+
+	sv.WriteDeltaEntities( pClient, pFrame, NULL, msg );
+
+	pClient->m_nBaselineUpdateTick = nBaselineUpdateTick;
+
+	if ( msg.IsOverflowed() )
+	{
+		// the string tables are never read, the keyframe is just not listed
+		return;
+	}
+
+	// same sequence number as the frame's own packet
+	WriteMessages( m_KeyframeFile, dem_packet, msg, m_SequenceInfo - 1 );
+
+	keyframe.keyframeEndOffset = m_KeyframeFile.GetCurPos( false );
+	m_DemoFile.m_Keyframes.AddToTail( keyframe );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Moves the keyframes behind dem_stop, where readers that don't know
+//			about them never get to, and writes their index
+//-----------------------------------------------------------------------------
+void CHLTVDemoRecorder::WriteKeyframes()
+{
+	if ( !m_KeyframeFile.IsOpen() )
+		return;
+
+	char szKeyframeFile[MAX_OSPATH];
+	Q_strncpy( szKeyframeFile, m_KeyframeFile.m_szFileName, sizeof( szKeyframeFile ) );
+
+	// waits for the file to be written
+	m_KeyframeFile.Close();
+
+	FileHandle_t fh = g_pFileSystem->Open( szKeyframeFile, "rb" );
+	if ( fh != FILESYSTEM_INVALID_HANDLE )
+	{
+		int nKeyframesOffset = m_DemoFile.GetCurPos( false );
+
+		m_DemoFile.WriteFileBytes( fh, g_pFileSystem->Size( fh ) );
+		g_pFileSystem->Close( fh );
+
+		FOR_EACH_VEC( m_DemoFile.m_Keyframes, i )
+		{
+			m_DemoFile.m_Keyframes[i].keyframeOffset += nKeyframesOffset;
+			m_DemoFile.m_Keyframes[i].keyframeEndOffset += nKeyframesOffset;
+		}
+
+		m_DemoFile.WriteKeyframeIndex();
+	}
+	else
+	{
+		ConMsg( "StopRecording: couldn't read %s, demo has no keyframes.\n", szKeyframeFile );
+	}
+
+	m_DemoFile.m_Keyframes.RemoveAll();
+	g_pFileSystem->RemoveFile( szKeyframeFile );
+}
+
 void CHLTVDemoRecorder::WriteFrame( CHLTVFrame *pFrame )
 {
 	ALIGN4 byte		buffer[ NET_MAX_PAYLOAD ] ALIGN4_POST;
@@ -386,9 +493,30 @@ void CHLTVDemoRecorder::WriteFrame( CHLTVFrame *pFrame )
 
 	// write packet to demo file
 	WriteMessages( dem_packet, msg ); 
+
+	// a keyframe every tv_keyframeinterval seconds
+	if ( m_KeyframeFile.IsOpen() && tv_keyframeinterval.GetFloat() > 0 && GetRecordingTick() >= m_nNextKeyframeTick )
+	{
+		WriteKeyframe( pFrame );
+		m_nNextKeyframeTick = GetRecordingTick() + MAX( 1, (int)( tv_keyframeinterval.GetFloat() / host_state.interval_per_tick ) );
+	}
 }
 
 void CHLTVDemoRecorder::WriteMessages( unsigned char cmd, bf_write &message )
+{
+	if ( message.GetNumBytesWritten() <= 0 )
+		return;
+
+	if ( cmd == dem_packet )
+	{
+		m_nFrameCount++;
+	}
+
+	WriteMessages( m_DemoFile, cmd, message, m_SequenceInfo );
+	m_SequenceInfo++;
+}
+
+void CHLTVDemoRecorder::WriteMessages( CDemoFile &demoFile, unsigned char cmd, bf_write &message, int nSequence )
 {
 	int len = message.GetNumBytesWritten();
 
@@ -408,29 +536,23 @@ void CHLTVDemoRecorder::WriteMessages( unsigned char cmd, bf_write &message )
 	// and wait for packet time
 	// byte cmd = (m_pDemoFileHeader != NULL)  ? dem_signon : dem_packet;
 
-	if ( cmd == dem_packet )
-	{
-		m_nFrameCount++;
-	}
-
 	// write command & time
-	m_DemoFile.WriteCmdHeader( cmd, GetRecordingTick() ); 
+	demoFile.WriteCmdHeader( cmd, GetRecordingTick() ); 
 	
 	// write NULL democmdinfo just to keep same format as client demos
 	democmdinfo_t info;
 	Q_memset( &info, 0, sizeof( info ) );
-	m_DemoFile.WriteCmdInfo( info );
+	demoFile.WriteCmdInfo( info );
 
 	// write continously increasing sequence numbers
-	m_DemoFile.WriteSequenceInfo( m_SequenceInfo, m_SequenceInfo );
-	m_SequenceInfo++;
+	demoFile.WriteSequenceInfo( nSequence, nSequence );
 	
 	// Output the buffer.  Skip the network packet stuff.
-	m_DemoFile.WriteRawData( (char*)message.GetBasePointer(), len );
+	demoFile.WriteRawData( (char*)message.GetBasePointer(), len );
 	
 	if ( tv_debug.GetInt() > 1 )
 	{
-		Msg( "Writing SourceTV demo message %i bytes at file pos %i\n", len, m_DemoFile.GetCurPos( false ) );
+		Msg( "Writing SourceTV demo message %i bytes at file pos %i\n", len, demoFile.GetCurPos( false ) );
 	}
 }
 
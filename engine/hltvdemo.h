@@ -45,17 +45,22 @@ public:
 
 public:
 	void	WriteFrame( CHLTVFrame *pFrame );
+	void	WriteKeyframe( CHLTVFrame *pFrame );
+	void	WriteKeyframes();
 	void	CloseFile();
 	void	Reset();
 
 	void	WriteServerInfo();
 	int		WriteSignonData();  // write all necessary signon data and returns written bytes
 	void	WriteMessages( unsigned char cmd, bf_write &message );
+	void	WriteMessages( CDemoFile &demoFile, unsigned char cmd, bf_write &message, int nSequence );
+	void	WriteStringTables( CDemoFile &demoFile );
 	int		GetMaxAckTickCount();
 
 public:
 
 	CDemoFile		m_DemoFile;
+	CDemoFile		m_KeyframeFile;	// keyframes while recording, see WriteKeyframes
 	bool			m_bIsRecording;
 	int				m_nFrameCount;
 	float			m_nStartTick;
@@ -63,6 +68,7 @@ public:
 	int				m_nDeltaTick;
 	int             m_nClientTick;	
 	int				m_nSignonTick;
+	int				m_nNextKeyframeTick;
 	bf_write		m_MessageData; // temp buffer for all network messages
 };
 
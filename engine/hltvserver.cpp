@@ -86,6 +86,7 @@ ConVar tv_transmitall( "tv_transmitall", "0", FCVAR_REPLICATED, "Transmit all en
 ConVar tv_debug( "tv_debug", "0", 0, "SourceTV debug info." );
 ConVar tv_title( "tv_title", "SourceTV", 0, "Set title for SourceTV spectator UI", tv_title_changed_f );
 static ConVar tv_deltacache( "tv_deltacache", "2", 0, "Enable delta entity bit stream cache" );
+static ConVar tv_packetcache( "tv_packetcache", "1", 0, "Share packet entity updates between spectators updated from the same tick" );
 static ConVar tv_relayvoice( "tv_relayvoice", "1", 0, "Relay voice data: 0=off, 1=on" );
 
 CDeltaEntityCache::CDeltaEntityCache()
@@ -212,6 +213,72 @@ void CDeltaEntityCache::AddDeltaBits( int nEntityIndex, int nDeltaTick, int nBit
 	}
 }
 
+CDeltaPacketCache::CDeltaPacketCache()
+{
+	m_nTick = 0;
+	m_nShared = 0;
+	m_nEncoded = 0;
+}
+
+void CDeltaPacketCache::Flush()
+{
+	m_Entries.RemoveAll();
+	m_Data.RemoveAll();
+	m_nTick = 0;
+}
+
+void CDeltaPacketCache::SetTick( int nTick )
+{
+	if ( nTick == m_nTick )
+		return;
+
+	// keep the memory, next tick needs about the same
+	m_Entries.RemoveAll();
+	m_Data.RemoveAll();
+	m_nTick = nTick;
+}
+
+unsigned char* CDeltaPacketCache::FindPacketBits( int nTick, int nDeltaTick, int nBaseline, int &nBits )
+{
+	nBits = -1;
+
+	if ( nTick != m_nTick )
+		return NULL;
+
+	for ( int i=0; i<m_Entries.Count(); i++ )
+	{
+		DeltaPacketEntry_s &entry = m_Entries[i];
+
+		if ( entry.nDeltaTick == nDeltaTick && entry.nBaseline == nBaseline )
+		{
+			nBits = entry.nBits;
+			return (unsigned char*)( m_Data.Base() + entry.nOffset );
+		}
+	}
+
+	return NULL;
+}
+
+void CDeltaPacketCache::AddPacketBits( int nTick, int nDeltaTick, int nBaseline, int nBits, bf_write *pBuffer )
+{
+	if ( nTick != m_nTick || nBits <= 0 )
+		return;
+
+	int nWords = PAD_NUMBER( Bits2Bytes(nBits), 4 ) / 4;
+
+	DeltaPacketEntry_s &entry = m_Entries[ m_Entries.AddToTail() ];
+	entry.nDeltaTick = nDeltaTick;
+	entry.nBaseline = nBaseline;
+	entry.nBits = nBits;
+	entry.nOffset = m_Data.AddMultipleToTail( nWords );
+
+	// pBuffer is at the start of the update, which has been written after it
+	bf_read  inBuffer; 
+	inBuffer.StartReading( pBuffer->GetData(), pBuffer->m_nDataBytes, pBuffer->GetNumBitsWritten() );
+	bf_write outBuffer( m_Data.Base() + entry.nOffset, nWords * 4 );
+	outBuffer.WriteBitsFromBuffer( &inBuffer, nBits );
+}
+
 						  
 static RecvTable* FindRecvTable( const char *pName, RecvTable **pRecvTables, int nRecvTables )
 {
@@ -567,7 +634,7 @@ void CHLTVServer::StartMaster(CGameClient *client)
 
 		if ( descriptor )
 		{
-			g_GameEventManager.AddListener( this, descriptor, CGameEventManager::CLIENTSTUB );
+			g_GameEventManager.AddClientStub( this, this, descriptor );
 		}
 		else
 		{
@@ -1015,6 +1082,14 @@ void CHLTVServer::FireGameEvent(IGameEvent *event)
 	}
 }
 
+void CHLTVServer::SendGameEvent( SVC_GameEvent &eventMsg )
+{
+	if ( !IsActive() )
+		return;
+
+	SendNetMsg( eventMsg );
+}
+
 bool CHLTVServer::ShouldUpdateMasterServer()
 {
 
@@ -1628,6 +1703,7 @@ void CHLTVServer::UpdateTick( void )
 	{
 		// delta entity cache works only for relay proxies
 		m_DeltaCache.SetTick( m_CurrentFrame->tick_count, m_CurrentFrame->last_entity+1 );
+		m_PacketCache.SetTick( m_CurrentFrame->tick_count );
 	}
 
 	int removeTick = m_nTickCount - 16.0f/m_flTickInterval; // keep 16 seconds buffer
@@ -1645,6 +1721,48 @@ const char *CHLTVServer::GetName( void ) const
 	return tv_name.GetString();
 }
 
+void CHLTVServer::WriteDeltaEntities( CBaseClient *client, CClientFrame *to, CClientFrame *from, bf_write &pBuf )
+{
+	// spectators of a relay proxy all see the same entities, so delta updates between
+	// the same two frames are the same for all of them. Props are culled for each
+	// client while the game server runs here, full updates may become new baselines.
+	if ( !tv_packetcache.GetBool() || sv.IsActive() || !from || client->IsTracing() )
+	{
+		CBaseServer::WriteDeltaEntities( client, to, from, pBuf );
+		return;
+	}
+
+	int nBits;
+	unsigned char *pBits = m_PacketCache.FindPacketBits( to->tick_count, from->tick_count, client->m_nBaselineUsed, nBits );
+
+	if ( pBits )
+	{
+		// same side effect as writing the update, see CBaseServer::WriteDeltaEntities()
+		if ( client->m_nBaselineUpdateTick == -1 )
+		{
+			client->m_BaselinesSent.ClearAll();
+			to->from_baseline = &client->m_BaselinesSent;
+		}
+
+		pBuf.WriteBits( pBits, nBits );
+		m_PacketCache.m_nShared++;
+		return;
+	}
+
+	bf_write bufStart = pBuf;
+	int nEnterPVS = 0;
+
+	CBaseServer::WriteDeltaEntities( client, to, from, pBuf, &nEnterPVS );
+
+	// entities entering the PVS are written relative to the client's own baseline
+	if ( nEnterPVS == 0 && !pBuf.IsOverflowed() )
+	{
+		nBits = pBuf.GetNumBitsWritten() - bufStart.GetNumBitsWritten();
+		m_PacketCache.AddPacketBits( to->tick_count, from->tick_count, client->m_nBaselineUsed, nBits, &bufStart );
+		m_PacketCache.m_nEncoded++;
+	}
+}
+
 void CHLTVServer::FillServerInfo(SVC_ServerInfo &serverinfo)
 {
 	CBaseServer::FillServerInfo( serverinfo );
@@ -1676,6 +1794,7 @@ void CHLTVServer::Clear( void )
 	DeleteClientFrames( -1 );
 
 	m_DeltaCache.Flush();
+	m_PacketCache.Flush();
 	m_FrameCache.RemoveAll();
 }
 
@@ -2201,6 +2320,12 @@ CON_COMMAND( tv_status, "Show SourceTV server status." )
 	ConMsg("Total Slots %i, Spectators %i, Proxies %i\n", 
 		slots, clients-proxies, proxies);
 
+	if ( !hltv->IsMasterProxy() )
+	{
+		ConMsg("Entity updates encoded %i, shared %i\n", 
+			hltv->m_PacketCache.m_nEncoded, hltv->m_PacketCache.m_nShared );
+	}
+
 	if ( hltv->m_DemoRecorder.IsRecording() )
 	{
 		ConMsg("Recording to \"%s\", length %s.\n", hltv->m_DemoRecorder.GetDemoFile()->m_szFileName, 
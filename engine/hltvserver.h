@@ -84,12 +84,41 @@ protected:
 	DeltaEntityEntry_s* m_Cache[MAX_EDICTS]; // array of pointers to delta entries
 };
 
+// complete packet entity updates of the current tick, shared by all clients
+// that are updated from the same delta tick with the same baseline
+class CDeltaPacketCache
+{
+	struct DeltaPacketEntry_s
+	{
+		int nDeltaTick;
+		int nBaseline;
+		int nBits;
+		int nOffset;	// into m_Data
+	};
+
+public:
+	CDeltaPacketCache();
+
+	void SetTick( int nTick );
+	unsigned char* FindPacketBits( int nTick, int nDeltaTick, int nBaseline, int &nBits );
+	void AddPacketBits( int nTick, int nDeltaTick, int nBaseline, int nBits, bf_write *pBuffer );
+	void Flush();
+
+	int	m_nShared;	// updates copied from the cache
+	int m_nEncoded;	// updates written and added to the cache
+
+protected:
+	int	m_nTick;	// current tick
+	CUtlVector<DeltaPacketEntry_s>	m_Entries;
+	CUtlVector<uint32>				m_Data;
+};
+
 
 class CGameClient;
 class CGameServer;
 class IHLTVDirector;
 
-class CHLTVServer : public IGameEventListener2, public CBaseServer, public CClientFrameManager, public IHLTVServer, public IDemoPlayer
+class CHLTVServer : public IGameEventListener2, public CBaseServer, public CClientFrameManager, public IHLTVServer, public IDemoPlayer, public IGameEventClientStub
 {
 friend class CHLTVClientState;
 
@@ -110,11 +139,13 @@ public: // CBaseServer interface:
 	int		GetChallengeType ( netadr_t &adr );
 	const char *GetName( void ) const;
 	const char *GetPassword() const;
+	void	WriteDeltaEntities( CBaseClient *client, CClientFrame *to, CClientFrame *from, bf_write &pBuf );
 	IClient *ConnectClient ( netadr_t &adr, int protocol, int challenge, int clientChallenge, int authProtocol, 
 		const char *name, const char *password, const char *hashedCDkey, int cdKeyLen );
 
 public:
 	void	FireGameEvent(IGameEvent *event);
+	void	SendGameEvent( SVC_GameEvent &eventMsg );
 
 public: // IHLTVServer interface:
 	IServer	*GetBaseServer( void );
@@ -245,6 +276,7 @@ public:
 	CNetworkStringTableContainer m_NetworkStringTables;
 
 	CDeltaEntityCache				m_DeltaCache;
+	CDeltaPacketCache				m_PacketCache;
 	CUtlVector<CFrameCacheEntry_s>	m_FrameCache;
 
 	// demoplayer stuff:
@@ -98,6 +98,7 @@
 #include "cl_main.h"
 #include "hltvserver.h"
 #include "hltvtest.h"
+#include "demoanalyzer.h"
 #if defined( REPLAY_ENABLED )
 #include "replayserver.h"
 #include "replay_internal.h"
@@ -124,6 +125,7 @@
 #include "soundservice.h"
 #include "profile.h"
 #include "steam/isteamremotestorage.h"
+#include "tier0/framearena.h"
 #if defined( _X360 )
 #include "xbox/xbox_win32stubs.h"
 #include "audio_pch.h"
@@ -353,6 +355,15 @@ CON_COMMAND( mem_compact, "" )
 	MemAlloc_CompactHeap();
 }
 
+CON_COMMAND( mem_framearena_stats, "Print how much per-frame scratch memory was served by the frame arenas last frame." )
+{
+	FrameArenaStats_t stats;
+	FrameArena_GetStats( &stats );
+
+	ConMsg( "Frame %d: %d allocations, %d bytes from %d thread(s), %d heap block allocation(s), %d kb reserved\n",
+		stats.m_nFrame, stats.m_nAllocations, stats.m_nBytes, stats.m_nThreads, stats.m_nBlockAllocations, stats.m_nReservedBytes / 1024 );
+}
+
 CON_COMMAND( mem_eat, "" )
 {
 	MemAlloc_Alloc( 1024* 1024 );
@@ -2592,6 +2603,9 @@ void Host_CheckDumpMemoryStats( void )
 	Msg("------------------------------------\n");
 	int hunk = Hunk_MallocSize();
 	Msg("\tAllocated outside hunk:  %s\n", Q_pretifymem( size - hunk ) );
+
+	// small block heap and per-thread cache stats
+	MemAlloc_DumpStats();
 #endif
 }
 
@@ -3626,6 +3640,8 @@ void _Host_RunFrame (float time)
 
 		Host_UpdateMapList();
 
+		DemoAnalyzer_Frame();
+
 		host_framecount++;
 #if !defined(SWDS)
 		if ( !demoplayer->IsPlaybackPaused() )
@@ -3648,6 +3664,9 @@ void _Host_RunFrame (float time)
 
 		Host_CheckDumpMemoryStats();
 
+		// everything that ran this frame is done with its scratch memory
+		FrameArena_EndFrame();
+
 		GetTestScriptMgr()->CheckPoint( "frame_end" );
 	} // Profile scope, protect from setjmp() problems
 
@@ -5018,6 +5037,8 @@ void Host_Shutdown(void)
 	}
 #endif
 
+	TRACESHUTDOWN( DemoAnalyzer_Shutdown() );
+
 	TRACESHUTDOWN( HLTV_Shutdown() );
 
 	TRACESHUTDOWN( g_Log.Shutdown() );
@@ -49,6 +49,7 @@
 #include "UtlSortVector.h"
 #include "utlhashtable.h"
 #include "tier1/lzmaDecoder.h"
+#include "tier1/memorymappedfile.h"
 #include "eiface.h"
 #include "server.h"
 #include "ifilelist.h"
@@ -76,6 +77,7 @@ static ConVar mod_offline_hdr_switch( "mod_offline_hdr_switch", CONVAR_DEFAULT_M
                                       "pathways." );
 static ConVar mod_touchalldata( "mod_touchalldata", "1", 0, "Touch model data during level startup" );
 static ConVar mod_forcetouchdata( "mod_forcetouchdata", "1", 0, "Forces all model file data into cache on model load." );
+static ConVar mod_mapbsp( "mod_mapbsp", "1", 0, "Memory map .bsp files during level load and hand out lumps straight from the mapping." );
 ConVar mat_excludetextures( "mat_excludetextures", "0", FCVAR_CHEAT );
 
 ConVar r_unloadlightmaps( "r_unloadlightmaps", "0", FCVAR_CHEAT );
@@ -395,6 +397,8 @@ static char				s_szMapName[128];
 static worldbrushdata_t	*s_pMap = NULL;
 static int				s_nMapLoadRecursion = 0;
 static CUtlBuffer		s_MapBuffer;
+static CMemoryMappedFile	s_MappedMapFile;
+static int				s_nMappedLumpRefs[ HEADER_LUMPS ];
 
 int s_MapVersion = 0;
 
@@ -475,6 +479,22 @@ void CMapLoadHelper::Init( model_t *pMapModel, const char *loadname )
 
 	V_strcpy_safe( s_szLoadName, loadname );
 
+	// Loose .bsp files can be mapped; ones inside pack files keep going through the file handle
+	V_memset( s_nMappedLumpRefs, 0, sizeof( s_nMappedLumpRefs ) );
+	if ( IsPC() && mod_mapbsp.GetBool() )
+	{
+		char szFullPath[MAX_PATH];
+		if ( g_pFileSystem->RelativePathToFullPath_safe( s_szMapName, NULL, szFullPath, FILTER_CULLPACK ) &&
+			 s_MappedMapFile.Open( szFullPath ) &&
+			 ( s_MappedMapFile.Size() != g_pFileSystem->Size( s_MapFileHandle ) ||
+			   s_MappedMapFile.Size() < (int64)sizeof( dheader_t ) ||
+			   V_memcmp( s_MappedMapFile.Base(), &s_MapHeader, sizeof( dheader_t ) ) != 0 ) )
+		{
+			// Not the file we opened, the header holds the revision and every lump's offset, size and version
+			s_MappedMapFile.Close();
+		}
+	}
+
 	// Store map version, but only do it once so that the communication between the engine and Hammer isn't broken. The map version
 	// is incremented whenever a Hammer to Engine session is established so resetting the global map version each time causes a problem.
 	if ( 0 == g_ServerGlobalVariables.mapversion )
@@ -602,6 +622,8 @@ void CMapLoadHelper::Shutdown( void )
 		s_MapFileHandle = FILESYSTEM_INVALID_HANDLE;
 	}
 
+	s_MappedMapFile.Close();
+
 	if ( IsPC() )
 	{
 		// Close our open lump files
@@ -768,6 +790,7 @@ CMapLoadHelper::CMapLoadHelper( int lumpToLoad )
 	m_pData = NULL;
 	m_pRawData = NULL;
 	m_pUncompressedData = NULL;
+	m_bMapped = false;
 	
 	// Load raw lump from disk
 	lump_t *lump = &s_MapHeader.lumps[ lumpToLoad ];
@@ -802,6 +825,14 @@ CMapLoadHelper::CMapLoadHelper( int lumpToLoad )
 		// bsp is in memory
 		m_pData = (unsigned char*)s_MapBuffer.Base() + m_nLumpOffset;
 	}
+	else if ( fileToUse == s_MapFileHandle && s_MappedMapFile.View( m_nLumpOffset, m_nLumpSize ).IsValid() )
+	{
+		// bsp is mapped, the lump is paged in as it gets used
+		m_pData = s_MappedMapFile.Base() + m_nLumpOffset;
+		m_bMapped = true;
+		s_nMappedLumpRefs[ m_nLumpID ]++;
+		s_MappedMapFile.WillNeed( m_nLumpOffset, m_nLumpSize );
+	}
 	else
 	{
 		if ( s_MapFileHandle == FILESYSTEM_INVALID_HANDLE )
@@ -867,6 +898,13 @@ CMapLoadHelper::~CMapLoadHelper( void )
 	{
 		g_pFileSystem->FreeOptimalReadBuffer( m_pRawData );
 	}
+
+	if ( m_bMapped && --s_nMappedLumpRefs[ m_nLumpID ] == 0 )
+	{
+		// Everyone is done with this lump; let its pages go instead of holding them until Shutdown
+		lump_t *lump = &s_MapHeader.lumps[ m_nLumpID ];
+		s_MappedMapFile.DontNeed( lump->fileofs, lump->filelen );
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -202,6 +202,7 @@ private:
 	byte				*m_pRawData;
 	byte				*m_pData;
 	byte				*m_pUncompressedData;
+	bool				m_bMapped;		// m_pData (or the compressed source) points into the mapped bsp
 
 	// Handling for lump files
 	int					m_nLumpID;
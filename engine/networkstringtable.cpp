@@ -15,12 +15,13 @@
 #include "baseclient.h"
 #include "vprof.h"
 #include <tier1/utlstring.h>
-#include <tier1/utlhashtable.h>
+#include <tier1/utlhashedstringdict.h>
 #include <tier0/etwprof.h>
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
 ConVar sv_dumpstringtables( "sv_dumpstringtables", "0", FCVAR_CHEAT );
+ConVar sv_stringtable_changelog( "sv_stringtable_changelog", "1", 0, "Send string table updates from each table's change log instead of scanning every entry per client." );
 ConVar sv_compressstringtablebaselines_threshhold( "sv_compressstringtablebaselines_threshold", "2048", 0, "Minimum size (in bytes) for stringtablebaseline buffer to be compressed." );
 
 #define SUBSTRING_BITS	5
@@ -43,7 +44,7 @@ static int CountSimilarCharacters( char const *str1, char const *str2 )
 	return c;
 }
 
-static int GetBestPreviousString( CUtlVector< StringHistoryEntry >& history, char const *newstring, int& substringsize )
+static int GetBestPreviousString( CUtlFrameVector< StringHistoryEntry >& history, char const *newstring, int& substringsize )
 {
 	int bestindex = -1;
 	int bestcount = 0;
@@ -67,84 +68,14 @@ static int GetBestPreviousString( CUtlVector< StringHistoryEntry >& history, cha
 	return bestindex;
 }
 
-bool CNetworkStringTable_LessFunc( FileNameHandle_t const &a, FileNameHandle_t const &b )
-{
-	return a < b;
-}
-
 //-----------------------------------------------------------------------------
-// Implementation when dictionary strings are filenames
-//-----------------------------------------------------------------------------
-class CNetworkStringFilenameDict : public INetworkStringDict
-{
-public:
-	CNetworkStringFilenameDict()
-	{
-		m_Items.SetLessFunc( CNetworkStringTable_LessFunc );
-	}
-
-	virtual ~CNetworkStringFilenameDict()
-	{
-		Purge();
-	}
-
-	unsigned int Count()
-	{
-		return m_Items.Count();
-	}
-
-	void Purge()
-	{
-		m_Items.Purge();
-	}
-
-	const char *String( int index )
-	{
-		char* pString = tmpstr512();
-		g_pFileSystem->String( m_Items.Key( index ), pString, 512 );
-		return pString;
-	}
-
-	bool IsValidIndex( int index )
-	{
-		return m_Items.IsValidIndex( index );
-	}
-
-	int Insert( const char *pString )
-	{
-		FileNameHandle_t fnHandle = g_pFileSystem->FindOrAddFileName( pString );
-		return m_Items.Insert( fnHandle );
-	}
-
-	int Find( const char *pString )
-	{
-		FileNameHandle_t fnHandle = g_pFileSystem->FindFileName( pString );
-		if ( !fnHandle )
-			return m_Items.InvalidIndex();
-		return m_Items.Find( fnHandle );
-	}
-
-	CNetworkStringTableItem	&Element( int index )
-	{
-		return m_Items.Element( index );
-	}
-
-	const CNetworkStringTableItem &Element( int index ) const
-	{
-		return m_Items.Element( index );
-	}
-
-private:
-	CUtlMap< FileNameHandle_t, CNetworkStringTableItem > m_Items;
-};
-
-//-----------------------------------------------------------------------------
-// Implementation for general purpose strings
+// Implementation on top of an open addressing hash index, finds are a hash of
+// the string and usually one compare. Filename tables treat '\' and '/' alike.
 //-----------------------------------------------------------------------------
 class CNetworkStringDict : public INetworkStringDict
 {
 public:
-	CNetworkStringDict() 
+	CNetworkStringDict( bool bFilenames = false ) : m_Lookup( bFilenames )
 	{
 	}
 
@@ -164,12 +95,12 @@ public:
 
 	const char *String( int index )
 	{
-		return m_Lookup.Key( index ).Get();
+		return m_Lookup.String( index );
 	}
 
 	bool IsValidIndex( int index )
 	{
-		return m_Lookup.IsValidHandle( index );
+		return m_Lookup.IsValidIndex( index );
 	}
 
 	int Insert( const char *pString )
@@ -179,7 +110,7 @@ public:
 
 	int Find( const char *pString )
 	{
-		return pString ? m_Lookup.Find( pString ) : m_Lookup.InvalidHandle();
+		return m_Lookup.Find( pString );
 	}
 
 	CNetworkStringTableItem	&Element( int index )
@@ -193,9 +124,24 @@ public:
 	}
 
 private:
-	CUtlStableHashtable< CUtlConstString, CNetworkStringTableItem, CaselessStringHashFunctor, UTLConstStringCaselessStringEqualFunctor<char> > m_Lookup;
+	CUtlHashedStringDict< CNetworkStringTableItem > m_Lookup;
 };
 
+//-----------------------------------------------------------------------------
+// Purpose: Checks table parameters that came off the wire, the constructor
+//			treats bad ones as fatal
+//-----------------------------------------------------------------------------
+bool CNetworkStringTable::IsValidSetup( int maxentries, int userdatafixedsize, int userdatanetworkbits )
+{
+	if ( maxentries <= 0 || ( 1 << Q_log2( maxentries ) ) != maxentries )
+		return false;
+
+	if ( userdatafixedsize < 0 || userdatafixedsize > CNetworkStringTableItem::MAX_USERDATA_SIZE )
+		return false;
+
+	return userdatanetworkbits >= 0 && userdatanetworkbits <= CNetworkStringTableItem::MAX_USERDATA_BITS;
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 // Input  : id - 
@@ -218,6 +164,7 @@ CNetworkStringTable::CNetworkStringTable( TABLEID id, const char *tableName, int
 	m_nTickCount = 0;
 	m_pMirrorTable = NULL;
 	m_nLastChangedTick = 0;
+	m_nChangeLogBaseTick = 0;
 	m_bChangeHistoryEnabled = false;
 	m_bLocked = false;
 
@@ -251,7 +198,7 @@ CNetworkStringTable::CNetworkStringTable( TABLEID id, const char *tableName, int
 	if ( IsXbox() || bIsFilenames )
 	{
 		m_bIsFilenames = true;
-		m_pItems = new CNetworkStringFilenameDict;
+		m_pItems = new CNetworkStringDict( true );
 	}
 	else
 	{
@@ -278,6 +225,10 @@ void CNetworkStringTable::SetAllowClientSideAddString( bool state )
 		m_pItemsClientSide->Insert( "___clientsideitemsplaceholder0___" ); // 0 slot can't be used
 		m_pItemsClientSide->Insert( "___clientsideitemsplaceholder1___" ); // -1 can't be used since it looks like the "invalid" index from other string lookups
 	}
+
+#ifndef SHARED_NET_STRING_TABLES
+	ResetChangeLog();
+#endif
 }
 
 //-----------------------------------------------------------------------------
@@ -331,14 +282,7 @@ CNetworkStringTable::~CNetworkStringTable( void )
 void CNetworkStringTable::DeleteAllStrings( void )
 {
 	delete m_pItems;
-	if ( m_bIsFilenames )
-	{
-		m_pItems = new CNetworkStringFilenameDict;
-	}
-	else
-	{
-		m_pItems = new CNetworkStringDict;
-	}
+	m_pItems = new CNetworkStringDict( m_bIsFilenames );
 
 	if ( m_pItemsClientSide )
 	{
@@ -428,6 +372,9 @@ void CNetworkStringTable::EnableRollback()
 	// stringtable must be empty 
 	Assert( m_pItems->Count() == 0);
 	m_bChangeHistoryEnabled = true;
+
+	// rollback rewrites item ticks, these tables always walk their items
+	ResetChangeLog();
 }
 
 void CNetworkStringTable::SetMirrorTable(INetworkStringTable *table)
@@ -440,6 +387,7 @@ void CNetworkStringTable::RestoreTick(int tick)
 	// TODO optimize this, most of the time the tables doens't really change
 
 	m_nLastChangedTick = 0;
+	ResetChangeLog();
 
 	int count = m_pItems->Count();
 		
@@ -464,16 +412,14 @@ void CNetworkStringTable::UpdateMirrorTable( int tick_ack  )
 
 	m_pMirrorTable->SetTick( m_nTickCount ); // use same tick
 
-	int count = m_pItems->Count();
-	
-	for ( int i = 0; i < count; i++ )
+	CUtlFrameVector< int > changed;
+	GetChangedEntries( tick_ack, changed );
+
+	for ( int j = 0; j < changed.Count(); j++ )
 	{
+		int i = changed[j];
 		CNetworkStringTableItem *p = &m_pItems->Element( i );
 
-		// mirror is up to date
-		if ( p->GetTickChanged() <= tick_ack )
-			continue;
-
 		const void *pUserData = p->GetUserData();
 
 		int nBytes = p->GetUserDataLength();
@@ -499,24 +445,132 @@ void CNetworkStringTable::UpdateMirrorTable( int tick_ack  )
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Records a change to a networked item at the current tick
+//-----------------------------------------------------------------------------
+void CNetworkStringTable::LogChange( int stringNumber )
+{
+	if ( m_bChangeHistoryEnabled || stringNumber < 0 )
+		return;
+
+	if ( m_ChangeLog.Count() )
+	{
+		const ChangeLogEntry_t &last = m_ChangeLog.Tail();
+
+		if ( last.tick == m_nTickCount && last.index == stringNumber )
+			return;
+
+		if ( last.tick > m_nTickCount )
+		{
+			// tick went backwards (CopyStringTable), everything up to the newest
+			// logged tick now has to come from the items
+			m_nChangeLogBaseTick = last.tick;
+			m_ChangeLog.RemoveAll();
+			return;
+		}
+	}
+	else if ( m_nTickCount <= m_nChangeLogBaseTick )
+	{
+		return;
+	}
+
+	// Compact by moving the base tick forward over the older half of the log.
+	// Clients that acked an older tick fall back to walking the items.
+	int nMaxEntries = MAX( 256, 2 * (int)m_pItems->Count() );
+	if ( m_ChangeLog.Count() >= nMaxEntries )
+	{
+		int nRemove = m_ChangeLog.Count() / 2;
+		int nBaseTick = m_ChangeLog[nRemove - 1].tick;
+		while ( nRemove < m_ChangeLog.Count() && m_ChangeLog[nRemove].tick == nBaseTick )
+		{
+			nRemove++;
+		}
+
+		m_ChangeLog.RemoveMultipleFromHead( nRemove );
+		m_nChangeLogBaseTick = nBaseTick;
+	}
+
+	ChangeLogEntry_t entry;
+	entry.tick = m_nTickCount;
+	entry.index = stringNumber;
+	m_ChangeLog.AddToTail( entry );
+}
+
+void CNetworkStringTable::ResetChangeLog( void )
+{
+	m_ChangeLog.Purge();
+	m_nChangeLogBaseTick = m_nTickCount;
+}
+
+static int ChangedEntryCompare( const int *a, const int *b )
+{
+	return *a - *b;
+}
+
+void CNetworkStringTable::GetChangedEntries( int tick_ack, CUtlFrameVector< int > &entries )
+{
+	entries.RemoveAll();
+
+	if ( !m_bChangeHistoryEnabled && tick_ack >= m_nChangeLogBaseTick && sv_stringtable_changelog.GetBool() )
+	{
+		// binary search for the first change the client hasn't acked
+		int lo = 0, hi = m_ChangeLog.Count();
+		while ( lo < hi )
+		{
+			int mid = ( lo + hi ) / 2;
+			if ( m_ChangeLog[mid].tick <= tick_ack )
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		for ( int i = lo; i < m_ChangeLog.Count(); i++ )
+		{
+			entries.AddToTail( m_ChangeLog[i].index );
+		}
+
+		// items changed more than once are sent once, in index order like below
+		entries.Sort( ChangedEntryCompare );
+		int nUnique = 0;
+		for ( int i = 0; i < entries.Count(); i++ )
+		{
+			if ( !nUnique || entries[nUnique - 1] != entries[i] )
+			{
+				entries[nUnique++] = entries[i];
+			}
+		}
+		entries.SetCountNonDestructively( nUnique );
+		return;
+	}
+
+	int count = m_pItems->Count();
+
+	for ( int i = 0; i < count; i++ )
+	{
+		// Client is up to date
+		if ( m_pItems->Element( i ).GetTickChanged() > tick_ack )
+		{
+			entries.AddToTail( i );
+		}
+	}
+}
+
 int CNetworkStringTable::WriteUpdate( CBaseClient *client, bf_write &buf, int tick_ack )
 {
-	CUtlVector< StringHistoryEntry > history;
+	CUtlFrameVector< StringHistoryEntry > history;
 
 	int entriesUpdated = 0;
 	int lastEntry = -1;
 	int nTableStartBit = buf.GetNumBitsWritten();
 
-	int count = m_pItems->Count();
+	CUtlFrameVector< int > changed;
+	GetChangedEntries( tick_ack, changed );
 
-	for ( int i = 0; i < count; i++ )
+	for ( int j = 0; j < changed.Count(); j++ )
 	{
+		int i = changed[j];
 		CNetworkStringTableItem *p = &m_pItems->Element( i );
 
-		// Client is up to date
-		if ( p->GetTickChanged() <= tick_ack )
-			continue;
-
 		int nStartBit = buf.GetNumBitsWritten();
 
 		// Write Entry index
@@ -610,11 +664,13 @@ int CNetworkStringTable::WriteUpdate( CBaseClient *client, bf_write &buf, int ti
 
 //-----------------------------------------------------------------------------
 // Purpose: Parse string update
+// Output : Returns false if the update is malformed
 //-----------------------------------------------------------------------------
-void CNetworkStringTable::ParseUpdate( bf_read &buf, int entries )
+bool CNetworkStringTable::ParseUpdate( bf_read &buf, int entries )
 {
 	int lastEntry = -1;
 
+	// heap backed, demo_analyze parses updates outside of the host frame
 	CUtlVector< StringHistoryEntry > history;
 
 	for (int i=0; i<entries; i++)
@@ -630,7 +686,8 @@ void CNetworkStringTable::ParseUpdate( bf_read &buf, int entries )
 		
 		if ( entryIndex < 0 || entryIndex >= GetMaxStrings() )
 		{
-			Host_Error( "Server sent bogus string index %i for table %s\n", entryIndex, GetTableName() );
+			Warning( "Server sent bogus string index %i for table %s\n", entryIndex, GetTableName() );
+			return false;
 		}
 
 		const char *pEntry = NULL;
@@ -647,8 +704,9 @@ void CNetworkStringTable::ParseUpdate( bf_read &buf, int entries )
 				unsigned int bytestocopy = buf.ReadUBitLong( SUBSTRING_BITS );
 				if ( index >= (unsigned int)history.Count() )
 				{
-					Host_Error( "Server sent bogus substring index %i for table %s\n",
-					            entryIndex, GetTableName() );
+					Warning( "Server sent bogus substring index %i for table %s\n",
+					         entryIndex, GetTableName() );
+					return false;
 				}
 				Q_strncpy( entry, history[ index ].string, Min( sizeof( entry ), (size_t)bytestocopy + 1 ) );
 				buf.ReadString( substr, sizeof(substr) );
@@ -681,9 +739,11 @@ void CNetworkStringTable::ParseUpdate( bf_read &buf, int entries )
 			else
 			{
 				nBytes = buf.ReadUBitLong( CNetworkStringTableItem::MAX_USERDATA_BITS );
-				ErrorIfNot( nBytes <= sizeof( tempbuf ),
-					("CNetworkStringTableClient::ParseUpdate: message too large (%d bytes).", nBytes)
-				);
+				if ( nBytes > (int)sizeof( tempbuf ) )
+				{
+					Warning( "CNetworkStringTableClient::ParseUpdate: message too large (%d bytes).\n", nBytes );
+					return false;
+				}
 
 				buf.ReadBytes( tempbuf, nBytes );
 			}
@@ -726,6 +786,58 @@ void CNetworkStringTable::ParseUpdate( bf_read &buf, int entries )
 		Q_strncpy( she.string, pEntry, sizeof( she.string ) );
 		history.AddToTail( she );
 	}
+
+	if ( buf.IsOverflowed() )
+	{
+		Warning( "CNetworkStringTable::ParseUpdate: table %s overflowed the message\n", GetTableName() );
+		return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: Parse the initial entries of a table, sent with SVC_CreateStringTable
+// Output : Returns false if the data is malformed
+//-----------------------------------------------------------------------------
+bool CNetworkStringTable::ParseCreate( bf_read &buf, int entries, bool bCompressed )
+{
+	if ( !bCompressed )
+		return ParseUpdate( buf, entries );
+
+	unsigned int msgUncompressedSize = buf.ReadLong();
+	unsigned int msgCompressedSize = buf.ReadLong();
+	unsigned int uncompressedSize = msgUncompressedSize;
+	/// XXX(JohnS): 11/08/2016 - The PAD_NUMBER() call below was overflowing on UINT32_MAX-3 values.  Enforcing
+	//              resource-usage limits at this level is a lost cause without a massive overhaul, but clamp these
+	//              to somewhat reasonable ranges to prevent overflows with less-audited code in the engine.
+	bool bSuccess = false;
+	if ( buf.TotalBytesAvailable() > 0 &&
+	     msgCompressedSize <= (unsigned int)buf.TotalBytesAvailable() &&
+	     msgCompressedSize < UINT_MAX/2 &&
+	     msgUncompressedSize < UINT_MAX/2 )
+	{
+		// allocate buffer for uncompressed data, align to 4 bytes boundary
+		char *uncompressedBuffer = new char[PAD_NUMBER( msgUncompressedSize, 4 )];
+		char *compressedBuffer = new char[PAD_NUMBER( msgCompressedSize, 4 )];
+
+		buf.ReadBits( compressedBuffer, msgCompressedSize * 8 );
+
+		// uncompress data
+		bSuccess = COM_BufferToBufferDecompress( uncompressedBuffer, &uncompressedSize, compressedBuffer, msgCompressedSize );
+		bSuccess &= ( uncompressedSize == msgUncompressedSize );
+
+		if ( bSuccess )
+		{
+			bf_read data( uncompressedBuffer, uncompressedSize );
+			bSuccess = ParseUpdate( data, entries );
+		}
+
+		delete[] uncompressedBuffer;
+		delete[] compressedBuffer;
+	}
+
+	return bSuccess;
 }
 
 void CNetworkStringTable::CopyStringTable(CNetworkStringTable * table)
@@ -1021,6 +1133,8 @@ void CNetworkStringTable::DataChanged( int stringNumber, CNetworkStringTableItem
 	
 #ifndef SHARED_NET_STRING_TABLES // but not if client & server share the same containers, we trigger that later
 
+	LogChange( stringNumber );
+
 	if ( m_changeFunc != NULL )
 	{
 		int userDataSize;
@@ -1492,18 +1606,22 @@ bool CNetworkStringTableContainer::ReadStringTables( bf_read& buf )
 		CNetworkStringTable *table = (CNetworkStringTable*)FindTable( tablename );
 		Assert( table );
 
-		// Now read the data for the table
-		if ( table && !table->ReadStringTable( buf ) )
+		// The rest of the buffer can't be parsed without the table
+		if ( !table )
 		{
-			Host_Error( "Error reading string table %s\n", tablename );
+			Warning( "Could not find table \"%s\"\n", tablename );
+			return false;
 		}
-		else
+
+		// Now read the data for the table
+		if ( !table->ReadStringTable( buf ) )
 		{
-			Warning( "Could not find table \"%s\"\n", tablename );
+			Warning( "Error reading string table %s\n", tablename );
+			return false;
 		}
 	}
 
-	return true;
+	return !buf.IsOverflowed();
 }
 
 //-----------------------------------------------------------------------------
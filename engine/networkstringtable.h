@@ -16,6 +16,7 @@
 #include <utldict.h>
 #include <utlbuffer.h>
 #include "tier1/bitbuf.h"
+#include "tier1/utlframememory.h"
 
 class SVC_CreateStringTable;
 class CBaseClient;
@@ -45,6 +46,8 @@ public:
 					CNetworkStringTable( TABLEID id, const char *tableName, int maxentries, int userdatafixedsize, int userdatanetworkbits, bool bIsFilenames );
 	virtual			~CNetworkStringTable( void );
 
+	static bool		IsValidSetup( int maxentries, int userdatafixedsize, int userdatanetworkbits );
+
 public:
 	// INetworkStringTable interface:
 
@@ -76,7 +79,8 @@ public:
 	
 #ifndef SHARED_NET_STRING_TABLES
 	int				WriteUpdate( CBaseClient *client, bf_write &buf, int tick_ack );
-	void			ParseUpdate( bf_read &buf, int entries );
+	bool			ParseUpdate( bf_read &buf, int entries );
+	bool			ParseCreate( bf_read &buf, int entries, bool bCompressed );
 
 	// HLTV change history & rollback
 	void			EnableRollback();
@@ -91,6 +95,9 @@ public:
 	bool			ReadStringTable( bf_read& buf );
 
 	bool			WriteBaselines( SVC_CreateStringTable &msg, char *msg_buffer, int msg_buffer_size );
+
+	// Fills entries with the ascending indices of items changed after tick_ack
+	void			GetChangedEntries( int tick_ack, CUtlFrameVector< int > &entries );
 #endif
 
 	void			TriggerCallbacks( int tick_ack  );
@@ -110,6 +117,11 @@ protected:
 	// Destroy string table
 	void			DeleteAllStrings( void );
 
+#ifndef SHARED_NET_STRING_TABLES
+	void			LogChange( int stringNumber );
+	void			ResetChangeLog( void );
+#endif
+
 	CNetworkStringTable( const CNetworkStringTable & ); // not implemented, not allowed
 
 	TABLEID					m_id;
@@ -139,6 +151,18 @@ protected:
 
 	INetworkStringDict		*m_pItems;
 	INetworkStringDict		*m_pItemsClientSide;	 // For m_bAllowClientSideAddString, these items are non-networked and are referenced by a negative string index!!!
+
+	// Append-only log of networked item changes in tick order. It holds every
+	// change after m_nChangeLogBaseTick, so a client that acked that tick or
+	// later is updated from the log instead of by walking all items.
+	struct ChangeLogEntry_t
+	{
+		int					tick;
+		int					index;
+	};
+
+	CUtlVector< ChangeLogEntry_t > m_ChangeLog;
+	int						m_nChangeLogBaseTick;
 };
 
 //-----------------------------------------------------------------------------
@@ -76,6 +76,7 @@ public:
 	CBaseServer		*m_pServer;	// the server who writes this entity
 
 	int				m_nFullProps;	// number of properties send as full update (Enter PVS)
+	int				m_nEnterPVS;	// number of entities send as full update (Enter PVS)
 	bool			m_bCullProps;	// filter props by clients in recipient lists
 	
 	/* Some profiling data
@@ -655,6 +656,8 @@ static inline void SV_WriteEnterPVS( CEntityWriteInfo &u )
 		Assert( 0 );
 	}
 
+	u.m_nEnterPVS++;
+
 	u.m_pBuf->WriteUBitLong( pClass->m_ClassID, u.m_pServer->serverclassbits );
 	
 	// Write some of the serial number's bits. 
@@ -868,6 +871,14 @@ Returns the size IN BITS of the message buffer created.
 */
 
 void CBaseServer::WriteDeltaEntities( CBaseClient *client, CClientFrame *to, CClientFrame *from, bf_write &pBuf )
+{
+	WriteDeltaEntities( client, to, from, pBuf, NULL );
+}
+
+// pEnterPVSCount, if set, returns the number of entities written as entering the PVS, which
+// are written relative to the clients baseline. Without them the update only depends on
+// the two frames and on which baseline the client uses.
+void CBaseServer::WriteDeltaEntities( CBaseClient *client, CClientFrame *to, CClientFrame *from, bf_write &pBuf, int *pEnterPVSCount )
 {
 	VPROF_BUDGET( "CBaseServer::WriteDeltaEntities", VPROF_BUDGETGROUP_OTHER_NETWORKING );
 	// Setup the CEntityWriteInfo structure.
@@ -877,6 +888,7 @@ void CBaseServer::WriteDeltaEntities( CBaseClient *client, CClientFrame *to, CCl
 	u.m_pToSnapshot = to->GetSnapshot();
 	u.m_pBaseline = client->m_pBaseline;
 	u.m_nFullProps = 0;
+	u.m_nEnterPVS = 0;
 	u.m_pServer = this;
 	u.m_nClientEntity = client->m_nEntityIndex;
 #ifndef _XBOX
@@ -1035,6 +1047,11 @@ void CBaseServer::WriteDeltaEntities( CBaseClient *client, CClientFrame *to, CCl
 	{
 		client->TraceNetworkData( pBuf, "Delta Finish" );
 	}
+
+	if ( pEnterPVSCount )
+	{
+		*pEnterPVSCount = u.m_nEnterPVS;
+	}
 }
 
 
@@ -57,6 +57,7 @@
 #include "cl_steamauth.h"
 #include "sv_steamauth.h"
 #include "sv_plugin.h"
+#include "sv_precache.h"
 #include "DownloadListGenerator.h"
 #include "sv_steamauth.h"
 #include "LocalNetworkBackdoor.h"
@@ -774,7 +775,11 @@ void SV_InitSendTables( ServerClass *pClasses )
 	SendTable *pTables[MAX_DATATABLES];
 	int nTables = SV_BuildSendTablesArray( pClasses, pTables, ARRAYSIZE( pTables ) );
 
-	SendTable_Init( pTables, nTables );
+	// the tables only fail to set up softly for demo_analyze, a game DLL with broken ones can't run
+	if ( !SendTable_Init( pTables, nTables ) )
+	{
+		Sys_Error( "SV_InitSendTables: failed to set up the SendTables, see the warnings above.\n" );
+	}
 }
 
 
@@ -1898,7 +1903,7 @@ void CGameServer::SendClientMessages ( bool bSendSnapshots )
 			// SV_ParallelSendSnapshot will not process HLTV or Replay clients as they
 			// must be run on the main thread due to un-threadsafe global state access.
 			// It will replace anything that it does process with a NULL pointer.
-			ParallelProcess( "SV_ParallelSendSnapshot", pReceivingClients, receivingClientCount, &SV_ParallelSendSnapshot );
+			ParallelFor( pReceivingClients, receivingClientCount, 1, &SV_ParallelSendSnapshot );
 		}
 		
 		for (int i = 0; i < receivingClientCount; ++i)
@@ -2168,6 +2173,8 @@ bool SV_ActivateServer()
 
 	// all setup is completed, any further precache statements are errors
 	sv.m_State = ss_active;
+
+	SV_PrecachePipeline_Finish();
 	
 	COM_TimestampedLog( "SV_CreateBaseline" );
 
@@ -2589,6 +2596,9 @@ bool CGameServer::SpawnServer( const char *szMapName, const char *szMapFile, con
 
 	COM_TimestampedLog( "modelloader->GetModelForName(%s) -- Finished", szMapFile );
 
+	// start reading what the level is going to precache, runs until the join below
+	SV_PrecachePipeline_Begin( szMapName );
+
 	if ( IsMultiplayer() && !IsX360() )
 	{
 #ifndef SWDS
@@ -2599,6 +2609,7 @@ bool CGameServer::SpawnServer( const char *szMapName, const char *szMapFile, con
 		if ( !MD5_MapFile( &worldmapMD5, szMapFile ) )
 		{
 			ConMsg( "Couldn't CRC server map: %s\n", szMapFile );
+			SV_PrecachePipeline_Abort();
 			m_State = ss_dead;
 			g_pFileSystem->EndMapAccess();
 			return false;
@@ -2716,6 +2727,9 @@ bool CGameServer::SpawnServer( const char *szMapName, const char *szMapFile, con
 		g_GameEventManager.FireEvent( event );
 	}
 
+	// the game dll spawns entities next, have the files in memory by then
+	SV_PrecachePipeline_Join();
+
 	COM_TimestampedLog( "SV_SpawnServer -- Finished" );
 
 	g_pFileSystem->EndMapAccess();
@@ -2887,6 +2901,9 @@ void SV_SendClientUpdates( bool bIsSimulating, bool bSendDuringPause )
 	// ask game.dll to add any debug graphics
 	SV_PreClientUpdate( bIsSimulating );
 
+	// send the game events fired since the last update, ahead of the snapshots
+	g_GameEventManager.FlushClientEvents();
+
 	// This causes network messages to be sent
 	sv.SendClientMessages( bIsSimulating || bForcedSend );
 
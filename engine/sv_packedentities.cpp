@@ -33,6 +33,7 @@
 #include "tier0/vcrmode.h"
 #include "vstdlib/jobthread.h"
 #include "enginethreads.h"
+#include "tier1/utlframememory.h"
 
 #ifdef SWDS
 IClientEntityList *entitylist = NULL;
@@ -411,7 +412,7 @@ void PackEntities_Normal(
 	Assert( snapshot->m_nValidEntities >= 0 && snapshot->m_nValidEntities <= MAX_EDICTS );
 	tmZoneFiltered( TELEMETRY_LEVEL0, 50, TMZF_NONE, "%s %d", __FUNCTION__, snapshot->m_nValidEntities );
 
-	CUtlVectorFixed< PackWork_t, MAX_EDICTS > workItems;
+	CUtlFrameVector< PackWork_t > workItems( snapshot->m_nValidEntities );
 
 	// check for all active entities, if they are seen by at least on client, if
 	// so, bit pack them 
@@ -455,7 +456,7 @@ void PackEntities_Normal(
 	// Process work
 	if ( sv_parallel_packentities.GetBool() )
 	{
-		ParallelProcess( "PackWork_t::Process", workItems.Base(), workItems.Count(), &PackWork_t::Process );
+		ParallelFor( workItems.Base(), workItems.Count(), 0, &PackWork_t::Process );
 	}
 	else
 	{
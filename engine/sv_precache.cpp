@@ -13,6 +13,8 @@
 #include "MapReslistGenerator.h"
 #include "DownloadListGenerator.h"
 #include "soundchars.h"
+#include "modelloader.h"
+#include "gamebspfile.h"
 #ifndef SWDS
 #include "vgui_baseui_interface.h"
 #endif
@@ -21,6 +23,8 @@
 #include "tier0/memdbgon.h"
 
 static ConVar sv_forcepreload( "sv_forcepreload", "0", FCVAR_ARCHIVE, "Force server side preloading.");
+static ConVar sv_precache_pipeline( "sv_precache_pipeline", "1", 0, "Read the files a level is going to precache on the i/o threads while the server spawns." );
+static ConVar sv_precache_pipeline_spew( "sv_precache_pipeline_spew", "0", 0, "Print per stage timing for the precache pipeline after every level load." );
 
 //-----------------------------------------------------------------------------
 // Purpose: 
@@ -653,3 +657,340 @@ CON_COMMAND( sv_precacheinfo, "Show precache info." )
 	sv.DumpPrecacheStats( sv.GetSoundPrecacheTable() );
 	sv.DumpPrecacheStats( sv.GetModelPrecacheTable() );
 }
+
+
+//-----------------------------------------------------------------------------
+// Map load precache pipeline
+//-----------------------------------------------------------------------------
+class CPrecachePipeline
+{
+public:
+	CPrecachePipeline();
+	~CPrecachePipeline();
+
+	void Begin( const char *pMapName );
+	void Join();
+	void Finish();
+	void Abort();
+
+	void PrintReport();
+
+private:
+	void AddModel( const char *pModelName );
+	void AddFile( const char *pFileName );
+	void GatherEntityLump();
+	void GatherStaticProps();
+	void GatherLastLoad();
+	void RememberPrecacheTables();
+
+	FileCacheHandle_t	m_hFileCache;
+	CUtlSymbolTable		m_Files;
+	CUtlStringList		m_FileList;
+
+	// what each map precached the last time it was loaded, for the next load
+	CUtlDict< CUtlStringList *, int > m_LastLoad;
+
+	char				m_szMapName[MAX_QPATH];
+
+	// stage timing of the most recent load
+	double				m_flBeginTime;
+	double				m_flJoinStartTime;
+	double				m_flJoinEndTime;
+	float				m_flGatherTime;
+	float				m_flSubmitTime;
+	float				m_flJoinWaitTime;
+	float				m_flSpawnServerTime;
+	float				m_flEntitySpawnTime;
+	int					m_nFilesFromMap;
+	int					m_nFilesFromLastLoad;
+	bool				m_bHaveReport;
+};
+
+static CPrecachePipeline s_PrecachePipeline;
+
+CPrecachePipeline::CPrecachePipeline() : m_Files( 0, 256, true )
+{
+	m_hFileCache = NULL;
+	m_szMapName[0] = 0;
+	m_bHaveReport = false;
+}
+
+CPrecachePipeline::~CPrecachePipeline()
+{
+	FOR_EACH_DICT_FAST( m_LastLoad, i )
+	{
+		delete m_LastLoad[i];
+	}
+}
+
+void CPrecachePipeline::AddFile( const char *pFileName )
+{
+	// The filesystem looks up memory files by the fixed up name
+	char szFixedName[MAX_PATH];
+	V_strncpy( szFixedName, pFileName, sizeof( szFixedName ) );
+	V_FixSlashes( szFixedName );
+	V_strlower( szFixedName );
+
+	if ( m_Files.HasElement( szFixedName ) )
+		return;
+
+	m_Files.AddString( szFixedName );
+	m_FileList.CopyAndAddToTail( szFixedName );
+}
+
+void CPrecachePipeline::AddModel( const char *pModelName )
+{
+	// brush models live in the bsp and sprites aren't worth a read
+	const char *pExtension = V_GetFileExtension( pModelName );
+	if ( pModelName[0] == '*' || !pExtension || V_stricmp( pExtension, "mdl" ) )
+		return;
+
+	char szBaseName[MAX_PATH];
+	V_StripExtension( pModelName, szBaseName, sizeof( szBaseName ) );
+
+	// Everything the server side of the mdlcache is going to ask for. Parts a
+	// model doesn't have get cached as missing, which saves the failing opens too.
+	AddFile( CFmtStr( "%s.mdl", szBaseName ) );
+	AddFile( CFmtStr( "%s.phy", szBaseName ) );
+#ifndef SWDS
+	AddFile( CFmtStr( "%s.vvd", szBaseName ) );
+#endif
+}
+
+void CPrecachePipeline::GatherEntityLump()
+{
+	const char *pEntities = CM_EntityString();
+	while ( pEntities && ( pEntities = COM_Parse( pEntities ) ) != NULL )
+	{
+		// Keys and values alternate, but models can hide behind any key
+		// ("model", "gibmodel", ...) so just look at every value
+		if ( V_strnicmp( com_token, "models", 6 ) == 0 )
+		{
+			AddModel( com_token );
+		}
+	}
+}
+
+void CPrecachePipeline::GatherStaticProps()
+{
+	int nSize = Mod_GameLumpSize( GAMELUMP_STATIC_PROPS );
+	if ( !nSize )
+		return;
+
+	CUtlBuffer buf( 0, nSize );
+	if ( !Mod_LoadGameLump( GAMELUMP_STATIC_PROPS, buf.PeekPut(), nSize ) )
+		return;
+	buf.SeekPut( CUtlBuffer::SEEK_HEAD, nSize );
+
+	// The model dictionary leads the lump in every version
+	int nDictCount = buf.GetInt();
+	for ( int i = 0; i < nDictCount && buf.IsValid(); i++ )
+	{
+		StaticPropDictLump_t lump;
+		buf.Get( &lump, sizeof( StaticPropDictLump_t ) );
+		if ( !buf.IsValid() )
+			break;
+
+		lump.m_Name[ STATIC_PROP_NAME_LENGTH - 1 ] = 0;
+		AddModel( lump.m_Name );
+	}
+}
+
+void CPrecachePipeline::GatherLastLoad()
+{
+	int iLastLoad = m_LastLoad.Find( m_szMapName );
+	if ( iLastLoad == m_LastLoad.InvalidIndex() )
+		return;
+
+	const CUtlStringList &list = *m_LastLoad[iLastLoad];
+	FOR_EACH_VEC( list, i )
+	{
+		if ( V_strnicmp( list[i], "sound", 5 ) == 0 )
+		{
+			AddFile( list[i] );
+		}
+		else
+		{
+			AddModel( list[i] );
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Gathers and submits. The game dll hasn't run yet for this level, so
+// everything here comes from the bsp or from the last time we loaded it.
+//-----------------------------------------------------------------------------
+void CPrecachePipeline::Begin( const char *pMapName )
+{
+	Abort();
+
+	if ( !sv_precache_pipeline.GetBool() || CommandLine()->FindParm( "-nopreload" ) )
+		return;
+
+	COM_TimestampedLog( "SV_PrecachePipeline_Begin" );
+
+	m_flBeginTime = Plat_FloatTime();
+	V_strncpy( m_szMapName, pMapName, sizeof( m_szMapName ) );
+
+	GatherEntityLump();
+	GatherStaticProps();
+	m_nFilesFromMap = m_FileList.Count();
+	GatherLastLoad();
+	m_nFilesFromLastLoad = m_FileList.Count() - m_nFilesFromMap;
+
+	double flGatherEnd = Plat_FloatTime();
+	m_flGatherTime = flGatherEnd - m_flBeginTime;
+
+	if ( m_FileList.Count() )
+	{
+		// Reads fan out over the filesystem's i/o thread pool; each file lands in
+		// memory registered under its name, where OpenForRead picks it up
+		m_hFileCache = g_pFileSystem->CreateFileCache();
+		g_pFileSystem->AddFilesToFileCache( m_hFileCache, (const char **)m_FileList.Base(), m_FileList.Count(), "GAME" );
+	}
+
+	m_flSubmitTime = Plat_FloatTime() - flGatherEnd;
+	m_flJoinStartTime = m_flJoinEndTime = 0.0;
+}
+
+void CPrecachePipeline::Join()
+{
+	if ( !m_hFileCache || m_flJoinStartTime != 0.0 )
+		return;
+
+	COM_TimestampedLog( "SV_PrecachePipeline_Join" );
+
+	m_flJoinStartTime = Plat_FloatTime();
+	while ( !g_pFileSystem->IsFileCacheLoaded( m_hFileCache ) )
+	{
+		ThreadSleep( 1 );
+	}
+	m_flJoinEndTime = Plat_FloatTime();
+}
+
+//-----------------------------------------------------------------------------
+// Remembers this level's precache tables for the next time it loads
+//-----------------------------------------------------------------------------
+void CPrecachePipeline::RememberPrecacheTables()
+{
+	CUtlStringList *pList = new CUtlStringList;
+
+	INetworkStringTable *pModels = sv.GetModelPrecacheTable();
+	for ( int i = 1; pModels && i < pModels->GetNumStrings(); i++ )
+	{
+		const char *pName = pModels->GetString( i );
+		if ( pName && pName[0] != '*' )
+		{
+			pList->CopyAndAddToTail( pName );
+		}
+	}
+
+#ifndef SWDS
+	// Only the local client reads sounds, and streamed ones never load whole
+	INetworkStringTable *pSounds = sv.GetSoundPrecacheTable();
+	for ( int i = 1; !sv.IsDedicated() && pSounds && i < pSounds->GetNumStrings(); i++ )
+	{
+		const char *pName = pSounds->GetString( i );
+		if ( pName && pName[0] && !TestSoundChar( pName, CHAR_STREAM ) && !TestSoundChar( pName, CHAR_SENTENCE ) )
+		{
+			pList->CopyAndAddToTail( CFmtStr( "sound/%s", PSkipSoundChars( pName ) ) );
+		}
+	}
+#endif
+
+	int iLastLoad = m_LastLoad.Find( m_szMapName );
+	if ( iLastLoad != m_LastLoad.InvalidIndex() )
+	{
+		delete m_LastLoad[iLastLoad];
+		m_LastLoad[iLastLoad] = pList;
+	}
+	else
+	{
+		m_LastLoad.Insert( m_szMapName, pList );
+	}
+}
+
+void CPrecachePipeline::Finish()
+{
+	if ( !m_szMapName[0] )
+		return;
+
+	// The game dll precached whatever it wanted in LevelInit/ServerActivate,
+	// the parsed data now lives in the mdlcache
+	double flEnd = Plat_FloatTime();
+	if ( m_flJoinEndTime != 0.0 )
+	{
+		m_flSpawnServerTime = m_flJoinStartTime - m_flBeginTime - m_flGatherTime - m_flSubmitTime;
+		m_flJoinWaitTime = m_flJoinEndTime - m_flJoinStartTime;
+		m_flEntitySpawnTime = flEnd - m_flJoinEndTime;
+	}
+	else
+	{
+		m_flSpawnServerTime = m_flJoinWaitTime = 0.0f;
+		m_flEntitySpawnTime = flEnd - m_flBeginTime - m_flGatherTime - m_flSubmitTime;
+	}
+	m_bHaveReport = true;
+
+	RememberPrecacheTables();
+	Abort();
+
+	COM_TimestampedLog( "SV_PrecachePipeline_Finish" );
+
+	if ( sv_precache_pipeline_spew.GetBool() )
+	{
+		PrintReport();
+	}
+}
+
+void CPrecachePipeline::Abort()
+{
+	if ( m_hFileCache )
+	{
+		g_pFileSystem->DestroyFileCache( m_hFileCache );
+		m_hFileCache = NULL;
+	}
+	m_Files.RemoveAll();
+	m_FileList.PurgeAndDeleteElementsArray();
+	m_szMapName[0] = 0;
+}
+
+void CPrecachePipeline::PrintReport()
+{
+	if ( !m_bHaveReport )
+	{
+		ConMsg( "No level has been loaded through the precache pipeline yet\n" );
+		return;
+	}
+
+	ConMsg( "Precache pipeline, %d files (%d from the bsp, %d from the last load):\n", m_nFilesFromMap + m_nFilesFromLastLoad, m_nFilesFromMap, m_nFilesFromLastLoad );
+	ConMsg( "  gather          %8.2f ms\n", m_flGatherTime * 1000.0f );
+	ConMsg( "  submit          %8.2f ms\n", m_flSubmitTime * 1000.0f );
+	ConMsg( "  spawn server    %8.2f ms  (i/o in flight)\n", m_flSpawnServerTime * 1000.0f );
+	ConMsg( "  join            %8.2f ms  (waiting on i/o)\n", m_flJoinWaitTime * 1000.0f );
+	ConMsg( "  entity spawn    %8.2f ms  (LevelInit + ServerActivate)\n", m_flEntitySpawnTime * 1000.0f );
+}
+
+void SV_PrecachePipeline_Begin( const char *pMapName )
+{
+	s_PrecachePipeline.Begin( pMapName );
+}
+
+void SV_PrecachePipeline_Join()
+{
+	s_PrecachePipeline.Join();
+}
+
+void SV_PrecachePipeline_Finish()
+{
+	s_PrecachePipeline.Finish();
+}
+
+void SV_PrecachePipeline_Abort()
+{
+	s_PrecachePipeline.Abort();
+}
+
+CON_COMMAND( sv_precache_pipeline_report, "Show per stage timing of the last level load's precache pipeline." )
+{
+	s_PrecachePipeline.PrintReport();
+}
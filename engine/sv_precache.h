@@ -12,7 +12,19 @@
 #endif
 
 
-
+//-----------------------------------------------------------------------------
+// Map load precache pipeline. Begin gathers the files the level is expected to
+// precache (models named by the entity lump and static prop dictionary, plus
+// whatever the last load of the same map precached) and hands them to the
+// filesystem's i/o threads while the rest of the server spawns. Join blocks
+// until they are in memory, right before the game dll spawns entities, so the
+// precache calls it makes are served from memory instead of serial disk reads.
+// Finish releases the preloaded files once the server has activated.
+//-----------------------------------------------------------------------------
+void SV_PrecachePipeline_Begin( const char *pMapName );
+void SV_PrecachePipeline_Join();
+void SV_PrecachePipeline_Finish();
+void SV_PrecachePipeline_Abort();
 
 
 #endif // SV_PRECACHE_H
@@ -693,6 +693,16 @@ int CFileSystem_Stdio::FS_stat( const char *pathT, struct _stat *buf, bool *pbLo
 
 	CBaseFileSystem::FixUpPath ( pathT, path, sizeof( path ) );
 
+#if defined(LINUX)
+	// Most misses are for files that aren't in this search path in any case,
+	// answer those from the directory index without touching the disk
+	if ( fileMissingCaseInsensitive( path ) )
+	{
+		errno = ENOENT;
+		return -1;
+	}
+#endif
+
 	int rt = _stat( path, buf );
 
 	// Workaround bug wherein stat() randomly fails on Windows XP.  See comment on function.
@@ -723,6 +733,13 @@ int CFileSystem_Stdio::FS_stat( const char *pathT, struct _stat *buf, bool *pbLo
 	return rt;
 }
 
+#if defined(LINUX)
+CON_COMMAND( fs_caseindex_stats, "Show stats for the directory index behind case-insensitive file lookups" )
+{
+	dumpCaseInsensitiveIndexStats();
+}
+#endif
+
 //-----------------------------------------------------------------------------
 // Purpose: low-level filesystem wrapper
 //-----------------------------------------------------------------------------
@@ -856,6 +873,13 @@ CStdioFile *CStdioFile::FS_fopen( const char *filenameT, const char *options, in
 	if ( p )
 		*p = '\0';
 
+#if defined(LINUX)
+	if ( !strchr( options, 'w' ) && !strchr( options, 'a' ) && !strchr( options, '+' ) && fileMissingCaseInsensitive( filename ) )
+	{
+		errno = ENOENT;
+		return NULL;
+	}
+#endif
 
 	pFile = fopen(filename, options);
 	if (pFile && size)
@@ -7,7 +7,15 @@
 
 #include "linux_support.h"
 #include "tier0/threadtools.h" // For ThreadInMainThread()
+#include "tier0/icommandline.h"
 #include "tier1/strtools.h"
+#include "tier1/utlhashtable.h"
+#include "tier1/utlstring.h"
+
+#ifdef LINUX
+#include <sys/inotify.h>
+#include <errno.h>
+#endif
 
 char selectBuf[PATH_MAX];
 
@@ -199,6 +207,303 @@ bool FindClose(HANDLE handle)
 
 
 
+#ifdef LINUX
+//-----------------------------------------------------------------------------
+// Per-directory index of entry names, case folded, for the case-insensitive
+// fallbacks. Directories are indexed the first time a lookup misses in them
+// and dropped again as soon as inotify reports a change, so a stale index is
+// never consulted.
+//-----------------------------------------------------------------------------
+struct UTLConstStringStringEqualFunctor
+{
+	bool operator()( const CUtlConstString &a, const char *b ) const { return V_strcmp( a.Get(), b ) == 0; }
+};
+
+struct CaseIndexDir_t
+{
+	// case folded name -> best on-disk name, picked like findFileInDirCaseInsensitive always has
+	CUtlHashtable< CUtlConstString, CUtlConstString, CaselessStringHashFunctor, UTLConstStringCaselessStringEqualFunctor<char> > m_Entries;
+	CUtlConstString m_Path;
+	int m_nWatch;
+};
+
+class CCaseInsensitiveIndex
+{
+public:
+	enum ELookup
+	{
+		LOOKUP_NOT_INDEXED,		// couldn't index the directory, caller has to scan it
+		LOOKUP_MISSING,			// no entry matches in any case
+		LOOKUP_FOUND,
+	};
+
+	CCaseInsensitiveIndex();
+	~CCaseInsensitiveIndex();
+
+	// Looks up pName in pDir. Only builds the directory index if bBuild is set,
+	// otherwise answers LOOKUP_NOT_INDEXED for directories we haven't seen miss yet.
+	ELookup Lookup( const char *pDir, const char *pName, bool bBuild, char *pOnDiskName, size_t nOnDiskNameSize );
+
+	void DumpStats();
+
+private:
+	bool Init();
+	void DrainEvents();
+	CaseIndexDir_t *BuildDir( const char *pDir );
+	void RemoveDir( CaseIndexDir_t *pDir );
+
+	CThreadFastMutex m_Mutex;
+	int m_nNotifyFD;
+	bool m_bInitialized;
+	bool m_bEnabled;
+
+	CUtlHashtable< CUtlConstString, CaseIndexDir_t *, StringHashFunctor, UTLConstStringStringEqualFunctor > m_Dirs;
+	CUtlHashtable< int, CaseIndexDir_t * > m_Watches;
+
+	// stats
+	uint m_nLookups;
+	uint m_nMissing;
+	uint m_nBuilds;
+	uint m_nInvalidations;
+	uint m_nWatchFailures;
+};
+
+static CCaseInsensitiveIndex s_CaseInsensitiveIndex;
+
+CCaseInsensitiveIndex::CCaseInsensitiveIndex()
+{
+	m_nNotifyFD = -1;
+	m_bInitialized = false;
+	m_bEnabled = false;
+	m_nLookups = 0;
+	m_nMissing = 0;
+	m_nBuilds = 0;
+	m_nInvalidations = 0;
+	m_nWatchFailures = 0;
+}
+
+CCaseInsensitiveIndex::~CCaseInsensitiveIndex()
+{
+	for ( UtlHashHandle_t h = m_Dirs.FirstHandle(); h != m_Dirs.InvalidHandle(); h = m_Dirs.NextHandle( h ) )
+	{
+		delete m_Dirs[h];
+	}
+	m_Dirs.Purge();
+	m_Watches.Purge();
+
+	if ( m_nNotifyFD >= 0 )
+	{
+		close( m_nNotifyFD );
+	}
+}
+
+// Lazily, so the command line is up by the time we look at it
+bool CCaseInsensitiveIndex::Init()
+{
+	if ( !m_bInitialized )
+	{
+		m_bInitialized = true;
+		if ( !CommandLine()->FindParm( "-fs_nocaseindex" ) )
+		{
+			m_nNotifyFD = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+			m_bEnabled = ( m_nNotifyFD >= 0 );
+		}
+	}
+	return m_bEnabled;
+}
+
+void CCaseInsensitiveIndex::RemoveDir( CaseIndexDir_t *pDir )
+{
+	inotify_rm_watch( m_nNotifyFD, pDir->m_nWatch );
+	m_Watches.Remove( pDir->m_nWatch );
+	m_Dirs.Remove( pDir->m_Path.Get() );
+	delete pDir;
+	m_nInvalidations++;
+}
+
+// Throw away every directory that changed since the last lookup. The kernel
+// queues events as part of the syscall that made the change, so anything done
+// before this call (by us or anyone else) is seen here.
+void CCaseInsensitiveIndex::DrainEvents()
+{
+	char buf[ 4096 ] __attribute__ (( aligned( __alignof__( struct inotify_event ) ) ));
+	for ( ;; )
+	{
+		ssize_t nRead = read( m_nNotifyFD, buf, sizeof( buf ) );
+		if ( nRead <= 0 )
+			break;
+
+		for ( char *p = buf; p < buf + nRead; )
+		{
+			const struct inotify_event *pEvent = (const struct inotify_event *)p;
+			p += sizeof( struct inotify_event ) + pEvent->len;
+
+			if ( pEvent->mask & IN_Q_OVERFLOW )
+			{
+				// Lost track, start over
+				while ( m_Dirs.Count() )
+				{
+					RemoveDir( m_Dirs[ m_Dirs.FirstHandle() ] );
+				}
+				continue;
+			}
+
+			CaseIndexDir_t **ppDir = m_Watches.GetPtr( pEvent->wd );
+			if ( ppDir )
+			{
+				RemoveDir( *ppDir );
+			}
+		}
+	}
+}
+
+CaseIndexDir_t *CCaseInsensitiveIndex::BuildDir( const char *pDir )
+{
+	// Watch before reading so changes made while we scan still invalidate us
+	int nWatch = inotify_add_watch( m_nNotifyFD, pDir, IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR );
+	if ( nWatch < 0 )
+	{
+		// Out of watches (fs.inotify.max_user_watches) or not a directory
+		m_nWatchFailures++;
+		return NULL;
+	}
+
+	DIR *pDirHandle = opendir( pDir );
+	if ( !pDirHandle )
+	{
+		inotify_rm_watch( m_nNotifyFD, nWatch );
+		return NULL;
+	}
+
+	// inotify hands back the same descriptor for the same inode, which could
+	// already be indexed under another spelling of its path
+	CaseIndexDir_t **ppExisting = m_Watches.GetPtr( nWatch );
+	if ( ppExisting )
+	{
+		RemoveDir( *ppExisting );
+		nWatch = inotify_add_watch( m_nNotifyFD, pDir, IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR );
+		if ( nWatch < 0 )
+		{
+			closedir( pDirHandle );
+			m_nWatchFailures++;
+			return NULL;
+		}
+	}
+
+	CaseIndexDir_t *pIndex = new CaseIndexDir_t;
+	pIndex->m_Path = pDir;
+	pIndex->m_nWatch = nWatch;
+
+	for ( dirent *pEntry = NULL; ( pEntry = readdir( pDirHandle ) ); /**/ )
+	{
+		bool bInserted = false;
+		UtlHashHandle_t h = pIndex->m_Entries.Insert( pEntry->d_name, CUtlConstString( pEntry->d_name ), &bInserted );
+		// test beats tesT which beats tEst, same as the scan
+		if ( !bInserted && V_strcmp( pIndex->m_Entries[h].Get(), pEntry->d_name ) < 0 )
+		{
+			pIndex->m_Entries[h] = pEntry->d_name;
+		}
+	}
+	closedir( pDirHandle );
+
+	m_Dirs.Insert( pIndex->m_Path.Get(), pIndex );
+	m_Watches.Insert( nWatch, pIndex );
+	m_nBuilds++;
+	return pIndex;
+}
+
+CCaseInsensitiveIndex::ELookup CCaseInsensitiveIndex::Lookup( const char *pDir, const char *pName, bool bBuild, char *pOnDiskName, size_t nOnDiskNameSize )
+{
+	AUTO_LOCK( m_Mutex );
+
+	if ( !Init() )
+		return LOOKUP_NOT_INDEXED;
+
+	DrainEvents();
+
+	CaseIndexDir_t **ppDir = m_Dirs.GetPtr( pDir );
+	CaseIndexDir_t *pIndex = ppDir ? *ppDir : NULL;
+	if ( !pIndex )
+	{
+		if ( !bBuild || !( pIndex = BuildDir( pDir ) ) )
+			return LOOKUP_NOT_INDEXED;
+	}
+
+	m_nLookups++;
+	const CUtlConstString *pOnDisk = pIndex->m_Entries.GetPtr( pName );
+	if ( !pOnDisk )
+	{
+		m_nMissing++;
+		return LOOKUP_MISSING;
+	}
+
+	if ( pOnDiskName )
+	{
+		V_strncpy( pOnDiskName, pOnDisk->Get(), nOnDiskNameSize );
+	}
+	return LOOKUP_FOUND;
+}
+
+void CCaseInsensitiveIndex::DumpStats()
+{
+	AUTO_LOCK( m_Mutex );
+
+	if ( !m_bEnabled )
+	{
+		Msg( "Case-insensitive directory index is disabled.\n" );
+		return;
+	}
+
+	uint nEntries = 0;
+	for ( UtlHashHandle_t h = m_Dirs.FirstHandle(); h != m_Dirs.InvalidHandle(); h = m_Dirs.NextHandle( h ) )
+	{
+		nEntries += m_Dirs[h]->m_Entries.Count();
+	}
+
+	Msg( "Case-insensitive directory index: %d directories, %u entries\n", m_Dirs.Count(), nEntries );
+	Msg( "  %u lookups, %u answered missing, %u builds, %u invalidations, %u watch failures\n",
+		m_nLookups, m_nMissing, m_nBuilds, m_nInvalidations, m_nWatchFailures );
+}
+#endif // LINUX
+
+// Splits a full path into its directory (no trailing separator) and file part
+static const char *SplitDirAndFile( const char *file, char *dirName, size_t dirSize )
+{
+	const char *dirSep = strrchr( file, '/' );
+	if ( !dirSep )
+	{
+		dirSep = strrchr( file, '\\' );
+		if ( !dirSep )
+		{
+			return NULL;
+		}
+	}
+
+	V_strncpy( dirName, file, MIN( dirSize, (size_t)( dirSep - file ) + 1 ) );
+	return dirSep + 1;
+}
+
+bool fileMissingCaseInsensitive( const char *file )
+{
+#ifdef LINUX
+	char dirName[ MAX_PATH ];
+	const char *filePart = SplitDirAndFile( file, dirName, sizeof( dirName ) );
+	if ( !filePart || !filePart[0] )
+		return false;
+
+	return s_CaseInsensitiveIndex.Lookup( dirName, filePart, false, NULL, 0 ) == CCaseInsensitiveIndex::LOOKUP_MISSING;
+#else
+	return false;
+#endif
+}
+
+void dumpCaseInsensitiveIndexStats()
+{
+#ifdef LINUX
+	s_CaseInsensitiveIndex.DumpStats();
+#endif
+}
+
 // Pass this function a full path and it will look for files in the specified
 // directory that match the file name but potentially with different case.
 // The directory name itself is not treated specially.
@@ -209,49 +514,49 @@ bool findFileInDirCaseInsensitive( const char *file, char* output, size_t bufSiz
 	output[0] = 0;
 
 	// Find where the file part starts.
-	const char *dirSep = strrchr(file,'/');
-	if( !dirSep )
+	char dirName[ MAX_PATH ];
+	const char *filePart = SplitDirAndFile( file, dirName, sizeof( dirName ) );
+	if ( !filePart )
 	{
-		dirSep=strrchr(file,'\\');
-		if( !dirSep ) 
-		{
-			return false;
-		}
-	}
-
-	// Allocate space for the directory portion.
-	size_t dirSize = ( dirSep - file ) + 1;
-	char *dirName = static_cast<char *>( alloca( dirSize ) ); 
-
-	V_strncpy( dirName , file, dirSize );
-
-	DIR* pDir = opendir( dirName );
-	if ( !pDir )
 		return false;
+	}
 
-	const char* filePart = dirSep + 1;
 	// The best matching file name will be placed in this array.
 	char outputFileName[ MAX_PATH ];
 	bool foundMatch = false;
 
-	// Scan through the directory.
-	for ( dirent* pEntry = NULL; ( pEntry = readdir( pDir ) ); /**/ )
+#ifdef LINUX
+	CCaseInsensitiveIndex::ELookup eLookup = s_CaseInsensitiveIndex.Lookup( dirName, filePart, true, outputFileName, sizeof( outputFileName ) );
+	if ( eLookup != CCaseInsensitiveIndex::LOOKUP_NOT_INDEXED )
 	{
-		if ( strcasecmp( pEntry->d_name, filePart ) == 0 )
+		foundMatch = ( eLookup == CCaseInsensitiveIndex::LOOKUP_FOUND );
+	}
+	else
+#endif
+	{
+		DIR* pDir = opendir( dirName );
+		if ( !pDir )
+			return false;
+
+		// Scan through the directory.
+		for ( dirent* pEntry = NULL; ( pEntry = readdir( pDir ) ); /**/ )
 		{
-			// If we don't have an existing candidate or if this name is
-			// a better candidate then copy it in. A 'better' candidate
-			// means that test beats tesT which beats tEst -- more lowercase
-			// letters earlier equals victory.
-			if ( !foundMatch || strcmp( outputFileName, pEntry->d_name ) < 0 )
+			if ( strcasecmp( pEntry->d_name, filePart ) == 0 )
 			{
-				foundMatch = true;
-				V_strcpy_safe( outputFileName, pEntry->d_name );
+				// If we don't have an existing candidate or if this name is
+				// a better candidate then copy it in. A 'better' candidate
+				// means that test beats tesT which beats tEst -- more lowercase
+				// letters earlier equals victory.
+				if ( !foundMatch || strcmp( outputFileName, pEntry->d_name ) < 0 )
+				{
+					foundMatch = true;
+					V_strcpy_safe( outputFileName, pEntry->d_name );
+				}
 			}
 		}
-	}
 
-	closedir( pDir );
+		closedir( pDir );
+	}
 
 	// If we didn't find any matching names then lowercase the passed in
 	// file name and use that.
@@ -44,8 +44,6 @@ bool FindClose(HANDLE handle);
 // filename will be returned in the user's buffer and 'true' will be returned.
 // If the file does not exist then the filename will be lowercased and 'false'
 // will be returned.
-// This function uses a static buffer for internal purposes and is therefore
-// not thread safe, so it must only be called from the main thread.
 bool findFileInDirCaseInsensitive( const char *file, OUT_Z_BYTECAP(bufSize) char* output, size_t bufSize );
 // The _safe version of this function should be preferred since it always infers
 // the directory size correctly.
@@ -55,4 +53,13 @@ bool findFileInDirCaseInsensitive_safe( const char *file, OUT_Z_ARRAY char (&out
 	return findFileInDirCaseInsensitive( file, output, bufSize );
 }
 
+// On Linux the scans above are served from a per-directory index of the
+// entries' lowercased names, built the first time a directory misses and
+// thrown away when inotify reports a change in it. fileMissingCaseInsensitive
+// returns true only when the file's directory is indexed and has no entry
+// matching the name in any case, so callers can skip the stat/open entirely.
+// Thread safe. Pass -fs_nocaseindex to go back to scanning every time.
+bool fileMissingCaseInsensitive( const char *file );
+void dumpCaseInsensitiveIndexStats();
+
 #endif // LINUX_SUPPORT_H
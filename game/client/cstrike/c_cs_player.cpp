@@ -2143,12 +2143,25 @@ void C_CSPlayer::FireGameEvent( IGameEvent* event )
 			{
 				const auto nAttackerTickBase = event->GetInt( "tickbase" );
 				const auto pStudioHdr		 = player->GetModelPtr();
-				const auto numhitboxes		 = event->GetInt( "num_hitboxes" );
 				const auto parent_index		 = event->GetInt( "parent_index", -1 );
 
 				QAngle angles[MAXSTUDIOBONES];
 				Vector positions[MAXSTUDIOBONES];
 
+				int hitboxIndexes[MAXSTUDIOBONES];
+				Vector hitboxPositions[MAXSTUDIOBONES];
+				QAngle hitboxAngles[MAXSTUDIOBONES];
+
+				// the counts come from the server or a demo, only use what every array has
+				auto numhitboxes = MIN( event->GetIntArray( "hitbox_indexes", hitboxIndexes, MAXSTUDIOBONES ), MAXSTUDIOBONES );
+				const auto numhitboxpositions = event->GetFloatArray( "hitbox_positions", hitboxPositions[0].Base(), MAXSTUDIOBONES * 3 );
+				const auto numhitboxangles = event->GetFloatArray( "hitbox_angles", hitboxAngles[0].Base(), MAXSTUDIOBONES * 3 );
+
+				if ( numhitboxpositions < numhitboxes * 3 || numhitboxangles < numhitboxes * 3 )
+				{
+					numhitboxes = 0;
+				}
+
 				player->m_bIsInsideLagCompensationContext = true;
 				player->PushEnableAbsRecomputations( true );
 
@@ -2156,23 +2169,13 @@ void C_CSPlayer::FireGameEvent( IGameEvent* event )
 
 				for ( int i = 0; i < numhitboxes; i++ )
 				{
-					char buffer[256];
-					V_sprintf_safe( buffer, "hitbox_index_%i", i );
-					const auto hitboxIndex = event->GetInt( buffer );
-
-					V_sprintf_safe( buffer, "hitbox_position_x_%i", i );
-					positions[hitboxIndex].x = event->GetFloat( buffer );
-					V_sprintf_safe( buffer, "hitbox_position_y_%i", i );
-					positions[hitboxIndex].y = event->GetFloat( buffer );
-					V_sprintf_safe( buffer, "hitbox_position_z_%i", i );
-					positions[hitboxIndex].z = event->GetFloat( buffer );
-
-					V_sprintf_safe( buffer, "hitbox_angle_x_%i", i );
-					angles[hitboxIndex].x = event->GetFloat( buffer );
-					V_sprintf_safe( buffer, "hitbox_angle_y_%i", i );
-					angles[hitboxIndex].y = event->GetFloat( buffer );
-					V_sprintf_safe( buffer, "hitbox_angle_z_%i", i );
-					angles[hitboxIndex].z = event->GetFloat( buffer );
+					const auto hitboxIndex = hitboxIndexes[i];
+
+					if ( hitboxIndex < 0 || hitboxIndex >= MAXSTUDIOBONES )
+						continue;
+
+					positions[hitboxIndex] = hitboxPositions[i];
+					angles[hitboxIndex]	   = hitboxAngles[i];
 				}
 
 				player->DrawServerHitboxes( positions, angles, flDuration, true );
@@ -2212,50 +2215,36 @@ void C_CSPlayer::FireGameEvent( IGameEvent* event )
 													event->GetFloat( "angle_y" ),
 													event->GetFloat( "angle_z" ) );
 
-				const auto numposeparams = event->GetInt( "num_poseparams" );
+				const auto numposeparams = event->GetFloatArray( "pose_params", player->m_flPoseParameter, MAXSTUDIOPOSEPARAM );
 				AssertFatal( numposeparams == pStudioHdr->GetNumPoseParameters() );
 
-				for ( int i = 0; i < numposeparams; i++ )
-				{
-					char buffer[256];
-					V_sprintf_safe( buffer, "pose_param_%i", i );
-
-					player->m_flPoseParameter[i] = event->GetFloat( buffer );
-				}
-
-				const auto numbonecontrollers = event->GetInt( "num_bonecontrollers" );
+				const auto numbonecontrollers = event->GetFloatArray( "bone_controllers", player->m_flEncodedController, MAXSTUDIOBONECTRLS );
 				AssertFatal( numbonecontrollers == pStudioHdr->GetNumBoneControllers() );
 
-				for ( int i = 0; i < numbonecontrollers; i++ )
-				{
-					char buffer[256];
-					V_sprintf_safe( buffer, "bone_controller_%i", i );
+				float overlayCycles[C_BaseAnimatingOverlay::MAX_OVERLAYS];
+				int overlaySequences[C_BaseAnimatingOverlay::MAX_OVERLAYS];
+				float overlayWeights[C_BaseAnimatingOverlay::MAX_OVERLAYS];
+				int overlayOrders[C_BaseAnimatingOverlay::MAX_OVERLAYS];
+				int overlayFlags[C_BaseAnimatingOverlay::MAX_OVERLAYS];
 
-					player->m_flEncodedController[i] = event->GetFloat( buffer );
-				}
-
-				auto numanimoverlays = event->GetInt( "num_anim_overlays" );
+				auto numanimoverlays = event->GetFloatArray( "anim_overlay_cycles", overlayCycles, C_BaseAnimatingOverlay::MAX_OVERLAYS );
 				AssertFatal( numanimoverlays == player->GetNumAnimOverlays() );
 
+				numanimoverlays = MIN( numanimoverlays, event->GetIntArray( "anim_overlay_sequences", overlaySequences, C_BaseAnimatingOverlay::MAX_OVERLAYS ) );
+				numanimoverlays = MIN( numanimoverlays, event->GetFloatArray( "anim_overlay_weights", overlayWeights, C_BaseAnimatingOverlay::MAX_OVERLAYS ) );
+				numanimoverlays = MIN( numanimoverlays, event->GetIntArray( "anim_overlay_orders", overlayOrders, C_BaseAnimatingOverlay::MAX_OVERLAYS ) );
+				numanimoverlays = MIN( numanimoverlays, event->GetIntArray( "anim_overlay_flags", overlayFlags, C_BaseAnimatingOverlay::MAX_OVERLAYS ) );
+				numanimoverlays = MIN( MIN( numanimoverlays, player->GetNumAnimOverlays() ), ( int )C_BaseAnimatingOverlay::MAX_OVERLAYS );
+
 				for ( int i = 0; i < numanimoverlays; i++ )
 				{
 					auto animOverlay = player->GetAnimOverlay( i );
 
-					char buffer[256];
-					V_sprintf_safe( buffer, "anim_overlay_cycle_%i", i );
-					animOverlay->m_flCycle = event->GetFloat( buffer );
-
-					V_sprintf_safe( buffer, "anim_overlay_sequence_%i", i );
-					animOverlay->m_nSequence = event->GetInt( buffer );
-
-					V_sprintf_safe( buffer, "anim_overlay_weight_%i", i );
-					animOverlay->m_flWeight = event->GetFloat( buffer );
-
-					V_sprintf_safe( buffer, "anim_overlay_order_%i", i );
-					animOverlay->m_nOrder = event->GetInt( buffer );
-
-					V_sprintf_safe( buffer, "anim_overlay_flags_%i", i );
-					animOverlay->m_fFlags = event->GetInt( buffer );
+					animOverlay->m_flCycle	 = overlayCycles[i];
+					animOverlay->m_nSequence = overlaySequences[i];
+					animOverlay->m_flWeight	 = overlayWeights[i];
+					animOverlay->m_nOrder	 = overlayOrders[i];
+					animOverlay->m_fFlags	 = overlayFlags[i];
 				}
 
 				// Let's see if anything wrong has happened, print some infos.
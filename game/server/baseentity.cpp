@@ -581,6 +581,15 @@ CBaseEntity *CBaseEntity::GetFollowedEntity()
 void CBaseEntity::SetClassname( const char *className )
 {
 	m_iClassname = AllocPooledString( className );
+	gEntList.UpdateEntitySearchIndex( this );
+}
+
+void CBaseEntity::SetName( string_t newName )
+{
+	// The entity search index reads the hash stored with pooled names, and
+	// some callers pass MAKE_STRING() of a literal
+	m_iName = ( newName != NULL_STRING && STRING( newName )[0] ) ? AllocPooledString( STRING( newName ) ) : newName;
+	gEntList.UpdateEntitySearchIndex( this );
 }
 
 void CBaseEntity::SetModelIndex( int index )
@@ -3159,6 +3168,9 @@ int CBaseEntity::Restore( IRestore &restore )
 		m_hGroundEntity->AddEntityToGroundList( this );
 	}
 
+	// The restored name and classname were written straight into the fields
+	gEntList.UpdateEntitySearchIndex( this );
+
 	return status;
 }
 
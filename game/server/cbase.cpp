@@ -87,6 +87,8 @@ OUTPUTS:
 #include "env_debughistory.h"
 
 #include "tier0/vprof.h"
+#include "tier0/fasttimer.h"
+#include "world.h"
 #include "sendproxy.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
@@ -645,8 +647,12 @@ CEventQueue g_EventQueue;
 
 CEventQueue::CEventQueue()
 {
-	m_Events.m_flFireTime = -FLT_MAX;
-	m_Events.m_pNext = NULL;
+	memset( m_Wheel0, 0, sizeof( m_Wheel0 ) );
+	memset( m_Wheel1, 0, sizeof( m_Wheel1 ) );
+	memset( &m_Overflow, 0, sizeof( m_Overflow ) );
+	m_nBaseTick = 0;
+	m_nEvents = 0;
+	m_nNextSequence = 0;
 
 	Init();
 }
@@ -757,11 +763,9 @@ void CEventQueue::Init( void )
 	Clear();
 }
 
-void CEventQueue::Clear( void )
+static void DeleteEventList( EventQueueList_t *pList )
 {
-	// delete all the events in the queue
-	EventQueuePrioritizedEvent_t *pe = m_Events.m_pNext;
-	
+	EventQueuePrioritizedEvent_t *pe = pList->m_pHead;
 	while ( pe != NULL )
 	{
 		EventQueuePrioritizedEvent_t *next = pe->m_pNext;
@@ -769,24 +773,38 @@ void CEventQueue::Clear( void )
 		pe = next;
 	}
 
-	m_Events.m_pNext = NULL;
+	pList->m_pHead = pList->m_pTail = NULL;
+}
+
+void CEventQueue::Clear( void )
+{
+	// delete all the events in the queue
+	for ( int i = 0; i < EVENTQUEUE_WHEEL0_SLOTS; i++ )
+	{
+		DeleteEventList( &m_Wheel0[i] );
+	}
+	for ( int i = 0; i < EVENTQUEUE_WHEEL1_SLOTS; i++ )
+	{
+		DeleteEventList( &m_Wheel1[i] );
+	}
+	DeleteEventList( &m_Overflow );
+
+	m_ByCaller.Purge();
+	m_ByTarget.Purge();
+	m_nEvents = 0;
+	m_nNextSequence = 0;
 }
 
 void CEventQueue::Dump( void )
 {
-	EventQueuePrioritizedEvent_t *pe = m_Events.m_pNext;
+	CUtlVector< EventQueuePrioritizedEvent_t * > events;
+	GetSortedEvents( events );
 
-	Msg("Dumping event queue. Current time is: %.2f\n",
-#ifdef TF_DLL
-		engine->GetServerTime()
-#else
-		gpGlobals->curtime
-#endif
-		);
+	Msg("Dumping event queue. Current time is: %.2f\n", GetQueueTime() );
 
-	while ( pe != NULL )
+	for ( int i = 0; i < events.Count(); i++ )
 	{
-		EventQueuePrioritizedEvent_t *next = pe->m_pNext;
+		EventQueuePrioritizedEvent_t *pe = events[i];
 
 		Msg("   (%.2f) Target: '%s', Input: '%s', Parameter '%s'. Activator: '%s', Caller '%s'.  \n", 
 			pe->m_flFireTime, 
@@ -795,13 +813,30 @@ void CEventQueue::Dump( void )
 			pe->m_VariantValue.String(),
 			pe->m_pActivator ? pe->m_pActivator->GetDebugName() : "None", 
 			pe->m_pCaller ? pe->m_pCaller->GetDebugName() : "None"  );
-
-		pe = next;
 	}
 
 	Msg("Finished dump.\n");
 }
 
+float CEventQueue::GetQueueTime( void )
+{
+#ifdef TF_DLL
+	return engine->GetServerTime();
+#else
+	return gpGlobals->curtime;
+#endif
+}
+
+int CEventQueue::TimeToQueueTick( float flTime )
+{
+	if ( gpGlobals->interval_per_tick <= 0.0f )
+		return 0;
+
+	// Rounded down, so a later fire time never gets an earlier tick
+	double flTick = floor( (double)flTime / gpGlobals->interval_per_tick );
+	return (int)clamp( flTick, (double)( INT_MIN / 2 ), (double)( INT_MAX / 2 ) );
+}
+
 
 //-----------------------------------------------------------------------------
 // Purpose: adds the action into the correct spot in the priority queue, targeting entity via string name
@@ -810,11 +845,7 @@ void CEventQueue::AddEvent( const char *target, const char *targetInput, variant
 {
 	// build the new event
 	EventQueuePrioritizedEvent_t *newEvent = new EventQueuePrioritizedEvent_t;
-#ifdef TF_DLL
-	newEvent->m_flFireTime = engine->GetServerTime() + fireDelay;	// priority key in the priority queue
-#else
-	newEvent->m_flFireTime = gpGlobals->curtime + fireDelay;	// priority key in the priority queue
-#endif
+	newEvent->m_flFireTime = GetQueueTime() + fireDelay;	// priority key in the priority queue
 	newEvent->m_iTarget = MAKE_STRING( target );
 	newEvent->m_pEntTarget = NULL;
 	newEvent->m_iTargetInput = MAKE_STRING( targetInput );
@@ -833,11 +864,7 @@ void CEventQueue::AddEvent( CBaseEntity *target, const char *targetInput, varian
 {
 	// build the new event
 	EventQueuePrioritizedEvent_t *newEvent = new EventQueuePrioritizedEvent_t;
-#ifdef TF_DLL
-	newEvent->m_flFireTime = engine->GetServerTime() + fireDelay;	// primary priority key in the priority queue
-#else
-	newEvent->m_flFireTime = gpGlobals->curtime + fireDelay;	// primary priority key in the priority queue
-#endif
+	newEvent->m_flFireTime = GetQueueTime() + fireDelay;	// primary priority key in the priority queue
 	newEvent->m_iTarget = NULL_STRING;
 	newEvent->m_pEntTarget = target;
 	newEvent->m_iTargetInput = MAKE_STRING( targetInput );
@@ -863,36 +890,346 @@ void CEventQueue::AddEvent( CBaseEntity *target, const char *action, float fireD
 //-----------------------------------------------------------------------------
 void CEventQueue::AddEvent( EventQueuePrioritizedEvent_t *newEvent )
 {
-	// loop through the actions looking for a place to insert
-	EventQueuePrioritizedEvent_t *pe;
-	for ( pe = &m_Events; pe->m_pNext != NULL; pe = pe->m_pNext )
+	if ( !m_nEvents )
 	{
-		if ( pe->m_pNext->m_flFireTime > newEvent->m_flFireTime )
-		{
-			break;
-		}
+		// nothing queued, the wheel can start at the present
+		m_nBaseTick = TimeToQueueTick( GetQueueTime() );
 	}
 
-	Assert( pe );
+	newEvent->m_nTick = TimeToQueueTick( newEvent->m_flFireTime );
+	newEvent->m_nSequence = m_nNextSequence++;
+
+	InsertEvent( newEvent );
+	LinkIndex( newEvent );
+	m_nEvents++;
+}
+
+void CEventQueue::RemoveEvent( EventQueuePrioritizedEvent_t *pe )
+{
+	UnlinkEvent( pe );
+	UnlinkIndex( pe );
+	m_nEvents--;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: files an event in the timer wheel by the tick it fires in
+//-----------------------------------------------------------------------------
+static bool FiresAfter( const EventQueuePrioritizedEvent_t *a, const EventQueuePrioritizedEvent_t *b )
+{
+	if ( a->m_flFireTime != b->m_flFireTime )
+		return a->m_flFireTime > b->m_flFireTime;
+	return a->m_nSequence > b->m_nSequence;
+}
 
-	// insert
-	newEvent->m_pNext = pe->m_pNext;
-	newEvent->m_pPrev = pe;
-	pe->m_pNext = newEvent;
-	if ( newEvent->m_pNext )
+static void AppendEvent( EventQueueList_t *pList, EventQueuePrioritizedEvent_t *pe )
+{
+	pe->m_pList = pList;
+	pe->m_pNext = NULL;
+	pe->m_pPrev = pList->m_pTail;
+	if ( pList->m_pTail )
+	{
+		pList->m_pTail->m_pNext = pe;
+	}
+	else
 	{
-		newEvent->m_pNext->m_pPrev = newEvent;
+		pList->m_pHead = pe;
 	}
+	pList->m_pTail = pe;
 }
 
-void CEventQueue::RemoveEvent( EventQueuePrioritizedEvent_t *pe )
+void CEventQueue::InsertEvent( EventQueuePrioritizedEvent_t *pe )
 {
-	Assert( pe->m_pPrev );
-	pe->m_pPrev->m_pNext = pe->m_pNext;
+	int nDelta = pe->m_nTick - m_nBaseTick;
+
+	// Far out events are only sorted once they get close
+	if ( nDelta >= EVENTQUEUE_WHEEL_TICKS )
+	{
+		AppendEvent( &m_Overflow, pe );
+		return;
+	}
+
+	if ( nDelta >= EVENTQUEUE_WHEEL0_SLOTS )
+	{
+		AppendEvent( &m_Wheel1[ ( pe->m_nTick >> EVENTQUEUE_WHEEL0_BITS ) & ( EVENTQUEUE_WHEEL1_SLOTS - 1 ) ], pe );
+		return;
+	}
+
+	// Anything already due goes in the current slot, sorted ahead of the rest
+	EventQueueList_t *pList = ( nDelta <= 0 ) ? CurrentSlot() : &m_Wheel0[ pe->m_nTick & ( EVENTQUEUE_WHEEL0_SLOTS - 1 ) ];
+
+	// Events mostly arrive in fire time order, so search from the back
+	EventQueuePrioritizedEvent_t *pAfter = pList->m_pTail;
+	while ( pAfter && FiresAfter( pAfter, pe ) )
+	{
+		pAfter = pAfter->m_pPrev;
+	}
+
+	pe->m_pList = pList;
+	pe->m_pPrev = pAfter;
+	pe->m_pNext = pAfter ? pAfter->m_pNext : pList->m_pHead;
+	if ( pe->m_pNext )
+	{
+		pe->m_pNext->m_pPrev = pe;
+	}
+	else
+	{
+		pList->m_pTail = pe;
+	}
+	if ( pAfter )
+	{
+		pAfter->m_pNext = pe;
+	}
+	else
+	{
+		pList->m_pHead = pe;
+	}
+}
+
+void CEventQueue::UnlinkEvent( EventQueuePrioritizedEvent_t *pe )
+{
+	EventQueueList_t *pList = pe->m_pList;
+	Assert( pList );
+
+	if ( pe->m_pPrev )
+	{
+		pe->m_pPrev->m_pNext = pe->m_pNext;
+	}
+	else
+	{
+		pList->m_pHead = pe->m_pNext;
+	}
+
 	if ( pe->m_pNext )
 	{
 		pe->m_pNext->m_pPrev = pe->m_pPrev;
 	}
+	else
+	{
+		pList->m_pTail = pe->m_pPrev;
+	}
+
+	pe->m_pList = NULL;
+	pe->m_pNext = pe->m_pPrev = NULL;
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: refiles every event of a wheel slot or the overflow list
+//-----------------------------------------------------------------------------
+void CEventQueue::Cascade( EventQueueList_t *pList )
+{
+	EventQueuePrioritizedEvent_t *pe = pList->m_pHead;
+	pList->m_pHead = pList->m_pTail = NULL;
+
+	while ( pe != NULL )
+	{
+		EventQueuePrioritizedEvent_t *next = pe->m_pNext;
+		InsertEvent( pe );
+		pe = next;
+	}
+}
+
+void CEventQueue::AdvanceTo( int nTick )
+{
+	if ( !m_nEvents )
+	{
+		m_nBaseTick = nTick;
+		return;
+	}
+
+	while ( m_nBaseTick < nTick )
+	{
+		// Whatever didn't fire in this slot carries over to the next one
+		EventQueueList_t carried = *CurrentSlot();
+		CurrentSlot()->m_pHead = CurrentSlot()->m_pTail = NULL;
+
+		m_nBaseTick++;
+
+		if ( !( m_nBaseTick & ( EVENTQUEUE_WHEEL_TICKS - 1 ) ) )
+		{
+			Cascade( &m_Overflow );
+		}
+		if ( !( m_nBaseTick & ( EVENTQUEUE_WHEEL0_SLOTS - 1 ) ) )
+		{
+			Cascade( &m_Wheel1[ ( m_nBaseTick >> EVENTQUEUE_WHEEL0_BITS ) & ( EVENTQUEUE_WHEEL1_SLOTS - 1 ) ] );
+		}
+
+		if ( carried.m_pHead )
+		{
+			// Carried events have earlier ticks, so they all fire before the slot's own
+			EventQueueList_t *pSlot = CurrentSlot();
+			for ( EventQueuePrioritizedEvent_t *pe = carried.m_pHead; pe; pe = pe->m_pNext )
+			{
+				pe->m_pList = pSlot;
+			}
+
+			carried.m_pTail->m_pNext = pSlot->m_pHead;
+			if ( pSlot->m_pHead )
+			{
+				pSlot->m_pHead->m_pPrev = carried.m_pTail;
+			}
+			else
+			{
+				pSlot->m_pTail = carried.m_pTail;
+			}
+			pSlot->m_pHead = carried.m_pHead;
+		}
+	}
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: chains of events by caller and by target entity, for cancelling
+//-----------------------------------------------------------------------------
+typedef CUtlHashtable< int, EventQueuePrioritizedEvent_t * > EventChainTable_t;
+
+static void LinkEventChain( EventChainTable_t &table, int nKey, EventQueuePrioritizedEvent_t *pe,
+	EventQueuePrioritizedEvent_t *EventQueuePrioritizedEvent_t::*pNext, EventQueuePrioritizedEvent_t *EventQueuePrioritizedEvent_t::*pPrev )
+{
+	pe->*pPrev = NULL;
+	pe->*pNext = NULL;
+
+	UtlHashHandle_t h = table.Find( nKey );
+	if ( h == table.InvalidHandle() )
+	{
+		table.Insert( nKey, pe );
+		return;
+	}
+
+	EventQueuePrioritizedEvent_t *&pHead = table.Element( h );
+	pe->*pNext = pHead;
+	pHead->*pPrev = pe;
+	pHead = pe;
+}
+
+static void UnlinkEventChain( EventChainTable_t &table, int nKey, EventQueuePrioritizedEvent_t *pe,
+	EventQueuePrioritizedEvent_t *EventQueuePrioritizedEvent_t::*pNext, EventQueuePrioritizedEvent_t *EventQueuePrioritizedEvent_t::*pPrev )
+{
+	if ( pe->*pNext )
+	{
+		(pe->*pNext)->*pPrev = pe->*pPrev;
+	}
+
+	if ( pe->*pPrev )
+	{
+		(pe->*pPrev)->*pNext = pe->*pNext;
+	}
+	else if ( pe->*pNext )
+	{
+		table[ table.Find( nKey ) ] = pe->*pNext;
+	}
+	else
+	{
+		table.Remove( nKey );
+	}
+}
+
+void CEventQueue::LinkIndex( EventQueuePrioritizedEvent_t *pe )
+{
+	if ( pe->m_pCaller.IsValid() )
+	{
+		LinkEventChain( m_ByCaller, pe->m_pCaller.ToInt(), pe, &EventQueuePrioritizedEvent_t::m_pNextByCaller, &EventQueuePrioritizedEvent_t::m_pPrevByCaller );
+	}
+	if ( pe->m_pEntTarget.IsValid() )
+	{
+		LinkEventChain( m_ByTarget, pe->m_pEntTarget.ToInt(), pe, &EventQueuePrioritizedEvent_t::m_pNextByTarget, &EventQueuePrioritizedEvent_t::m_pPrevByTarget );
+	}
+}
+
+void CEventQueue::UnlinkIndex( EventQueuePrioritizedEvent_t *pe )
+{
+	if ( pe->m_pCaller.IsValid() )
+	{
+		UnlinkEventChain( m_ByCaller, pe->m_pCaller.ToInt(), pe, &EventQueuePrioritizedEvent_t::m_pNextByCaller, &EventQueuePrioritizedEvent_t::m_pPrevByCaller );
+	}
+	if ( pe->m_pEntTarget.IsValid() )
+	{
+		UnlinkEventChain( m_ByTarget, pe->m_pEntTarget.ToInt(), pe, &EventQueuePrioritizedEvent_t::m_pNextByTarget, &EventQueuePrioritizedEvent_t::m_pPrevByTarget );
+	}
+}
+
+static int __cdecl EventFiringOrder( EventQueuePrioritizedEvent_t * const *a, EventQueuePrioritizedEvent_t * const *b )
+{
+	if ( FiresAfter( *a, *b ) )
+		return 1;
+	return FiresAfter( *b, *a ) ? -1 : 0;
+}
+
+void CEventQueue::GetSortedEvents( CUtlVector< EventQueuePrioritizedEvent_t * > &events )
+{
+	events.EnsureCapacity( m_nEvents );
+
+	for ( int i = 0; i < EVENTQUEUE_WHEEL0_SLOTS; i++ )
+	{
+		for ( EventQueuePrioritizedEvent_t *pe = m_Wheel0[i].m_pHead; pe; pe = pe->m_pNext )
+		{
+			events.AddToTail( pe );
+		}
+	}
+	for ( int i = 0; i < EVENTQUEUE_WHEEL1_SLOTS; i++ )
+	{
+		for ( EventQueuePrioritizedEvent_t *pe = m_Wheel1[i].m_pHead; pe; pe = pe->m_pNext )
+		{
+			events.AddToTail( pe );
+		}
+	}
+	for ( EventQueuePrioritizedEvent_t *pe = m_Overflow.m_pHead; pe; pe = pe->m_pNext )
+	{
+		events.AddToTail( pe );
+	}
+
+	events.Sort( EventFiringOrder );
+}
+
+//-----------------------------------------------------------------------------
+// Purpose: checks the wheel's bookkeeping, warns about anything inconsistent
+//-----------------------------------------------------------------------------
+void CEventQueue::ValidateQueue( void )
+{
+	int nEvents = 0;
+	int nBadSlot = 0;
+	int nBadOrder = 0;
+
+	for ( int i = 0; i < EVENTQUEUE_WHEEL0_SLOTS; i++ )
+	{
+		for ( EventQueuePrioritizedEvent_t *pe = m_Wheel0[i].m_pHead; pe; pe = pe->m_pNext )
+		{
+			nEvents++;
+			int nTick = MAX( pe->m_nTick, m_nBaseTick );
+			if ( pe->m_pList != &m_Wheel0[i] || ( nTick & ( EVENTQUEUE_WHEEL0_SLOTS - 1 ) ) != i || nTick - m_nBaseTick >= EVENTQUEUE_WHEEL0_SLOTS )
+			{
+				nBadSlot++;
+			}
+			if ( pe->m_pNext && FiresAfter( pe, pe->m_pNext ) )
+			{
+				nBadOrder++;
+			}
+		}
+	}
+
+	for ( int i = 0; i < EVENTQUEUE_WHEEL1_SLOTS; i++ )
+	{
+		for ( EventQueuePrioritizedEvent_t *pe = m_Wheel1[i].m_pHead; pe; pe = pe->m_pNext )
+		{
+			nEvents++;
+			if ( pe->m_pList != &m_Wheel1[i] || ( pe->m_nTick >> EVENTQUEUE_WHEEL0_BITS ) <= ( m_nBaseTick >> EVENTQUEUE_WHEEL0_BITS ) )
+			{
+				nBadSlot++;
+			}
+		}
+	}
+
+	for ( EventQueuePrioritizedEvent_t *pe = m_Overflow.m_pHead; pe; pe = pe->m_pNext )
+	{
+		nEvents++;
+		if ( pe->m_pList != &m_Overflow )
+		{
+			nBadSlot++;
+		}
+	}
+
+	if ( nEvents != m_nEvents || nBadSlot || nBadOrder )
+	{
+		Warning( "Event queue: %d events (%d counted), %d in the wrong slot, %d out of order\n", nEvents, m_nEvents, nBadSlot, nBadOrder );
+	}
 }
 
 
@@ -906,13 +1243,13 @@ void CEventQueue::ServiceEvents( void )
 		return;
 	}
 
-	EventQueuePrioritizedEvent_t *pe = m_Events.m_pNext;
+	float flNow = GetQueueTime();
+	AdvanceTo( TimeToQueueTick( flNow ) );
 
-#ifdef TF_DLL
-	while ( pe != NULL && pe->m_flFireTime <= engine->GetServerTime() )
-#else
-	while ( pe != NULL && pe->m_flFireTime <= gpGlobals->curtime )
-#endif
+	// Everything that is due is in the current slot, in firing order
+	EventQueuePrioritizedEvent_t *pe = CurrentSlot()->m_pHead;
+
+	while ( pe != NULL && pe->m_flFireTime <= flNow )
 	{
 		MDLCACHE_CRITICAL_SECTION();
 
@@ -995,7 +1332,7 @@ void CEventQueue::ServiceEvents( void )
 		}
 
 		// restart the list (to catch any new items have probably been added to the queue)
-		pe = m_Events.m_pNext;	
+		pe = CurrentSlot()->m_pHead;	
 	}
 }
 
@@ -1009,13 +1346,13 @@ void CEventQueue::ServiceEvent( CBaseEntity* pActivator )
 		return;
 	}
 
-	EventQueuePrioritizedEvent_t *pe = m_Events.m_pNext;
+	float flNow = GetQueueTime();
+	AdvanceTo( TimeToQueueTick( flNow ) );
 
-#ifdef TF_DLL
-	while ( pe != NULL && pe->m_flFireTime <= engine->GetServerTime() )
-#else
-	while ( pe != NULL && pe->m_flFireTime <= gpGlobals->curtime )
-#endif
+	// Everything that is due is in the current slot, in firing order
+	EventQueuePrioritizedEvent_t *pe = CurrentSlot()->m_pHead;
+
+	while ( pe != NULL && pe->m_flFireTime <= flNow )
     {
         if ( pe->m_pActivator != pActivator )
         {
@@ -1104,7 +1441,7 @@ void CEventQueue::ServiceEvent( CBaseEntity* pActivator )
 		}
 
 		// restart the list (to catch any new items have probably been added to the queue)
-		pe = m_Events.m_pNext;
+		pe = CurrentSlot()->m_pHead;
 	}
 }
 
@@ -1120,6 +1457,42 @@ void CC_DumpEventQueue()
 }
 static ConCommand dumpeventqueue( "dumpeventqueue", CC_DumpEventQueue, "Dump the contents of the Entity I/O event queue to the console." );
 
+//-----------------------------------------------------------------------------
+// Purpose: Times queueing and cancelling a burst of events on the world entity
+//-----------------------------------------------------------------------------
+CON_COMMAND_F( eventqueue_stress, "Queue and cancel a number of entity I/O events, timing both. Usage: eventqueue_stress [count]", FCVAR_CHEAT )
+{
+	if ( !UTIL_IsCommandIssuedByServerAdmin() )
+		return;
+
+	CBaseEntity *pWorld = GetWorldEntity();
+	if ( !pWorld )
+		return;
+
+	int nEvents = ( args.ArgC() > 1 ) ? MAX( atoi( args[1] ), 1 ) : 10000;
+
+	CFastTimer timer;
+	timer.Start();
+	for ( int i = 0; i < nEvents; i++ )
+	{
+		// spread over the wheel levels, several events per tick
+		float flDelay = (float)( ( i * 7919 ) % 6000 ) * 0.01f;
+		g_EventQueue.AddEvent( pWorld, "__stress", flDelay, NULL, NULL );
+	}
+	timer.End();
+	float flAdd = timer.GetDuration().GetMillisecondsF();
+
+	g_EventQueue.ValidateQueue();
+
+	timer.Start();
+	g_EventQueue.CancelEventOn( pWorld, "__stress" );
+	timer.End();
+	float flCancel = timer.GetDuration().GetMillisecondsF();
+
+	Msg( "eventqueue_stress: %d events queued in %.2fms, cancelled in %.2fms (%d other events pending)\n",
+		nEvents, flAdd, flCancel, g_EventQueue.Count() );
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: Removes all pending events from the I/O queue that were added by the
 //			given caller.
@@ -1132,30 +1505,20 @@ void CEventQueue::CancelEvents( CBaseEntity *pCaller )
 	if (!pCaller)
 		return;
 
-	EventQueuePrioritizedEvent_t *pCur = m_Events.m_pNext;
+	UtlHashHandle_t h = m_ByCaller.Find( pCaller->GetRefEHandle().ToInt() );
+	if ( h == m_ByCaller.InvalidHandle() )
+		return;
+
+	// Every event in the chain has this entity as its caller
+	EventQueuePrioritizedEvent_t *pCur = m_ByCaller.Element( h );
 
 	while (pCur != NULL)
 	{
-		bool bDelete = false;
-		if (pCur->m_pCaller == pCaller)
-		{
-			// Pointers match; make sure everything else matches.
-			if (!stricmp(STRING(pCur->m_pCaller->GetEntityName()), STRING(pCaller->GetEntityName())) &&
-				!stricmp(pCur->m_pCaller->GetClassname(), pCaller->GetClassname()))
-			{
-				// Found a matching event; delete it from the queue.
-				bDelete = true;
-			}
-		}
-
 		EventQueuePrioritizedEvent_t *pCurSave = pCur;
-		pCur = pCur->m_pNext;
+		pCur = pCur->m_pNextByCaller;
 
-		if (bDelete)
-		{
-			RemoveEvent( pCurSave );
-			delete pCurSave;
-		}
+		RemoveEvent( pCurSave );
+		delete pCurSave;
 	}
 }
 
@@ -1170,22 +1533,23 @@ void CEventQueue::CancelEventOn( CBaseEntity *pTarget, const char *sInputName )
 	if (!pTarget)
 		return;
 
-	EventQueuePrioritizedEvent_t *pCur = m_Events.m_pNext;
+	UtlHashHandle_t h = m_ByTarget.Find( pTarget->GetRefEHandle().ToInt() );
+	if ( h == m_ByTarget.InvalidHandle() )
+		return;
+
+	EventQueuePrioritizedEvent_t *pCur = m_ByTarget.Element( h );
 
 	while (pCur != NULL)
 	{
 		bool bDelete = false;
-		if (pCur->m_pEntTarget == pTarget)
+		if ( !Q_strncmp( STRING(pCur->m_iTargetInput), sInputName, strlen(sInputName) ) )
 		{
-			if ( !Q_strncmp( STRING(pCur->m_iTargetInput), sInputName, strlen(sInputName) ) )
-			{
-				// Found a matching event; delete it from the queue.
-				bDelete = true;
-			}
+			// Found a matching event; delete it from the queue.
+			bDelete = true;
 		}
 
 		EventQueuePrioritizedEvent_t *pCurSave = pCur;
-		pCur = pCur->m_pNext;
+		pCur = pCur->m_pNextByTarget;
 
 		if (bDelete)
 		{
@@ -1205,20 +1569,17 @@ bool CEventQueue::HasEventPending( CBaseEntity *pTarget, const char *sInputName
 	if (!pTarget)
 		return false;
 
-	EventQueuePrioritizedEvent_t *pCur = m_Events.m_pNext;
+	UtlHashHandle_t h = m_ByTarget.Find( pTarget->GetRefEHandle().ToInt() );
+	if ( h == m_ByTarget.InvalidHandle() )
+		return false;
 
-	while (pCur != NULL)
+	for ( EventQueuePrioritizedEvent_t *pCur = m_ByTarget.Element( h ); pCur != NULL; pCur = pCur->m_pNextByTarget )
 	{
-		if (pCur->m_pEntTarget == pTarget)
-		{
-			if ( !sInputName )
-				return true;
+		if ( !sInputName )
+			return true;
 
-			if ( !Q_strncmp( STRING(pCur->m_iTargetInput), sInputName, strlen(sInputName) ) )
-				return true;
-		}
-
-		pCur = pCur->m_pNext;
+		if ( !Q_strncmp( STRING(pCur->m_iTargetInput), sInputName, strlen(sInputName) ) )
+			return true;
 	}
 
 	return false;
@@ -1267,22 +1628,20 @@ END_DATADESC()
 
 int CEventQueue::Save( ISave &save )
 {
-	// count the number of items in the queue
-	EventQueuePrioritizedEvent_t *pe;
+	// saved in firing order, so restoring them in turn keeps the order of events with the same fire time
+	CUtlVector< EventQueuePrioritizedEvent_t * > events;
+	GetSortedEvents( events );
 
-	m_iListCount = 0;
-	for ( pe = m_Events.m_pNext; pe != NULL; pe = pe->m_pNext )
-	{
-		m_iListCount++;
-	}
+	m_iListCount = events.Count();
 
 	// save that value out to disk, so we know how many to restore
 	if ( !save.WriteFields( "EventQueue", this, NULL, m_DataMap.dataDesc, m_DataMap.dataNumFields ) )
 		return 0;
 	
 	// cycle through all the events, saving them all
-	for ( pe = m_Events.m_pNext; pe != NULL; pe = pe->m_pNext )
+	for ( int i = 0; i < events.Count(); i++ )
 	{
+		EventQueuePrioritizedEvent_t *pe = events[i];
 		if ( !save.WriteFields( "PEvent", pe, NULL, pe->m_DataMap.dataDesc, pe->m_DataMap.dataNumFields ) )
 			return 0;
 	}
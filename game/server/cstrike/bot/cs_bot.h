@@ -675,6 +675,7 @@ public:
 
 	//- navigation --------------------------------------------------------------------------------------------------
 	bool HasPath( void ) const;
+	bool IsPathPending( void ) const;							///< return true if we asked for a path that hasn't been computed yet
 	void DestroyPath( void );
 
 	float GetFeetZ( void ) const;								///< return Z of bottom of feet
@@ -712,7 +713,7 @@ public:
 	CBaseEntity *GetGoalEntity( void );
 
 	bool IsNearJump( void ) const;									///< return true if nearing a jump in the path
-	float GetApproximateFallDamage( float height ) const;			///< return how much damage will will take from the given fall height
+	static float GetApproximateFallDamage( float height );			///< return how much damage will will take from the given fall height
 
 	void ForceRun( float duration );								///< force the bot to run if it moves for the given duration
 	virtual bool IsRunning( void ) const;
@@ -896,6 +897,7 @@ private:
 
 private:
 	friend class CCSBotManager;
+	friend class CCSBotPathQueue;
 
 	/// @todo Get rid of these
 	friend class AttackState;
@@ -989,6 +991,10 @@ private:
 	int m_pathIndex;												///< index of next area on path
 	float m_areaEnteredTimestamp;
 	void BuildTrivialPath( const Vector &goal );					///< build trivial path to goal, assuming we are already in the same area
+	bool BuildPath( CNavArea * const *area, const NavTraverseType *how, int count, CNavArea *effectiveGoalArea, const Vector &pathEndPosition );	///< build path through the given areas, ending at pathEndPosition
+
+	bool m_isPathPending;											///< true if our path request is waiting in TheCSBotPathQueue
+	unsigned int m_pathRequestSerial;								///< serial of our latest path request
 
 	CountdownTimer m_repathTimer;									///< must have elapsed before bot can pathfind again
 
@@ -1162,9 +1168,12 @@ private:
 		Vector m_leftSidePos;										///< current left side position
 		Vector m_rightSidePos;										///< current right side position
 		int m_validFrame;											///< frame of last computation (for lazy evaluation)
+		CNavArea *m_visArea;										///< nav area the player is standing in, NULL if not on the mesh
+		int m_visAreaFrame;											///< frame of last m_visArea computation
 	};
 	static PartInfo m_partInfo[ MAX_PLAYERS ];						///< part positions for each player
 	void ComputePartPositions( CCSPlayer *player );					///< compute part positions from bone location
+	static CNavArea *GetVisibilityArea( CCSPlayer *player );		///< return the nav area whose visibility data applies to the player's view, or NULL
 
 	//- attack state data --------------------------------------------------------------------------------------------
 	DispositionType m_disposition;									///< how we will react to enemies
@@ -1598,11 +1607,19 @@ inline bool CCSBot::HasPath( void ) const
 	return (m_pathLength) ? true : false;
 }
 
+inline bool CCSBot::IsPathPending( void ) const
+{
+	return m_isPathPending;
+}
+
 inline void CCSBot::DestroyPath( void )		
 {
 	m_isStopping = false;
 	m_pathLength = 0;
 	m_pathLadder = NULL;
+
+	// a request still in the queue is dropped when it comes up
+	m_isPathPending = false;
 }
 
 inline CNavArea *CCSBot::GetLastKnownArea( void ) const		
@@ -179,6 +179,8 @@ void CCSBot::ResetValues( void )
 
 	m_pathLength = 0;
 	m_pathIndex = 0;
+	m_isPathPending = false;
+	m_pathRequestSerial = 0;
 	m_areaEnteredTimestamp = 0.0f;
 	m_currentArea = NULL;
 	m_lastKnownArea = NULL;
@@ -12,6 +12,7 @@
 #include "cbase.h"
 
 #include "cs_bot.h"
+#include "cs_bot_path_queue.h"
 #include "nav_area.h"
 #include "cs_gamerules.h"
 #include "shared_util.h"
@@ -136,6 +137,8 @@ void CCSBotManager::RestartRound( void )
 	// extend
 	CBotManager::RestartRound();
 
+	TheCSBotPathQueue.Clear();
+
 	SetLooseBomb( NULL );
 	m_isBombPlanted = false;
 	m_earliestBombPlantTimestamp = gpGlobals->curtime + RandomFloat( 10.0f, 30.0f ); // 60
@@ -248,6 +251,9 @@ void CCSBotManager::StartFrame( void )
 		return;
 	}
 
+	// compute the paths bots asked for last frame before they update
+	TheCSBotPathQueue.Update();
+
 	// EXTEND
 	CBotManager::StartFrame();
 
@@ -365,6 +371,9 @@ void CCSBotManager::ServerActivate( void )
 {
 	m_isMapDataLoaded = false;
 
+	TheCSBotPathQueue.Clear();
+	TheCSBotPathQueue.ResetStats();
+
 	// load the database of bot radio chatter
 	TheBotPhrases->Reset();
 	TheBotPhrases->Initialize( "BotChatter.db", 0 );
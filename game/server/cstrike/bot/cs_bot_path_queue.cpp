@@ -0,0 +1,440 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Queue of bot path requests, solved on the thread pool
+//
+//=============================================================================//
+
+#include "cbase.h"
+#include "cs_bot.h"
+#include "cs_bot_path_queue.h"
+#include "nav_search.h"
+#include "tier0/fasttimer.h"
+#include "vstdlib/jobthread.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+ConVar cv_bot_path_async( "bot_path_async", "1", FCVAR_GAMEDLL, "If nonzero, bot paths are computed on the thread pool at the start of the next frame instead of when they are asked for." );
+ConVar cv_bot_path_budget( "bot_path_budget", "8", FCVAR_GAMEDLL, "The most bot paths computed each frame when bot_path_async is set.", true, 1.0f, false, 0.0f );
+
+CCSBotPathQueue TheCSBotPathQueue;
+
+static CTHREADLOCALPTR( CNavAreaSearch ) s_threadSearch;
+
+
+//--------------------------------------------------------------------------------------------------------------
+float CSBotAsyncPathCost::operator() ( CNavArea *area, CNavArea *fromArea, const CNavLadder *ladder, const CFuncElevator *elevator, float length )
+{
+	float baseDangerFactor = 100.0f;
+
+	// respond to the danger modulated by our aggression (even super-aggressives pay SOME attention to danger)
+	float dangerFactor = (1.0f - (0.95f * m_params.aggression)) * baseDangerFactor;
+
+	if (fromArea == NULL)
+	{
+		if (m_params.route == FASTEST_ROUTE)
+			return 0.0f;
+
+		// first area in path, cost is just danger
+		return dangerFactor * area->PeekDanger( m_params.team );
+	}
+	else if ((fromArea->GetAttributes() & NAV_MESH_JUMP) && (area->GetAttributes() & NAV_MESH_JUMP))
+	{
+		// cannot actually walk in jump areas - disallow moving from jump area to jump area
+		return -1.0f;
+	}
+
+	if ( area->GetAttributes() & NAV_MESH_NO_HOSTAGES && m_params.isEscortingHostages )
+	{
+		// if we're leading hostages, don't try to go where they can't
+		return -1.0f;
+	}
+
+	// compute distance from previous area to this area
+	float dist;
+	if (ladder)
+	{
+		// ladders are slow to use
+		const float ladderPenalty = 1.0f;
+		dist = ladderPenalty * ladder->m_length;
+	}
+	else
+	{
+		dist = (area->GetCenter() - fromArea->GetCenter()).Length();
+	}
+
+	// compute distance travelled along path so far
+	float cost = dist + fromArea->GetCostSoFar();
+
+	// zombies ignore all path penalties
+	if (m_params.isZombie)
+		return cost;
+
+	// add cost of "jump down" pain unless we're jumping into water
+	if (!area->IsUnderwater() && area->IsConnected( fromArea, NUM_DIRECTIONS ) == false)
+	{
+		// this is a "jump down" (one way drop) transition - estimate damage we will take to traverse it,
+		// using the height of the edges rather than tracing down to the ground
+		float heightChange = fromArea->ComputeAdjacentConnectionHeightChange( area );
+		float fallDistance = (heightChange == FLT_MAX) ? fromArea->GetCenter().z - area->GetCenter().z : -heightChange;
+
+		// if it's a drop-down ladder, estimate height from the bottom of the ladder to the lower area
+		if ( ladder && ladder->m_bottom.z < fromArea->GetCenter().z && ladder->m_bottom.z > area->GetCenter().z )
+		{
+			fallDistance = ladder->m_bottom.z - area->GetCenter().z;
+		}
+
+		float fallDamage = CCSBot::GetApproximateFallDamage( fallDistance );
+
+		if (fallDamage > 0.0f)
+		{
+			// if the fall would kill us, don't use it
+			const float deathFallMargin = 10.0f;
+			if (fallDamage + deathFallMargin >= m_params.health)
+				return -1.0f;
+
+			// if we need to get there in a hurry, ignore minor pain
+			const float painTolerance = 15.0f * m_params.aggression + 10.0f;
+			if (m_params.route != FASTEST_ROUTE || fallDamage > painTolerance)
+			{
+				// cost is proportional to how much it hurts when we fall
+				cost += 100.0f * fallDamage * fallDamage;
+			}
+		}
+	}
+
+	// if this is a "crouch" or "walk" area, add penalty
+	if (area->GetAttributes() & (NAV_MESH_CROUCH | NAV_MESH_WALK))
+	{
+		// these areas are very slow to move through
+		float penalty = (m_params.route == FASTEST_ROUTE) ? 20.0f : 5.0f;
+
+		// avoid crouch areas if we are rescuing hostages
+		if ((area->GetAttributes() & NAV_MESH_CROUCH) && m_params.isEscortingHostages)
+		{
+			penalty *= 3.0f;
+		}
+
+		cost += penalty * dist;
+	}
+
+	// if this is a "jump" area, add penalty
+	if (area->GetAttributes() & NAV_MESH_JUMP)
+	{
+		const float jumpPenalty = 1.0f;
+		cost += jumpPenalty * dist;
+	}
+
+	// if this is an area to avoid, add penalty
+	if (area->GetAttributes() & NAV_MESH_AVOID)
+	{
+		const float avoidPenalty = 20.0f;
+		cost += avoidPenalty * dist;
+	}
+
+	if (m_params.route == SAFEST_ROUTE)
+	{
+		// add in the danger of this path - danger is per unit length travelled
+		cost += dist * dangerFactor * area->PeekDanger( m_params.team );
+	}
+
+	if (!m_params.isAttacking)
+	{
+		// add in cost of teammates in the way
+
+		// approximate density of teammates based on area
+		float size = (area->GetSizeX() + area->GetSizeY())/2.0f;
+
+		// degenerate check
+		if (size >= 1.0f)
+		{
+			// cost is proportional to the density of teammates in this area
+			const float costPerFriendPerUnit = 50000.0f;
+			cost += costPerFriendPerUnit * (float)area->GetPlayerCount( m_params.team ) / size;
+		}
+	}
+
+	return cost;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+CCSBotPathQueue::CCSBotPathQueue( void )
+{
+	m_nextSerial = 0;
+	ResetStats();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+CCSBotPathQueue::~CCSBotPathQueue()
+{
+	m_queue.PurgeAndDeleteElements();
+	m_freeRequests.PurgeAndDeleteElements();
+	m_threadSearches.PurgeAndDeleteElements();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CCSBotPathQueue::ResetStats( void )
+{
+	m_solvedCount = 0;
+	m_droppedCount = 0;
+	m_maxQueueDepth = 0;
+	m_maxLatencyTicks = 0;
+	m_totalLatency = 0.0;
+	m_maxLatency = 0.0;
+	m_totalSolveTime = 0.0;
+	m_maxFrameSolveTime = 0.0;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+int CCSBotPathQueue::Find( const CCSBot *bot ) const
+{
+	FOR_EACH_VEC( m_queue, it )
+	{
+		if ( m_queue[ it ]->bot.Get() == bot )
+			return it;
+	}
+	return m_queue.InvalidIndex();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return true if the bot that made the request is still waiting for it
+ */
+bool CCSBotPathQueue::IsWanted( const CSBotPathRequest_t *request ) const
+{
+	CCSBot *bot = request->bot.Get();
+	return bot && bot->IsAlive() && bot->m_isPathPending && bot->m_pathRequestSerial == request->serial;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CCSBotPathQueue::Release( CSBotPathRequest_t *request )
+{
+	request->bot = NULL;
+	m_freeRequests.AddToTail( request );
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CCSBotPathQueue::Submit( CCSBot *bot, CNavArea *startArea, CNavArea *goalArea, const Vector &goal, const Vector &pathEndPosition, const CSBotPathCostParams_t &cost )
+{
+	CSBotPathRequest_t *request;
+
+	int it = Find( bot );
+	if ( it != m_queue.InvalidIndex() )
+	{
+		// the earlier request is out of date, reuse it without losing our place
+		request = m_queue[ it ];
+	}
+	else
+	{
+		if ( m_freeRequests.Count() )
+		{
+			request = m_freeRequests.Tail();
+			m_freeRequests.RemoveMultipleFromTail( 1 );
+		}
+		else
+		{
+			request = new CSBotPathRequest_t;
+		}
+
+		request->bot = bot;
+		request->queuedTick = gpGlobals->tickcount;
+		request->queuedTime = Plat_FloatTime();
+		m_queue.AddToTail( request );
+
+		m_maxQueueDepth = MAX( m_maxQueueDepth, m_queue.Count() );
+	}
+
+	request->serial = ++m_nextSerial;
+	request->startArea = startArea;
+	request->goalArea = goalArea;
+	request->goal = goal;
+	request->pathEndPosition = pathEndPosition;
+	request->cost = cost;
+
+	bot->m_isPathPending = true;
+	bot->m_pathRequestSerial = request->serial;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CCSBotPathQueue::Clear( void )
+{
+	FOR_EACH_VEC( m_queue, it )
+	{
+		CCSBot *bot = m_queue[ it ]->bot.Get();
+		if ( bot )
+		{
+			bot->m_isPathPending = false;
+		}
+		Release( m_queue[ it ] );
+	}
+	m_queue.RemoveAll();
+	m_solving.RemoveAll();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * The calling thread's search, created the first time the thread solves a request
+ */
+CNavAreaSearch &CCSBotPathQueue::GetThreadSearch( void )
+{
+	CNavAreaSearch *search = s_threadSearch;
+	if ( search == NULL )
+	{
+		search = new CNavAreaSearch;
+		s_threadSearch = search;
+
+		AUTO_LOCK( m_threadSearchMutex );
+		m_threadSearches.AddToTail( search );
+	}
+	return *search;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Compute the path of a request. Runs on any thread, touching only the request and the search.
+ */
+void CCSBotPathQueue::Solve( CSBotPathRequest_t *request, CNavAreaSearch &search )
+{
+	CSBotAsyncPathCost cost( request->cost );
+	CNavArea *closestArea = NULL;
+	request->pathToGoalExists = NavAreaBuildPath( search, request->startArea, request->goalArea, &request->goal, cost, &closestArea );
+	request->effectiveGoalArea = ( request->pathToGoalExists ) ? request->goalArea : closestArea;
+
+	// get count
+	int count = 0;
+	CNavArea *area;
+	for( area = request->effectiveGoalArea; area; area = search.GetParent( area ) )
+		++count;
+
+	// save room for endpoint
+	if ( count > CSBotPathRequest_t::MAX_PATH_AREAS-1 )
+		count = CSBotPathRequest_t::MAX_PATH_AREAS-1;
+
+	// keep the end of the path if it is too long, like CCSBot::ComputePath()
+	request->areaCount = count;
+	for( area = request->effectiveGoalArea; count && area; area = search.GetParent( area ) )
+	{
+		--count;
+		request->area[ count ] = area;
+		request->how[ count ] = search.Find( area )->m_parentHow;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CCSBotPathQueue::SolveRange( void *context, int begin, int end )
+{
+	CCSBotPathQueue *queue = (CCSBotPathQueue *)context;
+	CNavAreaSearch &search = queue->GetThreadSearch();
+
+	for( int i=begin; i<end; ++i )
+	{
+		Solve( queue->m_solving[i], search );
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Invoked at the start of each frame, before the bots update
+ */
+void CCSBotPathQueue::Update( void )
+{
+	VPROF_BUDGET( "CCSBotPathQueue::Update", VPROF_BUDGETGROUP_NPCS );
+
+	if ( m_queue.Count() == 0 )
+		return;
+
+	// drop requests nobody is waiting for anymore, and take this frame's share of the rest
+	int budget = cv_bot_path_budget.GetInt();
+	m_solving.RemoveAll();
+
+	int kept = 0;
+	FOR_EACH_VEC( m_queue, it )
+	{
+		CSBotPathRequest_t *request = m_queue[ it ];
+		if ( !IsWanted( request ) )
+		{
+			++m_droppedCount;
+			Release( request );
+		}
+		else if ( m_solving.Count() < budget )
+		{
+			m_solving.AddToTail( request );
+		}
+		else
+		{
+			m_queue[ kept++ ] = request;
+		}
+	}
+	m_queue.SetCountNonDestructively( kept );
+
+	if ( m_solving.Count() == 0 )
+		return;
+
+	CFastTimer timer;
+	timer.Start();
+
+	// the nav mesh and the bots hold still until every thread is done
+	if ( g_pThreadPool && m_solving.Count() > 1 )
+	{
+		g_pThreadPool->ParallelFor( SolveRange, this, 0, m_solving.Count(), 1 );
+	}
+	else
+	{
+		SolveRange( this, 0, m_solving.Count() );
+	}
+
+	timer.End();
+	double solveTime = timer.GetDuration().GetSeconds();
+	m_totalSolveTime += solveTime;
+	m_maxFrameSolveTime = MAX( m_maxFrameSolveTime, solveTime );
+
+	// hand the paths to their bots
+	double now = Plat_FloatTime();
+	FOR_EACH_VEC( m_solving, it )
+	{
+		CSBotPathRequest_t *request = m_solving[ it ];
+		CCSBot *bot = request->bot.Get();
+
+		bot->m_isPathPending = false;
+		bot->BuildPath( request->area, request->how, request->areaCount, request->effectiveGoalArea, request->pathEndPosition );
+
+		++m_solvedCount;
+		double latency = now - request->queuedTime;
+		m_totalLatency += latency;
+		m_maxLatency = MAX( m_maxLatency, latency );
+		m_maxLatencyTicks = MAX( m_maxLatencyTicks, gpGlobals->tickcount - request->queuedTick );
+
+		Release( request );
+	}
+	m_solving.RemoveAll();
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CCSBotPathQueue::PrintStats( void ) const
+{
+	Msg( "Bot path queue: %s, budget %d paths per frame\n", cv_bot_path_async.GetBool() ? "async" : "off", cv_bot_path_budget.GetInt() );
+	Msg( "  queued now: %d (most at once: %d)\n", m_queue.Count(), m_maxQueueDepth );
+	Msg( "  solved: %d, dropped unsolved: %d\n", m_solvedCount, m_droppedCount );
+	if ( m_solvedCount )
+	{
+		Msg( "  latency: %.2f ms average, %.2f ms / %d ticks worst\n", 1000.0 * m_totalLatency / m_solvedCount, 1000.0 * m_maxLatency, m_maxLatencyTicks );
+		Msg( "  solve time: %.3f ms per path, %.2f ms worst frame\n", 1000.0 * m_totalSolveTime / m_solvedCount, 1000.0 * m_maxFrameSolveTime );
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+CON_COMMAND_F( bot_path_queue_stats, "Show how many bot path requests are queued and how long they wait. Use 'reset' to clear the counters.", FCVAR_GAMEDLL )
+{
+	if ( !UTIL_IsCommandIssuedByServerAdmin() )
+		return;
+
+	if ( args.ArgC() > 1 && FStrEq( args[1], "reset" ) )
+	{
+		TheCSBotPathQueue.ResetStats();
+		return;
+	}
+
+	TheCSBotPathQueue.PrintStats();
+}
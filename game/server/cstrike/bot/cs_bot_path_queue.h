@@ -0,0 +1,141 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Queue of bot path requests, solved on the thread pool
+//
+//=============================================================================//
+
+#ifndef _CS_BOT_PATH_QUEUE_H_
+#define _CS_BOT_PATH_QUEUE_H_
+
+#include "nav_pathfind.h"
+#include "tier0/threadtools.h"
+
+class CCSBot;
+class CNavAreaSearch;
+
+extern ConVar cv_bot_path_async;
+extern ConVar cv_bot_path_budget;
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * The parts of a bot that its path cost depends on, copied when the path is requested
+ * so the path can be computed away from the bot
+ */
+struct CSBotPathCostParams_t
+{
+	RouteType route;
+	int team;
+	float aggression;
+	int health;
+	bool isEscortingHostages;
+	bool isAttacking;
+	bool isZombie;
+};
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Thread safe counterpart of PathCost (cs_bot.h), working from a copy of the bot's state.
+ * Danger is read without decaying it in the area, and the fall height of a drop is taken
+ * from the nav mesh rather than traced.
+ */
+class CSBotAsyncPathCost
+{
+public:
+	CSBotAsyncPathCost( const CSBotPathCostParams_t &params ) : m_params( params )
+	{
+	}
+
+	float operator() ( CNavArea *area, CNavArea *fromArea, const CNavLadder *ladder, const CFuncElevator *elevator, float length );
+
+private:
+	const CSBotPathCostParams_t &m_params;
+};
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * A path a bot asked for, and the areas it goes through once it has been computed
+ */
+struct CSBotPathRequest_t
+{
+	enum { MAX_PATH_AREAS = 256 };
+
+	CHandle< CCSBot > bot;
+	unsigned int serial;						///< matches the bot's request serial until the bot asks for another path
+
+	CNavArea *startArea;
+	CNavArea *goalArea;
+	Vector goal;
+	Vector pathEndPosition;
+	CSBotPathCostParams_t cost;
+
+	int queuedTick;
+	double queuedTime;
+
+	// result
+	bool pathToGoalExists;
+	CNavArea *effectiveGoalArea;
+	int areaCount;
+	CNavArea *area[ MAX_PATH_AREAS ];				///< from the start of the path to its end
+	NavTraverseType how[ MAX_PATH_AREAS ];
+};
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Collects the bots' path requests and solves them once per frame, before the bots update.
+ * At most bot_path_budget requests are solved per frame, in the order they were made, split
+ * over the thread pool. The nav mesh isn't changed while they run, since the main thread
+ * works on them too and waits for the rest. The paths are handed to the bots right after.
+ * A bot has at most one request queued; one it no longer waits for (see CCSBot::DestroyPath)
+ * is dropped without being solved.
+ */
+class CCSBotPathQueue
+{
+public:
+	CCSBotPathQueue( void );
+	~CCSBotPathQueue();
+
+	void Submit( CCSBot *bot, CNavArea *startArea, CNavArea *goalArea, const Vector &goal, const Vector &pathEndPosition, const CSBotPathCostParams_t &cost );	///< replaces the bot's earlier request, keeping its place in the queue
+	void Clear( void );										///< drop all requests
+
+	void Update( void );									///< solve and deliver this frame's share of requests
+
+	int GetQueueDepth( void ) const				{ return m_queue.Count(); }
+	void PrintStats( void ) const;
+	void ResetStats( void );
+
+private:
+	int Find( const CCSBot *bot ) const;
+	bool IsWanted( const CSBotPathRequest_t *request ) const;
+	void Release( CSBotPathRequest_t *request );
+
+	static void Solve( CSBotPathRequest_t *request, CNavAreaSearch &search );
+	static void SolveRange( void *context, int begin, int end );
+	CNavAreaSearch &GetThreadSearch( void );
+
+	CUtlVector< CSBotPathRequest_t * > m_queue;				///< oldest first
+	CUtlVector< CSBotPathRequest_t * > m_freeRequests;
+	CUtlVector< CSBotPathRequest_t * > m_solving;			///< this frame's share of the queue
+	unsigned int m_nextSerial;
+
+	CUtlVector< CNavAreaSearch * > m_threadSearches;		///< one per thread that has solved a request
+	CThreadFastMutex m_threadSearchMutex;
+
+	// stats since the last map start
+	int m_solvedCount;
+	int m_droppedCount;
+	int m_maxQueueDepth;
+	int m_maxLatencyTicks;
+	double m_totalLatency;
+	double m_maxLatency;
+	double m_totalSolveTime;
+	double m_maxFrameSolveTime;
+};
+
+extern CCSBotPathQueue TheCSBotPathQueue;
+
+
+#endif // _CS_BOT_PATH_QUEUE_H_
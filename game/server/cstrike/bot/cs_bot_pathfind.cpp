@@ -9,6 +9,7 @@
 
 #include "cbase.h"
 #include "cs_bot.h"
+#include "cs_bot_path_queue.h"
 
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
@@ -1172,7 +1173,7 @@ bool CCSBot::IsNearJump( void ) const
 /**
  * Return approximately how much damage will will take from the given fall height
  */
-float CCSBot::GetApproximateFallDamage( float height ) const
+float CCSBot::GetApproximateFallDamage( float height )
 {
 	// empirically discovered height values
 	const float slope = 0.2178f;
@@ -1403,7 +1404,10 @@ CCSBot::PathResult CCSBot::UpdatePathMovement( bool allowSpeedChange )
 	VPROF_BUDGET( "CCSBot::UpdatePathMovement", VPROF_BUDGETGROUP_NPCS );
 
 	if (m_pathLength == 0)
-		return PATH_FAILURE;
+	{
+		// keep going once our path has been computed
+		return (m_isPathPending) ? PROGRESSING : PATH_FAILURE;
+	}
 
 	if (cv_bot_walk.GetBool())
 		Walk();
@@ -1879,13 +1883,16 @@ bool CCSBot::ComputePath( const Vector &goal, RouteType route )
 	VPROF_BUDGET( "CCSBot::ComputePath", VPROF_BUDGETGROUP_NPCS );
 
 	//
-	// Throttle re-pathing
+	// Throttle re-pathing, unless we are only changing the goal of a path still in the queue
 	//
-	if (!m_repathTimer.IsElapsed())
-		return false;
+	if (!m_isPathPending)
+	{
+		if (!m_repathTimer.IsElapsed())
+			return false;
 
-	// randomize to distribute CPU load
-	m_repathTimer.Start( RandomFloat( 0.4f, 0.6f ) );
+		// randomize to distribute CPU load
+		m_repathTimer.Start( RandomFloat( 0.4f, 0.6f ) );
+	}
 
 
 	DestroyPath();
@@ -1931,6 +1938,24 @@ bool CCSBot::ComputePath( const Vector &goal, RouteType route )
 		return true;
 	}
 
+	if (cv_bot_path_async.GetBool())
+	{
+		//
+		// Have the path computed with the other bots' paths at the start of next frame
+		//
+		CSBotPathCostParams_t cost;
+		cost.route = route;
+		cost.team = GetTeamNumber();
+		cost.aggression = GetProfile()->GetAggression();
+		cost.health = GetHealth();
+		cost.isEscortingHostages = (GetHostageEscortCount() > 0);
+		cost.isAttacking = IsAttacking();
+		cost.isZombie = cv_bot_zombie.GetBool();
+
+		TheCSBotPathQueue.Submit( this, startArea, goalArea, goal, pathEndPosition, cost );
+		return true;
+	}
+
 	//
 	// Compute shortest path to goal
 	//
@@ -1954,6 +1979,27 @@ bool CCSBot::ComputePath( const Vector &goal, RouteType route )
 	if (count > MAX_PATH_LENGTH-1)
 		count = MAX_PATH_LENGTH-1;
 
+	CNavArea *pathArea[ MAX_PATH_LENGTH ];
+	NavTraverseType pathHow[ MAX_PATH_LENGTH ];
+	int i = count;
+	for( area = effectiveGoalArea; i && area; area = area->GetParent() )
+	{
+		--i;
+		pathArea[i] = area;
+		pathHow[i] = area->GetParentHow();
+	}
+
+	return BuildPath( pathArea, pathHow, count, effectiveGoalArea, pathEndPosition );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Build our path through the given areas, the first being the one we start in, and set up to follow it.
+ * The path ends at pathEndPosition in effectiveGoalArea.
+ */
+bool CCSBot::BuildPath( CNavArea * const *area, const NavTraverseType *how, int count, CNavArea *effectiveGoalArea, const Vector &pathEndPosition )
+{
 	if (count == 0)
 		return false;
 
@@ -1965,11 +2011,10 @@ bool CCSBot::ComputePath( const Vector &goal, RouteType route )
 
 	// build path
 	m_pathLength = count;
-	for( area = effectiveGoalArea; count && area; area = area->GetParent() )
+	for( int i=0; i<count; ++i )
 	{
-		--count;
-		m_path[ count ].area = area;
-		m_path[ count ].how = area->GetParentHow();
+		m_path[i].area = area[i];
+		m_path[i].how = how[i];
 	}
 
 	// compute path positions
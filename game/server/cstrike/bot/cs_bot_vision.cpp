@@ -14,6 +14,12 @@
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
 
+ConVar bot_vision_use_nav_visibility( "bot_vision_use_nav_visibility", "1", FCVAR_GAMEDLL | FCVAR_CHEAT, "If nonzero, bots don't trace to players in nav areas the nav mesh visibility data says they can't see." );
+
+static int s_playerVisChecks = 0;		// IsVisible( player ) calls past the FOV test
+static int s_playerVisSkipped = 0;		// ...that the nav mesh visibility data answered
+static int s_playerVisTraces = 0;		// body parts tested for line of sight by the rest
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Used to update view angles to stay on a ladder
@@ -369,12 +375,28 @@ bool CCSBot::IsVisible( CCSPlayer *player, bool testFOV, unsigned char *visParts
 		return false;
 	}
 
+	++s_playerVisChecks;
+
+	// optimization - if the nav mesh knows our areas can't see each other, there is nothing to trace
+	if (bot_vision_use_nav_visibility.GetBool())
+	{
+		CNavArea *myArea = GetVisibilityArea( const_cast<CCSBot *>( this ) );
+		CNavArea *theirArea = GetVisibilityArea( player );
+
+		if (myArea && theirArea && !TheNavMesh->IsPotentiallyVisible( myArea, theirArea ))
+		{
+			++s_playerVisSkipped;
+			return false;
+		}
+	}
+
 	unsigned char testVisParts = NONE;
 
 	// check gut
 	Vector partPos = GetPartPosition( player, GUT );
 
 	// finish gut check
+	++s_playerVisTraces;
 	if (IsVisible( partPos, testFOV ))
 	{
 		if (visParts == NULL)
@@ -386,6 +408,7 @@ bool CCSBot::IsVisible( CCSPlayer *player, bool testFOV, unsigned char *visParts
 
 	// check top of head
 	partPos = GetPartPosition( player, HEAD );
+	++s_playerVisTraces;
 	if (IsVisible( partPos, testFOV ))
 	{
 		if (visParts == NULL)
@@ -396,6 +419,7 @@ bool CCSBot::IsVisible( CCSPlayer *player, bool testFOV, unsigned char *visParts
 
 	// check feet
 	partPos = GetPartPosition( player, FEET );
+	++s_playerVisTraces;
 	if (IsVisible( partPos, testFOV ))
 	{
 		if (visParts == NULL)
@@ -406,6 +430,7 @@ bool CCSBot::IsVisible( CCSPlayer *player, bool testFOV, unsigned char *visParts
 
 	// check "edges"
 	partPos = GetPartPosition( player, LEFT_SIDE );
+	++s_playerVisTraces;
 	if (IsVisible( partPos, testFOV ))
 	{
 		if (visParts == NULL)
@@ -415,6 +440,7 @@ bool CCSBot::IsVisible( CCSPlayer *player, bool testFOV, unsigned char *visParts
 	}
 
 	partPos = GetPartPosition( player, RIGHT_SIDE );
+	++s_playerVisTraces;
 	if (IsVisible( partPos, testFOV ))
 	{
 		if (visParts == NULL)
@@ -433,12 +459,62 @@ bool CCSBot::IsVisible( CCSPlayer *player, bool testFOV, unsigned char *visParts
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+CON_COMMAND_F( bot_vision_stats, "Show how many bot line of sight checks against players were skipped using the nav mesh visibility data. Use 'reset' to clear the counters.", FCVAR_GAMEDLL | FCVAR_CHEAT )
+{
+	if ( !UTIL_IsCommandIssuedByServerAdmin() )
+		return;
+
+	if ( args.ArgC() > 1 && FStrEq( args[1], "reset" ) )
+	{
+		s_playerVisChecks = 0;
+		s_playerVisSkipped = 0;
+		s_playerVisTraces = 0;
+		return;
+	}
+
+	int traced = s_playerVisChecks - s_playerVisSkipped;
+	Msg( "Bot vision: %d player checks, %d skipped by nav visibility (%.1f%%), %d line of sight tests (%.2f per check not skipped)\n",
+		 s_playerVisChecks, s_playerVisSkipped, s_playerVisChecks ? 100.0f * s_playerVisSkipped / s_playerVisChecks : 0.0f,
+		 s_playerVisTraces, traced ? (float)s_playerVisTraces / traced : 0.0f );
+}
+
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Interesting part positions
  */
 CCSBot::PartInfo CCSBot::m_partInfo[ MAX_PLAYERS ];
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return the nav area the player is standing in, if the visibility data of the mesh applies to the
+ * player's view from it. That data was computed from eye height above the areas, so a player in the
+ * air or standing well above the mesh could see more than it says, and gets NULL.
+ */
+CNavArea *CCSBot::GetVisibilityArea( CCSPlayer *player )
+{
+	PartInfo *info = &m_partInfo[ player->entindex() % MAX_PLAYERS ];
+
+	if (gpGlobals->framecount > info->m_visAreaFrame)
+	{
+		info->m_visAreaFrame = gpGlobals->framecount;
+		info->m_visArea = NULL;
+
+		if (player->GetFlags() & FL_ONGROUND)
+		{
+			const Vector &feet = player->GetAbsOrigin();
+			CNavArea *area = TheNavMesh->GetNavArea( feet );
+			if (area && feet.z - area->GetZ( feet ) < StepHeight)
+			{
+				info->m_visArea = area;
+			}
+		}
+	}
+
+	return info->m_visArea;
+}
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Compute part positions from bone location.
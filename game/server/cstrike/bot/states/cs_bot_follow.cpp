@@ -253,7 +253,7 @@ void FollowState::OnUpdate( CCSBot *me )
 
 	// if the leader has stopped, hide nearby
 	const float nearLeaderRange = 250.0f;
-	if (!me->HasPath() && m_leaderMotionState == STOPPED && m_leaderMotionStateTime.GetElapsedTime() > m_waitTime)
+	if (!me->HasPath() && !me->IsPathPending() && m_leaderMotionState == STOPPED && m_leaderMotionStateTime.GetElapsedTime() > m_waitTime)
 	{
 		// throttle how often this check occurs
 		m_waitTime += RandomFloat( 1.0f, 3.0f );
@@ -68,7 +68,7 @@ void InvestigateNoiseState::OnUpdate( CCSBot *me )
 
 
 	// if the pathfind fails, give up
-	if (!me->HasPath())
+	if (!me->HasPath() && !me->IsPathPending())
 	{
 		me->Idle();
 		return;
@@ -17,6 +17,7 @@
 #include "ai_initutils.h"
 #include "globalstate.h"
 #include "datacache/imdlcache.h"
+#include "entitysearchindex.h"
 
 #ifdef HL2_DLL
 #include "npc_playercompanion.h"
@@ -36,6 +37,11 @@ CBaseEntityList *g_pEntityList = &gEntList;
 static CFastEntityLookUp g_FastEntityLookUp;
 CFastEntityLookUp* g_pFastEntityLookUp = &g_FastEntityLookUp;
 
+static CEntitySearchIndex g_EntitySearchIndex;
+
+static ConVar ent_find_index( "ent_find_index", "1", 0, "Use the targetname and classname indexes for entity searches without wildcards. 0 walks the whole entity list." );
+static ConVar ent_find_index_verify( "ent_find_index_verify", "0", FCVAR_CHEAT, "Repeat every indexed entity search with a walk of the entity list and warn if they disagree." );
+
 class CAimTargetManager : public IEntityListener
 {
 public:
@@ -130,11 +136,31 @@ void AimTarget_ForceRepopulateList()
 // NOTE: This is usually a small subset of the global entity list, so it's
 // an optimization to maintain this list incrementally rather than polling each
 // frame.
+//
+// Simulating entities, and thinkers whose think tick has come, are kept in the
+// active list; that is all a frame has to visit. Other thinkers wait in a wheel
+// of lists indexed by think tick and are moved over when the tick count gets
+// to them, so idle entities cost nothing per frame. The active list is kept in
+// the order the entities were added to the manager.
+#define SIMTHINK_WHEEL_BITS		8
+#define SIMTHINK_WHEEL_SLOTS	( 1 << SIMTHINK_WHEEL_BITS )
+#define SIMTHINK_LIST_ACTIVE	SIMTHINK_WHEEL_SLOTS
+#define SIMTHINK_LIST_COUNT		( SIMTHINK_WHEEL_SLOTS + 1 )
+#define SIMTHINK_INVALID		0xFFFF
+
 struct simthinkentry_t
 {
-	unsigned short	entEntry;
+	unsigned short	list;			// wheel slot, SIMTHINK_LIST_ACTIVE, or SIMTHINK_INVALID if not managed
+	unsigned short	next;			// entinfo index of the neighbours in the list
+	unsigned short	prev;
 	unsigned short	unused0;
-	int				nextThinkTick;
+	int				nextThinkTick;	// 0 when simulating
+	unsigned int	order;
+};
+struct simthinkdue_t
+{
+	unsigned int	order;
+	unsigned short	entEntry;
 };
 class CSimThinkManager : public IEntityListener
 {
@@ -145,11 +171,20 @@ public:
 	}
 	void Clear()
 	{
-		m_simThinkList.Purge();
-		for ( int i = 0; i < ARRAYSIZE(m_entinfoIndex); i++ )
+		for ( int i = 0; i < (int)ARRAYSIZE(m_entries); i++ )
+		{
+			m_entries[i].list = SIMTHINK_INVALID;
+		}
+		for ( int i = 0; i < SIMTHINK_LIST_COUNT; i++ )
 		{
-			m_entinfoIndex[i] = 0xFFFF;
+			m_listHead[i] = m_listTail[i] = SIMTHINK_INVALID;
 		}
+		m_due.Purge();
+		m_count = 0;
+		m_activeCount = 0;
+		m_nextOrder = 0;
+		m_lastTick = 0;
+		m_bAdvanced = false;
 	}
 	void LevelInitPreEntity()
 	{
@@ -164,7 +199,7 @@ public:
 
 	void OnEntityCreated( CBaseEntity *pEntity )
 	{
-		Assert( m_entinfoIndex[pEntity->GetRefEHandle().GetEntryIndex()] == 0xFFFF );
+		Assert( m_entries[pEntity->GetRefEHandle().GetEntryIndex()].list == SIMTHINK_INVALID );
 	}
 	void OnEntityDeleted( CBaseEntity *pEntity )
 	{
@@ -173,43 +208,38 @@ public:
 
 	void RemoveEntinfoIndex( int index )
 	{
-		int listHandle = m_entinfoIndex[index];
-		// If this guy is in the active list, remove him
-		if ( listHandle != 0xFFFF )
+		// If this guy is managed, remove him
+		if ( m_entries[index].list != SIMTHINK_INVALID )
 		{
-			Assert(m_simThinkList[listHandle].entEntry == index);
-			m_simThinkList.FastRemove( listHandle );
-			m_entinfoIndex[index] = 0xFFFF;
-			
-			// fast remove shifted someone, update that someone
-			if ( listHandle < m_simThinkList.Count() )
-			{
-				m_entinfoIndex[m_simThinkList[listHandle].entEntry] = listHandle;
-			}
+			Unlink( index );
+			m_count--;
 		}
 	}
+
+	// number of entities that will simulate or think this frame
 	int ListCount()
 	{
-		return m_simThinkList.Count();
+		Advance( gpGlobals->tickcount );
+		return m_activeCount;
+	}
+
+	int TotalCount()
+	{
+		return m_count;
 	}
 
 	int ListCopy( CBaseEntity *pList[], int listMax )
 	{
-		int count = MIN(listMax, ListCount());
+		Advance( gpGlobals->tickcount );
+
 		int out = 0;
-		for ( int i = 0; i < count; i++ )
+		for ( int index = m_listHead[SIMTHINK_LIST_ACTIVE]; index != SIMTHINK_INVALID && out < listMax; index = m_entries[index].next )
 		{
-			// only copy out entities that will simulate or think this frame
-			if ( m_simThinkList[i].nextThinkTick <= gpGlobals->tickcount )
-			{
-				Assert(m_simThinkList[i].nextThinkTick>=0);
-				int entinfoIndex = m_simThinkList[i].entEntry;
-				const CEntInfo *pInfo = gEntList.GetEntInfoPtrByIndex( entinfoIndex );
-				pList[out] = (CBaseEntity *)pInfo->m_pEntity;
-				Assert(m_simThinkList[i].nextThinkTick==0 || pList[out]->GetFirstThinkTick()==m_simThinkList[i].nextThinkTick);
-				Assert( gEntList.IsEntityPtr( pList[out] ) );
-				out++;
-			}
+			const CEntInfo *pInfo = gEntList.GetEntInfoPtrByIndex( index );
+			pList[out] = (CBaseEntity *)pInfo->m_pEntity;
+			Assert( m_entries[index].nextThinkTick==0 || pList[out]->GetFirstThinkTick()==m_entries[index].nextThinkTick );
+			Assert( gEntList.IsEntityPtr( pList[out] ) );
+			out++;
 		}
 
 		return out;
@@ -232,38 +262,192 @@ public:
 		}
 		else
 		{
-			// already in the list? (had think or sim last time, now has both - or had both last time, now just one)
-			if ( m_entinfoIndex[index] == 0xFFFF )
+			// if no sim, wait for the think time
+			int nextThinkTick = 0;
+			if ( pEntity->IsEFlagSet(EFL_NO_GAME_PHYSICS_SIMULATION) )
 			{
-				MEM_ALLOC_CREDIT();
-				m_entinfoIndex[index] = m_simThinkList.AddToTail();
-				m_simThinkList[m_entinfoIndex[index]].entEntry = (unsigned short)index;
-				m_simThinkList[m_entinfoIndex[index]].nextThinkTick = 0;
-				if ( pEntity->IsEFlagSet(EFL_NO_GAME_PHYSICS_SIMULATION) )
-				{
-					m_simThinkList[m_entinfoIndex[index]].nextThinkTick = pEntity->GetFirstThinkTick();
-					Assert(m_simThinkList[m_entinfoIndex[index]].nextThinkTick>=0);
-				}
+				nextThinkTick = pEntity->GetFirstThinkTick();
+				Assert(nextThinkTick>=0);
 			}
-			else
+
+			// new to the list? (had think or sim last time, now has both - or had both last time, now just one)
+			if ( m_entries[index].list == SIMTHINK_INVALID )
 			{
-				// updating existing entry - if no sim, reset think time
-				if ( pEntity->IsEFlagSet(EFL_NO_GAME_PHYSICS_SIMULATION) )
-				{
-					m_simThinkList[m_entinfoIndex[index]].nextThinkTick = pEntity->GetFirstThinkTick();
-					Assert(m_simThinkList[m_entinfoIndex[index]].nextThinkTick>=0);
-				}
-				else
-				{
-					m_simThinkList[m_entinfoIndex[index]].nextThinkTick = 0;
-				}
+				m_entries[index].order = m_nextOrder++;
+				m_count++;
 			}
+			Schedule( index, nextThinkTick );
 		}
 	}
 
 private:
-	unsigned short m_entinfoIndex[NUM_ENT_ENTRIES];
-	CUtlVector<simthinkentry_t>	m_simThinkList;
+	void Schedule( int index, int nextThinkTick )
+	{
+		simthinkentry_t &entry = m_entries[index];
+		entry.nextThinkTick = nextThinkTick;
+
+		// anything due by the last tick the wheel got to runs from the next frame on
+		int list = ( m_bAdvanced && nextThinkTick <= m_lastTick ) ? SIMTHINK_LIST_ACTIVE : ( nextThinkTick & ( SIMTHINK_WHEEL_SLOTS - 1 ) );
+		if ( entry.list == list )
+			return;
+
+		if ( entry.list != SIMTHINK_INVALID )
+		{
+			Unlink( index );
+		}
+
+		if ( list == SIMTHINK_LIST_ACTIVE )
+		{
+			// usually the newest entity, search from the back
+			int after = m_listTail[SIMTHINK_LIST_ACTIVE];
+			while ( after != SIMTHINK_INVALID && m_entries[after].order > entry.order )
+			{
+				after = m_entries[after].prev;
+			}
+			LinkAfter( index, list, after );
+		}
+		else
+		{
+			LinkAfter( index, list, SIMTHINK_INVALID );
+		}
+	}
+
+	void LinkAfter( int index, int list, int after )
+	{
+		simthinkentry_t &entry = m_entries[index];
+		entry.list = list;
+		entry.prev = after;
+		entry.next = ( after != SIMTHINK_INVALID ) ? m_entries[after].next : m_listHead[list];
+		if ( entry.next != SIMTHINK_INVALID )
+		{
+			m_entries[entry.next].prev = index;
+		}
+		else
+		{
+			m_listTail[list] = index;
+		}
+		if ( after != SIMTHINK_INVALID )
+		{
+			m_entries[after].next = index;
+		}
+		else
+		{
+			m_listHead[list] = index;
+		}
+
+		if ( list == SIMTHINK_LIST_ACTIVE )
+		{
+			m_activeCount++;
+		}
+	}
+
+	void Unlink( int index )
+	{
+		simthinkentry_t &entry = m_entries[index];
+		int list = entry.list;
+		if ( entry.prev != SIMTHINK_INVALID )
+		{
+			m_entries[entry.prev].next = entry.next;
+		}
+		else
+		{
+			m_listHead[list] = entry.next;
+		}
+		if ( entry.next != SIMTHINK_INVALID )
+		{
+			m_entries[entry.next].prev = entry.prev;
+		}
+		else
+		{
+			m_listTail[list] = entry.prev;
+		}
+
+		if ( list == SIMTHINK_LIST_ACTIVE )
+		{
+			m_activeCount--;
+		}
+		entry.list = SIMTHINK_INVALID;
+	}
+
+	// takes the entities due by tick out of a wheel slot
+	void CollectDue( int slot, int tick )
+	{
+		int index = m_listHead[slot];
+		while ( index != SIMTHINK_INVALID )
+		{
+			int next = m_entries[index].next;
+			if ( m_entries[index].nextThinkTick <= tick )
+			{
+				Unlink( index );
+				simthinkdue_t &due = m_due[m_due.AddToTail()];
+				due.order = m_entries[index].order;
+				due.entEntry = (unsigned short)index;
+			}
+			index = next;
+		}
+	}
+
+	static int __cdecl DueOrder( const simthinkdue_t *a, const simthinkdue_t *b )
+	{
+		if ( a->order != b->order )
+			return ( a->order < b->order ) ? -1 : 1;
+		return 0;
+	}
+
+	// moves everything due by tick to the active list
+	void Advance( int tick )
+	{
+		if ( m_bAdvanced && tick == m_lastTick )
+			return;
+
+		m_due.RemoveAll();
+		if ( !m_bAdvanced || tick < m_lastTick || tick - m_lastTick >= SIMTHINK_WHEEL_SLOTS )
+		{
+			for ( int slot = 0; slot < SIMTHINK_WHEEL_SLOTS; slot++ )
+			{
+				CollectDue( slot, tick );
+			}
+		}
+		else
+		{
+			for ( int t = m_lastTick + 1; t <= tick; t++ )
+			{
+				CollectDue( t & ( SIMTHINK_WHEEL_SLOTS - 1 ), tick );
+			}
+		}
+		m_lastTick = tick;
+		m_bAdvanced = true;
+
+		if ( !m_due.Count() )
+			return;
+
+		// merge them into the active list, both sorted by order
+		MEM_ALLOC_CREDIT();
+		m_due.Sort( DueOrder );
+
+		int after = SIMTHINK_INVALID;
+		int cur = m_listHead[SIMTHINK_LIST_ACTIVE];
+		for ( int i = 0; i < m_due.Count(); i++ )
+		{
+			while ( cur != SIMTHINK_INVALID && m_entries[cur].order < m_due[i].order )
+			{
+				after = cur;
+				cur = m_entries[cur].next;
+			}
+			LinkAfter( m_due[i].entEntry, SIMTHINK_LIST_ACTIVE, after );
+			after = m_due[i].entEntry;
+		}
+	}
+
+	simthinkentry_t				m_entries[NUM_ENT_ENTRIES];
+	unsigned short				m_listHead[SIMTHINK_LIST_COUNT];
+	unsigned short				m_listTail[SIMTHINK_LIST_COUNT];
+	CUtlVector<simthinkdue_t>	m_due;
+	int							m_count;
+	int							m_activeCount;
+	unsigned int				m_nextOrder;
+	int							m_lastTick;		// the wheel has moved everything due by this tick to the active list
+	bool						m_bAdvanced;
 };
 
 CSimThinkManager g_SimThinkManager;
@@ -385,9 +569,20 @@ void CGlobalEntityList::Clear( void )
 	m_iHighestEnt = 0;
 	m_iNumEnts = 0;
 
+	g_EntitySearchIndex.FreeBuckets();
+
 	m_bClearingEntities = false;
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Refiles an entity in the search indexes after its targetname or
+//			classname may have changed.
+//-----------------------------------------------------------------------------
+void CGlobalEntityList::UpdateEntitySearchIndex( CBaseEntity *pEntity )
+{
+	g_EntitySearchIndex.Update( pEntity );
+}
+
 
 int CGlobalEntityList::NumberOfEntities( void )
 {
@@ -483,6 +678,33 @@ bool CGlobalEntityList::IsEntityPtr( void *pTest )
 //			szName - Classname to search for.
 //-----------------------------------------------------------------------------
 CBaseEntity *CGlobalEntityList::FindEntityByClassname( CBaseEntity *pStartEntity, const char *szName )
+{
+	if ( ent_find_index.GetBool() && CEntitySearchIndex::IsIndexable( szName ) )
+	{
+		CBaseEntity *pFound = NULL;
+
+		const CEntitySearchIndex::Entry_t *pEntries;
+		int nEntries = g_EntitySearchIndex.Find( CEntitySearchIndex::SEARCH_CLASSNAME, szName, pStartEntity, &pEntries );
+		for ( int i = 0; i < nEntries; i++ )
+		{
+			if ( pEntries[i].m_pEntity->ClassMatches( szName ) )
+			{
+				pFound = pEntries[i].m_pEntity;
+				break;
+			}
+		}
+
+		if ( ent_find_index_verify.GetBool() )
+		{
+			VerifyIndexedSearch( "FindEntityByClassname", szName, pFound, FindEntityByClassnameLinear( pStartEntity, szName ) );
+		}
+		return pFound;
+	}
+
+	return FindEntityByClassnameLinear( pStartEntity, szName );
+}
+
+CBaseEntity *CGlobalEntityList::FindEntityByClassnameLinear( CBaseEntity *pStartEntity, const char *szName )
 {
 	const CEntInfo *pInfo = pStartEntity ? GetEntInfoPtr( pStartEntity->GetRefEHandle() )->m_pNext : FirstEntInfo();
 
@@ -593,7 +815,35 @@ CBaseEntity *CGlobalEntityList::FindEntityByName( CBaseEntity *pStartEntity, con
 
 		return NULL;
 	}
-	
+
+	if ( ent_find_index.GetBool() && CEntitySearchIndex::IsIndexable( szName ) )
+	{
+		CBaseEntity *pFound = NULL;
+
+		const CEntitySearchIndex::Entry_t *pEntries;
+		int nEntries = g_EntitySearchIndex.Find( CEntitySearchIndex::SEARCH_NAME, szName, pStartEntity, &pEntries );
+		for ( int i = 0; i < nEntries; i++ )
+		{
+			CBaseEntity *ent = pEntries[i].m_pEntity;
+			if ( ent->NameMatches( szName ) && ( !pFilter || pFilter->ShouldFindEntity( ent ) ) )
+			{
+				pFound = ent;
+				break;
+			}
+		}
+
+		if ( ent_find_index_verify.GetBool() )
+		{
+			VerifyIndexedSearch( "FindEntityByName", szName, pFound, FindEntityByNameLinear( pStartEntity, szName, pFilter ) );
+		}
+		return pFound;
+	}
+
+	return FindEntityByNameLinear( pStartEntity, szName, pFilter );
+}
+
+CBaseEntity *CGlobalEntityList::FindEntityByNameLinear( CBaseEntity *pStartEntity, const char *szName, IEntityFindFilter *pFilter )
+{
 	const CEntInfo *pInfo = pStartEntity ? GetEntInfoPtr( pStartEntity->GetRefEHandle() )->m_pNext : FirstEntInfo();
 
 	for ( ;pInfo; pInfo = pInfo->m_pNext )
@@ -620,6 +870,16 @@ CBaseEntity *CGlobalEntityList::FindEntityByName( CBaseEntity *pStartEntity, con
 	return NULL;
 }
 
+void CGlobalEntityList::VerifyIndexedSearch( const char *pszSearch, const char *szName, CBaseEntity *pIndexed, CBaseEntity *pLinear )
+{
+	if ( pIndexed == pLinear )
+		return;
+
+	Warning( "%s( \"%s\" ): index found %s (%d), entity list walk found %s (%d)\n", pszSearch, szName,
+		pIndexed ? pIndexed->GetDebugName() : "nothing", pIndexed ? pIndexed->entindex() : -1,
+		pLinear ? pLinear->GetDebugName() : "nothing", pLinear ? pLinear->entindex() : -1 );
+}
+
 //-----------------------------------------------------------------------------
 // Purpose: 
 // Input  : pStartEntity - 
@@ -1095,6 +1355,8 @@ void CGlobalEntityList::OnAddEntity( IHandleEntity *pEnt, CBaseHandle handle )
 	CBaseEntity *pBaseEnt = static_cast<IServerUnknown*>(pEnt)->GetBaseEntity();
 	if ( pBaseEnt->edict() )
 		m_iNumEdicts++;
+
+	g_EntitySearchIndex.OnAddEntity( pBaseEnt, handle.GetEntryIndex() );
 	
 	// NOTE: Must be a CBaseEntity on server
 	Assert( pBaseEnt );
@@ -1128,6 +1390,8 @@ void CGlobalEntityList::OnRemoveEntity( IHandleEntity *pEnt, CBaseHandle handle
 	if ( pBaseEnt->edict() )
 		m_iNumEdicts--;
 
+	g_EntitySearchIndex.OnRemoveEntity( handle.GetEntryIndex() );
+
 	m_iNumEnts--;
 }
 
@@ -1635,6 +1899,7 @@ CON_COMMAND(report_simthinklist, "Lists all simulating/thinking entities")
 		list.AddEntityToList( pTmp[i] );
 	}
 	list.ReportEntityList();
+	Msg( "%d of %d simulating/thinking entities run this tick\n", count, g_SimThinkManager.TotalCount() );
 }
 
 CFastEntityLookUp::CFastEntityLookUp()
@@ -159,6 +159,11 @@ public:
 	CBaseEntity *FindEntityByNetname( CBaseEntity *pStartEntity, const char *szModelName );
 
 	CBaseEntity *FindEntityProcedural( const char *szName, CBaseEntity *pSearchingEntity = NULL, CBaseEntity *pActivator = NULL, CBaseEntity *pCaller = NULL );
+
+	// FindEntityByName/FindEntityByClassname look names without wildcards up in an
+	// index. Call this when an entity's targetname or classname was changed without
+	// going through SetName()/SetClassname()/KeyValue().
+	void UpdateEntitySearchIndex( CBaseEntity *pEntity );
 	
 	CGlobalEntityList();
 
@@ -168,6 +173,10 @@ protected:
 	virtual void OnAddEntity( IHandleEntity *pEnt, CBaseHandle handle );
 	virtual void OnRemoveEntity( IHandleEntity *pEnt, CBaseHandle handle );
 
+private:
+	CBaseEntity *FindEntityByClassnameLinear( CBaseEntity *pStartEntity, const char *szName );
+	CBaseEntity *FindEntityByNameLinear( CBaseEntity *pStartEntity, const char *szName, IEntityFindFilter *pFilter );
+	void VerifyIndexedSearch( const char *pszSearch, const char *szName, CBaseEntity *pIndexed, CBaseEntity *pLinear );
 };
 
 extern CGlobalEntityList gEntList;
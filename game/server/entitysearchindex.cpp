@@ -0,0 +1,188 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Targetname and classname indexes for the global entity list
+//
+//=============================================================================//
+
+#include "cbase.h"
+#include "entitysearchindex.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+CEntitySearchIndex::CEntitySearchIndex()
+{
+	memset( m_Filed, 0, sizeof( m_Filed ) );
+	memset( m_nIndexed, 0, sizeof( m_nIndexed ) );
+	m_nNextOrder = 0;
+}
+
+bool CEntitySearchIndex::IsIndexable( const char *pszQuery )
+{
+	// "!" names are resolved procedurally and "*" matches any suffix
+	return pszQuery && pszQuery[0] && pszQuery[0] != '!' && !strchr( pszQuery, '*' );
+}
+
+unsigned int CEntitySearchIndex::HashName( const char *pszName )
+{
+	// ascii folded to lower case like NamesMatch(), the same hash the string pool stores
+	return HashPooledStringCaseless( pszName );
+}
+
+string_t CEntitySearchIndex::GetKey( CBaseEntity *pEntity, SearchKey_t key ) const
+{
+	return ( key == SEARCH_NAME ) ? pEntity->GetEntityName() : pEntity->m_iClassname;
+}
+
+int CEntitySearchIndex::LowerBound( const CUtlVector< Entry_t > &entries, unsigned int nOrder )
+{
+	int nLow = 0;
+	int nHigh = entries.Count();
+	while ( nLow < nHigh )
+	{
+		int nMid = ( nLow + nHigh ) / 2;
+		if ( entries[nMid].m_nOrder < nOrder )
+		{
+			nLow = nMid + 1;
+		}
+		else
+		{
+			nHigh = nMid;
+		}
+	}
+	return nLow;
+}
+
+void CEntitySearchIndex::Insert( SearchKey_t key, int iEntry, CBaseEntity *pEntity )
+{
+	Filed_t &filed = m_Filed[iEntry];
+	Assert( filed.m_iKey[key] == NULL_STRING );
+
+	string_t iKey = GetKey( pEntity, key );
+	if ( iKey == NULL_STRING || !STRING( iKey )[0] )
+		return;
+
+	// Names and classnames are pooled, their hash was taken when they were
+	unsigned int nHash = GetPooledStringCaselessHash( iKey );
+
+	UtlHashHandle_t hBucket = m_Buckets[key].Find( nHash );
+	if ( hBucket == m_Buckets[key].InvalidHandle() )
+	{
+		hBucket = m_Buckets[key].Insert( nHash, m_Entries[key].AddToTail() );
+	}
+	CUtlVector< Entry_t > &entries = m_Entries[key][ m_Buckets[key].Element( hBucket ) ];
+
+	Entry_t entry;
+	entry.m_nOrder = filed.m_nOrder;
+	entry.m_pEntity = pEntity;
+
+	// Entities are mostly named as they're created, so they go on the end
+	if ( !entries.Count() || entries.Tail().m_nOrder < entry.m_nOrder )
+	{
+		entries.AddToTail( entry );
+	}
+	else
+	{
+		entries.InsertBefore( LowerBound( entries, entry.m_nOrder ), entry );
+	}
+
+	filed.m_iKey[key] = iKey;
+	filed.m_nHash[key] = nHash;
+	m_nIndexed[key]++;
+}
+
+void CEntitySearchIndex::Remove( SearchKey_t key, int iEntry )
+{
+	Filed_t &filed = m_Filed[iEntry];
+	if ( filed.m_iKey[key] == NULL_STRING )
+		return;
+
+	UtlHashHandle_t hBucket = m_Buckets[key].Find( filed.m_nHash[key] );
+	Assert( hBucket != m_Buckets[key].InvalidHandle() );
+	if ( hBucket != m_Buckets[key].InvalidHandle() )
+	{
+		CUtlVector< Entry_t > &entries = m_Entries[key][ m_Buckets[key].Element( hBucket ) ];
+		int i = LowerBound( entries, filed.m_nOrder );
+		Assert( i < entries.Count() && entries[i].m_nOrder == filed.m_nOrder );
+		if ( i < entries.Count() && entries[i].m_nOrder == filed.m_nOrder )
+		{
+			entries.Remove( i );
+		}
+	}
+
+	filed.m_iKey[key] = NULL_STRING;
+	m_nIndexed[key]--;
+}
+
+void CEntitySearchIndex::OnAddEntity( CBaseEntity *pEntity, int iEntry )
+{
+	Filed_t &filed = m_Filed[iEntry];
+	filed.m_nOrder = m_nNextOrder++;
+
+	for ( int key = 0; key < SEARCH_KEY_COUNT; key++ )
+	{
+		filed.m_iKey[key] = NULL_STRING;
+		Insert( (SearchKey_t)key, iEntry, pEntity );
+	}
+}
+
+void CEntitySearchIndex::OnRemoveEntity( int iEntry )
+{
+	for ( int key = 0; key < SEARCH_KEY_COUNT; key++ )
+	{
+		Remove( (SearchKey_t)key, iEntry );
+	}
+}
+
+void CEntitySearchIndex::Update( CBaseEntity *pEntity )
+{
+	const CBaseHandle &handle = pEntity->GetRefEHandle();
+	if ( !handle.IsValid() )
+		return;
+
+	int iEntry = handle.GetEntryIndex();
+	for ( int key = 0; key < SEARCH_KEY_COUNT; key++ )
+	{
+		string_t iKey = GetKey( pEntity, (SearchKey_t)key );
+		if ( IDENT_STRINGS( iKey, m_Filed[iEntry].m_iKey[key] ) )
+			continue;
+
+		Remove( (SearchKey_t)key, iEntry );
+		Insert( (SearchKey_t)key, iEntry, pEntity );
+	}
+}
+
+void CEntitySearchIndex::FreeBuckets()
+{
+	for ( int key = 0; key < SEARCH_KEY_COUNT; key++ )
+	{
+		if ( m_nIndexed[key] )
+			return;
+	}
+
+	for ( int key = 0; key < SEARCH_KEY_COUNT; key++ )
+	{
+		m_Buckets[key].Purge();
+		m_Entries[key].Purge();
+	}
+}
+
+int CEntitySearchIndex::Find( SearchKey_t key, const char *pszQuery, CBaseEntity *pStartEntity, const Entry_t **ppEntries ) const
+{
+	Assert( IsIndexable( pszQuery ) );
+
+	UtlHashHandle_t hBucket = m_Buckets[key].Find( HashName( pszQuery ) );
+	if ( hBucket == m_Buckets[key].InvalidHandle() )
+		return 0;
+
+	const CUtlVector< Entry_t > &entries = m_Entries[key][ m_Buckets[key].Element( hBucket ) ];
+
+	int iFirst = 0;
+	if ( pStartEntity )
+	{
+		iFirst = LowerBound( entries, m_Filed[ pStartEntity->GetRefEHandle().GetEntryIndex() ].m_nOrder + 1 );
+	}
+
+	*ppEntries = entries.Base() + iFirst;
+	return entries.Count() - iFirst;
+}
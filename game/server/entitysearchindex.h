@@ -0,0 +1,87 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Targetname and classname indexes for the global entity list.
+//
+// Every entity in the list is filed under the hash of its name and of its
+// classname, folded to lower case the way CBaseEntity::NameMatches() and
+// ClassMatches() compare. Both are pooled strings, so filing an entity reads
+// the hash the game string pool stored instead of hashing the name again. A bucket holds its entities in entity list order,
+// so searches that continue from a start entity return the same entity the
+// linear walk would. Hashes can collide, callers still check the match.
+//
+// Queries with wildcards, and procedural names, aren't indexed; the entity
+// list falls back to walking every entity for those.
+//
+//=============================================================================//
+
+#ifndef ENTITYSEARCHINDEX_H
+#define ENTITYSEARCHINDEX_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "utlvector.h"
+#include "utlhashtable.h"
+
+class CBaseEntity;
+
+class CEntitySearchIndex
+{
+public:
+	enum SearchKey_t
+	{
+		SEARCH_NAME,
+		SEARCH_CLASSNAME,
+
+		SEARCH_KEY_COUNT
+	};
+
+	struct Entry_t
+	{
+		unsigned int	m_nOrder;	// position in the entity list
+		CBaseEntity		*m_pEntity;
+	};
+
+	CEntitySearchIndex();
+
+	// Can Find() answer this query?
+	static bool IsIndexable( const char *pszQuery );
+	static unsigned int HashName( const char *pszName );
+
+	void OnAddEntity( CBaseEntity *pEntity, int iEntry );
+	void OnRemoveEntity( int iEntry );
+
+	// Refiles the entity if its name or classname changed since it was indexed
+	void Update( CBaseEntity *pEntity );
+
+	// Frees the (by then empty) buckets of the last level, once no entity is left
+	void FreeBuckets();
+
+	// Entities filed under the query's hash, in entity list order, starting
+	// after pStartEntity. Returns the number of entries in *ppEntries.
+	int Find( SearchKey_t key, const char *pszQuery, CBaseEntity *pStartEntity, const Entry_t **ppEntries ) const;
+
+	int Count( SearchKey_t key ) const		{ return m_nIndexed[key]; }
+	int BucketCount( SearchKey_t key ) const	{ return m_Entries[key].Count(); }
+
+private:
+	struct Filed_t
+	{
+		unsigned int	m_nOrder;
+		string_t		m_iKey[SEARCH_KEY_COUNT];
+		unsigned int	m_nHash[SEARCH_KEY_COUNT];
+	};
+
+	string_t GetKey( CBaseEntity *pEntity, SearchKey_t key ) const;
+	void Insert( SearchKey_t key, int iEntry, CBaseEntity *pEntity );
+	void Remove( SearchKey_t key, int iEntry );
+	static int LowerBound( const CUtlVector< Entry_t > &entries, unsigned int nOrder );
+
+	Filed_t									m_Filed[NUM_ENT_ENTRIES];	// by entity list entry
+	CUtlHashtable< unsigned int, int >		m_Buckets[SEARCH_KEY_COUNT];	// hash -> m_Entries index
+	CUtlVector< CUtlVector< Entry_t > >		m_Entries[SEARCH_KEY_COUNT];
+	int										m_nIndexed[SEARCH_KEY_COUNT];
+	unsigned int							m_nNextOrder;
+};
+
+#endif // ENTITYSEARCHINDEX_H
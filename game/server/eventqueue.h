@@ -6,6 +6,15 @@
 //
 //			The queue is serviced once per server frame.
 //
+//			Pending events are kept in a hierarchical timer wheel keyed by the
+//			tick they fire in: one slot per tick for the next EVENTQUEUE_WHEEL0_SLOTS
+//			ticks, one slot per EVENTQUEUE_WHEEL0_SLOTS ticks after that, and an
+//			unsorted overflow list for anything further out. Slots of the first
+//			wheel are sorted by fire time, then by the order the events were
+//			added in, so events fire in exactly the order a single time sorted
+//			list would give. Events are also chained by caller and by target
+//			entity so cancelling them doesn't have to look at the whole queue.
+//
 //=============================================================================//
 
 #ifndef EVENTQUEUE_H
@@ -15,6 +24,21 @@
 #endif
 
 #include "mempool.h"
+#include "utlhashtable.h"
+
+#define EVENTQUEUE_WHEEL0_BITS	8
+#define EVENTQUEUE_WHEEL0_SLOTS	( 1 << EVENTQUEUE_WHEEL0_BITS )
+#define EVENTQUEUE_WHEEL1_BITS	6
+#define EVENTQUEUE_WHEEL1_SLOTS	( 1 << EVENTQUEUE_WHEEL1_BITS )
+#define EVENTQUEUE_WHEEL_TICKS	( EVENTQUEUE_WHEEL0_SLOTS * EVENTQUEUE_WHEEL1_SLOTS )
+
+struct EventQueuePrioritizedEvent_t;
+
+struct EventQueueList_t
+{
+	EventQueuePrioritizedEvent_t *m_pHead;
+	EventQueuePrioritizedEvent_t *m_pTail;
+};
 
 struct EventQueuePrioritizedEvent_t
 {
@@ -28,9 +52,19 @@ struct EventQueuePrioritizedEvent_t
 
 	variant_t m_VariantValue;	// variable-type parameter
 
+	// Not saved, rebuilt when the event is added
+	int m_nTick;				// tick m_flFireTime falls in
+	unsigned int m_nSequence;	// breaks fire time ties, lower was added first
+	EventQueueList_t *m_pList;	// wheel slot or overflow list holding the event
 	EventQueuePrioritizedEvent_t *m_pNext;
 	EventQueuePrioritizedEvent_t *m_pPrev;
 
+	// Chains of events with the same caller / target entity
+	EventQueuePrioritizedEvent_t *m_pNextByCaller;
+	EventQueuePrioritizedEvent_t *m_pPrevByCaller;
+	EventQueuePrioritizedEvent_t *m_pNextByTarget;
+	EventQueuePrioritizedEvent_t *m_pPrevByTarget;
+
 	DECLARE_SIMPLE_DATADESC();
 
 	DECLARE_FIXEDSIZE_ALLOCATOR( PrioritizedEvent_t );
@@ -54,6 +88,7 @@ public:
 
 	// debugging
 	void ValidateQueue( void );
+	int Count( void ) const { return m_nEvents; }
 
 	// serialization
 	int Save( ISave &save );
@@ -72,8 +107,38 @@ private:
 	void AddEvent( EventQueuePrioritizedEvent_t *event );
 	void RemoveEvent( EventQueuePrioritizedEvent_t *pe );
 
+	// Files an event in the wheel slot or list for its tick
+	void InsertEvent( EventQueuePrioritizedEvent_t *pe );
+	void UnlinkEvent( EventQueuePrioritizedEvent_t *pe );
+
+	// Moves the wheel up to the given tick; afterwards every event due by
+	// then is in the current slot
+	void AdvanceTo( int nTick );
+	void Cascade( EventQueueList_t *pList );
+
+	void LinkIndex( EventQueuePrioritizedEvent_t *pe );
+	void UnlinkIndex( EventQueuePrioritizedEvent_t *pe );
+
+	// All events in firing order
+	void GetSortedEvents( CUtlVector< EventQueuePrioritizedEvent_t * > &events );
+
+	static float GetQueueTime( void );
+	static int TimeToQueueTick( float flTime );
+
+	EventQueueList_t *CurrentSlot( void ) { return &m_Wheel0[ m_nBaseTick & ( EVENTQUEUE_WHEEL0_SLOTS - 1 ) ]; }
+
 	DECLARE_SIMPLE_DATADESC();
-	EventQueuePrioritizedEvent_t m_Events;
+
+	EventQueueList_t m_Wheel0[ EVENTQUEUE_WHEEL0_SLOTS ];	// by tick
+	EventQueueList_t m_Wheel1[ EVENTQUEUE_WHEEL1_SLOTS ];	// by EVENTQUEUE_WHEEL0_SLOTS ticks
+	EventQueueList_t m_Overflow;
+	int m_nBaseTick;			// tick of the current slot, nothing is queued before it
+	int m_nEvents;
+	unsigned int m_nNextSequence;
+
+	CUtlHashtable< int, EventQueuePrioritizedEvent_t * > m_ByCaller;	// EHANDLE index -> first event
+	CUtlHashtable< int, EventQueuePrioritizedEvent_t * > m_ByTarget;
+
 	int m_iListCount;
 };
 
@@ -81,4 +146,3 @@ extern CEventQueue g_EventQueue;
 
 
 #endif // EVENTQUEUE_H
-
@@ -1743,6 +1743,8 @@ bool CNavArea::MergeEdit( CNavArea *adj )
 	if (m_seCorner.x < adj->m_seCorner.x || m_seCorner.y < adj->m_seCorner.y)
 		m_seCorner = adj->m_seCorner;
 
+	TheNavMesh->InvalidateAreaIndex();
+
 	m_center.x = (m_nwCorner.x + m_seCorner.x)/2.0f;
 	m_center.y = (m_nwCorner.y + m_seCorner.y)/2.0f;
 	m_center.z = (m_nwCorner.z + m_seCorner.z)/2.0f;
@@ -3590,6 +3592,8 @@ void CNavArea::SetCorner( NavCornerType corner, const Vector& newPosition )
 		}
 	}
 
+	TheNavMesh->InvalidateAreaIndex();
+
 	m_center.x = (m_nwCorner.x + m_seCorner.x)/2.0f;
 	m_center.y = (m_nwCorner.y + m_seCorner.y)/2.0f;
 	m_center.z = (m_nwCorner.z + m_seCorner.z)/2.0f;
@@ -4179,6 +4183,20 @@ float CNavArea::GetDanger( int teamID )
 	return m_danger[ teamIdx ];
 }
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return the danger of this area as GetDanger() would, leaving the area untouched
+ */
+float CNavArea::PeekDanger( int teamID ) const
+{
+	int teamIdx = teamID % MAX_NAV_TEAMS;
+
+	float deltaT = gpGlobals->curtime - m_dangerTimestamp[ teamIdx ];
+	float danger = m_danger[ teamIdx ] - GetDangerDecayRate() * deltaT;
+
+	return ( danger < 0.0f ) ? 0.0f : danger;
+}
+
 
 //--------------------------------------------------------------------------------------------------------------
 /**
@@ -4561,6 +4579,8 @@ void CNavArea::Shift( const Vector &shift )
 	m_seCorner += shift;
 	
 	m_center += shift;
+
+	TheNavMesh->InvalidateAreaIndex();
 }
 
 
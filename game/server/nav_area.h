@@ -47,6 +47,26 @@ typedef CNavVectorNoEditAllocator CNavVectorAllocator;
 #endif
 
 
+//-------------------------------------------------------------------------------------------------------------------
+/**
+ * Search state of an area in a CNavAreaSearch (see nav_search.h).
+ * While a search is bound to the calling thread, the area's search accessors
+ * (GetCostSoFar(), GetParent(), etc) return the state kept here instead of the area's own.
+ */
+struct NavAreaSearchState_t
+{
+	unsigned int m_generation;							// search this state belongs to
+	int m_heapIndex;									// position on the open list, or a NAV_SEARCH_* value
+	float m_totalCost;
+	float m_costSoFar;
+	float m_pathLengthSoFar;
+	CNavArea *m_parent;
+	NavTraverseType m_parentHow;
+};
+
+const NavAreaSearchState_t *NavAreaSearchBoundState( unsigned int areaID );	// NULL unless the thread's bound search reached the area
+
+
 //-------------------------------------------------------------------------------------------------------------------
 /**
  * Functor interface for iteration
@@ -395,6 +415,7 @@ public:
 	//- "danger" ----------------------------------------------------------------------------------------
 	void IncreaseDanger( int teamID, float amount );			// increase the danger of this area for the given team
 	float GetDanger( int teamID );								// return the danger of this area (decays over time)
+	float PeekDanger( int teamID ) const;						// return the decayed danger of this area without storing the decay, safe to call from any thread
 	virtual float GetDangerDecayRate( void ) const;				// return danger decay rate per second
 
 	//- extents -----------------------------------------------------------------------------------------
@@ -428,8 +449,8 @@ public:
 	BOOL IsMarked( void ) const			{ return (m_marker == m_masterMarker) ? true : false; }
 	
 	void SetParent( CNavArea *parent, NavTraverseType how = NUM_TRAVERSE_TYPES )	{ m_parent = parent; m_parentHow = how; }
-	CNavArea *GetParent( void ) const	{ return m_parent; }
-	NavTraverseType GetParentHow( void ) const	{ return m_parentHow; }
+	CNavArea *GetParent( void ) const	{ const NavAreaSearchState_t *state = NavAreaSearchBoundState( m_id ); return state ? state->m_parent : m_parent; }
+	NavTraverseType GetParentHow( void ) const	{ const NavAreaSearchState_t *state = NavAreaSearchBoundState( m_id ); return state ? state->m_parentHow : m_parentHow; }
 
 	bool IsOpen( void ) const;									// true if on "open list"
 	void AddToOpenList( void );									// add to open list in decreasing value order
@@ -446,13 +467,13 @@ public:
 	static void ClearSearchLists( void );						// clears the open and closed lists for a new search
 
 	void SetTotalCost( float value )	{ Assert( value >= 0.0 && !IS_NAN(value) ); m_totalCost = value; }
-	float GetTotalCost( void ) const	{ return m_totalCost; }
+	float GetTotalCost( void ) const	{ const NavAreaSearchState_t *state = NavAreaSearchBoundState( m_id ); return state ? state->m_totalCost : m_totalCost; }
 
 	void SetCostSoFar( float value )	{ Assert( value >= 0.0 && !IS_NAN(value) ); m_costSoFar = value; }
-	float GetCostSoFar( void ) const	{ return m_costSoFar; }
+	float GetCostSoFar( void ) const	{ const NavAreaSearchState_t *state = NavAreaSearchBoundState( m_id ); return state ? state->m_costSoFar : m_costSoFar; }
 
 	void SetPathLengthSoFar( float value )	{ Assert( value >= 0.0 && !IS_NAN(value) ); m_pathLengthSoFar = value; }
-	float GetPathLengthSoFar( void ) const	{ return m_pathLengthSoFar; }
+	float GetPathLengthSoFar( void ) const	{ const NavAreaSearchState_t *state = NavAreaSearchBoundState( m_id ); return state ? state->m_pathLengthSoFar : m_pathLengthSoFar; }
 
 	//- editing -----------------------------------------------------------------------------------------
 	virtual void Draw( void ) const;							// draw area for debugging & editing
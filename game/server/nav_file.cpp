@@ -1682,6 +1682,10 @@ NavErrorType CNavMesh::PostLoad( unsigned int version )
 
 	ValidateNavAreaConnections();
 
+	ComputeVisibilityMatrix();
+
+	BuildAreaIndex();
+
 	// TERROR: loading into a map directly creates entities before the mesh is loaded.  Tell the preexisting
 	// entities now that the mesh is loaded so they can update areas.
 	for ( int i=0; i<m_avoidanceObstacles.Count(); ++i )
@@ -16,6 +16,9 @@
 #include "fmtstr.h"
 #include "utlbuffer.h"
 #include "tier0/vprof.h"
+#include "tier0/fasttimer.h"
+#include "mathlib/ssemath.h"
+#include "vstdlib/random.h"
 #ifdef TERROR
 #include "func_simpleladder.h"
 #endif
@@ -48,6 +51,7 @@ ConVar nav_show_func_nav_prerequisite( "nav_show_func_nav_prerequisite", "0", FC
 ConVar nav_max_vis_delta_list_length( "nav_max_vis_delta_list_length", "64", FCVAR_CHEAT );
 
 extern ConVar nav_show_potentially_visible;
+extern ConVar nav_max_view_distance;
 
 int g_DebugPathfindCounter = 0;
 
@@ -106,6 +110,10 @@ void CNavMesh::Reset( void )
 	m_isAnalyzed = false;
 	m_isOutOfDate = false;
 	m_isEditing = false;
+	m_visMatrixAreaCount = 0;
+	m_visMatrixStride = 0;
+	m_visMatrixRangeSq = 0.0f;
+	m_isAreaIndexValid = false;
 	m_navPlace = UNDEFINED_PLACE;
 	m_markedArea = NULL;
 	m_selectedArea = NULL;
@@ -156,6 +164,8 @@ CNavArea *CNavMesh::GetMarkedArea( void ) const
  */
 void CNavMesh::DestroyNavigationMesh( bool incremental )
 {
+	DestroyVisibilityMatrix();
+
 	m_blockedAreas.RemoveAll();
 	m_avoidanceObstacleAreas.RemoveAll();
 	m_transientAreas.RemoveAll();
@@ -204,6 +214,7 @@ void CNavMesh::DestroyNavigationMesh( bool incremental )
 	{
 		// destroy the grid
 		m_grid.RemoveAll();
+		InvalidateAreaIndex();
 		m_gridSizeX = 0;
 		m_gridSizeY = 0;
 	}
@@ -285,6 +296,11 @@ void CNavMesh::Update( void )
 		}
 	}
 
+	if ( !m_isAreaIndexValid )
+	{
+		BuildAreaIndex();
+	}
+
 	if (nav_show_danger.GetBool())
 	{
 		DrawDanger();
@@ -452,6 +468,7 @@ void CNavMesh::FireGameEvent( IGameEvent *gameEvent )
 void CNavMesh::AllocateGrid( float minX, float maxX, float minY, float maxY )
 {
 	m_grid.RemoveAll();
+	InvalidateAreaIndex();
 
 	m_minX = minX;
 	m_minY = minY;
@@ -487,6 +504,7 @@ void CNavMesh::AddNavArea( CNavArea *area )
 			m_grid[ x + y*m_gridSizeX ].AddToTail( const_cast<CNavArea *>( area ) );
 		}
 	}
+	InvalidateAreaIndex();
 
 	// add to hash table
 	int key = ComputeHashKey( area->GetID() );
@@ -534,6 +552,7 @@ void CNavMesh::RemoveNavArea( CNavArea *area )
 			m_grid[ x + y*m_gridSizeX ].FindAndRemove( area );
 		}
 	}
+	InvalidateAreaIndex();
 
 	// remove from hash table
 	int key = ComputeHashKey( area->GetID() );
@@ -685,6 +704,180 @@ inline void CNavMesh::GridToWorld( int gridX, int gridY, Vector *pos ) const
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Copy the 2D extents of the areas in each grid cell into blocks of four
+ */
+void CNavMesh::BuildAreaIndex( void )
+{
+	m_areaIndex.RemoveAll();
+	m_areaIndexCellStart.SetCount( m_grid.Count() + 1 );
+
+	for( int cell=0; cell<m_grid.Count(); ++cell )
+	{
+		m_areaIndexCellStart[ cell ] = m_areaIndex.Count();
+
+		const NavAreaVector &areaVector = m_grid[ cell ];
+		for( int first=0; first<areaVector.Count(); first += 4 )
+		{
+			NavAreaIndexBlock_t &block = m_areaIndex[ m_areaIndex.AddToTail() ];
+
+			for( int lane=0; lane<4; ++lane )
+			{
+				if ( first + lane < areaVector.Count() )
+				{
+					CNavArea *area = areaVector[ first + lane ];
+					block.m_loX[ lane ] = area->m_nwCorner.x;
+					block.m_loY[ lane ] = area->m_nwCorner.y;
+					block.m_hiX[ lane ] = area->m_seCorner.x;
+					block.m_hiY[ lane ] = area->m_seCorner.y;
+					block.m_area[ lane ] = area;
+				}
+				else
+				{
+					// nothing overlaps an empty extent
+					block.m_loX[ lane ] = FLT_MAX;
+					block.m_loY[ lane ] = FLT_MAX;
+					block.m_hiX[ lane ] = -FLT_MAX;
+					block.m_hiY[ lane ] = -FLT_MAX;
+					block.m_area[ lane ] = NULL;
+				}
+			}
+		}
+	}
+
+	m_areaIndexCellStart[ m_grid.Count() ] = m_areaIndex.Count();
+	m_isAreaIndexValid = true;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Invoke functor on each area of the grid cell whose 2D extents contain pos,
+ * in the order of the cell's list, as CNavArea::IsOverlapping( pos ) would pick them.
+ */
+template < typename Functor >
+void CNavMesh::ForAllAreasOverlappingPoint( int cell, const Vector &pos, Functor &func ) const
+{
+	if ( !m_isAreaIndexValid )
+	{
+		const NavAreaVector &areaVector = m_grid[ cell ];
+		FOR_EACH_VEC( areaVector, it )
+		{
+			CNavArea *area = areaVector[ it ];
+			if ( area->IsOverlapping( pos ) )
+			{
+				func( area );
+			}
+		}
+		return;
+	}
+
+	fltx4 x = ReplicateX4( pos.x );
+	fltx4 y = ReplicateX4( pos.y );
+
+	const NavAreaIndexBlock_t *block = m_areaIndex.Base() + m_areaIndexCellStart[ cell ];
+	const NavAreaIndexBlock_t *end = m_areaIndex.Base() + m_areaIndexCellStart[ cell+1 ];
+	for( ; block < end; ++block )
+	{
+		fltx4 inX = AndSIMD( CmpGeSIMD( x, LoadAlignedSIMD( block->m_loX ) ), CmpLeSIMD( x, LoadAlignedSIMD( block->m_hiX ) ) );
+		fltx4 inY = AndSIMD( CmpGeSIMD( y, LoadAlignedSIMD( block->m_loY ) ), CmpLeSIMD( y, LoadAlignedSIMD( block->m_hiY ) ) );
+
+		for( int mask = TestSignSIMD( AndSIMD( inX, inY ) ), lane = 0; mask; mask >>= 1, ++lane )
+		{
+			if ( mask & 1 )
+			{
+				func( block->m_area[ lane ] );
+			}
+		}
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Invoke functor on each area of the grid cell that may be closer to pos than sqrt( func.m_maxDistSq ),
+ * in the order of the cell's list. Areas are only skipped if their 2D distance alone is too far, so the
+ * functor still has to check the distance, and may lower m_maxDistSq as it goes.
+ */
+template < typename Functor >
+void CNavMesh::ForAllAreasNearPoint( int cell, const Vector &pos, Functor &func ) const
+{
+	if ( !m_isAreaIndexValid )
+	{
+		const NavAreaVector &areaVector = m_grid[ cell ];
+		FOR_EACH_VEC( areaVector, it )
+		{
+			func( areaVector[ it ] );
+		}
+		return;
+	}
+
+	fltx4 x = ReplicateX4( pos.x );
+	fltx4 y = ReplicateX4( pos.y );
+
+	const NavAreaIndexBlock_t *block = m_areaIndex.Base() + m_areaIndexCellStart[ cell ];
+	const NavAreaIndexBlock_t *end = m_areaIndex.Base() + m_areaIndexCellStart[ cell+1 ];
+	for( ; block < end; ++block )
+	{
+		// the same clamp as CNavArea::GetClosestPointOnArea(), so the bound never exceeds the full distance
+		fltx4 dx = SubSIMD( MinSIMD( MaxSIMD( x, LoadAlignedSIMD( block->m_loX ) ), LoadAlignedSIMD( block->m_hiX ) ), x );
+		fltx4 dy = SubSIMD( MinSIMD( MaxSIMD( y, LoadAlignedSIMD( block->m_loY ) ), LoadAlignedSIMD( block->m_hiY ) ), y );
+		fltx4 distSq = AddSIMD( MulSIMD( dx, dx ), MulSIMD( dy, dy ) );
+
+		for( int mask = TestSignSIMD( CmpLtSIMD( distSq, ReplicateX4( func.m_maxDistSq ) ) ), lane = 0; mask; mask >>= 1, ++lane )
+		{
+			if ( ( mask & 1 ) && block->m_area[ lane ] )
+			{
+				func( block->m_area[ lane ] );
+			}
+		}
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Keeps the highest area beneath a point, for GetNavArea()
+ */
+class FindNavAreaBeneath
+{
+public:
+	FindNavAreaBeneath( const Vector &pos, float beneathLimit ) : m_testPos( pos + Vector( 0, 0, 5 ) )
+	{
+		m_minZ = pos.z - beneathLimit;
+		m_use = NULL;
+		m_useZ = -99999999.9f;
+	}
+
+	void operator() ( CNavArea *area )
+	{
+		// project position onto area to get Z
+		float z = area->GetZ( m_testPos );
+
+		// if area is above us, skip it
+		if (z > m_testPos.z)
+			return;
+
+		// if area is too far below us, skip it
+		if (z < m_minZ)
+			return;
+
+		// if area is higher than the one we have, use this instead
+		if (z > m_useZ)
+		{
+			m_use = area;
+			m_useZ = z;
+		}
+	}
+
+	Vector m_testPos;
+	float m_minZ;
+	CNavArea *m_use;
+	float m_useZ;
+};
+
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Given a position, return the nav area that IsOverlapping and is *immediately* beneath it
@@ -699,42 +892,64 @@ CNavArea *CNavMesh::GetNavArea( const Vector &pos, float beneathLimit ) const
 	// get list in cell that contains position
 	int x = WorldToGridX( pos.x );
 	int y = WorldToGridY( pos.y );
-	NavAreaVector *areaVector = &m_grid[ x + y*m_gridSizeX ];
 
 	// search cell list to find correct area
-	CNavArea *use = NULL;
-	float useZ = -99999999.9f;
-	Vector testPos = pos + Vector( 0, 0, 5 );
+	FindNavAreaBeneath find( pos, beneathLimit );
+	ForAllAreasOverlappingPoint( x + y*m_gridSizeX, find.m_testPos, find );
 
-	FOR_EACH_VEC( (*areaVector), it )
+	return find.m_use;
+}
+
+
+//----------------------------------------------------------------------------
+// Keeps the highest unblocked area within step height of an entity, for GetNavArea()
+//----------------------------------------------------------------------------
+class FindNavAreaBeneathEntity
+{
+public:
+	FindNavAreaBeneathEntity( const Vector &testPos, int team, bool bSkipBlockedAreas, float flStepHeight, float flBeneathLimit ) : m_testPos( testPos )
 	{
-		CNavArea *area = (*areaVector)[ it ];
+		m_team = team;
+		m_bSkipBlockedAreas = bSkipBlockedAreas;
+		m_flStepHeight = flStepHeight;
+		m_flBeneathLimit = flBeneathLimit;
+		m_use = NULL;
+		m_useZ = -99999999.9f;
+	}
 
-		// check if position is within 2D boundaries of this area
-		if (area->IsOverlapping( testPos ))
-		{
-			// project position onto area to get Z
-			float z = area->GetZ( testPos );
+	void operator() ( CNavArea *pArea )
+	{
+		// don't consider blocked areas
+		if ( m_bSkipBlockedAreas && pArea->IsBlocked( m_team ) )
+			return;
 
-			// if area is above us, skip it
-			if (z > testPos.z)
-				continue;
+		// project position onto area to get Z
+		float z = pArea->GetZ( m_testPos );
 
-			// if area is too far below us, skip it
-			if (z < pos.z - beneathLimit)
-				continue;
+		// if area is above us, skip it
+		if ( z > m_testPos.z + m_flStepHeight )
+			return;
 
-			// if area is higher than the one we have, use this instead
-			if (z > useZ)
-			{
-				use = area;
-				useZ = z;
-			}
-		}
+		// if area is too far below us, skip it
+		if ( z < m_testPos.z - m_flBeneathLimit )
+			return;
+
+		// if area is lower than the one we have, skip it
+		if ( z <= m_useZ )
+			return;
+
+		m_use = pArea;
+		m_useZ = z;
 	}
 
-	return use;
-}
+	const Vector &m_testPos;
+	int m_team;
+	bool m_bSkipBlockedAreas;
+	float m_flStepHeight;
+	float m_flBeneathLimit;
+	CNavArea *m_use;
+	float m_useZ;
+};
 
 
 //----------------------------------------------------------------------------
@@ -767,43 +982,14 @@ CNavArea *CNavMesh::GetNavArea( CBaseEntity *pEntity, int nFlags, float flBeneat
 	// get list in cell that contains position
 	int x = WorldToGridX( testPos.x );
 	int y = WorldToGridY( testPos.y );
-	NavAreaVector *areaVector = &m_grid[ x + y*m_gridSizeX ];
 
 	// search cell list to find correct area
-	CNavArea *use = NULL;
-	float useZ = -99999999.9f;
-
 	bool bSkipBlockedAreas = ( ( nFlags & GETNAVAREA_ALLOW_BLOCKED_AREAS ) == 0 );
-	FOR_EACH_VEC( (*areaVector), it )
-	{
-		CNavArea *pArea = (*areaVector)[ it ];
-
-		// check if position is within 2D boundaries of this area
-		if ( !pArea->IsOverlapping( testPos ) )
-			continue;
+	FindNavAreaBeneathEntity find( testPos, pEntity->GetTeamNumber(), bSkipBlockedAreas, flStepHeight, flBeneathLimit );
+	ForAllAreasOverlappingPoint( x + y*m_gridSizeX, testPos, find );
 
-		// don't consider blocked areas
-		if ( bSkipBlockedAreas && pArea->IsBlocked( pEntity->GetTeamNumber() ) )
-			continue;
-
-		// project position onto area to get Z
-		float z = pArea->GetZ( testPos );
-
-		// if area is above us, skip it
-		if ( z > testPos.z + flStepHeight )
-			continue;
-
-		// if area is too far below us, skip it
-		if ( z < testPos.z - flBeneathLimit )
-			continue;
-
-		// if area is lower than the one we have, skip it
-		if ( z <= useZ )
-			continue;
-
-		use = pArea;
-		useZ = z;
-	}
+	CNavArea *use = find.m_use;
+	float useZ = find.m_useZ;
 
 	// Check LOS if necessary
 	if ( use && ( nFlags && GETNAVAREA_CHECK_LOS ) && ( useZ < testPos.z - flStepHeight ) )
@@ -876,6 +1062,105 @@ CNavArea *CNavMesh::GetNearestNavArea( const Vector &pos, bool anyZ, float maxDi
 	}
 
 
+	// find closest area in a cell
+	class FindNearestNavArea
+	{
+	public:
+		FindNearestNavArea( const Vector &pos, const Vector &source, float maxDistSq, bool checkLOS, int team, unsigned int searchMarker ) : m_pos( pos ), m_source( source )
+		{
+			m_maxDistSq = maxDistSq;
+			m_checkLOS = checkLOS;
+			m_team = team;
+			m_searchMarker = searchMarker;
+			m_close = NULL;
+			m_isCloser = false;
+		}
+
+		void operator() ( CNavArea *area )
+		{
+			// skip if we've already visited this area
+			if ( area->m_nearNavSearchMarker == m_searchMarker )
+				return;
+
+			// don't consider blocked areas
+			if ( area->IsBlocked( m_team ) )
+				return;
+
+			// mark as visited
+			area->m_nearNavSearchMarker = m_searchMarker;
+
+			Vector areaPos;
+			area->GetClosestPointOnArea( m_source, &areaPos );
+
+			// TERROR: Using the original pos for distance calculations.  Since it's a pure 3D distance,
+			// with no Z restrictions or LOS checks, this should work for passing in bot foot positions.
+			// This needs to be ported back to CS:S.
+			float distSq = ( areaPos - m_pos ).LengthSqr();
+
+			// keep the closest area
+			if ( distSq >= m_maxDistSq )
+				return;
+
+			// check LOS to area
+			// REMOVED: If we do this for !anyZ, it's likely we wont have LOS and will enumerate every area in the mesh
+			// It is still good to do this in some isolated cases, however
+			if ( m_checkLOS )
+			{
+				trace_t result;
+
+				// make sure 'pos' is not embedded in the world
+				Vector safePos;
+
+				UTIL_TraceLine( m_pos, m_pos + Vector( 0, 0, StepHeight ), MASK_NPCSOLID_BRUSHONLY, NULL, COLLISION_GROUP_NONE, &result );
+				if ( result.startsolid )
+				{
+					// it was embedded - move it out
+					safePos = result.endpos + Vector( 0, 0, 1.0f );
+				}
+				else
+				{
+					safePos = m_pos;
+				}
+
+				// Don't bother tracing from the nav area up to safePos.z if it's within StepHeight of the area, since areas can be embedded in the ground a bit
+				float heightDelta = fabs(areaPos.z - safePos.z);
+				if ( heightDelta > StepHeight )
+				{
+					// trace to the height of the original point
+					UTIL_TraceLine( areaPos + Vector( 0, 0, StepHeight ), Vector( areaPos.x, areaPos.y, safePos.z ), MASK_NPCSOLID_BRUSHONLY, NULL, COLLISION_GROUP_NONE, &result );
+				
+					if ( result.fraction != 1.0f )
+					{
+						return;
+					}
+				}
+
+				// trace to the original point's height above the area
+				UTIL_TraceLine( safePos, Vector( areaPos.x, areaPos.y, safePos.z + StepHeight ), MASK_NPCSOLID_BRUSHONLY, NULL, COLLISION_GROUP_NONE, &result );
+
+				if ( result.fraction != 1.0f )
+				{
+					return;
+				}
+			}
+
+			m_maxDistSq = distSq;
+			m_close = area;
+			m_isCloser = true;
+		}
+
+		const Vector &m_pos;
+		const Vector &m_source;
+		float m_maxDistSq;										// distance to the closest area so far
+		bool m_checkLOS;
+		int m_team;
+		unsigned int m_searchMarker;
+		CNavArea *m_close;
+		bool m_isCloser;										// found a closer area in the current cell
+	};
+
+	FindNearestNavArea find( pos, source, closeDistSq, checkLOS, team, searchMarker );
+
 	// get list in cell that contains position
 	int originX = WorldToGridX( pos.x );
 	int originY = WorldToGridY( pos.y );
@@ -908,82 +1193,11 @@ CNavArea *CNavMesh::GetNearestNavArea( const Vector &pos, bool anyZ, float maxDi
 					 y < originY + shift )
 					continue;
 
-				NavAreaVector *areaVector = &m_grid[ x + y*m_gridSizeX ];
+				find.m_isCloser = false;
+				ForAllAreasNearPoint( x + y*m_gridSizeX, pos, find );
 
-				// find closest area in this cell
-				FOR_EACH_VEC( (*areaVector), it )
+				if ( find.m_isCloser )
 				{
-					CNavArea *area = (*areaVector)[ it ];
-
-					// skip if we've already visited this area
-					if ( area->m_nearNavSearchMarker == searchMarker )
-						continue;
-
-					// don't consider blocked areas
-					if ( area->IsBlocked( team ) )
-						continue;
-
-					// mark as visited
-					area->m_nearNavSearchMarker = searchMarker;
-
-					Vector areaPos;
-					area->GetClosestPointOnArea( source, &areaPos );
-
-					// TERROR: Using the original pos for distance calculations.  Since it's a pure 3D distance,
-					// with no Z restrictions or LOS checks, this should work for passing in bot foot positions.
-					// This needs to be ported back to CS:S.
-					float distSq = ( areaPos - pos ).LengthSqr();
-
-					// keep the closest area
-					if ( distSq >= closeDistSq )
-						continue;
-
-					// check LOS to area
-					// REMOVED: If we do this for !anyZ, it's likely we wont have LOS and will enumerate every area in the mesh
-					// It is still good to do this in some isolated cases, however
-					if ( checkLOS )
-					{
-						trace_t result;
-
-						// make sure 'pos' is not embedded in the world
-						Vector safePos;
-
-						UTIL_TraceLine( pos, pos + Vector( 0, 0, StepHeight ), MASK_NPCSOLID_BRUSHONLY, NULL, COLLISION_GROUP_NONE, &result );
-						if ( result.startsolid )
-						{
-							// it was embedded - move it out
-							safePos = result.endpos + Vector( 0, 0, 1.0f );
-						}
-						else
-						{
-							safePos = pos;
-						}
-
-						// Don't bother tracing from the nav area up to safePos.z if it's within StepHeight of the area, since areas can be embedded in the ground a bit
-						float heightDelta = fabs(areaPos.z - safePos.z);
-						if ( heightDelta > StepHeight )
-						{
-							// trace to the height of the original point
-							UTIL_TraceLine( areaPos + Vector( 0, 0, StepHeight ), Vector( areaPos.x, areaPos.y, safePos.z ), MASK_NPCSOLID_BRUSHONLY, NULL, COLLISION_GROUP_NONE, &result );
-							
-							if ( result.fraction != 1.0f )
-							{
-								continue;
-							}
-						}
-
-						// trace to the original point's height above the area
-						UTIL_TraceLine( safePos, Vector( areaPos.x, areaPos.y, safePos.z + StepHeight ), MASK_NPCSOLID_BRUSHONLY, NULL, COLLISION_GROUP_NONE, &result );
-
-						if ( result.fraction != 1.0f )
-						{
-							continue;
-						}
-					}
-
-					closeDistSq = distSq;
-					close = area;
-
 					// look one more step outwards
 					shiftLimit = shift+1;
 				}
@@ -991,7 +1205,7 @@ CNavArea *CNavMesh::GetNearestNavArea( const Vector &pos, bool anyZ, float maxDi
 		}
 	}
 
-	return close;
+	return find.m_close;
 }
 
 
@@ -1019,6 +1233,108 @@ CNavArea *CNavMesh::GetNearestNavArea( CBaseEntity *pEntity, int nFlags, float m
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Time GetNavArea() and GetNearestNavArea() at random points around the areas of the mesh,
+ * searching the grid cell lists and then the area index, and make sure both find the same areas.
+ */
+void CNavMesh::CommandNavQueryBenchmark( const CCommand &args )
+{
+	int areaCount = TheNavAreas.Count();
+	if ( !m_grid.Count() || areaCount == 0 )
+	{
+		Msg( "nav_query_benchmark: no navigation mesh loaded\n" );
+		return;
+	}
+
+	int queryCount = ( args.ArgC() > 1 ) ? MAX( atoi( args[1] ), 1 ) : 10000;
+
+	// the same points every run on a given mesh, on and around the areas
+	CUniformRandomStream random;
+	random.SetSeed( 1234 );
+
+	CUtlVector< Vector > points;
+	points.SetCount( queryCount );
+	for( int i=0; i<queryCount; ++i )
+	{
+		const CNavArea *area = TheNavAreas[ random.RandomInt( 0, areaCount - 1 ) ];
+		const float margin = 2.0f * GenerationStepSize;
+		points[i].x = random.RandomFloat( area->m_nwCorner.x - margin, area->m_seCorner.x + margin );
+		points[i].y = random.RandomFloat( area->m_nwCorner.y - margin, area->m_seCorner.y + margin );
+		points[i].z = area->GetCenter().z + random.RandomFloat( 0.0f, HalfHumanHeight );
+	}
+
+	CUtlVector< CNavArea * > found[2];
+	CUtlVector< CNavArea * > nearest[2];
+	float foundTime[2];
+	float nearestTime[2];
+
+	CFastTimer timer;
+
+	for( int pass=0; pass<2; ++pass )
+	{
+		// the first pass searches the grid cell lists, the second the area index
+		if ( pass == 0 )
+		{
+			m_isAreaIndexValid = false;
+		}
+		else
+		{
+			BuildAreaIndex();
+		}
+
+		found[ pass ].SetCount( queryCount );
+		nearest[ pass ].SetCount( queryCount );
+
+		timer.Start();
+		for( int i=0; i<queryCount; ++i )
+		{
+			found[ pass ][i] = GetNavArea( points[i] );
+		}
+		timer.End();
+		foundTime[ pass ] = timer.GetDuration().GetMillisecondsF();
+
+		timer.Start();
+		for( int i=0; i<queryCount; ++i )
+		{
+			nearest[ pass ][i] = GetNearestNavArea( points[i], false, 10000.0f, false, false );
+		}
+		timer.End();
+		nearestTime[ pass ] = timer.GetDuration().GetMillisecondsF();
+	}
+
+	int onMesh = 0;
+	int mismatched = 0;
+	for( int i=0; i<queryCount; ++i )
+	{
+		if ( found[0][i] )
+		{
+			++onMesh;
+		}
+		if ( found[0][i] != found[1][i] || nearest[0][i] != nearest[1][i] )
+		{
+			++mismatched;
+		}
+	}
+
+	Msg( "nav_query_benchmark: %d points over %d areas, %d on the mesh, %d index blocks\n", queryCount, areaCount, onMesh, m_areaIndex.Count() );
+	Msg( "  GetNavArea:        cell lists %.2f ms, area index %.2f ms\n", foundTime[0], foundTime[1] );
+	Msg( "  GetNearestNavArea: cell lists %.2f ms, area index %.2f ms\n", nearestTime[0], nearestTime[1] );
+	if ( mismatched )
+	{
+		Warning( "nav_query_benchmark: %d points had different results with the area index\n", mismatched );
+	}
+}
+
+CON_COMMAND_F( nav_query_benchmark, "Time GetNavArea() and GetNearestNavArea() with and without the area index. Arguments: [point count]", FCVAR_GAMEDLL | FCVAR_CHEAT )
+{
+	if ( !UTIL_IsCommandIssuedByServerAdmin() )
+		return;
+
+	TheNavMesh->CommandNavQueryBenchmark( args );
+}
+
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Given an ID, return the associated area
@@ -3301,4 +3617,103 @@ void CNavMesh::EndVisibilityComputations( void )
 	}
 
 	Msg( "NavMesh Visibility List Lengths:  min = %d, avg = %d, max = %d\n", minVisLength, avgVisLength, maxVisLength );
+
+	ComputeVisibilityMatrix();
+}
+
+
+//--------------------------------------------------------------------------------------------------------
+/**
+ * Marks both areas as seeing each other in the visibility matrix
+ */
+class MarkPotentiallyVisible
+{
+public:
+	MarkPotentiallyVisible( CUtlVector< uint32 > &matrix, unsigned int stride, const CNavArea *area ) : m_matrix( matrix )
+	{
+		m_stride = stride;
+		m_areaID = area->GetID();
+		m_count = 0;
+	}
+
+	bool operator() ( CNavArea *other )
+	{
+		unsigned int otherID = other->GetID();
+		m_matrix[ m_areaID * m_stride + ( otherID >> 5 ) ] |= 1u << ( otherID & 31 );
+		m_matrix[ otherID * m_stride + ( m_areaID >> 5 ) ] |= 1u << ( m_areaID & 31 );
+		++m_count;
+		return true;
+	}
+
+	CUtlVector< uint32 > &m_matrix;
+	unsigned int m_stride;
+	unsigned int m_areaID;
+	int m_count;
+};
+
+
+//--------------------------------------------------------------------------------------------------------
+/**
+ * Pack the potentially visible areas of every area into one bit matrix indexed by area ID, so "can these
+ * two areas see each other" is a single lookup rather than a search of the (possibly inherited) lists.
+ * Visibility is made symmetric, which can only add areas that may be seen.
+ */
+void CNavMesh::ComputeVisibilityMatrix( void )
+{
+	DestroyVisibilityMatrix();
+
+	unsigned int maxID = 0;
+	FOR_EACH_VEC( TheNavAreas, it )
+	{
+		maxID = MAX( maxID, TheNavAreas[ it ]->GetID() );
+	}
+
+	const unsigned int maxMatrixAreas = 16384;		// 32MB
+	unsigned int areaCount = maxID + 1;
+	if ( TheNavAreas.Count() == 0 || areaCount > maxMatrixAreas )
+	{
+		return;
+	}
+
+	unsigned int stride = ( areaCount + 31 ) / 32;
+	m_visMatrix.SetCount( areaCount * stride );
+	V_memset( m_visMatrix.Base(), 0, m_visMatrix.Count() * sizeof( uint32 ) );
+
+	int visibleCount = 0;
+	FOR_EACH_VEC( TheNavAreas, it )
+	{
+		CNavArea *area = TheNavAreas[ it ];
+
+		// an area can always see itself
+		unsigned int id = area->GetID();
+		m_visMatrix[ id * stride + ( id >> 5 ) ] |= 1u << ( id & 31 );
+
+		MarkPotentiallyVisible mark( m_visMatrix, stride, area );
+		area->ForAllPotentiallyVisibleAreas( mark );
+		visibleCount += mark.m_count;
+	}
+
+	if ( visibleCount == 0 )
+	{
+		// the mesh has no visibility data
+		DestroyVisibilityMatrix();
+		return;
+	}
+
+	// same range CNavArea::ComputeVisibilityToMesh() looks for visible areas within
+	float range = ( nav_max_view_distance.GetFloat() > 0.0f ) ? nav_max_view_distance.GetFloat() : 1500.0f;
+
+	m_visMatrixAreaCount = areaCount;
+	m_visMatrixStride = stride;
+	m_visMatrixRangeSq = range * range;
+}
+
+
+//--------------------------------------------------------------------------------------------------------
+void CNavMesh::DestroyVisibilityMatrix( void )
+{
+	m_visMatrix.Purge();
+	m_visMatrixAreaCount = 0;
+	m_visMatrixStride = 0;
+	m_visMatrixRangeSq = 0.0f;
 }
@@ -281,6 +281,7 @@ public:
 	virtual NavErrorType PostLoad( unsigned int version );				// (EXTEND) invoked after all areas have been loaded - for pointer binding, etc
 	bool IsLoaded( void ) const		{ return m_isLoaded; }				// return true if a Navigation Mesh has been loaded
 	bool IsAnalyzed( void ) const	{ return m_isAnalyzed; }			// return true if a Navigation Mesh has been analyzed
+	bool IsPotentiallyVisible( const CNavArea *area, const CNavArea *other ) const;	// return false only if the areas are known not to see each other (very fast)
 
 	/**
 	 * Return true if nav mesh can be trusted for all climbing/jumping decisions because game environment is fairly simple.
@@ -328,6 +329,8 @@ public:
 	CNavArea *GetNavAreaByID( unsigned int id ) const;
 	CNavArea *GetNearestNavArea( const Vector &pos, bool anyZ = false, float maxDist = 10000.0f, bool checkLOS = false, bool checkGround = true, int team = TEAM_ANY ) const;
 	CNavArea *GetNearestNavArea( CBaseEntity *pEntity, int nGetNavAreaFlags = GETNAVAREA_CHECK_GROUND, float maxDist = 10000.0f ) const;
+	void CommandNavQueryBenchmark( const CCommand &args );			// time GetNavArea() and GetNearestNavArea() with and without the area index
+	void InvalidateAreaIndex( void )	{ m_isAreaIndexValid = false; }	// must be called when the extent of an area changes
 
 	Place GetPlace( const Vector &pos ) const;							// return Place at given coordinate
 	const char *PlaceToName( Place place ) const;						// given a place, return its name
@@ -1078,10 +1081,38 @@ private:
 	float m_minY;
 	unsigned int m_areaCount;									// total number of nav areas
 
+	// The areas of each grid cell again, in the same order, with their 2D extents side by side in blocks of four
+	// so a point can be tested against four areas at once. Rebuilt by Update() once the mesh has changed;
+	// until then queries use m_grid.
+	struct NavAreaIndexBlock_t
+	{
+		float m_loX[4];
+		float m_loY[4];
+		float m_hiX[4];
+		float m_hiY[4];
+		CNavArea *m_area[4];										// NULL in unused slots, whose extents are empty
+	};
+	CUtlVector< NavAreaIndexBlock_t, CUtlMemoryAligned< NavAreaIndexBlock_t, 16 > > m_areaIndex;
+	CUtlVector< int > m_areaIndexCellStart;						// first block of each grid cell, plus one past the last block
+	bool m_isAreaIndexValid;
+	void BuildAreaIndex( void );
+
+	template < typename Functor >
+	void ForAllAreasOverlappingPoint( int cell, const Vector &pos, Functor &func ) const;	// areas of the grid cell that IsOverlapping( pos ), in the cell's order
+	template < typename Functor >
+	void ForAllAreasNearPoint( int cell, const Vector &pos, Functor &func ) const;		// areas of the grid cell within sqrt( func.m_maxDistSq ) of pos in 2D, in the cell's order
+
 	bool m_isLoaded;											// true if a Navigation Mesh has been loaded
 	bool m_isOutOfDate;											// true if the Navigation Mesh is older than the actual BSP
 	bool m_isAnalyzed;											// true if the Navigation Mesh needs analysis
 
+	void ComputeVisibilityMatrix( void );						// pack the potentially visible areas of all areas into m_visMatrix
+	void DestroyVisibilityMatrix( void );
+	CUtlVector< uint32 > m_visMatrix;							// row per area ID, with a bit per area ID set if the two areas may see each other - empty if the mesh has no visibility data
+	unsigned int m_visMatrixAreaCount;							// number of rows and columns of m_visMatrix
+	unsigned int m_visMatrixStride;								// 32 bit words per row of m_visMatrix
+	float m_visMatrixRangeSq;									// visibility was not computed between areas farther apart than this
+
 	enum { HASH_TABLE_SIZE = 256 };
 	CNavArea *m_hashTable[ HASH_TABLE_SIZE ];					// hash table to optimize lookup by ID
 	int ComputeHashKey( unsigned int id ) const;				// returns a hash key for the given nav area ID
@@ -1287,6 +1318,25 @@ inline unsigned int CNavMesh::GetSubVersionNumber( void ) const
 	return 0;
 }
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Return false only if the areas are known not to see each other, based on the visibility data of the mesh.
+ * Areas the data says nothing about, including areas made since it was loaded, are assumed to see each other.
+ */
+inline bool CNavMesh::IsPotentiallyVisible( const CNavArea *area, const CNavArea *other ) const
+{
+	unsigned int areaID = area->GetID();
+	unsigned int otherID = other->GetID();
+
+	if ( areaID >= m_visMatrixAreaCount || otherID >= m_visMatrixAreaCount )
+		return true;
+
+	if ( area->GetCenter().DistToSqr( other->GetCenter() ) > m_visMatrixRangeSq )
+		return true;
+
+	return ( m_visMatrix[ areaID * m_visMatrixStride + ( otherID >> 5 ) ] & ( 1u << ( otherID & 31 ) ) ) != 0;
+}
+
 
 //--------------------------------------------------------------------------------------------------------------
 inline CNavArea *CNavMesh::CreateArea( void ) const
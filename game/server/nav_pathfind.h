@@ -15,6 +15,7 @@
 #include "tier0/vprof.h"
 #include "mathlib/ssemath.h"
 #include "nav_area.h"
+#include "nav_search.h"
 
 extern int g_DebugPathfindCounter;
 
@@ -96,10 +97,13 @@ public:
  * If 'goalPos' is NULL, will use the center of 'goalArea' as the goal position.
  * If 'maxPathLength' is nonzero, path building will stop when this length is reached.
  * Returns true if a path exists.
+ *
+ * The search state is kept in 'search', and the parent pointers are read back with search.GetParent().
+ * Any thread can run a search with its own CNavAreaSearch, as long as the cost functor is thread safe.
  */
 #define IGNORE_NAV_BLOCKERS true
 template< typename CostFunctor >
-bool NavAreaBuildPath( CNavArea *startArea, CNavArea *goalArea, const Vector *goalPos, CostFunctor &costFunc, CNavArea **closestArea = NULL, float maxPathLength = 0.0f, int teamID = TEAM_ANY, bool ignoreNavBlockers = false )
+bool NavAreaBuildPath( CNavAreaSearch &search, CNavArea *startArea, CNavArea *goalArea, const Vector *goalPos, CostFunctor &costFunc, CNavArea **closestArea = NULL, float maxPathLength = 0.0f, int teamID = TEAM_ANY, bool ignoreNavBlockers = false )
 {
 	VPROF_BUDGET( "NavAreaBuildPath", "NextBotSpiky" );
 
@@ -108,12 +112,16 @@ bool NavAreaBuildPath( CNavArea *startArea, CNavArea *goalArea, const Vector *go
 		*closestArea = startArea;
 	}
 
-	bool isDebug = ( g_DebugPathfindCounter-- > 0 );
+	bool isDebug = ThreadInMainThread() && ( g_DebugPathfindCounter-- > 0 );
 
 	if (startArea == NULL)
 		return false;
 
-	startArea->SetParent( NULL );
+	// start search
+	search.Begin();
+	CNavAreaSearchBind bind( &search );
+
+	search.Reach( startArea );
 
 	if (goalArea != NULL && goalArea->IsBlocked( teamID, ignoreNavBlockers ))
 		goalArea = NULL;
@@ -130,29 +138,27 @@ bool NavAreaBuildPath( CNavArea *startArea, CNavArea *goalArea, const Vector *go
 	// determine actual goal position
 	Vector actualGoalPos = (goalPos) ? *goalPos : goalArea->GetCenter();
 
-	// start search
-	CNavArea::ClearSearchLists();
-
 	// compute estimate of path length
 	/// @todo Cost might work as "manhattan distance"
-	startArea->SetTotalCost( (startArea->GetCenter() - actualGoalPos).Length() );
+	NavAreaSearchState_t &startState = search.Reach( startArea );
+	startState.m_totalCost = (startArea->GetCenter() - actualGoalPos).Length();
 
 	float initCost = costFunc( startArea, NULL, NULL, NULL, -1.0f );	
 	if (initCost < 0.0f)
 		return false;
-	startArea->SetCostSoFar( initCost );
-	startArea->SetPathLengthSoFar( 0.0 );
+	startState.m_costSoFar = initCost;
+	startState.m_pathLengthSoFar = 0.0;
 
-	startArea->AddToOpenList();
+	search.AddToOpenList( startArea );
 
 	// keep track of the area we visit that is closest to the goal
-	float closestAreaDist = startArea->GetTotalCost();
+	float closestAreaDist = startState.m_totalCost;
 
 	// do A* search
-	while( !CNavArea::IsOpenListEmpty() )
+	while( !search.IsOpenListEmpty() )
 	{
 		// get next area to check
-		CNavArea *area = CNavArea::PopOpenList();
+		CNavArea *area = search.PopOpenList();
 
 		if ( isDebug )
 		{
@@ -329,7 +335,7 @@ bool NavAreaBuildPath( CNavArea *startArea, CNavArea *goalArea, const Vector *go
 
 			// don't backtrack
 			Assert( newArea );
-			if ( newArea == area->GetParent() )
+			if ( newArea == search.GetParent( area ) )
 				continue;
 			if ( newArea == area ) // self neighbor?
 				continue;
@@ -346,13 +352,14 @@ bool NavAreaBuildPath( CNavArea *startArea, CNavArea *goalArea, const Vector *go
 
 			// Safety check against a bogus functor.  The cost of the path
 			// A...B, C should always be at least as big as the path A...B.
-			Assert( newCostSoFar >= area->GetCostSoFar() );
+			const NavAreaSearchState_t &areaState = *search.Find( area );
+			Assert( newCostSoFar >= areaState.m_costSoFar );
 
 			// And now that we've asserted, let's be a bit more defensive.
 			// Make sure that any jump to a new area incurs some pathfinsing
 			// cost, to avoid us spinning our wheels over insignificant cost
 			// benefit, floating point precision bug, or busted cost functor.
-			float minNewCostSoFar = area->GetCostSoFar() * 1.00001 + 0.00001;
+			float minNewCostSoFar = areaState.m_costSoFar * 1.00001 + 0.00001;
 			newCostSoFar = Max( newCostSoFar, minNewCostSoFar );
 				
 			// stop if path length limit reached
@@ -360,14 +367,15 @@ bool NavAreaBuildPath( CNavArea *startArea, CNavArea *goalArea, const Vector *go
 			{
 				// keep track of path length so far
 				float deltaLength = ( newArea->GetCenter() - area->GetCenter() ).Length();
-				float newLengthSoFar = area->GetPathLengthSoFar() + deltaLength;
+				float newLengthSoFar = areaState.m_pathLengthSoFar + deltaLength;
 				if ( newLengthSoFar > maxPathLength )
 					continue;
 				
-				newArea->SetPathLengthSoFar( newLengthSoFar );
+				search.Reach( newArea ).m_pathLengthSoFar = newLengthSoFar;
 			}
 
-			if ( ( newArea->IsOpen() || newArea->IsClosed() ) && newArea->GetCostSoFar() <= newCostSoFar )
+			const NavAreaSearchState_t *newState = search.Find( newArea );
+			if ( newState && newState->m_heapIndex != NAV_SEARCH_NEW && newState->m_costSoFar <= newCostSoFar )
 			{
 				// this is a worse path - skip it
 				continue;
@@ -385,36 +393,63 @@ bool NavAreaBuildPath( CNavArea *startArea, CNavArea *goalArea, const Vector *go
 					closestAreaDist = newCostRemaining;
 				}
 				
-				newArea->SetCostSoFar( newCostSoFar );
-				newArea->SetTotalCost( newCostSoFar + newCostRemaining );
+				NavAreaSearchState_t &newAreaState = search.Reach( newArea );
+				newAreaState.m_costSoFar = newCostSoFar;
+				newAreaState.m_totalCost = newCostSoFar + newCostRemaining;
 
-				if ( newArea->IsClosed() )
+				if ( newAreaState.m_heapIndex == NAV_SEARCH_CLOSED )
 				{
-					newArea->RemoveFromClosedList();
+					search.RemoveFromClosedList( newArea );
 				}
 
-				if ( newArea->IsOpen() )
+				if ( newAreaState.m_heapIndex >= 0 )
 				{
 					// area already on open list, update the list order to keep costs sorted
-					newArea->UpdateOnOpenList();
+					search.UpdateOnOpenList( newArea );
 				}
 				else
 				{
-					newArea->AddToOpenList();
+					search.AddToOpenList( newArea );
 				}
 
-				newArea->SetParent( area, how );
+				newAreaState.m_parent = area;
+				newAreaState.m_parentHow = how;
 			}
 		}
 
 		// we have searched this area
-		area->AddToClosedList();
+		search.AddToClosedList( area );
 	}
 
 	return false;
 }
 
 
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * NavAreaBuildPath() for the main thread, leaving the path in the areas themselves: the parent pointers,
+ * costs and path lengths from the area the search ended at back to startArea are copied to the areas.
+ */
+template< typename CostFunctor >
+bool NavAreaBuildPath( CNavArea *startArea, CNavArea *goalArea, const Vector *goalPos, CostFunctor &costFunc, CNavArea **closestArea = NULL, float maxPathLength = 0.0f, int teamID = TEAM_ANY, bool ignoreNavBlockers = false )
+{
+	Assert( ThreadInMainThread() );
+
+	CNavAreaSearch &search = NavAreaMainThreadSearch();
+
+	CNavArea *endArea = NULL;
+	bool result = NavAreaBuildPath( search, startArea, goalArea, goalPos, costFunc, &endArea, maxPathLength, teamID, ignoreNavBlockers );
+	search.CopyPathToAreas( endArea );
+
+	if ( closestArea )
+	{
+		*closestArea = endArea;
+	}
+
+	return result;
+}
+
+
 //--------------------------------------------------------------------------------------------------------------
 /**
  * Compute distance between two areas. Return -1 if can't reach 'endArea' from 'startArea'.
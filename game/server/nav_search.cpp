@@ -0,0 +1,347 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Open/closed list and per area state of one path search
+//
+//=============================================================================//
+// nav_search.cpp
+// Search state for NavAreaBuildPath(), kept outside of the areas
+
+#include "cbase.h"
+#include "nav_mesh.h"
+#include "nav_pathfind.h"
+#include "nav_search.h"
+#include "tier0/fasttimer.h"
+#include "vstdlib/jobthread.h"
+#include "vstdlib/random.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+static CTHREADLOCALPTR( CNavAreaSearch ) s_boundSearch;
+
+
+//--------------------------------------------------------------------------------------------------------------
+CNavAreaSearch::CNavAreaSearch( void )
+{
+	m_generation = 0;
+	m_sequence = 0;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavAreaSearch::Begin( void )
+{
+	m_heap.RemoveAll();
+	m_sequence = 0;
+
+	++m_generation;
+	if ( m_generation == 0 )
+	{
+		// wrapped around, states of long ago searches would look current
+		for( int i=0; i<m_state.Count(); ++i )
+		{
+			m_state[i].m_generation = 0;
+		}
+		m_generation = 1;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavAreaSearch::Grow( unsigned int areaID )
+{
+	int oldCount = m_state.Count();
+	int newCount = MAX( (int)areaID + 1, 2 * oldCount );
+	m_state.SetCount( newCount );
+
+	for( int i=oldCount; i<newCount; ++i )
+	{
+		m_state[i].m_generation = 0;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavAreaSearch::SetHeapEntry( int index, const HeapEntry_t &entry )
+{
+	m_heap[ index ] = entry;
+	m_state[ entry.m_area->GetID() ].m_heapIndex = index;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavAreaSearch::SiftUp( int index )
+{
+	HeapEntry_t entry = m_heap[ index ];
+	while ( index > 0 )
+	{
+		int parent = ( index - 1 ) / 2;
+		if ( !IsBefore( entry, m_heap[ parent ] ) )
+			break;
+
+		SetHeapEntry( index, m_heap[ parent ] );
+		index = parent;
+	}
+	SetHeapEntry( index, entry );
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavAreaSearch::SiftDown( int index )
+{
+	HeapEntry_t entry = m_heap[ index ];
+	int count = m_heap.Count();
+	while ( true )
+	{
+		int child = 2 * index + 1;
+		if ( child >= count )
+			break;
+
+		if ( child + 1 < count && IsBefore( m_heap[ child + 1 ], m_heap[ child ] ) )
+		{
+			++child;
+		}
+
+		if ( !IsBefore( m_heap[ child ], entry ) )
+			break;
+
+		SetHeapEntry( index, m_heap[ child ] );
+		index = child;
+	}
+	SetHeapEntry( index, entry );
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavAreaSearch::AddToOpenList( CNavArea *area )
+{
+	NavAreaSearchState_t &state = Reach( area );
+	if ( state.m_heapIndex >= 0 )
+	{
+		// already on list
+		return;
+	}
+
+	HeapEntry_t entry;
+	entry.m_totalCost = state.m_totalCost;
+	entry.m_sequence = m_sequence++;
+	entry.m_area = area;
+
+	SiftUp( m_heap.AddToTail( entry ) );
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavAreaSearch::UpdateOnOpenList( CNavArea *area )
+{
+	NavAreaSearchState_t &state = Reach( area );
+	Assert( state.m_heapIndex >= 0 );
+
+	// queued behind any area of the same cost, as if it was added now
+	HeapEntry_t &entry = m_heap[ state.m_heapIndex ];
+	Assert( state.m_totalCost <= entry.m_totalCost );
+	entry.m_totalCost = state.m_totalCost;
+	entry.m_sequence = m_sequence++;
+
+	SiftUp( state.m_heapIndex );
+}
+
+//--------------------------------------------------------------------------------------------------------------
+CNavArea *CNavAreaSearch::PopOpenList( void )
+{
+	Assert( m_heap.Count() );
+
+	CNavArea *area = m_heap[0].m_area;
+	m_state[ area->GetID() ].m_heapIndex = NAV_SEARCH_NEW;
+
+	int last = m_heap.Count() - 1;
+	if ( last > 0 )
+	{
+		m_heap[0] = m_heap[ last ];
+		m_heap.RemoveMultipleFromTail( 1 );
+		SiftDown( 0 );
+	}
+	else
+	{
+		m_heap.RemoveAll();
+	}
+
+	return area;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+void CNavAreaSearch::CopyPathToAreas( CNavArea *lastArea ) const
+{
+	for( CNavArea *area = lastArea; area; )
+	{
+		const NavAreaSearchState_t *state = Find( area );
+		if ( !state )
+			break;
+
+		area->SetParent( state->m_parent, state->m_parentHow );
+		area->SetCostSoFar( state->m_costSoFar );
+		area->SetTotalCost( state->m_totalCost );
+		area->SetPathLengthSoFar( state->m_pathLengthSoFar );
+
+		area = state->m_parent;
+	}
+}
+
+//--------------------------------------------------------------------------------------------------------------
+size_t CNavAreaSearch::GetMemoryUsage( void ) const
+{
+	return m_state.NumAllocated() * sizeof( NavAreaSearchState_t ) + m_heap.NumAllocated() * sizeof( HeapEntry_t );
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+CNavAreaSearchBind::CNavAreaSearchBind( CNavAreaSearch *search )
+{
+	m_prevSearch = s_boundSearch;
+	s_boundSearch = search;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+CNavAreaSearchBind::~CNavAreaSearchBind()
+{
+	s_boundSearch = m_prevSearch;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+const NavAreaSearchState_t *NavAreaSearchBoundState( unsigned int areaID )
+{
+	const CNavAreaSearch *search = s_boundSearch;
+	return search ? search->Find( areaID ) : NULL;
+}
+
+//--------------------------------------------------------------------------------------------------------------
+CNavAreaSearch &NavAreaMainThreadSearch( void )
+{
+	static CNavAreaSearch search;
+	return search;
+}
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Times shortest path queries between random pairs of areas of the loaded mesh,
+ * on the main thread and then spread over the thread pool.
+ */
+struct NavPathQuery_t
+{
+	CNavArea *m_start;
+	CNavArea *m_goal;
+	float m_cost;			// -1 if there is no path
+};
+
+struct NavPathBenchmark_t
+{
+	NavPathQuery_t *m_queries;
+	int m_queryCount;
+	int m_batchSize;
+};
+
+static void RunNavPathQueries( NavPathQuery_t *queries, int count, CNavAreaSearch &search )
+{
+	ShortestPathCost cost;
+	for( int i=0; i<count; ++i )
+	{
+		NavPathQuery_t &query = queries[i];
+		if ( NavAreaBuildPath( search, query.m_start, query.m_goal, NULL, cost ) )
+		{
+			const NavAreaSearchState_t *state = search.Find( query.m_goal );
+			query.m_cost = state ? state->m_costSoFar : 0.0f;
+		}
+		else
+		{
+			query.m_cost = -1.0f;
+		}
+	}
+}
+
+static void RunNavPathBatch( void *context, int begin, int end )
+{
+	NavPathBenchmark_t *benchmark = (NavPathBenchmark_t *)context;
+
+	// one search per batch, batches may run on any thread
+	CNavAreaSearch search;
+	for( int batch=begin; batch<end; ++batch )
+	{
+		int first = batch * benchmark->m_batchSize;
+		int count = MIN( benchmark->m_batchSize, benchmark->m_queryCount - first );
+		RunNavPathQueries( benchmark->m_queries + first, count, search );
+	}
+}
+
+CON_COMMAND_F( nav_pathfind_benchmark, "Time shortest path queries between random areas. Arguments: [query count]", FCVAR_CHEAT )
+{
+	if ( !UTIL_IsCommandIssuedByServerAdmin() )
+		return;
+
+	int areaCount = TheNavAreas.Count();
+	if ( areaCount < 2 )
+	{
+		Msg( "nav_pathfind_benchmark: no navigation mesh loaded\n" );
+		return;
+	}
+
+	int queryCount = ( args.ArgC() > 1 ) ? MAX( atoi( args[1] ), 1 ) : 1000;
+
+	// the same pairs every run on a given mesh
+	CUniformRandomStream random;
+	random.SetSeed( 1234 );
+
+	CUtlVector< NavPathQuery_t > serial;
+	serial.SetCount( queryCount );
+	for( int i=0; i<queryCount; ++i )
+	{
+		serial[i].m_start = TheNavAreas[ random.RandomInt( 0, areaCount - 1 ) ];
+		serial[i].m_goal = TheNavAreas[ random.RandomInt( 0, areaCount - 1 ) ];
+		serial[i].m_cost = -1.0f;
+	}
+
+	CUtlVector< NavPathQuery_t > parallel;
+	parallel.CopyArray( serial.Base(), serial.Count() );
+
+	CFastTimer timer;
+
+	// the main thread's search, the way bots path today
+	timer.Start();
+	RunNavPathQueries( serial.Base(), serial.Count(), NavAreaMainThreadSearch() );
+	timer.End();
+	float serialTime = timer.GetDuration().GetMillisecondsF();
+
+	NavPathBenchmark_t benchmark;
+	benchmark.m_queries = parallel.Base();
+	benchmark.m_queryCount = parallel.Count();
+	benchmark.m_batchSize = 16;
+	int batchCount = ( benchmark.m_queryCount + benchmark.m_batchSize - 1 ) / benchmark.m_batchSize;
+
+	timer.Start();
+	if ( g_pThreadPool )
+	{
+		g_pThreadPool->ParallelFor( RunNavPathBatch, &benchmark, 0, batchCount, 1 );
+	}
+	else
+	{
+		RunNavPathBatch( &benchmark, 0, batchCount );
+	}
+	timer.End();
+	float parallelTime = timer.GetDuration().GetMillisecondsF();
+
+	int found = 0;
+	int mismatched = 0;
+	for( int i=0; i<queryCount; ++i )
+	{
+		if ( serial[i].m_cost >= 0.0f )
+		{
+			++found;
+		}
+		if ( serial[i].m_cost != parallel[i].m_cost )
+		{
+			++mismatched;
+		}
+	}
+
+	Msg( "nav_pathfind_benchmark: %d queries over %d areas, %d paths found\n", queryCount, areaCount, found );
+	Msg( "  main thread: %.2f ms (%.0f queries/s)\n", serialTime, queryCount * 1000.0f / MAX( serialTime, 0.001f ) );
+	Msg( "  thread pool (%d threads): %.2f ms (%.0f queries/s)\n", g_pThreadPool ? g_pThreadPool->NumThreads() : 0, parallelTime, queryCount * 1000.0f / MAX( parallelTime, 0.001f ) );
+	Msg( "  search state: %d bytes\n", (int)NavAreaMainThreadSearch().GetMemoryUsage() );
+	if ( mismatched )
+	{
+		Warning( "nav_pathfind_benchmark: %d queries had different results on the thread pool\n", mismatched );
+	}
+}
@@ -0,0 +1,131 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Open/closed list and per area state of one path search
+//
+//=============================================================================//
+// nav_search.h
+// Search state for NavAreaBuildPath(), kept outside of the areas
+
+#ifndef _NAV_SEARCH_H_
+#define _NAV_SEARCH_H_
+
+#include "tier1/utlvector.h"
+#include "nav_area.h"
+
+enum
+{
+	NAV_SEARCH_NEW = -2,			// reached, but neither open nor closed
+	NAV_SEARCH_CLOSED = -1,
+};
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * The scratch state of an A* search. Areas are looked up by ID, and their state is stamped with the
+ * generation of the search that wrote it, so starting a new search doesn't have to clear anything.
+ * The open list is a binary heap ordered by total cost; areas with the same cost come off in the order
+ * they were added, like the sorted open list of CNavArea.
+ *
+ * A search only touches its own memory, so each thread can run its own search at the same time as others.
+ * While a search is bound to a thread (see CNavAreaSearchBind), the cost, path length and parent accessors
+ * of CNavArea return the bound search's state, so cost functors and path builders work unchanged.
+ */
+class CNavAreaSearch
+{
+public:
+	CNavAreaSearch( void );
+
+	void Begin( void );											// start a new search, forgetting the last one
+
+	const NavAreaSearchState_t *Find( unsigned int areaID ) const	// NULL if this search hasn't reached the area
+	{
+		if ( areaID < (unsigned int)m_state.Count() && m_state[ areaID ].m_generation == m_generation )
+			return &m_state[ areaID ];
+		return NULL;
+	}
+	const NavAreaSearchState_t *Find( const CNavArea *area ) const	{ return Find( area->GetID() ); }
+
+	NavAreaSearchState_t &Reach( CNavArea *area )				// state of the area in this search, created as new if needed
+	{
+		unsigned int id = area->GetID();
+		if ( id >= (unsigned int)m_state.Count() )
+		{
+			Grow( id );
+		}
+
+		NavAreaSearchState_t &state = m_state[ id ];
+		if ( state.m_generation != m_generation )
+		{
+			state.m_generation = m_generation;
+			state.m_heapIndex = NAV_SEARCH_NEW;
+			state.m_totalCost = 0.0f;
+			state.m_costSoFar = 0.0f;
+			state.m_pathLengthSoFar = 0.0f;
+			state.m_parent = NULL;
+			state.m_parentHow = NUM_TRAVERSE_TYPES;
+		}
+		return state;
+	}
+
+	bool IsOpen( const CNavArea *area ) const					{ const NavAreaSearchState_t *state = Find( area ); return state && state->m_heapIndex >= 0; }
+	bool IsClosed( const CNavArea *area ) const					{ const NavAreaSearchState_t *state = Find( area ); return state && state->m_heapIndex == NAV_SEARCH_CLOSED; }
+
+	void AddToOpenList( CNavArea *area );						// area must have been reached
+	void UpdateOnOpenList( CNavArea *area );					// its total cost went down
+	bool IsOpenListEmpty( void ) const							{ return m_heap.Count() == 0; }
+	CNavArea *PopOpenList( void );
+
+	void AddToClosedList( CNavArea *area )						{ Reach( area ).m_heapIndex = NAV_SEARCH_CLOSED; }
+	void RemoveFromClosedList( CNavArea *area )					{ Reach( area ).m_heapIndex = NAV_SEARCH_NEW; }
+
+	CNavArea *GetParent( const CNavArea *area ) const			{ const NavAreaSearchState_t *state = Find( area ); return state ? state->m_parent : NULL; }
+
+	void CopyPathToAreas( CNavArea *lastArea ) const;			// copy the state of the path ending at lastArea to the areas themselves
+
+	size_t GetMemoryUsage( void ) const;
+
+private:
+	struct HeapEntry_t
+	{
+		float m_totalCost;
+		unsigned int m_sequence;
+		CNavArea *m_area;
+	};
+
+	static bool IsBefore( const HeapEntry_t &a, const HeapEntry_t &b )
+	{
+		if ( a.m_totalCost != b.m_totalCost )
+			return a.m_totalCost < b.m_totalCost;
+		return a.m_sequence < b.m_sequence;
+	}
+
+	void Grow( unsigned int areaID );
+	void SiftUp( int index );
+	void SiftDown( int index );
+	void SetHeapEntry( int index, const HeapEntry_t &entry );
+
+	CUtlVector< NavAreaSearchState_t > m_state;				// by area ID
+	CUtlVector< HeapEntry_t > m_heap;
+	unsigned int m_generation;
+	unsigned int m_sequence;
+};
+
+
+//--------------------------------------------------------------------------------------------------------------
+/**
+ * Binds a search to the calling thread for its lifetime
+ */
+class CNavAreaSearchBind
+{
+public:
+	CNavAreaSearchBind( CNavAreaSearch *search );
+	~CNavAreaSearchBind();
+
+private:
+	CNavAreaSearch *m_prevSearch;
+};
+
+CNavAreaSearch &NavAreaMainThreadSearch( void );				// the search used by NavAreaBuildPath() calls that don't pass their own
+
+
+#endif // _NAV_SEARCH_H_
@@ -73,6 +73,7 @@
 #include "dt_utlvector_send.h"
 #include "vote_controller.h"
 #include "ai_speech.h"
+#include "tier1/utlframememory.h"
 
 #if defined USES_ECON_ITEMS
 #include "econ_wearable.h"
@@ -3256,7 +3257,7 @@ void CBasePlayer::PhysicsSimulate( void )
 	
 
 	// Build a list of all available commands
-	CUtlVector< CUserCmd >	vecAvailCommands;
+	CUtlFrameVector< CUserCmd >	vecAvailCommands;
 
 	// Contexts go from oldest to newest
 	for ( int context_number = 0; context_number < command_context_count; context_number++ )
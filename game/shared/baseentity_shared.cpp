@@ -459,7 +459,14 @@ bool CBaseEntity::KeyValue( const char *szKeyName, const char *szValue )
 #ifdef GAME_DLL
 	if ( FStrEq( szKeyName, "targetname" ) )
 	{
-		m_iName = AllocPooledString( szValue );
+		SetName( AllocPooledString( szValue ) );
+		return true;
+	}
+
+	// Goes through SetClassname so the entity list search index sees the change
+	if ( FStrEq( szKeyName, "classname" ) )
+	{
+		SetClassname( szValue );
 		return true;
 	}
 #endif
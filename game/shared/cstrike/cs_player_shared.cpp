@@ -589,73 +589,50 @@ void CCSPlayer::FireBullet(
 			event->SetInt( "sequence", lagPlayer->GetSequence() );
 
 			int numhitboxes = lagPlayer->GetServerHitboxes( positions, angles, indexes );
-			event->SetInt( "num_hitboxes", numhitboxes );
+
+			Vector hitboxPositions[MAXSTUDIOBONES];
+			QAngle hitboxAngles[MAXSTUDIOBONES];
 
 			for ( int i = 0; i < numhitboxes; i++ )
 			{
-				char buffer[256];
-				V_sprintf_safe( buffer, "hitbox_index_%i", i );
-				event->SetInt( buffer, indexes[i] );
-				V_sprintf_safe( buffer, "hitbox_position_x_%i", i );
-				event->SetFloat( buffer, positions[indexes[i]].x );
-				V_sprintf_safe( buffer, "hitbox_position_y_%i", i );
-				event->SetFloat( buffer, positions[indexes[i]].y );
-				V_sprintf_safe( buffer, "hitbox_position_z_%i", i );
-				event->SetFloat( buffer, positions[indexes[i]].z );
-				V_sprintf_safe( buffer, "hitbox_angle_x_%i", i );
-				event->SetFloat( buffer, angles[indexes[i]].x );
-				V_sprintf_safe( buffer, "hitbox_angle_y_%i", i );
-				event->SetFloat( buffer, angles[indexes[i]].y );
-				V_sprintf_safe( buffer, "hitbox_angle_z_%i", i );
-				event->SetFloat( buffer, angles[indexes[i]].z );
+				hitboxPositions[i] = positions[indexes[i]];
+				hitboxAngles[i]	   = angles[indexes[i]];
 			}
 
+			event->SetIntArray( "hitbox_indexes", indexes, numhitboxes );
+			event->SetFloatArray( "hitbox_positions", hitboxPositions[0].Base(), numhitboxes * 3 );
+			event->SetFloatArray( "hitbox_angles", hitboxAngles[0].Base(), numhitboxes * 3 );
+
 			auto model = lagPlayer->GetModelPtr();
 
-			auto numposeparams = model->GetNumPoseParameters();
-			event->SetInt( "num_poseparams", numposeparams );
+			event->SetFloatArray( "pose_params", lagPlayer->GetPoseParameterArray(), model->GetNumPoseParameters() );
+			event->SetFloatArray( "bone_controllers", lagPlayer->GetBoneControllerArray(), model->GetNumBoneControllers() );
 
-			for ( int i = 0; i < numposeparams; i++ )
-			{
-				char buffer[256];
-				V_sprintf_safe( buffer, "pose_param_%i", i );
-				event->SetFloat( buffer, lagPlayer->GetPoseParameterArray()[i] );
-			}
+			auto numanimoverlays = MIN( lagPlayer->GetNumAnimOverlays(), ( int )CBaseAnimatingOverlay::MAX_OVERLAYS );
 
-			auto numbonecontrollers = model->GetNumBoneControllers();
-			event->SetInt( "num_bonecontrollers", numbonecontrollers );
-
-			for ( int i = 0; i < numbonecontrollers; i++ )
-			{
-				char buffer[256];
-				V_sprintf_safe( buffer, "bone_controller_%i", i );
-				event->SetFloat( buffer, lagPlayer->GetBoneControllerArray()[i] );
-			}
-
-			auto numanimoverlays = lagPlayer->GetNumAnimOverlays();
-			event->SetInt( "num_anim_overlays", numanimoverlays );
+			float overlayCycles[CBaseAnimatingOverlay::MAX_OVERLAYS];
+			int overlaySequences[CBaseAnimatingOverlay::MAX_OVERLAYS];
+			float overlayWeights[CBaseAnimatingOverlay::MAX_OVERLAYS];
+			int overlayOrders[CBaseAnimatingOverlay::MAX_OVERLAYS];
+			int overlayFlags[CBaseAnimatingOverlay::MAX_OVERLAYS];
 
 			for ( int i = 0; i < numanimoverlays; i++ )
 			{
 				auto animOverlay = lagPlayer->GetAnimOverlay( i );
 
-				char buffer[256];
-				V_sprintf_safe( buffer, "anim_overlay_cycle_%i", i );
-				event->SetFloat( buffer, animOverlay->m_flCycle.Get() );
-
-				V_sprintf_safe( buffer, "anim_overlay_sequence_%i", i );
-				event->SetInt( buffer, animOverlay->m_nSequence.Get() );
-
-				V_sprintf_safe( buffer, "anim_overlay_weight_%i", i );
-				event->SetFloat( buffer, animOverlay->m_flWeight.Get() );
-
-				V_sprintf_safe( buffer, "anim_overlay_order_%i", i );
-				event->SetInt( buffer, animOverlay->m_nOrder.Get() );
-
-				V_sprintf_safe( buffer, "anim_overlay_flags_%i", i );
-				event->SetInt( buffer, animOverlay->m_fFlags.Get() );
+				overlayCycles[i]	= animOverlay->m_flCycle.Get();
+				overlaySequences[i] = animOverlay->m_nSequence.Get();
+				overlayWeights[i]	= animOverlay->m_flWeight.Get();
+				overlayOrders[i]	= animOverlay->m_nOrder.Get();
+				overlayFlags[i]		= animOverlay->m_fFlags.Get();
 			}
 
+			event->SetFloatArray( "anim_overlay_cycles", overlayCycles, numanimoverlays );
+			event->SetIntArray( "anim_overlay_sequences", overlaySequences, numanimoverlays );
+			event->SetFloatArray( "anim_overlay_weights", overlayWeights, numanimoverlays );
+			event->SetIntArray( "anim_overlay_orders", overlayOrders, numanimoverlays );
+			event->SetIntArray( "anim_overlay_flags", overlayFlags, numanimoverlays );
+
 			gameeventmanager->FireEvent( event );
 		}
 	};
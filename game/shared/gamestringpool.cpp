@@ -8,6 +8,7 @@
 #include "cbase.h"
 
 #include "utlhashtable.h"
+#include "tier1/utlstringintern.h"
 #ifndef GC
 #include "igamesystem.h"
 #endif
@@ -31,29 +32,26 @@ class CGameStringPool : public CBaseGameSystem
 	void FreeAll()
 	{
 #if 0 && _DEBUG
-		m_Strings.DbgCheckIntegrity();
 		m_KeyLookupCache.DbgCheckIntegrity();
 #endif
 		m_Strings.Purge();
 		m_KeyLookupCache.Purge();
 	}
 
-	CUtlHashtable<CUtlConstString> m_Strings;
+	// Lookups don't lock and are safe from any thread, the key cache is main thread only
+	CUtlStringInternTable m_Strings;
 	CUtlHashtable<const void*, const char*> m_KeyLookupCache;
 
 public:
 
-	CGameStringPool() : m_Strings(256) { }
+	CGameStringPool() { }
 
 	~CGameStringPool() { FreeAll(); }
 
 	void Dump( void )
 	{
 		CUtlVector<const char*> strings( 0, m_Strings.Count() );
-		for (UtlHashHandle_t i = m_Strings.FirstHandle(); i != m_Strings.InvalidHandle(); i = m_Strings.NextHandle(i))
-		{
-			strings.AddToTail( strings[i] );
-		}
+		m_Strings.GetStrings( strings );
 		struct _Local {
 			static int __cdecl F(const char * const *a, const char * const *b) { return strcmp(*a, *b); }
 		};
@@ -64,18 +62,17 @@ public:
 			DevMsg( "  %d (0x%p) : %s\n", i, strings[i], strings[i] );
 		}
 		DevMsg( "\n" );
-		DevMsg( "Size:  %d items\n", strings.Count() );
+		DevMsg( "Size:  %d items, %d bytes\n", strings.Count(), (int)m_Strings.GetMemoryUsage() );
 	}
 
 	const char *Find(const char *string)
 	{
-		UtlHashHandle_t i = m_Strings.Find( string );
-		return i == m_Strings.InvalidHandle() ? NULL : m_Strings[ i ].Get();
+		return m_Strings.Find( string );
 	}
 
 	const char *Allocate(const char *string)
 	{
-		return m_Strings[ m_Strings.Insert( string ) ].Get();
+		return m_Strings.Intern( string );
 	}
 
 	const char *AllocateWithKey(const char *string, const void* key)
@@ -123,6 +120,17 @@ string_t FindPooledString( const char *pszValue )
 	return MAKE_STRING( g_GameStringPool.Find( pszValue ) );
 }
 
+unsigned int GetPooledStringCaselessHash( string_t str )
+{
+	AssertIsValidString( str );
+	return str == NULL_STRING ? HashPooledStringCaseless( "" ) : CUtlStringInternTable::GetCaselessHash( STRING( str ) );
+}
+
+unsigned int HashPooledStringCaseless( const char *pszValue )
+{
+	return CUtlStringInternTable::HashStringCaseless( pszValue ? pszValue : "" );
+}
+
 #if !defined(CLIENT_DLL) && !defined( GC )
 //------------------------------------------------------------------------------
 // Purpose: 
@@ -21,6 +21,12 @@ string_t AllocPooledString( const char *pszValue );
 string_t AllocPooledString_StaticConstantStringPointer( const char *pszGlobalConstValue );
 string_t FindPooledString( const char *pszValue );
 
+// Ascii case folded hash stored with a pooled string, equal to
+// HashPooledStringCaseless() of its text. Only valid for strings returned by
+// the functions above.
+unsigned int GetPooledStringCaselessHash( string_t str );
+unsigned int HashPooledStringCaseless( const char *pszValue );
+
 #define AssertIsValidString( s )	AssertMsg( s == NULL_STRING || s == FindPooledString( STRING(s) ), "Invalid string " #s );
 		 
 #ifndef GC
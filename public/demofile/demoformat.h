@@ -15,7 +15,8 @@
 #include "tier0/platform.h"
 
 #define DEMO_HEADER_ID		"HL2DEMO"
-#define DEMO_PROTOCOL		3
+#define DEMO_HEADER_ID_ZSTD	"HL2DEMZ"		// demo compressed in chunks, see demochunk_t
+#define DEMO_PROTOCOL		4
 
 #if !defined( MAX_OSPATH )
 #define	MAX_OSPATH		260			// max length of a filesystem pathname
@@ -70,6 +71,131 @@ inline void ByteSwap_demoheader_t( demoheader_t &swap )
 	swap.signonlength = LittleDWord( swap.signonlength );
 }
 
+// A compressed demo starts with its demoheader_t, uncompressed. The rest of the demo follows
+// in chunks of DEMO_CHUNK_SIZE bytes, each compressed on its own with the engine's zstd
+// dictionary (COM_BufferToBufferCompress_ZSTD), so reading can start at any chunk. The file
+// ends with the seek index, one demochunk_t per chunk, and a demochunktrailer_t.
+#define DEMO_CHUNK_SIZE		(256*1024)
+#define DEMO_CHUNK_INDEX_ID	(('X'<<24)|('D'<<16)|('N'<<8)|('I'))
+
+struct demochunk_t
+{
+	int		uncompressedOffset;				// in the uncompressed demo, counting the header
+	int		uncompressedSize;
+	int		fileOffset;						// of the compressed data
+	int		compressedSize;
+};
+
+struct demochunktrailer_t
+{
+	int		id;								// Should be DEMO_CHUNK_INDEX_ID
+	int		indexOffset;					// file offset of the first demochunk_t
+	int		numChunks;
+};
+
+inline void ByteSwap_demochunk_t( demochunk_t &swap )
+{
+	swap.uncompressedOffset = LittleDWord( swap.uncompressedOffset );
+	swap.uncompressedSize = LittleDWord( swap.uncompressedSize );
+	swap.fileOffset = LittleDWord( swap.fileOffset );
+	swap.compressedSize = LittleDWord( swap.compressedSize );
+}
+
+inline void ByteSwap_demochunktrailer_t( demochunktrailer_t &swap )
+{
+	swap.id = LittleDWord( swap.id );
+	swap.indexOffset = LittleDWord( swap.indexOffset );
+	swap.numChunks = LittleDWord( swap.numChunks );
+}
+
+// A keyframe holds the full state after the dem_packet of a tick: a dem_stringtables command
+// with all string tables, then a dem_packet with an uncompressed entity update of that tick.
+// Keyframes are stored after dem_stop, so readers that don't know about them never see them.
+// After them comes the index, then a demokeyframetrailer_t at the very end of the demo.
+// Playback jumps to a keyframe, reads it, then goes on at the packet that follows the one of
+// the keyframe's tick, which is delta compressed against that tick.
+// Offsets are positions in the demo as read, after any decompression.
+#define DEMO_KEYFRAME_INDEX_ID	(('X'<<24)|('D'<<16)|('F'<<8)|('K'))
+
+struct demokeyframe_t
+{
+	int		tick;
+	int		frameOffset;					// where playback goes on, after the dem_packet of tick
+	int		keyframeOffset;					// of the keyframe's dem_stringtables, after dem_stop
+	int		keyframeEndOffset;				// after the keyframe's dem_packet
+};
+
+struct demokeyframetrailer_t
+{
+	int		id;								// Should be DEMO_KEYFRAME_INDEX_ID
+	int		indexOffset;					// offset of the first demokeyframe_t
+	int		numKeyframes;
+};
+
+inline void ByteSwap_demokeyframe_t( demokeyframe_t &swap )
+{
+	swap.tick = LittleDWord( swap.tick );
+	swap.frameOffset = LittleDWord( swap.frameOffset );
+	swap.keyframeOffset = LittleDWord( swap.keyframeOffset );
+	swap.keyframeEndOffset = LittleDWord( swap.keyframeEndOffset );
+}
+
+inline void ByteSwap_demokeyframetrailer_t( demokeyframetrailer_t &swap )
+{
+	swap.id = LittleDWord( swap.id );
+	swap.indexOffset = LittleDWord( swap.indexOffset );
+	swap.numKeyframes = LittleDWord( swap.numKeyframes );
+}
+
+// demo_analyze decodes a demo into a stream of records, written next to the demo with the
+// DEMO_ANALYSIS_EXTENSION extension. The stream starts with a demoanalysisheader_t, each
+// record is a dma_* byte followed by its fields. Numbers are little endian and strings are
+// null terminated. Entity properties are numbered by their index in the flattened property
+// list of the entity's class, as listed by its dma_class record. A demo that couldn't be
+// decoded to its end has no dma_stop record.
+#define DEMO_ANALYSIS_ID		"HL2DEMA"
+#define DEMO_ANALYSIS_VERSION	1
+#define DEMO_ANALYSIS_EXTENSION	".dma"
+
+struct demoanalysisheader_t
+{
+	char	id[8];							// Should be DEMO_ANALYSIS_ID
+	int		version;						// Should be DEMO_ANALYSIS_VERSION
+	int		networkprotocol;				// of the demo
+	char	mapname[ MAX_OSPATH ];			// Name of map
+};
+
+// Records of the analysis stream
+enum
+{
+	// float tick interval, short max classes
+	dma_serverinfo = 1,
+	// short class id, string class name, string table name, short prop count, per prop:
+	// byte type (DPT_*), for DPT_Array a byte element type, string name
+	dma_class,
+	// int tick, the records up to the next dma_tick happened on it
+	dma_tick,
+	// short entity, short class id, short serial number, then all its props as in dma_props
+	dma_enter,
+	// short entity, byte 1 if the entity was deleted or 0 if it only left the PVS
+	dma_leave,
+	// short entity, then per changed prop a short prop index and the value, ended by index -1.
+	// DPT_Int is an int, DPT_Float a float, DPT_Vector 3 and DPT_VectorXY 2 floats, DPT_String
+	// a string and DPT_Array a short element count followed by the elements
+	dma_props,
+	// short event id, string name, byte key count, per networked key: byte type
+	// (CGameEventManager TYPE_*), string name
+	dma_eventtype,
+	// short event id, per key of its type a byte 1 and the value if it was sent or a byte 0.
+	// Strings are strings, floats floats, longs ints, shorts shorts, bytes and bools bytes, and
+	// arrays an int count followed by 4 byte elements. Then an int count of extra keys, per key:
+	// string name, byte type (KeyValues TYPE_*) and for TYPE_STRING, TYPE_FLOAT and TYPE_INT
+	// a string, float or int value
+	dma_event,
+	// end of the demo
+	dma_stop,
+};
+
 #define FDEMO_NORMAL		0
 #define FDEMO_USE_ORIGIN2	(1<<0)
 #define FDEMO_USE_ANGLES2	(1<<1)
@@ -16,6 +16,7 @@
 #include "tier0/fasttimer.h"
 #include "vphysics/virtualmesh.h"
 #include "tier1/datamanager.h"
+#include "tier1/utlbuffer.h"
 // memdbgon must be the last include file in a .cpp file!!!
 #include "tier0/memdbgon.h"
 
@@ -1490,6 +1491,94 @@ void CDispCollTree::GetVirtualMeshList( virtualmeshlist_t *pList )
 	}
 }
 
+//-----------------------------------------------------------------------------
+// Purpose: Save/restore the output of Create()
+//-----------------------------------------------------------------------------
+struct DispCollTreeHeader_t
+{
+	int				m_nPower;
+	int				m_nFlags;
+	int				m_nContents;
+	unsigned int	m_nSize;
+	Vector			m_mins;
+	Vector			m_maxs;
+	Vector			m_vecSurfPoints[4];
+	Vector			m_vecStabDir;
+	int				m_nVerts;
+	int				m_nTris;
+	int				m_nNodes;
+	int				m_nLeaves;
+};
+
+void CDispCollTree::Serialize( CUtlBuffer &buf ) const
+{
+	DispCollTreeHeader_t header;
+	header.m_nPower = m_nPower;
+	header.m_nFlags = m_nFlags;
+	header.m_nContents = m_nContents;
+	header.m_nSize = m_nSize;
+	header.m_mins = m_mins;
+	header.m_maxs = m_maxs;
+	for ( int iPoint = 0; iPoint < 4; ++iPoint )
+	{
+		header.m_vecSurfPoints[iPoint] = m_vecSurfPoints[iPoint];
+	}
+	header.m_vecStabDir = m_vecStabDir;
+	header.m_nVerts = m_aVerts.Count();
+	header.m_nTris = m_aTris.Count();
+	header.m_nNodes = m_nodes.Count();
+	header.m_nLeaves = m_leaves.Count();
+
+	buf.Put( &header, sizeof( header ) );
+	buf.Put( m_aVerts.Base(), m_aVerts.Count() * sizeof( m_aVerts[0] ) );
+	buf.Put( m_aTris.Base(), m_aTris.Count() * sizeof( m_aTris[0] ) );
+	buf.Put( m_nodes.Base(), m_nodes.Count() * sizeof( m_nodes[0] ) );
+	buf.Put( m_leaves.Base(), m_leaves.Count() * sizeof( m_leaves[0] ) );
+}
+
+bool CDispCollTree::Unserialize( CUtlBuffer &buf )
+{
+	DispCollTreeHeader_t header;
+	buf.Get( &header, sizeof( header ) );
+	if ( !buf.IsValid() || header.m_nPower < 0 || header.m_nPower > MAX_MAP_DISP_POWER )
+		return false;
+
+	m_nPower = header.m_nPower;
+
+	// Counts have to be the ones Create() would have made for this power
+	int numLeaves = ( GetWidth() - 1 ) * ( GetHeight() - 1 );
+	if ( header.m_nVerts != GetSize() || header.m_nTris != GetTriSize() ||
+		 header.m_nLeaves != numLeaves || header.m_nNodes != Nodes_CalcCount( m_nPower ) - numLeaves )
+	{
+		return false;
+	}
+
+	m_nFlags = header.m_nFlags;
+	m_nContents = header.m_nContents;
+	m_nSize = header.m_nSize;
+	m_mins = header.m_mins;
+	m_maxs = header.m_maxs;
+	for ( int iPoint = 0; iPoint < 4; ++iPoint )
+	{
+		m_vecSurfPoints[iPoint] = header.m_vecSurfPoints[iPoint];
+	}
+	m_vecStabDir = header.m_vecStabDir;
+
+	{
+	MEM_ALLOC_CREDIT();
+	m_aVerts.SetCount( header.m_nVerts );
+	m_aTris.SetCount( header.m_nTris );
+	m_nodes.SetCount( header.m_nNodes );
+	m_leaves.SetCount( header.m_nLeaves );
+	}
+
+	buf.Get( m_aVerts.Base(), m_aVerts.Count() * sizeof( m_aVerts[0] ) );
+	buf.Get( m_aTris.Base(), m_aTris.Count() * sizeof( m_aTris[0] ) );
+	buf.Get( m_nodes.Base(), m_nodes.Count() * sizeof( m_nodes[0] ) );
+	buf.Get( m_leaves.Base(), m_leaves.Count() * sizeof( m_leaves[0] ) );
+	return buf.IsValid();
+}
+
 //-----------------------------------------------------------------------------
 //-----------------------------------------------------------------------------
 #ifdef ENGINE_DLL
@@ -30,6 +30,8 @@ class CDispVector : public CUtlVector<T, CUtlMemoryAligned<T,16> >
 
 FORWARD_DECLARE_HANDLE( memhandle_t );
 
+class CUtlBuffer;
+
 #define DISPCOLL_TREETRI_SIZE		MAX_DISPTRIS
 #define DISPCOLL_DIST_EPSILON		0.03125f
 #define DISPCOLL_ROOTNODE_INDEX		0
@@ -208,6 +210,11 @@ public:
 	void GetVirtualMeshList( struct virtualmeshlist_t *pList );
 	int AABBTree_GetTrisInSphere( const Vector &center, float radius, unsigned short *pIndexOut, int indexMax );
 
+	// Persistence of a tree as Create() leaves it, so loaders can skip rebuilding it.
+	// Surface props aren't included, they index a table that can change between runs.
+	void Serialize( CUtlBuffer &buf ) const;
+	bool Unserialize( CUtlBuffer &buf );
+
 public:
 
 	inline int Nodes_GetChild( int iNode, int nDirection );
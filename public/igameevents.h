@@ -51,6 +51,14 @@ of data fields. each data field must specify a data type, so the engine
 knows how to serialize/unserialize that event for network transmission.
 Valid data types are string, float, long, short, byte & bool. If a 
 data field should not be broadcasted to clients, use the type "local".
+
+Fields that carry a variable number of values use "float_array" or
+"long_array" and are accessed with Set/GetFloatArray and Set/GetIntArray;
+they are networked as a count followed by the raw 32 bit values.
+
+The declared fields of an event are compiled into a fixed slot layout when
+the event is registered. GetKeySlot() returns the slot of a field, which can
+then be read and written without looking the name up again.
 */
 
 
@@ -83,6 +91,19 @@ public:
 	virtual void SetFloat( const char *keyName, float value ) = 0;
 	virtual void SetString( const char *keyName, const char *value ) = 0;
 	virtual KeyValues *GetDataKeys() = 0;
+
+	// Array fields, GetXXXArray copies at most maxCount values and returns how many it copied
+	virtual void SetFloatArray( const char *keyName, const float *values, int count ) = 0;
+	virtual void SetIntArray( const char *keyName, const int *values, int count ) = 0;
+	virtual int  GetFloatArray( const char *keyName, float *values, int maxCount ) = 0;
+	virtual int  GetIntArray( const char *keyName, int *values, int maxCount ) = 0;
+
+	// Slot access to declared fields, GetKeySlot returns -1 if the field isn't declared
+	virtual int   GetKeySlot( const char *keyName ) const = 0;
+	virtual int   GetIntBySlot( int slot, int defaultValue = 0 ) = 0;
+	virtual float GetFloatBySlot( int slot, float defaultValue = 0.0f ) = 0;
+	virtual void  SetIntBySlot( int slot, int value ) = 0;
+	virtual void  SetFloatBySlot( int slot, float value ) = 0;
 };
 
 
@@ -0,0 +1,47 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Per-thread bump allocator for memory that only lives for one frame
+//
+// Every thread gets its own arena, so allocating takes no locks and only
+// bumps a pointer. Nothing is freed individually: FrameArena_EndFrame(),
+// called by the engine at the end of each host frame, releases everything
+// allocated during the frame at once. A thread's arena rewinds the first
+// time it allocates after that.
+//
+// Memory from the frame arena must not be kept past the end of the frame,
+// passed to free()/delete, or used by code that can run outside a host frame.
+// See CUtlFrameMemory/CUtlFrameVector in tier1/utlframememory.h.
+//
+//=============================================================================//
+
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "tier0/platform.h"
+
+struct FrameArenaStats_t
+{
+	int		m_nFrame;
+	int		m_nAllocations;		// allocations served by the arenas
+	int		m_nBytes;			// bytes handed out, before alignment
+	int		m_nBlockAllocations;// heap blocks the arenas had to allocate
+	int		m_nThreads;			// threads that used their arena
+	int		m_nReservedBytes;	// size of all arena blocks, all threads
+};
+
+PLATFORM_INTERFACE void *FrameArena_Alloc( size_t nBytes, size_t nAlignment = 16 );
+
+// Releases all frame arena memory, no thread may be using any of it
+PLATFORM_INTERFACE void FrameArena_EndFrame();
+
+// Incremented by FrameArena_EndFrame
+PLATFORM_INTERFACE int FrameArena_GetFrame();
+
+// Totals over all threads for the last completed frame
+PLATFORM_INTERFACE void FrameArena_GetStats( FrameArenaStats_t *pStats );
+
+
+#endif // FRAMEARENA_H
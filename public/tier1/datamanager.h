@@ -30,8 +30,9 @@ public:
 	// type-safe implementation in derived class
 	//void					*LockResource( memhandle_t handle );
 	int						UnlockResource( memhandle_t handle );
-	void					TouchResource( memhandle_t handle );
+	void					TouchResource( memhandle_t handle );	// lock free, sets the reference bit
 	void					MarkAsStale( memhandle_t handle );		// move to head of LRU
+	bool					TestAndClearReferenced( memhandle_t handle ); // must lock first
 
 	int						LockCount( memhandle_t handle );
 	int						BreakLock( memhandle_t handle );
@@ -71,6 +72,12 @@ public:
 	void					GetLRUHandleList( CUtlVector< memhandle_t >& list );
 	void					GetLockHandleList( CUtlVector< memhandle_t >& list );
 
+	// Replacement stats: resources freed to make room, and resources skipped
+	// over because they were referenced since the clock hand last passed them
+	unsigned int			EvictionCount() const		{ return m_nEvictions; }
+	unsigned int			SecondChanceCount() const	{ return m_nSecondChances; }
+	void					ResetStats()				{ m_nEvictions = 0; m_nSecondChances = 0; }
+
 
 protected:
 	// derived class must call these to implement public API
@@ -102,6 +109,21 @@ protected:
 	void					TouchByIndex( unsigned short memoryIndex );
 	void *					GetForFreeByIndex( unsigned short memoryIndex );
 
+	// The unlocked list is replaced with CLOCK rather than exact LRU: touching
+	// a resource only sets its reference bit, and eviction gives referenced
+	// resources at the head of the list a second chance by moving them to the
+	// tail. The bits live outside m_memoryLists, in chunks that never move, so
+	// they can be set without the mutex while the lists grow.
+	enum
+	{
+		REFERENCE_CHUNK_SIZE = 256,
+		REFERENCE_CHUNK_COUNT = 65536 / REFERENCE_CHUNK_SIZE,
+	};
+
+	void					AllocReferenceBit( unsigned short memoryIndex );
+	inline void				SetReferenced( unsigned int memoryIndex );
+	inline bool				TestAndClearReferencedByIndex( unsigned short memoryIndex );
+
 	// One of these is stored per active allocation
 	struct resource_lru_element_t
 	{
@@ -119,6 +141,10 @@ protected:
 
 	unsigned int m_targetMemorySize;
 	unsigned int m_memUsed;
+	unsigned int m_nEvictions;
+	unsigned int m_nSecondChances;
+
+	volatile uint8 *m_pReferenceChunks[REFERENCE_CHUNK_COUNT];
 	
 	CUtlMultiList< resource_lru_element_t, unsigned short >  m_memoryLists;
 	
@@ -279,6 +305,29 @@ inline unsigned short CDataManagerBase::FromHandle( memhandle_t handle )
 	return m_memoryLists.InvalidIndex();
 }
 
+inline void CDataManagerBase::SetReferenced( unsigned int memoryIndex )
+{
+	if ( memoryIndex >= REFERENCE_CHUNK_SIZE * REFERENCE_CHUNK_COUNT )
+		return;
+
+	volatile uint8 *pChunk = m_pReferenceChunks[memoryIndex / REFERENCE_CHUNK_SIZE];
+	// Test first so hot resources don't keep dirtying the line for other cores
+	if ( pChunk && !pChunk[memoryIndex % REFERENCE_CHUNK_SIZE] )
+	{
+		pChunk[memoryIndex % REFERENCE_CHUNK_SIZE] = 1;
+	}
+}
+
+inline bool CDataManagerBase::TestAndClearReferencedByIndex( unsigned short memoryIndex )
+{
+	volatile uint8 *pChunk = m_pReferenceChunks[memoryIndex / REFERENCE_CHUNK_SIZE];
+	if ( !pChunk || !pChunk[memoryIndex % REFERENCE_CHUNK_SIZE] )
+		return false;
+
+	pChunk[memoryIndex % REFERENCE_CHUNK_SIZE] = 0;
+	return true;
+}
+
 inline int CDataManagerBase::LockCount( memhandle_t handle )
 {
 	Lock();
@@ -0,0 +1,86 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Read-only memory mapping of files on disk, with bounded views
+//			handed out over the mapping instead of copies.
+//
+//===========================================================================//
+
+#ifndef MEMORYMAPPEDFILE_H
+#define MEMORYMAPPEDFILE_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "tier0/platform.h"
+
+
+//-----------------------------------------------------------------------------
+// A non-owning window into a mapped file. Stays valid as long as the
+// CMemoryMappedFile it came from is open.
+//-----------------------------------------------------------------------------
+class CMemoryMappedFileView
+{
+public:
+	CMemoryMappedFileView() : m_pData( NULL ), m_nSize( 0 ) {}
+	CMemoryMappedFileView( const uint8 *pData, int64 nSize ) : m_pData( pData ), m_nSize( nSize ) {}
+
+	const uint8 *Base() const	{ return m_pData; }
+	int64 Count() const			{ return m_nSize; }
+	bool IsValid() const		{ return m_pData != NULL; }
+
+	// Returns a sub-view, or an invalid view if the range doesn't fit
+	CMemoryMappedFileView Slice( int64 nOffset, int64 nSize ) const
+	{
+		if ( !m_pData || nOffset < 0 || nSize < 0 || nOffset + nSize > m_nSize )
+			return CMemoryMappedFileView();
+		return CMemoryMappedFileView( m_pData + nOffset, nSize );
+	}
+
+private:
+	const uint8 *m_pData;
+	int64 m_nSize;
+};
+
+
+//-----------------------------------------------------------------------------
+// Maps a whole file into the address space. Pages are private copy-on-write,
+// so callers that patch data in place (byteswapping, fixups) never touch the
+// file, and untouched pages are shared with the page cache rather than
+// counted against our heap.
+//-----------------------------------------------------------------------------
+class CMemoryMappedFile
+{
+public:
+	CMemoryMappedFile();
+	~CMemoryMappedFile();
+
+	// pFullPath must be an absolute path on the local disk
+	bool Open( const char *pFullPath );
+	void Close();
+
+	bool IsOpen() const			{ return m_pBase != NULL; }
+	uint8 *Base() const			{ return m_pBase; }
+	int64 Size() const			{ return m_nSize; }
+
+	// Returns a view of [nOffset, nOffset + nSize), or an invalid view if out of range
+	CMemoryMappedFileView View( int64 nOffset, int64 nSize ) const;
+	CMemoryMappedFileView View() const { return CMemoryMappedFileView( m_pBase, m_nSize ); }
+
+	// Paging hints. WillNeed starts readahead for a range we're about to walk,
+	// DontNeed drops clean pages we're done with so they stop counting towards RSS.
+	void WillNeed( int64 nOffset, int64 nSize ) const;
+	void DontNeed( int64 nOffset, int64 nSize ) const;
+
+private:
+	CMemoryMappedFile( const CMemoryMappedFile & );
+	CMemoryMappedFile &operator=( const CMemoryMappedFile & );
+
+	uint8 *m_pBase;
+	int64 m_nSize;
+#ifdef _WIN32
+	void *m_hFile;
+	void *m_hMapping;
+#endif
+};
+
+#endif // MEMORYMAPPEDFILE_H
@@ -0,0 +1,137 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: CUtlMemory replacement that allocates from the per-thread frame
+// arena (tier0/framearena.h), and a vector using it. Meant for scratch
+// containers that are built and thrown away within one frame.
+//
+// Growing copies into a new arena allocation, the old one is only reclaimed
+// at the end of the frame, so reserve up front when the size is known.
+// A frame container must not be kept past the end of the frame it was first
+// allocated in.
+//
+//=============================================================================//
+
+#ifndef UTLFRAMEMEMORY_H
+#define UTLFRAMEMEMORY_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "tier0/framearena.h"
+#include "tier1/utlvector.h"
+
+template< class T, class I = int >
+class CUtlFrameMemory
+{
+public:
+	CUtlFrameMemory( int nGrowSize = 0, int nInitSize = 0 ) : m_pMemory( NULL ), m_nAllocationCount( 0 ), m_nFrame( -1 )
+	{
+		if ( nInitSize )
+		{
+			EnsureCapacity( nInitSize );
+		}
+	}
+
+	class Iterator_t
+	{
+	public:
+		Iterator_t( I i ) : index( i ) {}
+		I index;
+
+		bool operator==( const Iterator_t it ) const	{ return index == it.index; }
+		bool operator!=( const Iterator_t it ) const	{ return index != it.index; }
+	};
+	Iterator_t First() const							{ return Iterator_t( IsIdxValid( 0 ) ? 0 : InvalidIndex() ); }
+	Iterator_t Next( const Iterator_t &it ) const		{ return Iterator_t( IsIdxValid( it.index + 1 ) ? it.index + 1 : InvalidIndex() ); }
+	I GetIndex( const Iterator_t &it ) const			{ return it.index; }
+	bool IsIdxAfter( I i, const Iterator_t &it ) const	{ return i > it.index; }
+	bool IsValidIterator( const Iterator_t &it ) const	{ return IsIdxValid( it.index ); }
+	Iterator_t InvalidIterator() const					{ return Iterator_t( InvalidIndex() ); }
+
+	// element access
+	T& operator[]( I i )								{ Assert( IsIdxValid( i ) ); return m_pMemory[i]; }
+	const T& operator[]( I i ) const					{ Assert( IsIdxValid( i ) ); return m_pMemory[i]; }
+	T& Element( I i )									{ Assert( IsIdxValid( i ) ); return m_pMemory[i]; }
+	const T& Element( I i ) const						{ Assert( IsIdxValid( i ) ); return m_pMemory[i]; }
+
+	bool IsIdxValid( I i ) const						{ return ( (int)i >= 0 ) && ( (int)i < m_nAllocationCount ); }
+	static I InvalidIndex()								{ return ( I )-1; }
+
+	T* Base()											{ return m_pMemory; }
+	const T* Base() const								{ return m_pMemory; }
+
+	int NumAllocated() const							{ return m_nAllocationCount; }
+	int Count() const									{ return m_nAllocationCount; }
+
+	// Grows the memory, so that at least allocated + num elements are allocated
+	void Grow( int num = 1 )
+	{
+		EnsureCapacity( MAX( m_nAllocationCount + num, m_nAllocationCount * 2 ) );
+	}
+
+	// Makes sure we've got at least this much memory
+	void EnsureCapacity( int num )
+	{
+		if ( num <= m_nAllocationCount )
+			return;
+
+		// memory from an earlier frame is gone
+		Assert( !m_pMemory || m_nFrame == FrameArena_GetFrame() );
+
+		num = MAX( num, (int)( 64 / sizeof( T ) ) );
+		T *pMemory = (T *)FrameArena_Alloc( num * sizeof( T ), MAX( (size_t)VALIGNOF( T ), sizeof( void * ) ) );
+		if ( !pMemory )
+		{
+			Error( "CUtlFrameMemory: out of memory allocating %d bytes\n", (int)( num * sizeof( T ) ) );
+		}
+
+		if ( m_nAllocationCount )
+		{
+			memcpy( (void *)pMemory, (const void *)m_pMemory, m_nAllocationCount * sizeof( T ) );
+		}
+
+		m_pMemory = pMemory;
+		m_nAllocationCount = num;
+		m_nFrame = FrameArena_GetFrame();
+	}
+
+	// The arena takes the memory back at the end of the frame
+	void Purge()										{ m_pMemory = NULL; m_nAllocationCount = 0; }
+	void Purge( int numElements )						{ if ( !numElements ) Purge(); }
+
+	bool IsExternallyAllocated() const					{ return false; }
+	bool IsReadOnly() const								{ return false; }
+
+	void SetGrowSize( int size )						{}
+
+	void Swap( CUtlFrameMemory< T, I > &mem )
+	{
+		V_swap( m_pMemory, mem.m_pMemory );
+		V_swap( m_nAllocationCount, mem.m_nAllocationCount );
+		V_swap( m_nFrame, mem.m_nFrame );
+	}
+
+private:
+	CUtlFrameMemory( const CUtlFrameMemory& );
+	CUtlFrameMemory& operator=( const CUtlFrameMemory& );
+
+	T*	m_pMemory;
+	int	m_nAllocationCount;
+	int	m_nFrame;
+};
+
+
+//-----------------------------------------------------------------------------
+// The CUtlFrameVector class:
+// A vector whose memory comes from the frame arena
+//-----------------------------------------------------------------------------
+template< class T >
+class CUtlFrameVector : public CUtlVector< T, CUtlFrameMemory< T > >
+{
+	typedef CUtlVector< T, CUtlFrameMemory< T > > BaseClass;
+public:
+	explicit CUtlFrameVector( int initSize = 0 ) : BaseClass( 0, initSize ) {}
+};
+
+
+#endif // UTLFRAMEMEMORY_H
@@ -0,0 +1,343 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: insertion ordered, case insensitive string dictionary backed by an
+// open addressing hash index with stored hashes.
+//
+// Usage notes:
+// - indices are assigned in insertion order, starting at 0, and never change.
+//   There is no removal, only RemoveAll()/Purge().
+// - element and string addresses are stable: elements live in fixed size
+//   chunks and strings are interned in an arena that is never reallocated.
+// - Insert() returns the index of an existing match if there is one.
+// - in filename mode '\' and '/' compare equal, "./" sequences are removed
+//   and strings are stored with forward slashes.
+//
+// Implementation notes:
+// - the index table holds { hash, element index } pairs and is kept at most
+//   half full, lookups probe linearly and only compare strings whose stored
+//   hash matches.
+//
+//=============================================================================//
+
+#ifndef UTLHASHEDSTRINGDICT_H
+#define UTLHASHEDSTRINGDICT_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "tier1/utlvector.h"
+#include "tier1/strtools.h"
+
+template < class T >
+class CUtlHashedStringDict
+{
+public:
+	explicit CUtlHashedStringDict( bool bFilenames = false );
+	~CUtlHashedStringDict();
+
+	int			Count() const							{ return m_nCount; }
+	bool		IsValidIndex( int i ) const				{ return i >= 0 && i < m_nCount; }
+	static int	InvalidIndex()							{ return -1; }
+
+	int			Insert( const char *pString );
+	int			Find( const char *pString ) const;
+
+	const char	*String( int i ) const					{ Assert( IsValidIndex( i ) ); return m_Strings[i]; }
+	T			&Element( int i )						{ Assert( IsValidIndex( i ) ); return m_Chunks[i >> CHUNK_BITS][i & CHUNK_MASK]; }
+	const T		&Element( int i ) const					{ Assert( IsValidIndex( i ) ); return m_Chunks[i >> CHUNK_BITS][i & CHUNK_MASK]; }
+	T			&operator[]( int i )					{ return Element( i ); }
+	const T		&operator[]( int i ) const				{ return Element( i ); }
+
+	void		RemoveAll();
+	void		Purge()									{ RemoveAll(); }
+
+	// Average number of slots probed by a successful Find, for profiling
+	float		AverageProbeLength() const;
+
+private:
+	enum
+	{
+		CHUNK_BITS = 8,
+		CHUNK_SIZE = 1 << CHUNK_BITS,
+		CHUNK_MASK = CHUNK_SIZE - 1,
+		ARENA_BLOCK_SIZE = 16 * 1024,
+		MIN_TABLE_SIZE = 64,
+	};
+
+	struct Slot_t
+	{
+		unsigned int	m_nHash;
+		int				m_nIndex;	// -1 if the slot is empty
+	};
+
+	// lower case, and '\\' -> '/' for filenames
+	struct FoldTable_t
+	{
+		FoldTable_t( bool bFilenames )
+		{
+			for ( int i = 0; i < 256; i++ )
+			{
+				m_Fold[i] = ( i >= 'A' && i <= 'Z' ) ? i + ( 'a' - 'A' ) : i;
+			}
+			if ( bFilenames )
+			{
+				m_Fold['\\'] = '/';
+			}
+		}
+		unsigned char m_Fold[256];
+	};
+
+	const unsigned char *FoldTable() const
+	{
+		static const FoldTable_t s_Plain( false ), s_Filenames( true );
+		return m_bFilenames ? s_Filenames.m_Fold : s_Plain.m_Fold;
+	}
+
+	unsigned int	Hash( const char *pString, bool *pDotSlash = NULL ) const;
+	bool			Equal( const char *pA, const char *pB ) const;
+	const char		*Normalize( const char *pString, unsigned int *pHash, char *pBuf, int nBufLen ) const;
+	int				FindSlot( const char *pString, unsigned int nHash ) const;
+	const char		*AllocString( const char *pString );
+	void			GrowTable();
+
+	CUtlVector< Slot_t >	m_Table;			// power of two
+	CUtlVector< T* >		m_Chunks;			// CHUNK_SIZE elements each
+	CUtlVector< const char* > m_Strings;		// by element index
+	CUtlVector< char* >		m_ArenaBlocks;
+	int						m_nArenaUsed;		// bytes used in the last block
+	int						m_nArenaBlockSize;	// size of the last block
+	int						m_nCount;
+	bool					m_bFilenames;
+};
+
+
+template < class T >
+CUtlHashedStringDict<T>::CUtlHashedStringDict( bool bFilenames )
+{
+	m_nArenaUsed = 0;
+	m_nArenaBlockSize = 0;
+	m_nCount = 0;
+	m_bFilenames = bFilenames;
+}
+
+template < class T >
+CUtlHashedStringDict<T>::~CUtlHashedStringDict()
+{
+	RemoveAll();
+}
+
+template < class T >
+void CUtlHashedStringDict<T>::RemoveAll()
+{
+	for ( int i = 0; i < m_Chunks.Count(); i++ )
+	{
+		delete [] m_Chunks[i];
+	}
+
+	for ( int i = 0; i < m_ArenaBlocks.Count(); i++ )
+	{
+		delete [] m_ArenaBlocks[i];
+	}
+
+	m_Table.Purge();
+	m_Chunks.Purge();
+	m_Strings.Purge();
+	m_ArenaBlocks.Purge();
+	m_nArenaUsed = 0;
+	m_nArenaBlockSize = 0;
+	m_nCount = 0;
+}
+
+template < class T >
+unsigned int CUtlHashedStringDict<T>::Hash( const char *pString, bool *pDotSlash ) const
+{
+	// FNV-1a over the folded characters, also notes any "./" for filenames
+	const unsigned char *pFold = FoldTable();
+	unsigned int nHash = 2166136261u;
+	unsigned char prev = 0;
+	bool bDotSlash = false;
+
+	for ( const unsigned char *p = (const unsigned char *)pString; *p; p++ )
+	{
+		unsigned char c = pFold[*p];
+		bDotSlash |= ( c == '/' && prev == '.' );
+		prev = c;
+		nHash = ( nHash ^ c ) * 16777619u;
+	}
+
+	if ( pDotSlash )
+		*pDotSlash = bDotSlash && m_bFilenames;
+
+	return nHash;
+}
+
+template < class T >
+bool CUtlHashedStringDict<T>::Equal( const char *pA, const char *pB ) const
+{
+	const unsigned char *pFold = FoldTable();
+	const unsigned char *a = (const unsigned char *)pA;
+	const unsigned char *b = (const unsigned char *)pB;
+
+	for ( ;; a++, b++ )
+	{
+		if ( *a != *b && pFold[*a] != pFold[*b] )
+			return false;
+		if ( !*a )
+			return true;
+	}
+}
+
+template < class T >
+const char *CUtlHashedStringDict<T>::Normalize( const char *pString, unsigned int *pHash, char *pBuf, int nBufLen ) const
+{
+	bool bDotSlash;
+	*pHash = Hash( pString, &bDotSlash );
+
+	if ( !bDotSlash )
+		return pString;
+
+	V_strncpy( pBuf, pString, nBufLen );
+	V_RemoveDotSlashes( pBuf, '/' );
+	*pHash = Hash( pBuf );
+	return pBuf;
+}
+
+template < class T >
+int CUtlHashedStringDict<T>::FindSlot( const char *pString, unsigned int nHash ) const
+{
+	int nMask = m_Table.Count() - 1;
+	for ( int i = nHash & nMask; ; i = ( i + 1 ) & nMask )
+	{
+		const Slot_t &slot = m_Table[i];
+		if ( slot.m_nIndex < 0 )
+			return i;
+		if ( slot.m_nHash == nHash && Equal( m_Strings[slot.m_nIndex], pString ) )
+			return i;
+	}
+}
+
+template < class T >
+int CUtlHashedStringDict<T>::Find( const char *pString ) const
+{
+	if ( !pString || !m_nCount )
+		return InvalidIndex();
+
+	char buf[MAX_PATH];
+	unsigned int nHash;
+	pString = Normalize( pString, &nHash, buf, sizeof( buf ) );
+
+	return m_Table[ FindSlot( pString, nHash ) ].m_nIndex;
+}
+
+template < class T >
+int CUtlHashedStringDict<T>::Insert( const char *pString )
+{
+	if ( !pString )
+		return InvalidIndex();
+
+	char buf[MAX_PATH];
+	unsigned int nHash;
+	pString = Normalize( pString, &nHash, buf, sizeof( buf ) );
+
+	if ( ( m_nCount + 1 ) * 2 > m_Table.Count() )
+	{
+		GrowTable();
+	}
+
+	Slot_t &slot = m_Table[ FindSlot( pString, nHash ) ];
+	if ( slot.m_nIndex >= 0 )
+		return slot.m_nIndex;
+
+	int nIndex = m_nCount++;
+	if ( ( nIndex >> CHUNK_BITS ) >= m_Chunks.Count() )
+	{
+		m_Chunks.AddToTail( new T[CHUNK_SIZE] );
+	}
+
+	slot.m_nHash = nHash;
+	slot.m_nIndex = nIndex;
+	m_Strings.AddToTail( AllocString( pString ) );
+
+	return nIndex;
+}
+
+template < class T >
+const char *CUtlHashedStringDict<T>::AllocString( const char *pString )
+{
+	int nLen = V_strlen( pString ) + 1;
+
+	if ( m_nArenaUsed + nLen > m_nArenaBlockSize )
+	{
+		m_nArenaBlockSize = MAX( nLen, (int)ARENA_BLOCK_SIZE );
+		m_ArenaBlocks.AddToTail( new char[m_nArenaBlockSize] );
+		m_nArenaUsed = 0;
+	}
+
+	char *pCopy = m_ArenaBlocks.Tail() + m_nArenaUsed;
+	m_nArenaUsed += nLen;
+
+	if ( m_bFilenames )
+	{
+		for ( int i = 0; i < nLen; i++ )
+		{
+			pCopy[i] = ( pString[i] == '\\' ) ? '/' : pString[i];
+		}
+	}
+	else
+	{
+		V_memcpy( pCopy, pString, nLen );
+	}
+
+	return pCopy;
+}
+
+template < class T >
+void CUtlHashedStringDict<T>::GrowTable()
+{
+	int nNewSize = MAX( m_Table.Count() * 2, (int)MIN_TABLE_SIZE );
+
+	CUtlVector< Slot_t > oldTable;
+	oldTable.Swap( m_Table );
+
+	m_Table.SetCount( nNewSize );
+	for ( int i = 0; i < nNewSize; i++ )
+	{
+		m_Table[i].m_nIndex = -1;
+	}
+
+	// the stored hashes are reused, strings aren't touched
+	int nMask = nNewSize - 1;
+	for ( int j = 0; j < oldTable.Count(); j++ )
+	{
+		if ( oldTable[j].m_nIndex < 0 )
+			continue;
+
+		int i = oldTable[j].m_nHash & nMask;
+		while ( m_Table[i].m_nIndex >= 0 )
+		{
+			i = ( i + 1 ) & nMask;
+		}
+		m_Table[i] = oldTable[j];
+	}
+}
+
+template < class T >
+float CUtlHashedStringDict<T>::AverageProbeLength() const
+{
+	if ( !m_nCount )
+		return 0.0f;
+
+	int nMask = m_Table.Count() - 1;
+	int nProbes = 0;
+	for ( int i = 0; i < m_Table.Count(); i++ )
+	{
+		if ( m_Table[i].m_nIndex >= 0 )
+		{
+			nProbes += ( ( i - (int)( m_Table[i].m_nHash & nMask ) ) & nMask ) + 1;
+		}
+	}
+
+	return (float)nProbes / m_nCount;
+}
+
+#endif // UTLHASHEDSTRINGDICT_H
@@ -0,0 +1,94 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: case sensitive string interning table with lock free lookups.
+//
+// Usage notes:
+// - Intern() returns the one copy of a string the table owns, so interned
+//   strings can be compared by pointer. The copies never move and are only
+//   freed by Purge().
+// - every interned string is preceded by its hash, an ascii case folded hash
+//   and its length. GetHash(), GetCaselessHash() and GetLength() read them back
+//   without touching the characters, so callers that compare names case
+//   insensitively don't have to hash interned strings again.
+// - Intern() can be called from any thread. Find() takes no lock and can run
+//   on any thread at the same time as Intern(); it may miss a string that is
+//   being interned concurrently, but never returns a partly written one.
+// - Purge() must not run while another thread is using the table.
+//
+// Implementation notes:
+// - the index is an open addressing table of string pointers kept at most
+//   half full. Growing builds a new table and publishes it with a single
+//   pointer store; retired tables are kept until Purge() so readers still
+//   probing them stay valid.
+//
+//=============================================================================//
+
+#ifndef UTLSTRINGINTERN_H
+#define UTLSTRINGINTERN_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include "tier0/threadtools.h"
+#include "tier1/utlvector.h"
+
+class CUtlStringInternTable
+{
+public:
+	CUtlStringInternTable();
+	~CUtlStringInternTable();
+
+	const char	*Intern( const char *pString );
+	const char	*Find( const char *pString ) const;
+
+	int			Count() const			{ return m_nCount; }
+	void		Purge();
+
+	// Only valid for strings returned by Intern()/Find()
+	static uint32	GetHash( const char *pInterned )			{ return ( (const StringHeader_t *)pInterned - 1 )->m_nHash; }
+	static uint32	GetCaselessHash( const char *pInterned )	{ return ( (const StringHeader_t *)pInterned - 1 )->m_nCaselessHash; }
+	static int		GetLength( const char *pInterned )			{ return ( (const StringHeader_t *)pInterned - 1 )->m_nLength; }
+
+	// The hashes GetHash() and GetCaselessHash() return for an interned copy of pString
+	static uint32	HashString( const char *pString, int *pLength = NULL );
+	static uint32	HashStringCaseless( const char *pString );
+
+	void		GetStrings( CUtlVector< const char * > &strings ) const;
+	size_t		GetMemoryUsage() const;
+
+private:
+	enum
+	{
+		ARENA_BLOCK_SIZE = 32 * 1024,
+		MIN_TABLE_SIZE = 256,
+	};
+
+	struct StringHeader_t
+	{
+		uint32	m_nHash;
+		uint32	m_nCaselessHash;
+		uint32	m_nLength;
+		uint32	m_nUnused;		// keeps the strings 16 byte aligned
+	};
+
+	struct Table_t
+	{
+		int					m_nMask;
+		const char * volatile m_pSlots[1];	// m_nMask + 1 of them
+	};
+
+	static const char *FindInTable( const Table_t *pTable, const char *pString, uint32 nHash, int nLength, int *pEmptySlot );
+	const char	*AllocString( const char *pString, uint32 nHash, int nLength );
+	void		GrowTable();
+
+	Table_t * volatile		m_pTable;
+	CUtlVector< Table_t * >	m_RetiredTables;
+	CUtlVector< char * >	m_ArenaBlocks;
+	int						m_nArenaUsed;		// bytes used in the last block
+	int						m_nArenaBlockSize;	// size of the last block
+	size_t					m_nArenaBytes;		// size of all blocks
+	volatile int			m_nCount;
+	CThreadMutex			m_WriteMutex;
+};
+
+#endif // UTLSTRINGINTERN_H
@@ -23,6 +23,7 @@
 #include "tier1/UtlSortVector.h"
 #include "tier1/utlmap.h"
 #include "tier1/checksum_md5.h"
+#include "tier1/memorymappedfile.h"
 
 //#define VPK_ENABLE_SIGNING
 
@@ -130,6 +131,7 @@ struct FileHandleTracker_t
 	PackDataFileHandle_t m_hFileHandle;
 	int m_nCurOfs;
 	CThreadFastMutex m_Mutex;
+	CMemoryMappedFile m_MappedFile;							// whole chunk file, if CPackedStore::MapChunkFiles() is on
 
 	FileHandleTracker_t( void )
 	{
@@ -293,6 +295,10 @@ public:
 
 	int ReadData( CPackedStoreFileHandle &handle, void *pOutData, int nNumBytes );
 
+	// Chunk files are mapped into memory instead of read through file handles,
+	// unless the store is open for writing or -vpk_nommap is set
+	bool MapChunkFiles() const { return m_bMapChunkFiles; }
+
 	~CPackedStore( void );
 
 	FORCEINLINE void *DirectoryData( void )
@@ -389,6 +395,7 @@ private:
 	int m_nDirectoryDataSize;
 	int m_nWriteChunkSize;
 	bool m_bUseDirFile;
+	bool m_bMapChunkFiles;
 
 	IBaseFileSystem *m_pFileSystem;
 	IThreadedFileMD5Processor *m_pFileTracker;
@@ -403,6 +410,8 @@ private:
 
 	CUtlSortVector<ChunkHashFraction_t, ChunkHashFractionLess_t > m_vecChunkHashFraction;
 	bool BFileContainedHashes() { return m_vecChunkHashFraction.Count() > 0; }
+	// chunk reads have to be checked against the hashes through the read cache
+	bool BReadsNeedHashing() { return m_pFileTracker && BFileContainedHashes(); }
 	// these are valid if BFileContainedHashes() is true
 	MD5Value_t m_DirectoryMD5;
 	MD5Value_t m_ChunkHashesMD5;
@@ -135,6 +135,9 @@ struct ThreadPoolStartParams_t
 
 typedef bool (*JobFilter_t)( CJob * );
 
+// Body of a ParallelFor, called with consecutive subranges of the loop
+typedef void (*ThreadPoolTaskFunc_t)( void *pContext, int iBegin, int iEnd );
+
 //---------------------------------------------------------
 // Messages supported through the CallWorker() method
 //---------------------------------------------------------
@@ -211,7 +214,13 @@ public:
 	virtual int AbortAll() = 0;
 
 	//-----------------------------------------------------
-	virtual void Reserved1() = 0;
+	// Fine grained data parallelism (any thread). Splits [iBegin, iEnd)
+	// into ranges of at most nGrain items that idle workers steal from the
+	// calling thread, which works on the loop too. Blocks until all of it
+	// is done, and may be called from inside another ParallelFor.
+	// See the ParallelFor() helpers below.
+	//-----------------------------------------------------
+	virtual void ParallelFor( ThreadPoolTaskFunc_t pfnTask, void *pContext, int iBegin, int iEnd, int nGrain = 0 ) = 0;
 
 	//-----------------------------------------------------
 	// Add an arbitrary call to the queue (master thread) 
@@ -1067,6 +1076,56 @@ inline void ParallelLoopProcess( const char *szDescription, long lBegin, unsigne
 }
 
 
+//-----------------------------------------------------------------------------
+// Work splitting: recursive with work stealing, best when there are many
+// cheap items. Unlike ParallelProcess no jobs are created, the loop is split
+// into tasks on the workers' deques. nGrain is the largest range run as one
+// task, 0 picks one from the item and thread counts.
+//
+//		ParallelFor( 0, nEntities, 16, [&]( int i ) { Process( pEntities[i] ); } );
+//-----------------------------------------------------------------------------
+
+template <typename FUNCTOR>
+inline void ParallelForRange( void *pContext, int iBegin, int iEnd )
+{
+	const FUNCTOR &functor = *(const FUNCTOR *)pContext;
+	for ( int i = iBegin; i < iEnd; i++ )
+	{
+		functor( i );
+	}
+}
+
+template <typename FUNCTOR>
+inline void ParallelFor( int iBegin, int iEnd, int nGrain, const FUNCTOR &functor, IThreadPool *pThreadPool = NULL )
+{
+	if ( !pThreadPool )
+	{
+		pThreadPool = g_pThreadPool;
+	}
+
+	if ( !pThreadPool )
+	{
+		ParallelForRange<FUNCTOR>( (void *)&functor, iBegin, iEnd );
+		return;
+	}
+
+	pThreadPool->ParallelFor( &ParallelForRange<FUNCTOR>, (void *)&functor, iBegin, iEnd, nGrain );
+}
+
+template <typename ITEM_TYPE>
+inline void ParallelFor( ITEM_TYPE *pItems, int nItems, int nGrain, void (*pfnProcess)( ITEM_TYPE & ), IThreadPool *pThreadPool = NULL )
+{
+	struct CProcessItem
+	{
+		ITEM_TYPE *m_pItems;
+		void (*m_pfnProcess)( ITEM_TYPE & );
+		void operator()( int i ) const { (*m_pfnProcess)( m_pItems[i] ); }
+	} process = { pItems, pfnProcess };
+
+	ParallelFor( 0, nItems, nGrain, process, pThreadPool );
+}
+
+
 template <class Derived>
 class CParallelProcessorBase
 {
@@ -0,0 +1,209 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Per-thread bump allocator for memory that only lives for one frame
+//
+//=============================================================================//
+
+#include "pch_tier0.h"
+
+#include "tier0/platform.h"
+#include "tier0/threadtools.h"
+#include "tier0/framearena.h"
+
+#define FRAME_ARENA_BLOCK_SIZE	( 256 * 1024 )
+
+struct FrameArenaBlock_t
+{
+	FrameArenaBlock_t	*m_pNext;
+	size_t				m_nSize;	// usable bytes following the header
+};
+
+//-----------------------------------------------------------------------------
+// One per thread, never freed. Blocks come straight from the CRT so the
+// arena doesn't reenter the allocator it's meant to relieve.
+//-----------------------------------------------------------------------------
+class CFrameArena
+{
+public:
+	void *Alloc( size_t nBytes, size_t nAlignment );
+	void Rewind( int nFrame );
+
+	size_t ReservedBytes() const;
+
+	FrameArenaBlock_t	*m_pBlocks;		// the block being allocated from is first
+	byte				*m_pNextAlloc;
+	byte				*m_pAllocLimit;
+	int					m_nFrame;
+
+	// Stats for m_nFrame
+	int					m_nAllocations;
+	int					m_nBytes;
+	int					m_nBlockAllocations;
+
+	CFrameArena			*m_pNextArena;	// list of all arenas, for stats
+
+private:
+	bool AddBlock( size_t nMinSize );
+};
+
+static volatile int s_nFrameArenaFrame;
+static CFrameArena *s_pFrameArenas;
+static CThreadFastMutex s_FrameArenaMutex;
+static FrameArenaStats_t s_LastFrameStats;
+
+static CFrameArena *GetThreadFrameArena()
+{
+	static CTHREADLOCALPTR( CFrameArena ) s_pThreadArena;
+
+	CFrameArena *pArena = s_pThreadArena;
+	if ( !pArena )
+	{
+		pArena = (CFrameArena *)calloc( 1, sizeof( CFrameArena ) );
+		if ( !pArena )
+		{
+			return NULL;
+		}
+
+		pArena->m_nFrame = s_nFrameArenaFrame;
+		{
+			AUTO_LOCK( s_FrameArenaMutex );
+			pArena->m_pNextArena = s_pFrameArenas;
+			s_pFrameArenas = pArena;
+		}
+		s_pThreadArena = pArena;
+	}
+	return pArena;
+}
+
+bool CFrameArena::AddBlock( size_t nMinSize )
+{
+	size_t nSize = MAX( nMinSize, (size_t)FRAME_ARENA_BLOCK_SIZE );
+	FrameArenaBlock_t *pBlock = (FrameArenaBlock_t *)malloc( sizeof( FrameArenaBlock_t ) + nSize );
+	if ( !pBlock )
+	{
+		return false;
+	}
+
+	pBlock->m_pNext = m_pBlocks;
+	pBlock->m_nSize = nSize;
+	m_pBlocks = pBlock;
+	m_pNextAlloc = (byte *)( pBlock + 1 );
+	m_pAllocLimit = m_pNextAlloc + nSize;
+	m_nBlockAllocations++;
+	return true;
+}
+
+void *CFrameArena::Alloc( size_t nBytes, size_t nAlignment )
+{
+	if ( m_nFrame != s_nFrameArenaFrame )
+	{
+		Rewind( s_nFrameArenaFrame );
+	}
+
+	byte *pResult = (byte *)AlignValue( m_pNextAlloc, nAlignment );
+	if ( !m_pBlocks || pResult + nBytes > m_pAllocLimit )
+	{
+		if ( !AddBlock( nBytes + nAlignment ) )
+		{
+			return NULL;
+		}
+		pResult = (byte *)AlignValue( m_pNextAlloc, nAlignment );
+	}
+
+	m_pNextAlloc = pResult + nBytes;
+	m_nAllocations++;
+	m_nBytes += nBytes;
+
+	return pResult;
+}
+
+void CFrameArena::Rewind( int nFrame )
+{
+	m_nFrame = nFrame;
+	m_nAllocations = 0;
+	m_nBytes = 0;
+	m_nBlockAllocations = 0;
+
+	// If the last frame spilled into more blocks, replace them with a single
+	// block big enough for all of it so the next frame doesn't spill again
+	if ( m_pBlocks && m_pBlocks->m_pNext )
+	{
+		size_t nTotal = ReservedBytes();
+		while ( m_pBlocks )
+		{
+			FrameArenaBlock_t *pNext = m_pBlocks->m_pNext;
+			free( m_pBlocks );
+			m_pBlocks = pNext;
+		}
+		AddBlock( nTotal );
+	}
+
+	if ( m_pBlocks )
+	{
+		m_pNextAlloc = (byte *)( m_pBlocks + 1 );
+		m_pAllocLimit = m_pNextAlloc + m_pBlocks->m_nSize;
+#ifdef _DEBUG
+		memset( m_pNextAlloc, 0xdd, m_pBlocks->m_nSize );
+#endif
+	}
+}
+
+size_t CFrameArena::ReservedBytes() const
+{
+	size_t nTotal = 0;
+	for ( FrameArenaBlock_t *pBlock = m_pBlocks; pBlock; pBlock = pBlock->m_pNext )
+	{
+		nTotal += pBlock->m_nSize;
+	}
+	return nTotal;
+}
+
+
+PLATFORM_INTERFACE void *FrameArena_Alloc( size_t nBytes, size_t nAlignment )
+{
+	Assert( nAlignment && !( nAlignment & ( nAlignment - 1 ) ) );
+
+	CFrameArena *pArena = GetThreadFrameArena();
+	if ( !pArena )
+	{
+		return NULL;
+	}
+	return pArena->Alloc( nBytes, nAlignment );
+}
+
+PLATFORM_INTERFACE void FrameArena_EndFrame()
+{
+	FrameArenaStats_t stats;
+	memset( &stats, 0, sizeof( stats ) );
+	stats.m_nFrame = s_nFrameArenaFrame;
+
+	{
+		AUTO_LOCK( s_FrameArenaMutex );
+		for ( CFrameArena *pArena = s_pFrameArenas; pArena; pArena = pArena->m_pNextArena )
+		{
+			stats.m_nReservedBytes += pArena->ReservedBytes();
+			if ( pArena->m_nFrame != stats.m_nFrame || !pArena->m_nAllocations )
+				continue;
+
+			stats.m_nAllocations += pArena->m_nAllocations;
+			stats.m_nBytes += pArena->m_nBytes;
+			stats.m_nBlockAllocations += pArena->m_nBlockAllocations;
+			stats.m_nThreads++;
+		}
+	}
+
+	s_LastFrameStats = stats;
+
+	ThreadMemoryBarrier();
+	s_nFrameArenaFrame = stats.m_nFrame + 1;
+}
+
+PLATFORM_INTERFACE int FrameArena_GetFrame()
+{
+	return s_nFrameArenaFrame;
+}
+
+PLATFORM_INTERFACE void FrameArena_GetStats( FrameArenaStats_t *pStats )
+{
+	*pStats = s_LastFrameStats;
+}
@@ -174,3 +174,92 @@ size_t CalcHeapUsed()
 }
 #endif
 
+
+void ReserveBottomMemory()
+{
+	// If we are running a 64-bit build then reserve all addresses below the
+	// 4 GB line to push as many pointers as possible above the line.
+#ifdef PLATFORM_WINDOWS_PC64
+	// Avoid the cost of calling this multiple times.
+	static bool s_initialized = false;
+	if ( s_initialized )
+		return;
+	s_initialized = true;
+
+	// If AppVerifier is enabled then memory reservations get turned into committed
+	// memory in the working set. This means that ReserveBottomMemory() can end
+	// up adding almost 4 GB to the working set, which is a significant problem if
+	// you run many processes in parallel. Therefore, if vfbasics.dll (part of AppVerifier)
+	// is loaded, don't do the reservation.
+	HMODULE vfBasicsDLL = GetModuleHandle( "vfbasics.dll" );
+	if ( vfBasicsDLL )
+		return;
+
+	// Start by reserving large blocks of memory. When those reservations
+	// have exhausted the bottom 4 GB then halve the size and try again.
+	// The granularity for reserving address space is 64 KB so if we wanted
+	// to reserve every single page we would need to continue down to 64 KB.
+	// However stopping at 1 MB is sufficient because it prevents the Windows
+	// heap (and dlmalloc and the small block heap) from grabbing address space
+	// from the bottom 4 GB, while still allowing Steam to allocate a few pages
+	// for setting up detours.
+	const size_t LOW_MEM_LINE = 0x100000000LL;
+	size_t totalReservation = 0;
+	size_t numVAllocs = 0;
+	size_t numHeapAllocs = 0;
+	for ( size_t blockSize = 256 * 1024 * 1024; blockSize >= 1024 * 1024; blockSize /= 2 )
+	{
+		for (;;)
+		{
+			void* p = VirtualAlloc( 0, blockSize, MEM_RESERVE, PAGE_NOACCESS );
+			if ( !p )
+				break;
+
+			if ( (size_t)p >= LOW_MEM_LINE )
+			{
+				// We don't need this memory, so release it completely.
+				VirtualFree( p, 0, MEM_RELEASE );
+				break;
+			}
+
+			totalReservation += blockSize;
+			++numVAllocs;
+		}
+	}
+
+	// Now repeat the same process but making heap allocations, to use up the
+	// already committed heap blocks that are below the 4 GB line. Now we start
+	// with 64-KB allocations and proceed down to 16-byte allocations.
+	HANDLE heap = GetProcessHeap();
+	for ( size_t blockSize = 64 * 1024; blockSize >= 16; blockSize /= 2 )
+	{
+		for (;;)
+		{
+			void* p = HeapAlloc( heap, 0, blockSize );
+			if ( !p )
+				break;
+
+			if ( (size_t)p >= LOW_MEM_LINE )
+			{
+				// We don't need this memory, so release it completely.
+				HeapFree( heap, 0, p );
+				break;
+			}
+
+			totalReservation += blockSize;
+			++numHeapAllocs;
+		}
+	}
+
+	// Print diagnostics showing how many allocations we had to make in order to
+	// reserve all of low memory. In one test run it took 55 virtual allocs and
+	// 85 heap allocs. Note that since the process may have multiple heaps (each
+	// CRT seems to have its own) there is likely to be a few MB of address space
+	// that was previously reserved and is available to be handed out by some allocators.
+	//char buffer[1000];
+	//sprintf_s( buffer, "Reserved %1.3f MB (%d vallocs, %d heap allocs) to keep allocations out of low-memory.\n",
+	//			totalReservation / (1024 * 1024.0), (int)numVAllocs, (int)numHeapAllocs );
+	// Can't use Msg here because it isn't necessarily initialized yet.
+	//OutputDebugString( buffer );
+#endif
+}
@@ -370,6 +370,13 @@ private:
 
 static CStdMemAlloc s_StdMemAlloc CONSTRUCT_EARLY;
 
+#ifdef MEM_SBH_ENABLED
+size_t CStdMemAlloc::SmallBlockHeapAllocFailHandler( size_t nBytes )
+{
+	return s_StdMemAlloc.CallAllocFailHandler( nBytes );
+}
+#endif
+
 #ifndef TIER0_VALIDATE_HEAP
 IMemAlloc *g_pMemAlloc = &s_StdMemAlloc;
 #else
@@ -544,535 +551,6 @@ public:
 CInitGlobalMemAllocPtr sg_InitGlobalMemAllocPtr;
 #endif
 
-#ifdef _WIN32
-//-----------------------------------------------------------------------------
-// Small block heap (multi-pool)
-//-----------------------------------------------------------------------------
-
-#ifndef NO_SBH
-#ifdef ALLOW_NOSBH
-static bool g_UsingSBH = true;
-#define UsingSBH() g_UsingSBH
-#else
-#define UsingSBH() true
-#endif
-#else
-#define UsingSBH() false
-#endif
-
-
-//-----------------------------------------------------------------------------
-//
-//-----------------------------------------------------------------------------
-template <typename T>
-inline T MemAlign( T val, size_t alignment )
-{
-	return (T)( ( (size_t)val + alignment - 1 ) & ~( alignment - 1 ) );
-}
-//-----------------------------------------------------------------------------
-// 
-//-----------------------------------------------------------------------------
-
-void CSmallBlockPool::Init( unsigned nBlockSize, byte *pBase, unsigned initialCommit )
-{
-	if ( !( nBlockSize % MIN_SBH_ALIGN == 0 && nBlockSize >= MIN_SBH_BLOCK && nBlockSize >= sizeof(TSLNodeBase_t) ) )
-		DebuggerBreak();
-
-	m_nBlockSize = nBlockSize;
-	m_pCommitLimit = m_pNextAlloc = m_pBase = pBase;
-	m_pAllocLimit = m_pBase + MAX_POOL_REGION;
-
-	if ( initialCommit )
-	{
-		initialCommit = MemAlign( initialCommit, SBH_PAGE_SIZE );
-		if ( !VirtualAlloc( m_pCommitLimit, initialCommit, VA_COMMIT_FLAGS, PAGE_READWRITE ) )
-		{
-			Assert( 0 );
-			return;
-		}
-		m_pCommitLimit += initialCommit;
-	}
-}
-
-size_t CSmallBlockPool::GetBlockSize()
-{
-	return m_nBlockSize;
-}
-
-bool CSmallBlockPool::IsOwner( void *p )
-{
-	return ( p >= m_pBase && p < m_pAllocLimit );
-	}
-
-void *CSmallBlockPool::Alloc()
-	{
-	void *pResult = m_FreeList.Pop();
-		if ( !pResult )
-		{
-			int nBlockSize = m_nBlockSize;
-		byte *pCommitLimit;
-			byte *pNextAlloc;
-		for (;;)
-				{
-			pCommitLimit = m_pCommitLimit;
-			pNextAlloc = m_pNextAlloc;
-			if ( pNextAlloc + nBlockSize <= pCommitLimit )
-					{
-				if ( m_pNextAlloc.AssignIf( pNextAlloc, pNextAlloc + m_nBlockSize ) )
-					{
-					pResult = pNextAlloc;
-						break;
-					}
-				}
-						else
-						{
-				AUTO_LOCK( m_CommitMutex );
-				if ( pCommitLimit == m_pCommitLimit )
-							{
-					if ( pCommitLimit + COMMIT_SIZE <= m_pAllocLimit )
-								{
-						if ( !VirtualAlloc( pCommitLimit, COMMIT_SIZE, VA_COMMIT_FLAGS, PAGE_READWRITE ) )
-								{
-							Assert( 0 );
-							return NULL;
-							}
-
-						m_pCommitLimit = pCommitLimit + COMMIT_SIZE;
-						}
-						else
-						{
-							return NULL;
-						}
-					}
-					}
-				}
-			}
-	return pResult;
-}
-
-void CSmallBlockPool::Free( void *p )
-	{	
-	Assert( IsOwner( p ) );
-
-	m_FreeList.Push( p );
-}
-
-// Count the free blocks.  
-int CSmallBlockPool::CountFreeBlocks()
-{
-	return m_FreeList.Count();
-}
-
-// Size of committed memory managed by this heap:
-int CSmallBlockPool::GetCommittedSize()
-{
-	unsigned totalSize = (uintp)m_pCommitLimit - (uintp)m_pBase;
-	Assert( 0 != m_nBlockSize );
-
-	return totalSize;
-}
-
-// Return the total blocks memory is committed for in the heap
-int CSmallBlockPool::CountCommittedBlocks()
-{		 
-	return  GetCommittedSize() / GetBlockSize();
-}
-
-// Count the number of allocated blocks in the heap:
-int CSmallBlockPool::CountAllocatedBlocks()
-{
-	return CountCommittedBlocks( ) - ( CountFreeBlocks( ) + ( m_pCommitLimit - (byte *)m_pNextAlloc ) / GetBlockSize() );
-}
-
-int CSmallBlockPool::Compact()
-{
-	int nBytesFreed = 0;
-	if ( m_FreeList.Count() )
-{
-	int i;
-		int nFree = CountFreeBlocks();
-		FreeBlock_t **pSortArray = (FreeBlock_t **)malloc( nFree * sizeof(FreeBlock_t *) ); // can't use new because will reenter
-
-		if ( !pSortArray )
-		{
-		return 0;
-		}
-
-		i = 0;
-		while ( i < nFree )
-		{
-			pSortArray[i++] = m_FreeList.Pop();
-			}
-
-		std::sort( pSortArray, pSortArray + nFree );
-
-		byte *pOldNextAlloc = m_pNextAlloc;
-
-		for ( i = nFree - 1; i >= 0; i-- )
-			{
-			if ( (byte *)pSortArray[i] == m_pNextAlloc - m_nBlockSize )
-				{
-				pSortArray[i] = NULL;
-				m_pNextAlloc -= m_nBlockSize;
-				}
-				else
-				{
-							break;
-						}
-			}
-
-		if ( pOldNextAlloc != m_pNextAlloc )
-		{
-			byte *pNewCommitLimit = MemAlign( (byte *)m_pNextAlloc, SBH_PAGE_SIZE );
-			if ( pNewCommitLimit < m_pCommitLimit )
-		{
-				nBytesFreed = m_pCommitLimit - pNewCommitLimit;
-				VirtualFree( pNewCommitLimit, nBytesFreed, MEM_DECOMMIT );
-				m_pCommitLimit = pNewCommitLimit;
-		}
-	}
-
-		if ( pSortArray[0] )
-	{
-			for ( i = 0; i < nFree ; i++ )
-		{
-				if ( !pSortArray[i] )
-			{
-					break;
-				}
-				m_FreeList.Push( pSortArray[i] );
-			}
-			}
-
-		free( pSortArray );
-		}
-
-	return nBytesFreed;
-}
-
-
-//-----------------------------------------------------------------------------
-//
-//-----------------------------------------------------------------------------
-#define GetInitialCommitForPool( i ) 0
-
-CSmallBlockHeap::CSmallBlockHeap()
-{
-	// Make sure that we return 64-bit addresses in 64-bit builds.
-	ReserveBottomMemory();
-
-	if ( !UsingSBH() )
-	{
-		return;
-	}
-
-	m_pBase = (byte *)VirtualAlloc( NULL, NUM_POOLS * MAX_POOL_REGION, VA_RESERVE_FLAGS, PAGE_NOACCESS );
-	m_pLimit = m_pBase + NUM_POOLS * MAX_POOL_REGION;
-
-	// Build a lookup table used to find the correct pool based on size
-	const int MAX_TABLE = MAX_SBH_BLOCK >> 2;
-	int i = 0;
-	int nBytesElement = 0;
-	byte *pCurBase = m_pBase;
-	CSmallBlockPool *pCurPool = NULL;
-	int iCurPool = 0;
-
-#if _M_X64
-	// Blocks sized 0 - 256 are in pools in increments of 16
-	for ( ; i < 64 && i < MAX_TABLE; i++ )
-	{
-		if ( (i + 1) % 4 == 1)
-		{
-			nBytesElement += 16;
-			pCurPool = &m_Pools[iCurPool];
-			pCurPool->Init( nBytesElement, pCurBase, GetInitialCommitForPool(iCurPool) );
-			iCurPool++;
-			m_PoolLookup[i] = pCurPool;
-			pCurBase += MAX_POOL_REGION;
-		}
-		else
-		{
-			m_PoolLookup[i] = pCurPool;
-		}
-	}
-#else
-	// Blocks sized 0 - 128 are in pools in increments of 8
-	for ( ; i < 32; i++ )
-	{
-		if ( (i + 1) % 2 == 1)
-		{
-			nBytesElement += 8;
-			pCurPool = &m_Pools[iCurPool];
-			pCurPool->Init( nBytesElement, pCurBase, GetInitialCommitForPool(iCurPool) );
-			iCurPool++;
-			m_PoolLookup[i] = pCurPool;
-			pCurBase += MAX_POOL_REGION;
-		}
-		else
-		{
-			m_PoolLookup[i] = pCurPool;
-		}
-	}
-
-	// Blocks sized 129 - 256 are in pools in increments of 16
-	for ( ; i < 64; i++ )
-	{
-		if ( (i + 1) % 4 == 1)
-		{
-			nBytesElement += 16;
-			pCurPool = &m_Pools[iCurPool];
-			pCurPool->Init( nBytesElement, pCurBase, GetInitialCommitForPool(iCurPool) );
-			iCurPool++;
-			m_PoolLookup[i] = pCurPool;
-			pCurBase += MAX_POOL_REGION;
-		}
-		else
-		{
-			m_PoolLookup[i] = pCurPool;
-		}
-	}
-#endif
-
-	// Blocks sized 257 - 512 are in pools in increments of 32
-	for ( ; i < 128; i++ )
-	{
-		if ( (i + 1) % 8 == 1)
-		{
-			nBytesElement += 32;
-			pCurPool = &m_Pools[iCurPool];
-			pCurPool->Init( nBytesElement, pCurBase, GetInitialCommitForPool(iCurPool) );
-			iCurPool++;
-			m_PoolLookup[i] = pCurPool;
-			pCurBase += MAX_POOL_REGION;
-		}
-		else
-		{
-			m_PoolLookup[i] = pCurPool;
-		}
-	}
-
-	// Blocks sized 513 - 768 are in pools in increments of 64
-	for ( ; i < 192; i++ )
-	{
-		if ( (i + 1) % 16 == 1)
-		{
-			nBytesElement += 64;
-			pCurPool = &m_Pools[iCurPool];
-			pCurPool->Init( nBytesElement, pCurBase, GetInitialCommitForPool(iCurPool) );
-			iCurPool++;
-			m_PoolLookup[i] = pCurPool;
-			pCurBase += MAX_POOL_REGION;
-		}
-		else
-		{
-			m_PoolLookup[i] = pCurPool;
-		}
-	}
-
-	// Blocks sized 769 - 1024 are in pools in increments of 128
-	for ( ; i < 256; i++ )
-	{
-		if ( (i + 1) % 32 == 1)
-		{
-			nBytesElement += 128;
-			pCurPool = &m_Pools[iCurPool];
-			pCurPool->Init( nBytesElement, pCurBase, GetInitialCommitForPool(iCurPool) );
-			iCurPool++;
-			m_PoolLookup[i] = pCurPool;
-			pCurBase += MAX_POOL_REGION;
-		}
-		else
-		{
-			m_PoolLookup[i] = pCurPool;
-		}
-	}
-
-	// Blocks sized 1025 - 2048 are in pools in increments of 256
-	for ( ; i < MAX_TABLE; i++ )
-	{
-		if ( (i + 1) % 64 == 1)
-		{
-			nBytesElement += 256;
-			pCurPool = &m_Pools[iCurPool];
-			pCurPool->Init( nBytesElement, pCurBase, GetInitialCommitForPool(iCurPool) );
-			iCurPool++;
-			m_PoolLookup[i] = pCurPool;
-			pCurBase += MAX_POOL_REGION;
-		}
-		else
-		{
-			m_PoolLookup[i] = pCurPool;
-		}
-	}
-
-	Assert( iCurPool == NUM_POOLS );
-}
-
-bool CSmallBlockHeap::ShouldUse( size_t nBytes )
-{
-	return ( UsingSBH() && nBytes <= MAX_SBH_BLOCK );
-}
-
-bool CSmallBlockHeap::IsOwner( void * p )
-{
-	return ( UsingSBH() && p >= m_pBase && p < m_pLimit );
-}
-
-void *CSmallBlockHeap::Alloc( size_t nBytes )
-{
-	if ( nBytes == 0)
-	{
-		nBytes = 1;
-	}
-	Assert( ShouldUse( nBytes ) );
-	CSmallBlockPool *pPool = FindPool( nBytes );
-	
-	void *p = pPool->Alloc();
-	if ( p )
-	{
-		return p;
-	}
-
-	if ( s_StdMemAlloc.CallAllocFailHandler( nBytes ) >= nBytes )
-	{
-		p = pPool->Alloc();
-		if ( p )
-		{
-	return p;
-}
-	}
-
-	void *pRet = malloc( nBytes );
-	if ( !pRet )
-	{
-		s_StdMemAlloc.SetCRTAllocFailed( nBytes );
-	}
-	return pRet;
-}
-
-void *CSmallBlockHeap::Realloc( void *p, size_t nBytes )
-{
-	if ( nBytes == 0)
-	{
-		nBytes = 1;
-	}
-
-	CSmallBlockPool *pOldPool = FindPool( p );
-	CSmallBlockPool *pNewPool = ( ShouldUse( nBytes ) ) ? FindPool( nBytes ) : NULL;
-
-	if ( pOldPool == pNewPool )
-	{
-		return p;
-	}
-
-	void *pNewBlock = NULL;
-
-	if ( pNewPool )
-	{
-		pNewBlock = pNewPool->Alloc();
-
-	if ( !pNewBlock )
-	{
-			if ( s_StdMemAlloc.CallAllocFailHandler( nBytes ) >= nBytes )
-			{
-				pNewBlock = pNewPool->Alloc();
-			}
-		}
-	}
-
-	if ( !pNewBlock )
-	{
-		pNewBlock = malloc( nBytes );
-		if ( !pNewBlock )
-		{
-			s_StdMemAlloc.SetCRTAllocFailed( nBytes );
-		}
-	}
-
-	if ( pNewBlock )
-	{
-		int nBytesCopy = min( nBytes, pOldPool->GetBlockSize() );
-		memcpy( pNewBlock, p, nBytesCopy );
-	} 
-
-	pOldPool->Free( p );
-
-	return pNewBlock;
-}
-
-void CSmallBlockHeap::Free( void *p )
-	{
-	CSmallBlockPool *pPool = FindPool( p );
-		pPool->Free( p );
-	}
-
-size_t CSmallBlockHeap::GetSize( void *p )
-{
-	CSmallBlockPool *pPool = FindPool( p );
-	return pPool->GetBlockSize();
-}
-
-void CSmallBlockHeap::DumpStats( FILE *pFile )
-{
-	bool bSpew = true;
-
-	if ( pFile )
-	{
-		for ( int i = 0; i < NUM_POOLS; i++ )
-		{
-			// output for vxconsole parsing
-			fprintf( pFile, "Pool %i: Size: %llu Allocated: %i Free: %i Committed: %i CommittedSize: %i\n", 
-				i, 
-				(uint64)m_Pools[i].GetBlockSize(), 
-				m_Pools[i].CountAllocatedBlocks(), 
-				m_Pools[i].CountFreeBlocks(),
-				m_Pools[i].CountCommittedBlocks(), 
-				m_Pools[i].GetCommittedSize() );
-		}
-		bSpew = false;
-	}
-
-	if ( bSpew )
-	{
-		unsigned bytesCommitted = 0;
-		unsigned bytesAllocated = 0;
-
-		for ( int i = 0; i < NUM_POOLS; i++ )
-		{
-			Msg( "Pool %i: (size: %llu) blocks: allocated:%i free:%i committed:%i (committed size:%u kb)\n",i, (uint64)m_Pools[i].GetBlockSize(),m_Pools[i].CountAllocatedBlocks(), m_Pools[i].CountFreeBlocks(),m_Pools[i].CountCommittedBlocks(), m_Pools[i].GetCommittedSize() / 1024);
-
-			bytesCommitted += m_Pools[i].GetCommittedSize();
-			bytesAllocated += ( m_Pools[i].CountAllocatedBlocks() * m_Pools[i].GetBlockSize() );
-		}
-
-		Msg( "Totals: Committed:%u kb Allocated:%u kb\n", bytesCommitted / 1024, bytesAllocated / 1024 );
-	}
-}
-
-int CSmallBlockHeap::Compact()
-{
-	int nBytesFreed = 0;
-	for( int i = 0; i < NUM_POOLS; i++ )
-	{
-		nBytesFreed += m_Pools[i].Compact();
-	}
-	return nBytesFreed;
-}
-
-CSmallBlockPool *CSmallBlockHeap::FindPool( size_t nBytes )
-{
-	return m_PoolLookup[(nBytes - 1) >> 2];
-}
-
-CSmallBlockPool *CSmallBlockHeap::FindPool( void *p )
-{
-	size_t i = ((byte *)p - m_pBase) / MAX_POOL_REGION;
-	return &m_Pools[i];
-}
-
-
-#endif
-
 #if USE_PHYSICAL_SMALL_BLOCK_HEAP
 
 CX360SmallBlockPool *CX360SmallBlockPool::gm_AddressToPool[BYTES_X360_SBH/PAGESIZE_X360_SBH];
@@ -1482,6 +960,10 @@ void *CStdMemAlloc::Alloc( size_t nSize )
 	if ( m_SmallBlockHeap.ShouldUse( nSize ) )
 	{
 		pMem = m_SmallBlockHeap.Alloc( nSize );
+		if ( !pMem )
+		{
+			SetCRTAllocFailed( nSize );
+		}
 	ApplyMemoryInitializations( pMem, nSize );
 	return pMem;
 }
@@ -1516,7 +998,12 @@ void *CStdMemAlloc::Realloc( void *pMem, size_t nSize )
 
 	if ( m_SmallBlockHeap.IsOwner( pMem ) )
 	{
-		return m_SmallBlockHeap.Realloc( pMem, nSize );
+		void *pRet = m_SmallBlockHeap.Realloc( pMem, nSize );
+		if ( !pRet )
+		{
+			SetCRTAllocFailed( nSize );
+		}
+		return pRet;
 	}
 #endif
 
@@ -1698,6 +1185,9 @@ int CStdMemAlloc::heapchk()
 
 void CStdMemAlloc::DumpStats() 
 { 
+#ifdef MEM_SBH_ENABLED
+	m_SmallBlockHeap.DumpThreadCacheStats();
+#endif
 	DumpStatsFileBase( "memstats" );
 }
 
@@ -1812,93 +1302,4 @@ size_t CStdMemAlloc::MemoryAllocFailed()
 
 #endif
 
-void ReserveBottomMemory()
-{
-	// If we are running a 64-bit build then reserve all addresses below the
-	// 4 GB line to push as many pointers as possible above the line.
-#ifdef PLATFORM_WINDOWS_PC64
-	// Avoid the cost of calling this multiple times.
-	static bool s_initialized = false;
-	if ( s_initialized )
-		return;
-	s_initialized = true;
-
-	// If AppVerifier is enabled then memory reservations get turned into committed
-	// memory in the working set. This means that ReserveBottomMemory() can end
-	// up adding almost 4 GB to the working set, which is a significant problem if
-	// you run many processes in parallel. Therefore, if vfbasics.dll (part of AppVerifier)
-	// is loaded, don't do the reservation.
-	HMODULE vfBasicsDLL = GetModuleHandle( "vfbasics.dll" );
-	if ( vfBasicsDLL )
-		return;
-
-	// Start by reserving large blocks of memory. When those reservations
-	// have exhausted the bottom 4 GB then halve the size and try again.
-	// The granularity for reserving address space is 64 KB so if we wanted
-	// to reserve every single page we would need to continue down to 64 KB.
-	// However stopping at 1 MB is sufficient because it prevents the Windows
-	// heap (and dlmalloc and the small block heap) from grabbing address space
-	// from the bottom 4 GB, while still allowing Steam to allocate a few pages
-	// for setting up detours.
-	const size_t LOW_MEM_LINE = 0x100000000LL;
-	size_t totalReservation = 0;
-	size_t numVAllocs = 0;
-	size_t numHeapAllocs = 0;
-	for ( size_t blockSize = 256 * 1024 * 1024; blockSize >= 1024 * 1024; blockSize /= 2 )
-	{
-		for (;;)
-		{
-			void* p = VirtualAlloc( 0, blockSize, MEM_RESERVE, PAGE_NOACCESS );
-			if ( !p )
-				break;
-
-			if ( (size_t)p >= LOW_MEM_LINE )
-			{
-				// We don't need this memory, so release it completely.
-				VirtualFree( p, 0, MEM_RELEASE );
-				break;
-			}
-
-			totalReservation += blockSize;
-			++numVAllocs;
-		}
-	}
-
-	// Now repeat the same process but making heap allocations, to use up the
-	// already committed heap blocks that are below the 4 GB line. Now we start
-	// with 64-KB allocations and proceed down to 16-byte allocations.
-	HANDLE heap = GetProcessHeap();
-	for ( size_t blockSize = 64 * 1024; blockSize >= 16; blockSize /= 2 )
-	{
-		for (;;)
-		{
-			void* p = HeapAlloc( heap, 0, blockSize );
-			if ( !p )
-				break;
-
-			if ( (size_t)p >= LOW_MEM_LINE )
-			{
-				// We don't need this memory, so release it completely.
-				HeapFree( heap, 0, p );
-				break;
-			}
-
-			totalReservation += blockSize;
-			++numHeapAllocs;
-		}
-	}
-
-	// Print diagnostics showing how many allocations we had to make in order to
-	// reserve all of low memory. In one test run it took 55 virtual allocs and
-	// 85 heap allocs. Note that since the process may have multiple heaps (each
-	// CRT seems to have its own) there is likely to be a few MB of address space
-	// that was previously reserved and is available to be handed out by some allocators.
-	//char buffer[1000];
-	//sprintf_s( buffer, "Reserved %1.3f MB (%d vallocs, %d heap allocs) to keep allocations out of low-memory.\n",
-	//			totalReservation / (1024 * 1024.0), (int)numVAllocs, (int)numHeapAllocs );
-	// Can't use Msg here because it isn't necessarily initialized yet.
-	//OutputDebugString( buffer );
-#endif
-}
-
 #endif // STEAM
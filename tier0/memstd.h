@@ -29,6 +29,7 @@
 #include "tier0/threadtools.h"
 #include "tier0/tslist.h"
 #include "mem_helpers.h"
+#include "smallblockheap.h"
 
 #pragma pack(4)
 
@@ -37,26 +38,6 @@
 #endif
 
 
-// #define NO_SBH	1
-
-
-#define MIN_SBH_BLOCK	8
-#define MIN_SBH_ALIGN	8
-#define MAX_SBH_BLOCK	2048
-#define MAX_POOL_REGION (4*1024*1024)
-#if !defined(_X360)
-#define SBH_PAGE_SIZE		(4*1024)
-#define COMMIT_SIZE		(16*SBH_PAGE_SIZE)
-#else
-#define SBH_PAGE_SIZE		(64*1024)
-#define COMMIT_SIZE		(SBH_PAGE_SIZE)
-#endif
-#if _M_X64
-#define NUM_POOLS		34
-#else
-#define NUM_POOLS		42
-#endif
-
 // SBH not enabled for LINUX right now. Unlike on Windows, we can't globally hook malloc. Well,
 //  we can and did in override_init_hook(), but that unfortunately causes all malloc functions
 //	to get hooked - including the nVidia driver, etc. And these hooks appear to happen after
@@ -73,65 +54,6 @@
 #define MEM_SBH_ENABLED 1
 #endif
 
-class ALIGN16 CSmallBlockPool
-{
-public:
-	void Init( unsigned nBlockSize, byte *pBase, unsigned initialCommit = 0 );
-	size_t GetBlockSize();
-	bool IsOwner( void *p );
-	void *Alloc();
-	void Free( void *p );
-	int CountFreeBlocks();
-	int GetCommittedSize();
-	int CountCommittedBlocks();
-	int CountAllocatedBlocks();
-	int Compact();
-
-private:
-
-	typedef TSLNodeBase_t FreeBlock_t;
-	class CFreeList : public CTSListBase
-	{
-	public:
-		void Push( void *p ) { CTSListBase::Push( (TSLNodeBase_t *)p );	}
-	};
-
-	CFreeList		m_FreeList;
-
-	unsigned		m_nBlockSize;
-
-	CInterlockedPtr<byte> m_pNextAlloc;
-	byte *			m_pCommitLimit;
-	byte *			m_pAllocLimit;
-	byte *			m_pBase;
-
-	CThreadFastMutex m_CommitMutex;
-} ALIGN16_POST;
-
-
-class ALIGN16 CSmallBlockHeap
-{
-public:
-	CSmallBlockHeap();
-	bool ShouldUse( size_t nBytes );
-	bool IsOwner( void * p );
-	void *Alloc( size_t nBytes );
-	void *Realloc( void *p, size_t nBytes );
-	void Free( void *p );
-	size_t GetSize( void *p );
-	void DumpStats( FILE *pFile = NULL );
-	int Compact();
-
-private:
-	CSmallBlockPool *FindPool( size_t nBytes );
-	CSmallBlockPool *FindPool( void *p );
-
-	CSmallBlockPool *m_PoolLookup[MAX_SBH_BLOCK >> 2];
-	CSmallBlockPool m_Pools[NUM_POOLS];
-	byte *m_pBase;
-	byte *m_pLimit;
-} ALIGN16_POST;
-
 #ifdef USE_PHYSICAL_SMALL_BLOCK_HEAP
 #define BYTES_X360_SBH (32*1024*1024)
 #define PAGESIZE_X360_SBH (64*1024)
@@ -217,6 +139,9 @@ public:
 	{
 		// Make sure that we return 64-bit addresses in 64-bit builds.
 		ReserveBottomMemory();
+#ifdef MEM_SBH_ENABLED
+		m_SmallBlockHeap.SetAllocFailHandler( SmallBlockHeapAllocFailHandler );
+#endif
 	}
 	// Release versions
 	virtual void *Alloc( size_t nSize );
@@ -275,6 +200,7 @@ public:
 	static size_t DefaultFailHandler( size_t );
 	void DumpBlockStats( void *p ) {}
 #ifdef MEM_SBH_ENABLED
+	static size_t SmallBlockHeapAllocFailHandler( size_t nBytes );
 	CSmallBlockHeap m_SmallBlockHeap;
 #ifdef USE_PHYSICAL_SMALL_BLOCK_HEAP
 	CX360SmallBlockHeap m_LargePageSmallBlockHeap;
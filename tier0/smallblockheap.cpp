@@ -0,0 +1,890 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Small block heap (multi-pool)
+//
+//=============================================================================//
+
+#include "pch_tier0.h"
+
+#if defined( _WIN32 ) || ( defined( POSIX ) && !defined( _PS3 ) )
+
+#if defined( _WIN32 ) && !defined( _X360 )
+#define WIN_32_LEAN_AND_MEAN
+#include <windows.h>
+#define VA_COMMIT_FLAGS MEM_COMMIT
+#define VA_RESERVE_FLAGS MEM_RESERVE
+#elif defined( _X360 )
+#undef Verify
+#define _XBOX
+#include <xtl.h>
+#undef _XBOX
+#include "xbox/xbox_win32stubs.h"
+#define VA_COMMIT_FLAGS (MEM_COMMIT|MEM_NOZERO|MEM_LARGE_PAGES)
+#define VA_RESERVE_FLAGS (MEM_RESERVE|MEM_LARGE_PAGES)
+#else
+#include <sys/mman.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "tier0/valve_minmax_off.h"	// GCC 4.2.2 headers screw up our min/max defs.
+#include <algorithm>
+#include "tier0/valve_minmax_on.h"	// GCC 4.2.2 headers screw up our min/max defs.
+
+#include "tier0/dbg.h"
+#include "tier0/threadtools.h"
+#include "smallblockheap.h"
+#include "mem_helpers.h"
+
+// NOTE: no memdbgon.h, malloc and free here are the CRT's
+
+//-----------------------------------------------------------------------------
+// Address space for the pools is reserved up front and committed as they grow
+//-----------------------------------------------------------------------------
+#ifdef _WIN32
+static byte *SBHReserve( size_t nBytes )
+{
+	return (byte *)VirtualAlloc( NULL, nBytes, VA_RESERVE_FLAGS, PAGE_NOACCESS );
+}
+
+static bool SBHCommit( void *p, size_t nBytes )
+{
+	return ( VirtualAlloc( p, nBytes, VA_COMMIT_FLAGS, PAGE_READWRITE ) != NULL );
+}
+
+static void SBHDecommit( void *p, size_t nBytes )
+{
+	VirtualFree( p, nBytes, MEM_DECOMMIT );
+}
+#else
+static byte *SBHReserve( size_t nBytes )
+{
+	void *p = mmap( NULL, nBytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+	return ( p != MAP_FAILED ) ? (byte *)p : NULL;
+}
+
+static bool SBHCommit( void *p, size_t nBytes )
+{
+	return ( mprotect( p, nBytes, PROT_READ | PROT_WRITE ) == 0 );
+}
+
+static void SBHDecommit( void *p, size_t nBytes )
+{
+	// hand the pages back before making them inaccessible again
+	madvise( p, nBytes, MADV_DONTNEED );
+	mprotect( p, nBytes, PROT_NONE );
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// Thread exit callback, returns the blocks cached by the exiting thread
+//-----------------------------------------------------------------------------
+#if defined( _WIN32 ) && !defined( _X360 )
+static VOID WINAPI SBHThreadExit( PVOID pData )
+#else
+static void SBHThreadExit( void *pData )
+#endif
+{
+	CSmallBlockThreadCache *pCache = (CSmallBlockThreadCache *)pData;
+	if ( pCache )
+	{
+		pCache->m_pHeap->ReleaseThreadCache( pCache );
+	}
+}
+
+//-----------------------------------------------------------------------------
+// 
+//-----------------------------------------------------------------------------
+
+void CSmallBlockPool::Init( unsigned nBlockSize, byte *pBase, unsigned initialCommit )
+{
+	if ( !( nBlockSize % MIN_SBH_ALIGN == 0 && nBlockSize >= MIN_SBH_BLOCK && nBlockSize >= sizeof(TSLNodeBase_t) ) )
+		DebuggerBreak();
+
+	m_nBlockSize = nBlockSize;
+	m_pCommitLimit = m_pNextAlloc = m_pBase = pBase;
+	m_pAllocLimit = m_pBase + MAX_POOL_REGION;
+	m_pMagazines = NULL;
+	m_nMagazineBlocks = 0;
+
+	if ( initialCommit )
+	{
+		initialCommit = MemAlign( initialCommit, SBH_PAGE_SIZE );
+		if ( !SBHCommit( m_pCommitLimit, initialCommit ) )
+		{
+			Assert( 0 );
+			return;
+		}
+		m_pCommitLimit += initialCommit;
+	}
+}
+
+size_t CSmallBlockPool::GetBlockSize()
+{
+	return m_nBlockSize;
+}
+
+bool CSmallBlockPool::IsOwner( void *p )
+{
+	return ( p >= m_pBase && p < m_pAllocLimit );
+	}
+
+void *CSmallBlockPool::Alloc()
+	{
+	void *pResult = m_FreeList.Pop();
+		if ( !pResult )
+		{
+			int nBlockSize = m_nBlockSize;
+		byte *pCommitLimit;
+			byte *pNextAlloc;
+		for (;;)
+				{
+			pCommitLimit = m_pCommitLimit;
+			pNextAlloc = m_pNextAlloc;
+			if ( pNextAlloc + nBlockSize <= pCommitLimit )
+					{
+				if ( m_pNextAlloc.AssignIf( pNextAlloc, pNextAlloc + m_nBlockSize ) )
+					{
+					pResult = pNextAlloc;
+						break;
+					}
+				}
+						else
+						{
+				AUTO_LOCK( m_CommitMutex );
+				if ( pCommitLimit == m_pCommitLimit )
+							{
+					if ( pCommitLimit + COMMIT_SIZE <= m_pAllocLimit )
+								{
+						if ( !SBHCommit( pCommitLimit, COMMIT_SIZE ) )
+								{
+							Assert( 0 );
+							return NULL;
+							}
+
+						m_pCommitLimit = pCommitLimit + COMMIT_SIZE;
+						}
+						else
+						{
+							return NULL;
+						}
+					}
+					}
+				}
+			}
+	return pResult;
+}
+
+void CSmallBlockPool::Free( void *p )
+	{	
+	Assert( IsOwner( p ) );
+
+	m_FreeList.Push( p );
+}
+
+//-----------------------------------------------------------------------------
+// Hands out a full magazine if a thread returned one, otherwise builds one
+// from the free list and uncommitted space. Returns the chain, NULL if the
+// pool is exhausted.
+//-----------------------------------------------------------------------------
+void *CSmallBlockPool::AllocMagazine( int *pCount )
+{
+	if ( m_pMagazines )
+	{
+		AUTO_LOCK( m_MagazineMutex );
+		Magazine_t *pMagazine = m_pMagazines;
+		if ( pMagazine )
+		{
+			m_pMagazines = pMagazine->m_pNextMagazine;
+			m_nMagazineBlocks -= SBH_MAGAZINE_SIZE;
+			*pCount = SBH_MAGAZINE_SIZE;
+			return pMagazine;
+		}
+	}
+
+	void *pChain = NULL;
+	int nCount = 0;
+	while ( nCount < SBH_MAGAZINE_SIZE )
+	{
+		void *p = Alloc();
+		if ( !p )
+		{
+			break;
+		}
+		*(void **)p = pChain;
+		pChain = p;
+		nCount++;
+	}
+
+	*pCount = nCount;
+	return pChain;
+}
+
+void CSmallBlockPool::FreeMagazine( void *pChain, int nCount )
+{
+	if ( nCount == SBH_MAGAZINE_SIZE )
+	{
+		Magazine_t *pMagazine = (Magazine_t *)pChain;
+		AUTO_LOCK( m_MagazineMutex );
+		pMagazine->m_pNextMagazine = m_pMagazines;
+		m_pMagazines = pMagazine;
+		m_nMagazineBlocks += SBH_MAGAZINE_SIZE;
+		return;
+	}
+
+	// partial magazines (thread cache flushes) go back block by block
+	while ( pChain )
+	{
+		void *pNext = *(void **)pChain;
+		Free( pChain );
+		pChain = pNext;
+	}
+}
+
+int CSmallBlockPool::CountMagazineBlocks()
+{
+	return m_nMagazineBlocks;
+}
+
+// Moves the blocks of all full magazines to the free list
+void CSmallBlockPool::FlushMagazines()
+{
+	Magazine_t *pMagazines;
+	{
+		AUTO_LOCK( m_MagazineMutex );
+		pMagazines = m_pMagazines;
+		m_pMagazines = NULL;
+		m_nMagazineBlocks = 0;
+	}
+
+	while ( pMagazines )
+	{
+		Magazine_t *pNextMagazine = pMagazines->m_pNextMagazine;
+
+		void *pBlock = pMagazines;
+		while ( pBlock )
+		{
+			void *pNext = *(void **)pBlock;
+			m_FreeList.Push( pBlock );
+			pBlock = pNext;
+		}
+
+		pMagazines = pNextMagazine;
+	}
+}
+
+// Count the free blocks.  
+int CSmallBlockPool::CountFreeBlocks()
+{
+	return m_FreeList.Count() + m_nMagazineBlocks;
+}
+
+// Size of committed memory managed by this heap:
+int CSmallBlockPool::GetCommittedSize()
+{
+	unsigned totalSize = (uintp)m_pCommitLimit - (uintp)m_pBase;
+	Assert( 0 != m_nBlockSize );
+
+	return totalSize;
+}
+
+// Return the total blocks memory is committed for in the heap
+int CSmallBlockPool::CountCommittedBlocks()
+{		 
+	return  GetCommittedSize() / GetBlockSize();
+}
+
+// Count the number of allocated blocks in the heap:
+int CSmallBlockPool::CountAllocatedBlocks()
+{
+	return CountCommittedBlocks( ) - ( CountFreeBlocks( ) + ( m_pCommitLimit - (byte *)m_pNextAlloc ) / GetBlockSize() );
+}
+
+int CSmallBlockPool::Compact()
+{
+	FlushMagazines();
+
+	int nBytesFreed = 0;
+	if ( m_FreeList.Count() )
+{
+	int i;
+		int nFree = m_FreeList.Count();
+		FreeBlock_t **pSortArray = (FreeBlock_t **)malloc( nFree * sizeof(FreeBlock_t *) ); // can't use new because will reenter
+
+		if ( !pSortArray )
+		{
+		return 0;
+		}
+
+		i = 0;
+		while ( i < nFree )
+		{
+			pSortArray[i++] = m_FreeList.Pop();
+			}
+
+		std::sort( pSortArray, pSortArray + nFree );
+
+		byte *pOldNextAlloc = m_pNextAlloc;
+
+		for ( i = nFree - 1; i >= 0; i-- )
+			{
+			if ( (byte *)pSortArray[i] == m_pNextAlloc - m_nBlockSize )
+				{
+				pSortArray[i] = NULL;
+				m_pNextAlloc -= m_nBlockSize;
+				}
+				else
+				{
+							break;
+						}
+			}
+
+		if ( pOldNextAlloc != m_pNextAlloc )
+		{
+			byte *pNewCommitLimit = MemAlign( (byte *)m_pNextAlloc, SBH_PAGE_SIZE );
+			if ( pNewCommitLimit < m_pCommitLimit )
+		{
+				nBytesFreed = m_pCommitLimit - pNewCommitLimit;
+				SBHDecommit( pNewCommitLimit, nBytesFreed );
+				m_pCommitLimit = pNewCommitLimit;
+		}
+	}
+
+		if ( pSortArray[0] )
+	{
+			for ( i = 0; i < nFree ; i++ )
+		{
+				if ( !pSortArray[i] )
+			{
+					break;
+				}
+				m_FreeList.Push( pSortArray[i] );
+			}
+			}
+
+		free( pSortArray );
+		}
+
+	return nBytesFreed;
+}
+
+
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+#define GetInitialCommitForPool( i ) 0
+
+CSmallBlockHeap::CSmallBlockHeap()
+{
+	// Make sure that we return 64-bit addresses in 64-bit builds.
+	ReserveBottomMemory();
+
+	m_pThreadCaches = NULL;
+	m_pfnAllocFailHandler = NULL;
+
+#if defined( POSIX ) && !defined( _GAMECONSOLE )
+	m_bThreadExitKey = ( pthread_key_create( &m_hThreadExitKey, SBHThreadExit ) == 0 );
+#elif defined( _WIN32 ) && !defined( _X360 )
+	// fiber local storage, unlike TLS it calls back when a thread exits
+	m_hThreadExitKey = FlsAlloc( SBHThreadExit );
+	m_bThreadExitKey = ( m_hThreadExitKey != FLS_OUT_OF_INDEXES );
+#else
+	m_bThreadExitKey = false;
+#endif
+
+	if ( !UsingSBH() )
+	{
+		return;
+	}
+
+	m_pBase = SBHReserve( NUM_POOLS * MAX_POOL_REGION );
+	m_pLimit = m_pBase + NUM_POOLS * MAX_POOL_REGION;
+
+	// Build a lookup table used to find the correct pool based on size
+	const int MAX_TABLE = MAX_SBH_BLOCK >> 2;
+	int i = 0;
+	int nBytesElement = 0;
+	byte *pCurBase = m_pBase;
+	CSmallBlockPool *pCurPool = NULL;
+	int iCurPool = 0;
+
+#ifdef PLATFORM_64BITS
+	// Blocks sized 0 - 256 are in pools in increments of 16
+	for ( ; i < 64 && i < MAX_TABLE; i++ )
+	{
+		if ( (i + 1) % 4 == 1)
+		{
+			nBytesElement += 16;
+			pCurPool = &m_Pools[iCurPool];
+			pCurPool->Init( nBytesElement, pCurBase, GetInitialCommitForPool(iCurPool) );
+			iCurPool++;
+			m_PoolLookup[i] = pCurPool;
+			pCurBase += MAX_POOL_REGION;
+		}
+		else
+		{
+			m_PoolLookup[i] = pCurPool;
+		}
+	}
+#else
+	// Blocks sized 0 - 128 are in pools in increments of 8
+	for ( ; i < 32; i++ )
+	{
+		if ( (i + 1) % 2 == 1)
+		{
+			nBytesElement += 8;
+			pCurPool = &m_Pools[iCurPool];
+			pCurPool->Init( nBytesElement, pCurBase, GetInitialCommitForPool(iCurPool) );
+			iCurPool++;
+			m_PoolLookup[i] = pCurPool;
+			pCurBase += MAX_POOL_REGION;
+		}
+		else
+		{
+			m_PoolLookup[i] = pCurPool;
+		}
+	}
+
+	// Blocks sized 129 - 256 are in pools in increments of 16
+	for ( ; i < 64; i++ )
+	{
+		if ( (i + 1) % 4 == 1)
+		{
+			nBytesElement += 16;
+			pCurPool = &m_Pools[iCurPool];
+			pCurPool->Init( nBytesElement, pCurBase, GetInitialCommitForPool(iCurPool) );
+			iCurPool++;
+			m_PoolLookup[i] = pCurPool;
+			pCurBase += MAX_POOL_REGION;
+		}
+		else
+		{
+			m_PoolLookup[i] = pCurPool;
+		}
+	}
+#endif
+
+	// Blocks sized 257 - 512 are in pools in increments of 32
+	for ( ; i < 128; i++ )
+	{
+		if ( (i + 1) % 8 == 1)
+		{
+			nBytesElement += 32;
+			pCurPool = &m_Pools[iCurPool];
+			pCurPool->Init( nBytesElement, pCurBase, GetInitialCommitForPool(iCurPool) );
+			iCurPool++;
+			m_PoolLookup[i] = pCurPool;
+			pCurBase += MAX_POOL_REGION;
+		}
+		else
+		{
+			m_PoolLookup[i] = pCurPool;
+		}
+	}
+
+	// Blocks sized 513 - 768 are in pools in increments of 64
+	for ( ; i < 192; i++ )
+	{
+		if ( (i + 1) % 16 == 1)
+		{
+			nBytesElement += 64;
+			pCurPool = &m_Pools[iCurPool];
+			pCurPool->Init( nBytesElement, pCurBase, GetInitialCommitForPool(iCurPool) );
+			iCurPool++;
+			m_PoolLookup[i] = pCurPool;
+			pCurBase += MAX_POOL_REGION;
+		}
+		else
+		{
+			m_PoolLookup[i] = pCurPool;
+		}
+	}
+
+	// Blocks sized 769 - 1024 are in pools in increments of 128
+	for ( ; i < 256; i++ )
+	{
+		if ( (i + 1) % 32 == 1)
+		{
+			nBytesElement += 128;
+			pCurPool = &m_Pools[iCurPool];
+			pCurPool->Init( nBytesElement, pCurBase, GetInitialCommitForPool(iCurPool) );
+			iCurPool++;
+			m_PoolLookup[i] = pCurPool;
+			pCurBase += MAX_POOL_REGION;
+		}
+		else
+		{
+			m_PoolLookup[i] = pCurPool;
+		}
+	}
+
+	// Blocks sized 1025 - 2048 are in pools in increments of 256
+	for ( ; i < MAX_TABLE; i++ )
+	{
+		if ( (i + 1) % 64 == 1)
+		{
+			nBytesElement += 256;
+			pCurPool = &m_Pools[iCurPool];
+			pCurPool->Init( nBytesElement, pCurBase, GetInitialCommitForPool(iCurPool) );
+			iCurPool++;
+			m_PoolLookup[i] = pCurPool;
+			pCurBase += MAX_POOL_REGION;
+		}
+		else
+		{
+			m_PoolLookup[i] = pCurPool;
+		}
+	}
+
+	Assert( iCurPool == NUM_POOLS );
+}
+
+bool CSmallBlockHeap::ShouldUse( size_t nBytes )
+{
+	return ( UsingSBH() && nBytes <= MAX_SBH_BLOCK );
+}
+
+bool CSmallBlockHeap::IsOwner( void * p )
+{
+	return ( UsingSBH() && p >= m_pBase && p < m_pLimit );
+}
+
+void *CSmallBlockHeap::Alloc( size_t nBytes )
+{
+	if ( nBytes == 0)
+	{
+		nBytes = 1;
+	}
+	Assert( ShouldUse( nBytes ) );
+	CSmallBlockPool *pPool = FindPool( nBytes );
+	
+	void *p = CacheAlloc( pPool );
+	if ( p )
+	{
+		return p;
+	}
+
+	if ( m_pfnAllocFailHandler && m_pfnAllocFailHandler( nBytes ) >= nBytes )
+	{
+		p = CacheAlloc( pPool );
+		if ( p )
+		{
+	return p;
+}
+	}
+
+	// NULL if the CRT is out of memory too, the caller reports that
+	return malloc( nBytes );
+}
+
+void *CSmallBlockHeap::Realloc( void *p, size_t nBytes )
+{
+	if ( nBytes == 0)
+	{
+		nBytes = 1;
+	}
+
+	CSmallBlockPool *pOldPool = FindPool( p );
+	CSmallBlockPool *pNewPool = ( ShouldUse( nBytes ) ) ? FindPool( nBytes ) : NULL;
+
+	if ( pOldPool == pNewPool )
+	{
+		return p;
+	}
+
+	void *pNewBlock = NULL;
+
+	if ( pNewPool )
+	{
+		pNewBlock = CacheAlloc( pNewPool );
+
+	if ( !pNewBlock )
+	{
+			if ( m_pfnAllocFailHandler && m_pfnAllocFailHandler( nBytes ) >= nBytes )
+			{
+				pNewBlock = CacheAlloc( pNewPool );
+			}
+		}
+	}
+
+	if ( !pNewBlock )
+	{
+		pNewBlock = malloc( nBytes );
+	}
+
+	if ( pNewBlock )
+	{
+		size_t nBytesCopy = MIN( nBytes, pOldPool->GetBlockSize() );
+		memcpy( pNewBlock, p, nBytesCopy );
+	} 
+
+	CacheFree( pOldPool, p );
+
+	// NULL if the CRT is out of memory too, the caller reports that
+	return pNewBlock;
+}
+
+void CSmallBlockHeap::Free( void *p )
+	{
+	CSmallBlockPool *pPool = FindPool( p );
+	CacheFree( pPool, p );
+	}
+
+//-----------------------------------------------------------------------------
+// Thread caches
+//-----------------------------------------------------------------------------
+CSmallBlockThreadCache *CSmallBlockHeap::GetThreadCache()
+{
+	CSmallBlockThreadCache *pCache = m_ThreadCache;
+	if ( !pCache )
+	{
+		// can't use new because will reenter
+		pCache = (CSmallBlockThreadCache *)calloc( 1, sizeof( CSmallBlockThreadCache ) );
+		if ( !pCache )
+		{
+			return NULL;
+		}
+
+		pCache->m_ThreadId = ThreadGetCurrentId();
+		pCache->m_pHeap = this;
+		{
+			AUTO_LOCK( m_ThreadCacheMutex );
+			pCache->m_pNext = m_pThreadCaches;
+			m_pThreadCaches = pCache;
+		}
+		m_ThreadCache = pCache;
+
+		if ( m_bThreadExitKey )
+		{
+#if defined( POSIX ) && !defined( _GAMECONSOLE )
+			pthread_setspecific( m_hThreadExitKey, pCache );
+#elif defined( _WIN32 ) && !defined( _X360 )
+			FlsSetValue( m_hThreadExitKey, pCache );
+#endif
+		}
+	}
+	return pCache;
+}
+
+void CSmallBlockHeap::ReleaseThreadCache( CSmallBlockThreadCache *pCache )
+{
+	FlushThreadCache( pCache );
+
+	{
+		AUTO_LOCK( m_ThreadCacheMutex );
+		CSmallBlockThreadCache **ppLink = &m_pThreadCaches;
+		while ( *ppLink != pCache )
+		{
+			ppLink = &(*ppLink)->m_pNext;
+		}
+		*ppLink = pCache->m_pNext;
+	}
+
+	// Frees from exit callbacks that run after this one start a new cache,
+	// which is released again on the next round of callbacks
+	if ( (CSmallBlockThreadCache *)m_ThreadCache == pCache )
+	{
+		m_ThreadCache = NULL;
+	}
+	free( pCache );
+}
+
+void *CSmallBlockHeap::CacheAlloc( CSmallBlockPool *pPool )
+{
+	CSmallBlockThreadCache *pCache = GetThreadCache();
+	if ( !pCache )
+	{
+		return pPool->Alloc();
+	}
+
+	CSmallBlockThreadCache::PoolCache_t &cache = pCache->m_Pools[pPool - m_Pools];
+	if ( !cache.m_pHead )
+	{
+		cache.m_pHead = (CSmallBlockThreadCache::FreeBlock_t *)pPool->AllocMagazine( &cache.m_nCount );
+		if ( !cache.m_pHead )
+		{
+			return NULL;
+		}
+		pCache->m_nRefills++;
+	}
+
+	CSmallBlockThreadCache::FreeBlock_t *pBlock = cache.m_pHead;
+	cache.m_pHead = pBlock->m_pNext;
+	cache.m_nCount--;
+	pCache->m_nAllocs++;
+
+	return pBlock;
+}
+
+void CSmallBlockHeap::CacheFree( CSmallBlockPool *pPool, void *p )
+{
+	Assert( pPool->IsOwner( p ) );
+
+	CSmallBlockThreadCache *pCache = GetThreadCache();
+	if ( !pCache )
+	{
+		pPool->Free( p );
+		return;
+	}
+
+	CSmallBlockThreadCache::PoolCache_t &cache = pCache->m_Pools[pPool - m_Pools];
+	if ( cache.m_nCount >= 2 * SBH_MAGAZINE_SIZE )
+	{
+		// keep the most recently freed magazine, it's the one still in cache
+		CSmallBlockThreadCache::FreeBlock_t *pLast = cache.m_pHead;
+		for ( int i = 1; i < SBH_MAGAZINE_SIZE; i++ )
+		{
+			pLast = pLast->m_pNext;
+		}
+
+		pPool->FreeMagazine( pLast->m_pNext, cache.m_nCount - SBH_MAGAZINE_SIZE );
+		pLast->m_pNext = NULL;
+		cache.m_nCount = SBH_MAGAZINE_SIZE;
+		pCache->m_nReturns++;
+	}
+
+	CSmallBlockThreadCache::FreeBlock_t *pBlock = (CSmallBlockThreadCache::FreeBlock_t *)p;
+	pBlock->m_pNext = cache.m_pHead;
+	cache.m_pHead = pBlock;
+	cache.m_nCount++;
+	pCache->m_nFrees++;
+}
+
+// Gives all blocks cached by a thread back to the pools
+void CSmallBlockHeap::FlushThreadCache( CSmallBlockThreadCache *pCache )
+{
+	for ( int i = 0; i < NUM_POOLS; i++ )
+	{
+		CSmallBlockThreadCache::PoolCache_t &cache = pCache->m_Pools[i];
+		if ( cache.m_pHead )
+		{
+			m_Pools[i].FreeMagazine( cache.m_pHead, cache.m_nCount );
+			cache.m_pHead = NULL;
+			cache.m_nCount = 0;
+		}
+	}
+}
+
+size_t CSmallBlockHeap::GetSize( void *p )
+{
+	CSmallBlockPool *pPool = FindPool( p );
+	return pPool->GetBlockSize();
+}
+
+void CSmallBlockHeap::DumpStats( FILE *pFile )
+{
+	bool bSpew = true;
+
+	if ( pFile )
+	{
+		for ( int i = 0; i < NUM_POOLS; i++ )
+		{
+			// output for vxconsole parsing
+			fprintf( pFile, "Pool %i: Size: %llu Allocated: %i Free: %i Committed: %i CommittedSize: %i\n", 
+				i, 
+				(uint64)m_Pools[i].GetBlockSize(), 
+				m_Pools[i].CountAllocatedBlocks(), 
+				m_Pools[i].CountFreeBlocks(),
+				m_Pools[i].CountCommittedBlocks(), 
+				m_Pools[i].GetCommittedSize() );
+		}
+		bSpew = false;
+	}
+
+	if ( bSpew )
+	{
+		unsigned bytesCommitted = 0;
+		unsigned bytesAllocated = 0;
+
+		for ( int i = 0; i < NUM_POOLS; i++ )
+		{
+			Msg( "Pool %i: (size: %llu) blocks: allocated:%i free:%i committed:%i (committed size:%u kb)\n",i, (uint64)m_Pools[i].GetBlockSize(),m_Pools[i].CountAllocatedBlocks(), m_Pools[i].CountFreeBlocks(),m_Pools[i].CountCommittedBlocks(), m_Pools[i].GetCommittedSize() / 1024);
+
+			bytesCommitted += m_Pools[i].GetCommittedSize();
+			bytesAllocated += ( m_Pools[i].CountAllocatedBlocks() * m_Pools[i].GetBlockSize() );
+		}
+
+		Msg( "Totals: Committed:%u kb Allocated:%u kb\n", bytesCommitted / 1024, bytesAllocated / 1024 );
+	}
+
+	DumpThreadCacheStats( pFile );
+}
+
+// Blocks sitting in thread caches count as allocated in the pool stats above
+void CSmallBlockHeap::DumpThreadCacheStats( FILE *pFile )
+{
+	AUTO_LOCK( m_ThreadCacheMutex );
+
+	for ( CSmallBlockThreadCache *pCache = m_pThreadCaches; pCache; pCache = pCache->m_pNext )
+	{
+		unsigned bytesCached = 0;
+		for ( int i = 0; i < NUM_POOLS; i++ )
+		{
+			bytesCached += pCache->m_Pools[i].m_nCount * m_Pools[i].GetBlockSize();
+		}
+
+		if ( pFile )
+		{
+			fprintf( pFile, "Thread %u: Allocs: %u Frees: %u Refills: %u Returns: %u CachedSize: %u\n",
+				(unsigned)pCache->m_ThreadId, pCache->m_nAllocs, pCache->m_nFrees, pCache->m_nRefills, pCache->m_nReturns, bytesCached );
+		}
+		else
+		{
+			Msg( "Thread %u cache: allocs:%u frees:%u magazines: refilled:%u returned:%u (cached size:%u kb)\n",
+				(unsigned)pCache->m_ThreadId, pCache->m_nAllocs, pCache->m_nFrees, pCache->m_nRefills, pCache->m_nReturns, bytesCached / 1024 );
+		}
+	}
+}
+
+int CSmallBlockHeap::CountAllocatedBlocks()
+{
+	int nBlocks = 0;
+	for ( int i = 0; i < NUM_POOLS; i++ )
+	{
+		nBlocks += m_Pools[i].CountAllocatedBlocks();
+	}
+	return nBlocks;
+}
+
+int CSmallBlockHeap::CountThreadCaches()
+{
+	AUTO_LOCK( m_ThreadCacheMutex );
+
+	int nCaches = 0;
+	for ( CSmallBlockThreadCache *pCache = m_pThreadCaches; pCache; pCache = pCache->m_pNext )
+	{
+		nCaches++;
+	}
+	return nCaches;
+}
+
+int CSmallBlockHeap::Compact()
+{
+	// only the calling thread's cache can be flushed safely
+	CSmallBlockThreadCache *pCache = m_ThreadCache;
+	if ( pCache )
+	{
+		FlushThreadCache( pCache );
+	}
+
+	int nBytesFreed = 0;
+	for( int i = 0; i < NUM_POOLS; i++ )
+	{
+		nBytesFreed += m_Pools[i].Compact();
+	}
+	return nBytesFreed;
+}
+
+CSmallBlockPool *CSmallBlockHeap::FindPool( size_t nBytes )
+{
+	return m_PoolLookup[(nBytes - 1) >> 2];
+}
+
+CSmallBlockPool *CSmallBlockHeap::FindPool( void *p )
+{
+	size_t i = ((byte *)p - m_pBase) / MAX_POOL_REGION;
+	return &m_Pools[i];
+}
+
+#endif // _WIN32 || POSIX
@@ -0,0 +1,217 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Small block heap: fixed size block pools carved from reserved
+//			address space, with per-thread magazine caches in front of them.
+//
+// Used by the standard allocator (memstd.cpp) where MEM_SBH_ENABLED is set.
+// Built on every platform so it can be tested where the allocator doesn't
+// use it.
+//
+//=============================================================================//
+
+#ifndef SMALLBLOCKHEAP_H
+#define SMALLBLOCKHEAP_H
+#ifdef _WIN32
+#pragma once
+#endif
+
+#include <stdio.h>
+#include "tier0/platform.h"
+#include "tier0/threadtools.h"
+#include "tier0/tslist.h"
+
+#define MIN_SBH_BLOCK	8
+#define MIN_SBH_ALIGN	8
+#define MAX_SBH_BLOCK	2048
+#define MAX_POOL_REGION (4*1024*1024)
+#if !defined(_X360)
+#define SBH_PAGE_SIZE		(4*1024)
+#define COMMIT_SIZE		(16*SBH_PAGE_SIZE)
+#else
+#define SBH_PAGE_SIZE		(64*1024)
+#define COMMIT_SIZE		(SBH_PAGE_SIZE)
+#endif
+#ifdef PLATFORM_64BITS
+#define NUM_POOLS		34
+#else
+#define NUM_POOLS		42
+#endif
+#define SBH_MAGAZINE_SIZE	32	// blocks moved between a thread cache and a pool at a time
+
+// #define NO_SBH	1
+
+#ifndef NO_SBH
+#ifdef ALLOW_NOSBH
+static bool g_UsingSBH = true;
+#define UsingSBH() g_UsingSBH
+#else
+#define UsingSBH() true
+#endif
+#else
+#define UsingSBH() false
+#endif
+
+//-----------------------------------------------------------------------------
+//
+//-----------------------------------------------------------------------------
+template <typename T>
+inline T MemAlign( T val, size_t alignment )
+{
+	return (T)( ( (size_t)val + alignment - 1 ) & ~( alignment - 1 ) );
+}
+
+// The layout must not depend on the packing of the file that includes this
+#pragma pack(push, 8)
+
+class ALIGN16 CSmallBlockPool
+{
+public:
+	void Init( unsigned nBlockSize, byte *pBase, unsigned initialCommit = 0 );
+	size_t GetBlockSize();
+	bool IsOwner( void *p );
+	void *Alloc();
+	void Free( void *p );
+	int CountFreeBlocks();
+	int GetCommittedSize();
+	int CountCommittedBlocks();
+	int CountAllocatedBlocks();
+	int Compact();
+
+	// Magazines are chains of free blocks linked through their first word.
+	// The thread caches take and return them whole, so the shared free list
+	// and the commit mutex are only touched once per SBH_MAGAZINE_SIZE blocks.
+	void *AllocMagazine( int *pCount );
+	void FreeMagazine( void *pChain, int nCount );
+	int CountMagazineBlocks();
+
+private:
+
+	typedef TSLNodeBase_t FreeBlock_t;
+	class CFreeList : public CTSListBase
+	{
+	public:
+		void Push( void *p ) { CTSListBase::Push( (TSLNodeBase_t *)p );	}
+	};
+
+	// Full magazine, the head block also links to the next magazine
+	struct Magazine_t
+	{
+		void		*m_pNextBlock;
+		Magazine_t	*m_pNextMagazine;
+	};
+
+	void FlushMagazines();
+
+	CFreeList		m_FreeList;
+
+	CThreadFastMutex m_MagazineMutex;
+	Magazine_t *	m_pMagazines;
+	int				m_nMagazineBlocks;
+
+	unsigned		m_nBlockSize;
+
+	CInterlockedPtr<byte> m_pNextAlloc;
+	byte *			m_pCommitLimit;
+	byte *			m_pAllocLimit;
+	byte *			m_pBase;
+
+	CThreadFastMutex m_CommitMutex;
+} ALIGN16_POST;
+
+
+class CSmallBlockHeap;
+
+//-----------------------------------------------------------------------------
+// Per-thread front end of the small block heap. Each thread keeps up to two
+// magazines of free blocks per pool, so most allocations and frees don't
+// touch any shared cache line.
+//-----------------------------------------------------------------------------
+class CSmallBlockThreadCache
+{
+public:
+	struct FreeBlock_t
+	{
+		FreeBlock_t *m_pNext;
+	};
+
+	struct PoolCache_t
+	{
+		FreeBlock_t *m_pHead;
+		int			m_nCount;
+	};
+
+	PoolCache_t		m_Pools[NUM_POOLS];
+
+	ThreadId_t		m_ThreadId;
+	CSmallBlockHeap	*m_pHeap;			// the cache is given back to it when the thread exits
+	CSmallBlockThreadCache *m_pNext;	// list of all thread caches, for stats
+
+	// Written by the owning thread only
+	uint32			m_nAllocs;
+	uint32			m_nFrees;
+	uint32			m_nRefills;			// magazines taken from the pools
+	uint32			m_nReturns;			// magazines given back to the pools
+};
+
+
+// Called when a pool is out of space, before the heap falls back to malloc.
+// Returns the number of bytes it could free up.
+typedef size_t (*SmallBlockAllocFailHandler_t)( size_t nBytes );
+
+class ALIGN16 PLATFORM_CLASS CSmallBlockHeap
+{
+public:
+	CSmallBlockHeap();
+	bool ShouldUse( size_t nBytes );
+	bool IsOwner( void * p );
+	void *Alloc( size_t nBytes );
+	void *Realloc( void *p, size_t nBytes );
+	void Free( void *p );
+	size_t GetSize( void *p );
+	void DumpStats( FILE *pFile = NULL );
+	void DumpThreadCacheStats( FILE *pFile = NULL );
+	int Compact();
+
+	void SetAllocFailHandler( SmallBlockAllocFailHandler_t pfnHandler )	{ m_pfnAllocFailHandler = pfnHandler; }
+
+	// Blocks sitting in thread caches count as allocated
+	int CountAllocatedBlocks();
+	int CountThreadCaches();
+
+	// Gives a thread's cached blocks back to the pools and frees its cache,
+	// called on the thread itself when it exits
+	void ReleaseThreadCache( CSmallBlockThreadCache *pCache );
+
+private:
+	CSmallBlockPool *FindPool( size_t nBytes );
+	CSmallBlockPool *FindPool( void *p );
+
+	CSmallBlockThreadCache *GetThreadCache();
+	void *CacheAlloc( CSmallBlockPool *pPool );
+	void CacheFree( CSmallBlockPool *pPool, void *p );
+	void FlushThreadCache( CSmallBlockThreadCache *pCache );
+
+	CTHREADLOCALPTR( CSmallBlockThreadCache ) m_ThreadCache;
+	CSmallBlockThreadCache *m_pThreadCaches;
+	CThreadFastMutex m_ThreadCacheMutex;
+
+	// Thread local slot whose exit callback releases the thread's cache.
+	// The Xbox 360 has no such callback, caches of exited threads stay around.
+	bool			m_bThreadExitKey;
+#if defined( POSIX ) && !defined( _GAMECONSOLE )
+	pthread_key_t	m_hThreadExitKey;
+#else
+	uint32			m_hThreadExitKey;
+#endif
+
+	SmallBlockAllocFailHandler_t m_pfnAllocFailHandler;
+
+	CSmallBlockPool *m_PoolLookup[MAX_SBH_BLOCK >> 2];
+	CSmallBlockPool m_Pools[NUM_POOLS];
+	byte *m_pBase;
+	byte *m_pLimit;
+} ALIGN16_POST;
+
+#pragma pack(pop)
+
+#endif // SMALLBLOCKHEAP_H
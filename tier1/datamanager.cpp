@@ -21,6 +21,9 @@ CDataManagerBase::CDataManagerBase( unsigned int maxSize )
 {
 	m_targetMemorySize = maxSize;
 	m_memUsed = 0;
+	m_nEvictions = 0;
+	m_nSecondChances = 0;
+	memset( (void *)m_pReferenceChunks, 0, sizeof( m_pReferenceChunks ) );
 	m_lruList = m_memoryLists.CreateList();
 	m_lockList = m_memoryLists.CreateList();
 	m_freeList = m_memoryLists.CreateList();
@@ -31,6 +34,11 @@ CDataManagerBase::CDataManagerBase( unsigned int maxSize )
 CDataManagerBase::~CDataManagerBase() 
 {
 	Assert( !m_freeOnDestruct || m_listsAreFreed );
+
+	for ( int i = 0; i < REFERENCE_CHUNK_COUNT; i++ )
+	{
+		delete [] const_cast<uint8 *>( m_pReferenceChunks[i] );
+	}
 }
 
 void CDataManagerBase::NotifySizeChanged( memhandle_t handle, unsigned int oldSize, unsigned int newSize )
@@ -242,8 +250,19 @@ void *CDataManagerBase::GetResource_NoLock( memhandle_t handle )
 
 void CDataManagerBase::TouchResource( memhandle_t handle )
 {
-	AUTO_LOCK_DM();
-	TouchByIndex( FromHandle(handle) );
+	// No mutex and no serial check: a stale handle at worst hands a second
+	// chance to whatever resource reused its slot
+	unsigned int fullWord = (unsigned int)reinterpret_cast<uintp>( handle );
+	SetReferenced( ( fullWord & 0xFFFF ) - 1 );
+}
+
+bool CDataManagerBase::TestAndClearReferenced( memhandle_t handle )
+{
+	unsigned short memoryIndex = FromHandle(handle);
+	if ( memoryIndex == m_memoryLists.InvalidIndex() )
+		return false;
+
+	return TestAndClearReferencedByIndex( memoryIndex );
 }
 
 void CDataManagerBase::MarkAsStale( memhandle_t handle )
@@ -257,6 +276,7 @@ void CDataManagerBase::MarkAsStale( memhandle_t handle )
 			m_memoryLists.Unlink( m_lruList, memoryIndex );
 			m_memoryLists.LinkToHead( m_lruList, memoryIndex );
 		}
+		TestAndClearReferencedByIndex( memoryIndex );
 	}
 }
 
@@ -318,6 +338,8 @@ unsigned short CDataManagerBase::CreateHandle( bool bCreateLocked )
 		m_memoryLists[memoryIndex].lockCount++;
 	}
 
+	AllocReferenceBit( memoryIndex );
+
 	return memoryIndex;
 }
 
@@ -334,14 +356,25 @@ void CDataManagerBase::TouchByIndex( unsigned short memoryIndex )
 {
 	if ( memoryIndex != m_memoryLists.InvalidIndex() )
 	{
-		if ( m_memoryLists[memoryIndex].lockCount == 0 )
-		{
-			m_memoryLists.Unlink( m_lruList, memoryIndex );
-			m_memoryLists.LinkToTail( m_lruList, memoryIndex );
-		}
+		SetReferenced( memoryIndex );
 	}
 }
 
+// Must be locked. Chunks are published before any handle into them exists,
+// so lock free readers never see a half initialized one.
+void CDataManagerBase::AllocReferenceBit( unsigned short memoryIndex )
+{
+	int nChunk = memoryIndex / REFERENCE_CHUNK_SIZE;
+	if ( !m_pReferenceChunks[nChunk] )
+	{
+		uint8 *pChunk = new uint8[REFERENCE_CHUNK_SIZE];
+		memset( pChunk, 0, REFERENCE_CHUNK_SIZE );
+		ThreadMemoryBarrier();
+		m_pReferenceChunks[nChunk] = pChunk;
+	}
+	m_pReferenceChunks[nChunk][memoryIndex % REFERENCE_CHUNK_SIZE] = 0;
+}
+
 memhandle_t CDataManagerBase::ToHandle( unsigned short index )
 {
 	unsigned int hiword = m_memoryLists.Element(index).serial;
@@ -370,6 +403,7 @@ unsigned int CDataManagerBase::UsedSize()
 unsigned int CDataManagerBase::EnsureCapacity( unsigned int size )
 {
 	unsigned nBytesInitial = MemUsed_Inline();
+	int nSecondChancesLeft = -1;
 	while ( MemUsed_Inline() > MemTotal_Inline() || MemAvailable_Inline() < size )
 	{
 		Lock();
@@ -379,8 +413,26 @@ unsigned int CDataManagerBase::EnsureCapacity( unsigned int size )
 			Unlock();
 			break;
 		}
+
+		// Clock hand: referenced resources get cleared and sent round again.
+		// One lap at most, so touches racing with us can't keep it spinning.
+		if ( nSecondChancesLeft < 0 )
+		{
+			nSecondChancesLeft = m_memoryLists.Count( m_lruList );
+		}
+		if ( nSecondChancesLeft > 0 && TestAndClearReferencedByIndex( lruIndex ) )
+		{
+			nSecondChancesLeft--;
+			m_nSecondChances++;
+			m_memoryLists.Unlink( m_lruList, lruIndex );
+			m_memoryLists.LinkToTail( m_lruList, lruIndex );
+			Unlock();
+			continue;
+		}
+
 		m_memoryLists.Unlink( m_lruList, lruIndex );
 		void *p = GetForFreeByIndex( lruIndex );
+		m_nEvictions++;
 		Unlock();
 		DestroyResourceStorage( p );
 	}
@@ -406,6 +458,7 @@ void *CDataManagerBase::GetForFreeByIndex( unsigned short memoryIndex )
 		p = mem.pStore;
 		mem.pStore = NULL;
 		mem.serial++;
+		TestAndClearReferencedByIndex( memoryIndex );
 		m_memoryLists.LinkToTail( m_freeList, memoryIndex );
 	}
 	return p;
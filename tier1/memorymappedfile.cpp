@@ -0,0 +1,176 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Read-only memory mapping of files on disk
+//
+//===========================================================================//
+
+#if defined( _WIN32 ) && !defined( _X360 )
+#include <windows.h>
+#elif defined( POSIX )
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "tier1/memorymappedfile.h"
+#include "tier0/dbg.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+
+CMemoryMappedFile::CMemoryMappedFile()
+{
+	m_pBase = NULL;
+	m_nSize = 0;
+#ifdef _WIN32
+	m_hFile = INVALID_HANDLE_VALUE;
+	m_hMapping = NULL;
+#endif
+}
+
+CMemoryMappedFile::~CMemoryMappedFile()
+{
+	Close();
+}
+
+bool CMemoryMappedFile::Open( const char *pFullPath )
+{
+	Close();
+
+#if defined( _WIN32 ) && !defined( _X360 )
+	m_hFile = CreateFileA( pFullPath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( m_hFile == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER size;
+	if ( !GetFileSizeEx( (HANDLE)m_hFile, &size ) || size.QuadPart == 0 )
+	{
+		Close();
+		return false;
+	}
+
+	// PAGE_WRITECOPY gives us private pages on write, same as MAP_PRIVATE
+	m_hMapping = CreateFileMappingA( (HANDLE)m_hFile, NULL, PAGE_WRITECOPY, 0, 0, NULL );
+	if ( !m_hMapping )
+	{
+		Close();
+		return false;
+	}
+
+	m_pBase = (uint8 *)MapViewOfFile( (HANDLE)m_hMapping, FILE_MAP_COPY, 0, 0, 0 );
+	if ( !m_pBase )
+	{
+		Close();
+		return false;
+	}
+	m_nSize = size.QuadPart;
+	return true;
+#elif defined( POSIX )
+	int fd = open( pFullPath, O_RDONLY );
+	if ( fd < 0 )
+		return false;
+
+	struct stat st;
+	if ( fstat( fd, &st ) != 0 || !S_ISREG( st.st_mode ) || st.st_size == 0 )
+	{
+		close( fd );
+		return false;
+	}
+
+	void *pBase = mmap( NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+
+	// The mapping holds its own reference to the file
+	close( fd );
+
+	if ( pBase == MAP_FAILED )
+		return false;
+
+	m_pBase = (uint8 *)pBase;
+	m_nSize = st.st_size;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void CMemoryMappedFile::Close()
+{
+#if defined( _WIN32 ) && !defined( _X360 )
+	if ( m_pBase )
+	{
+		UnmapViewOfFile( m_pBase );
+	}
+	if ( m_hMapping )
+	{
+		CloseHandle( (HANDLE)m_hMapping );
+		m_hMapping = NULL;
+	}
+	if ( m_hFile != INVALID_HANDLE_VALUE )
+	{
+		CloseHandle( (HANDLE)m_hFile );
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+#elif defined( POSIX )
+	if ( m_pBase )
+	{
+		munmap( m_pBase, m_nSize );
+	}
+#endif
+	m_pBase = NULL;
+	m_nSize = 0;
+}
+
+CMemoryMappedFileView CMemoryMappedFile::View( int64 nOffset, int64 nSize ) const
+{
+	if ( !m_pBase || nOffset < 0 || nSize < 0 || nOffset + nSize > m_nSize )
+		return CMemoryMappedFileView();
+
+	return CMemoryMappedFileView( m_pBase + nOffset, nSize );
+}
+
+#ifdef POSIX
+//-----------------------------------------------------------------------------
+// madvise wants page aligned ranges; widen [nOffset, nOffset + nSize) to pages
+//-----------------------------------------------------------------------------
+static bool AlignToPages( int64 nMappingSize, int64 nOffset, int64 nSize, int64 &nAlignedOffset, int64 &nAlignedSize )
+{
+	if ( nOffset < 0 || nSize <= 0 || nOffset >= nMappingSize )
+		return false;
+
+	static const int64 s_nPageSize = sysconf( _SC_PAGESIZE );
+	nAlignedOffset = nOffset & ~( s_nPageSize - 1 );
+	nAlignedSize = MIN( nOffset + nSize, nMappingSize ) - nAlignedOffset;
+	return true;
+}
+#endif
+
+void CMemoryMappedFile::WillNeed( int64 nOffset, int64 nSize ) const
+{
+#ifdef POSIX
+	int64 nAlignedOffset, nAlignedSize;
+	if ( m_pBase && AlignToPages( m_nSize, nOffset, nSize, nAlignedOffset, nAlignedSize ) )
+	{
+		madvise( m_pBase + nAlignedOffset, nAlignedSize, MADV_WILLNEED );
+	}
+#endif
+}
+
+void CMemoryMappedFile::DontNeed( int64 nOffset, int64 nSize ) const
+{
+#ifdef POSIX
+	// Only whole pages inside the range may be dropped, or we'd lose
+	// copy-on-write edits that neighbouring data made to a shared page
+	static const int64 s_nPageSize = sysconf( _SC_PAGESIZE );
+	if ( !m_pBase || nOffset < 0 || nSize <= 0 )
+		return;
+
+	int64 nStart = ( nOffset + s_nPageSize - 1 ) & ~( s_nPageSize - 1 );
+	int64 nEnd = MIN( nOffset + nSize, m_nSize ) & ~( s_nPageSize - 1 );
+	if ( nEnd > nStart )
+	{
+		madvise( m_pBase + nStart, nEnd - nStart, MADV_DONTNEED );
+	}
+#endif
+}
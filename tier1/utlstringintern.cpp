@@ -0,0 +1,243 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: case sensitive string interning table with lock free lookups
+//
+//=============================================================================//
+
+#include "tier1/utlstringintern.h"
+#include "tier1/strtools.h"
+#include "tier1/generichash.h"
+
+// memdbgon must be the last include file in a .cpp file!!!
+#include "tier0/memdbgon.h"
+
+CUtlStringInternTable::CUtlStringInternTable()
+{
+	m_pTable = NULL;
+	m_nArenaUsed = 0;
+	m_nArenaBlockSize = 0;
+	m_nArenaBytes = 0;
+	m_nCount = 0;
+}
+
+CUtlStringInternTable::~CUtlStringInternTable()
+{
+	Purge();
+}
+
+void CUtlStringInternTable::Purge()
+{
+	AUTO_LOCK( m_WriteMutex );
+
+	free( m_pTable );
+	m_pTable = NULL;
+
+	for ( int i = 0; i < m_RetiredTables.Count(); i++ )
+	{
+		free( m_RetiredTables[i] );
+	}
+
+	for ( int i = 0; i < m_ArenaBlocks.Count(); i++ )
+	{
+		free( m_ArenaBlocks[i] );
+	}
+
+	m_RetiredTables.Purge();
+	m_ArenaBlocks.Purge();
+	m_nArenaUsed = 0;
+	m_nArenaBlockSize = 0;
+	m_nArenaBytes = 0;
+	m_nCount = 0;
+}
+
+uint32 CUtlStringInternTable::HashString( const char *pString, int *pLength )
+{
+	// Every lookup hashes its string, Murmur takes it four bytes at a time
+	int nLength = V_strlen( pString );
+	if ( pLength )
+		*pLength = nLength;
+
+	return MurmurHash2( pString, nLength, 0x31415926 );
+}
+
+uint32 CUtlStringInternTable::HashStringCaseless( const char *pString )
+{
+	// FNV-1a, ascii folded to lower case. Only runs when a string is interned.
+	uint32 nHash = 2166136261u;
+	for ( const unsigned char *p = (const unsigned char *)pString; *p; p++ )
+	{
+		unsigned char c = ( *p >= 'A' && *p <= 'Z' ) ? *p + ( 'a' - 'A' ) : *p;
+		nHash = ( nHash ^ c ) * 16777619u;
+	}
+	return nHash;
+}
+
+const char *CUtlStringInternTable::FindInTable( const Table_t *pTable, const char *pString, uint32 nHash, int nLength, int *pEmptySlot )
+{
+	int nMask = pTable->m_nMask;
+	for ( int i = nHash & nMask; ; i = ( i + 1 ) & nMask )
+	{
+		const char *pSlot = pTable->m_pSlots[i];
+		if ( !pSlot )
+		{
+			if ( pEmptySlot )
+				*pEmptySlot = i;
+			return NULL;
+		}
+
+		const StringHeader_t *pHeader = (const StringHeader_t *)pSlot - 1;
+		if ( pHeader->m_nHash == nHash && pHeader->m_nLength == (uint32)nLength && !V_memcmp( pSlot, pString, nLength ) )
+			return pSlot;
+	}
+}
+
+const char *CUtlStringInternTable::Find( const char *pString ) const
+{
+	const Table_t *pTable = m_pTable;
+	if ( !pString || !pTable )
+		return NULL;
+
+	int nLength;
+	uint32 nHash = HashString( pString, &nLength );
+	return FindInTable( pTable, pString, nHash, nLength, NULL );
+}
+
+const char *CUtlStringInternTable::Intern( const char *pString )
+{
+	if ( !pString )
+		return NULL;
+
+	int nLength;
+	uint32 nHash = HashString( pString, &nLength );
+
+	// Most calls find an existing string, do that without the lock. The count
+	// is read first: if it and the table are unchanged once the lock is held,
+	// nothing was interned in between and the empty slot the probe stopped at
+	// is where the string goes.
+	int nCount = m_nCount;
+	const Table_t *pTable = m_pTable;
+	int iSlot = -1;
+	if ( pTable )
+	{
+		const char *pFound = FindInTable( pTable, pString, nHash, nLength, &iSlot );
+		if ( pFound )
+			return pFound;
+	}
+
+	AUTO_LOCK( m_WriteMutex );
+
+	if ( !m_pTable || ( m_nCount + 1 ) * 2 > m_pTable->m_nMask + 1 )
+	{
+		GrowTable();
+	}
+
+	// Retired tables are kept until Purge(), so a new table never reuses the address of an old one
+	Table_t *pWriteTable = m_pTable;
+	if ( pWriteTable != pTable || m_nCount != nCount )
+	{
+		const char *pFound = FindInTable( pWriteTable, pString, nHash, nLength, &iSlot );
+		if ( pFound )
+			return pFound;
+	}
+
+	const char *pCopy = AllocString( pString, nHash, nLength );
+
+	// The characters and header have to be visible before the slot is
+	ThreadMemoryBarrier();
+	pWriteTable->m_pSlots[iSlot] = pCopy;
+	m_nCount = m_nCount + 1;
+
+	return pCopy;
+}
+
+const char *CUtlStringInternTable::AllocString( const char *pString, uint32 nHash, int nLength )
+{
+	int nSize = AlignValue( (int)sizeof( StringHeader_t ) + nLength + 1, (int)sizeof( StringHeader_t ) );
+
+	if ( m_nArenaUsed + nSize > m_nArenaBlockSize )
+	{
+		m_nArenaBlockSize = MAX( nSize, (int)ARENA_BLOCK_SIZE );
+		m_ArenaBlocks.AddToTail( (char *)malloc( m_nArenaBlockSize ) );
+		m_nArenaUsed = 0;
+		m_nArenaBytes += m_nArenaBlockSize;
+	}
+
+	StringHeader_t *pHeader = (StringHeader_t *)( m_ArenaBlocks.Tail() + m_nArenaUsed );
+	m_nArenaUsed += nSize;
+
+	pHeader->m_nHash = nHash;
+	pHeader->m_nCaselessHash = HashStringCaseless( pString );
+	pHeader->m_nLength = nLength;
+	pHeader->m_nUnused = 0;
+
+	char *pCopy = (char *)( pHeader + 1 );
+	V_memcpy( pCopy, pString, nLength + 1 );
+	return pCopy;
+}
+
+void CUtlStringInternTable::GrowTable()
+{
+	Table_t *pOldTable = m_pTable;
+	int nNewSize = pOldTable ? ( pOldTable->m_nMask + 1 ) * 2 : (int)MIN_TABLE_SIZE;
+
+	Table_t *pNewTable = (Table_t *)calloc( 1, sizeof( Table_t ) + ( nNewSize - 1 ) * sizeof( const char * ) );
+	pNewTable->m_nMask = nNewSize - 1;
+
+	// the stored hashes are reused, strings aren't touched
+	if ( pOldTable )
+	{
+		for ( int j = 0; j <= pOldTable->m_nMask; j++ )
+		{
+			const char *pSlot = pOldTable->m_pSlots[j];
+			if ( !pSlot )
+				continue;
+
+			int i = GetHash( pSlot ) & pNewTable->m_nMask;
+			while ( pNewTable->m_pSlots[i] )
+			{
+				i = ( i + 1 ) & pNewTable->m_nMask;
+			}
+			pNewTable->m_pSlots[i] = pSlot;
+		}
+
+		// Readers may still be probing the old table
+		m_RetiredTables.AddToTail( pOldTable );
+	}
+
+	ThreadMemoryBarrier();
+	m_pTable = pNewTable;
+}
+
+void CUtlStringInternTable::GetStrings( CUtlVector< const char * > &strings ) const
+{
+	const Table_t *pTable = m_pTable;
+	if ( !pTable )
+		return;
+
+	strings.EnsureCapacity( strings.Count() + m_nCount );
+	for ( int i = 0; i <= pTable->m_nMask; i++ )
+	{
+		const char *pSlot = pTable->m_pSlots[i];
+		if ( pSlot )
+		{
+			strings.AddToTail( pSlot );
+		}
+	}
+}
+
+size_t CUtlStringInternTable::GetMemoryUsage() const
+{
+	size_t nBytes = m_nArenaBytes;
+
+	const Table_t *pTable = m_pTable;
+	if ( pTable )
+	{
+		nBytes += ( pTable->m_nMask + 1 ) * sizeof( const char * );
+	}
+
+	for ( int i = 0; i < m_RetiredTables.Count(); i++ )
+	{
+		nBytes += ( m_RetiredTables[i]->m_nMask + 1 ) * sizeof( const char * );
+	}
+	return nBytes;
+}
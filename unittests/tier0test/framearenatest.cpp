@@ -0,0 +1,85 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Unit tests for the frame arena and CUtlFrameVector
+//
+//=============================================================================
+
+#include "tier0/dbg.h"
+#include "tier0/framearena.h"
+#include "tier1/utlframememory.h"
+#include "unitlib/unitlib.h"
+
+DEFINE_TESTSUITE( FrameArenaTestSuite )
+
+static void ArenaTests()
+{
+	// finish whatever frame earlier tests were in
+	FrameArena_EndFrame();
+	int nFrame = FrameArena_GetFrame();
+
+	byte *p1 = (byte *)FrameArena_Alloc( 3 );
+	byte *p2 = (byte *)FrameArena_Alloc( 100, 64 );
+	byte *p3 = (byte *)FrameArena_Alloc( 8, 4 );
+	Shipping_Assert( p1 && p2 && p3 );
+	Shipping_Assert( ( (uintp)p1 & 15 ) == 0 && ( (uintp)p2 & 63 ) == 0 && ( (uintp)p3 & 3 ) == 0 );
+	Shipping_Assert( p2 >= p1 + 3 && p3 >= p2 + 100 );
+
+	// bigger than a block
+	byte *pBig = (byte *)FrameArena_Alloc( 1024 * 1024 );
+	Shipping_Assert( pBig != NULL );
+	memset( pBig, 1, 1024 * 1024 );
+
+	FrameArena_EndFrame();
+	Shipping_Assert( FrameArena_GetFrame() == nFrame + 1 );
+
+	FrameArenaStats_t stats;
+	FrameArena_GetStats( &stats );
+	Shipping_Assert( stats.m_nFrame == nFrame );
+	Shipping_Assert( stats.m_nAllocations == 4 );
+	Shipping_Assert( stats.m_nBytes == 3 + 100 + 8 + 1024 * 1024 );
+	Shipping_Assert( stats.m_nThreads == 1 );
+
+	// the next frame starts over in a single block big enough for the last one
+	byte *pRewound = (byte *)FrameArena_Alloc( 16 );
+	byte *pBig2 = (byte *)FrameArena_Alloc( 1024 * 1024 );
+	Shipping_Assert( pRewound && pBig2 );
+	FrameArena_EndFrame();
+	FrameArena_GetStats( &stats );
+	Shipping_Assert( stats.m_nAllocations == 2 && stats.m_nBlockAllocations == 1 );
+}
+
+static void FrameVectorTests()
+{
+	CUtlFrameVector< int > vec;
+	for ( int i = 0; i < 1000; i++ )
+	{
+		vec.AddToTail( i );
+	}
+	Shipping_Assert( vec.Count() == 1000 );
+
+	vec.Remove( 0 );
+	vec.InsertBefore( 0, -1 );
+	for ( int i = 1; i < 1000; i++ )
+	{
+		Shipping_Assert( vec[i] == i );
+	}
+	Shipping_Assert( vec[0] == -1 );
+
+	CUtlFrameVector< int > other( 10 );
+	Shipping_Assert( other.NumAllocated() >= 10 && other.Count() == 0 );
+	other.Swap( vec );
+	Shipping_Assert( other.Count() == 1000 && vec.Count() == 0 );
+
+	other.Purge();
+	Shipping_Assert( other.Count() == 0 && other.NumAllocated() == 0 );
+
+	FrameArena_EndFrame();
+}
+
+DEFINE_TESTCASE( FrameArenaTest, FrameArenaTestSuite )
+{
+	Msg( "Running frame arena tests\n" );
+
+	ArenaTests();
+	FrameVectorTests();
+}
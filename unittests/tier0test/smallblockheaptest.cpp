@@ -0,0 +1,185 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Unit tests for the small block heap and its thread caches
+//
+//=============================================================================
+
+#include "tier0/dbg.h"
+#include "tier0/threadtools.h"
+#include "smallblockheap.h"
+#include "unitlib/unitlib.h"
+
+DEFINE_TESTSUITE( SmallBlockHeapTestSuite )
+
+#define SBH_TEST_THREADS	4
+#define SBH_TEST_BLOCKS		4000
+
+static CSmallBlockHeap &TestHeap()
+{
+	// Not the allocator's heap, so the counts only see what the tests did
+	static CSmallBlockHeap s_Heap;
+	return s_Heap;
+}
+
+static size_t TestBlockSize( int i )
+{
+	// walks every pool, with a bias towards the small ones
+	return 1 + ( ( i * 37 ) % ( ( i & 3 ) ? 256 : MAX_SBH_BLOCK ) );
+}
+
+static byte TestBlockPattern( int iThread, int i )
+{
+	return (byte)( iThread * 31 + i );
+}
+
+struct SBHTestThread_t
+{
+	int		m_iThread;
+	byte	*m_pBlocks[SBH_TEST_BLOCKS];
+};
+
+static SBHTestThread_t g_SBHTestThreads[SBH_TEST_THREADS];
+
+static void CheckBlock( int iThread, int i, byte *p )
+{
+	size_t nSize = TestBlockSize( i );
+	byte pattern = TestBlockPattern( iThread, i );
+	Shipping_Assert( TestHeap().IsOwner( p ) && TestHeap().GetSize( p ) >= nSize );
+	for ( size_t j = 0; j < nSize; j++ )
+	{
+		Shipping_Assert( p[j] == pattern );
+	}
+}
+
+// Allocates a set of blocks, then frees every other one. The rest are freed
+// by another thread.
+static uintp SBHAllocThread( void *pParam )
+{
+	SBHTestThread_t *pThread = (SBHTestThread_t *)pParam;
+	CSmallBlockHeap &heap = TestHeap();
+
+	for ( int i = 0; i < SBH_TEST_BLOCKS; i++ )
+	{
+		size_t nSize = TestBlockSize( i );
+		byte *p = (byte *)heap.Alloc( nSize );
+		Shipping_Assert( p != NULL );
+		memset( p, TestBlockPattern( pThread->m_iThread, i ), nSize );
+		pThread->m_pBlocks[i] = p;
+	}
+
+	for ( int i = 0; i < SBH_TEST_BLOCKS; i += 2 )
+	{
+		CheckBlock( pThread->m_iThread, i, pThread->m_pBlocks[i] );
+		heap.Free( pThread->m_pBlocks[i] );
+		pThread->m_pBlocks[i] = NULL;
+	}
+	return 0;
+}
+
+// Frees the blocks another thread left behind
+static uintp SBHFreeThread( void *pParam )
+{
+	SBHTestThread_t *pThread = (SBHTestThread_t *)pParam;
+	for ( int i = 1; i < SBH_TEST_BLOCKS; i += 2 )
+	{
+		CheckBlock( pThread->m_iThread, i, pThread->m_pBlocks[i] );
+		TestHeap().Free( pThread->m_pBlocks[i] );
+		pThread->m_pBlocks[i] = NULL;
+	}
+	return 0;
+}
+
+static uintp SBHShortLivedThread( void *pParam )
+{
+	void *p = TestHeap().Alloc( (size_t)(uintp)pParam );
+	Shipping_Assert( p != NULL );
+	TestHeap().Free( p );
+	return 0;
+}
+
+static void RunThreads( ThreadFunc_t pfnThread, void **ppParams, int nThreads )
+{
+	ThreadHandle_t hThreads[SBH_TEST_THREADS];
+	Assert( nThreads <= SBH_TEST_THREADS );
+	for ( int i = 0; i < nThreads; i++ )
+	{
+		hThreads[i] = CreateSimpleThread( pfnThread, ppParams[i] );
+		Shipping_Assert( hThreads[i] != NULL );
+	}
+	for ( int i = 0; i < nThreads; i++ )
+	{
+		ThreadJoin( hThreads[i] );
+		ReleaseThreadHandle( hThreads[i] );
+	}
+}
+
+static void SingleThreadTests()
+{
+	CSmallBlockHeap &heap = TestHeap();
+
+	Shipping_Assert( heap.ShouldUse( 1 ) && heap.ShouldUse( MAX_SBH_BLOCK ) && !heap.ShouldUse( MAX_SBH_BLOCK + 1 ) );
+
+	byte *p = (byte *)heap.Alloc( 24 );
+	Shipping_Assert( p && heap.IsOwner( p ) && heap.GetSize( p ) >= 24 );
+	Shipping_Assert( ( (uintp)p & ( MIN_SBH_ALIGN - 1 ) ) == 0 );
+	memset( p, 0x5a, 24 );
+
+	// growing into another pool keeps the contents
+	byte *pGrown = (byte *)heap.Realloc( p, 700 );
+	Shipping_Assert( pGrown && heap.IsOwner( pGrown ) && heap.GetSize( pGrown ) >= 700 );
+	for ( int i = 0; i < 24; i++ )
+	{
+		Shipping_Assert( pGrown[i] == 0x5a );
+	}
+
+	// too big for the heap, it hands the block to the CRT
+	byte *pLarge = (byte *)heap.Realloc( pGrown, MAX_SBH_BLOCK + 1 );
+	Shipping_Assert( pLarge && !heap.IsOwner( pLarge ) && pLarge[23] == 0x5a );
+	free( pLarge );
+
+	int nThreadCaches = heap.CountThreadCaches();
+	heap.Compact();
+	Shipping_Assert( heap.CountAllocatedBlocks() == 0 );
+	Shipping_Assert( heap.CountThreadCaches() == nThreadCaches );
+}
+
+static void MultiThreadTests()
+{
+	CSmallBlockHeap &heap = TestHeap();
+	int nThreadCaches = heap.CountThreadCaches();
+
+	void *pParams[SBH_TEST_THREADS];
+	for ( int i = 0; i < SBH_TEST_THREADS; i++ )
+	{
+		g_SBHTestThreads[i].m_iThread = i;
+		pParams[i] = &g_SBHTestThreads[i];
+	}
+
+	// the second round of threads frees what the first one left
+	RunThreads( SBHAllocThread, pParams, SBH_TEST_THREADS );
+	RunThreads( SBHFreeThread, pParams, SBH_TEST_THREADS );
+
+	// exited threads gave their caches back
+	Shipping_Assert( heap.CountThreadCaches() == nThreadCaches );
+	Shipping_Assert( heap.CountAllocatedBlocks() == 0 );
+
+	for ( int i = 0; i < 64; i++ )
+	{
+		void *pSize = (void *)(uintp)TestBlockSize( i );
+		void *pSizes[SBH_TEST_THREADS] = { pSize, pSize, pSize, pSize };
+		RunThreads( SBHShortLivedThread, pSizes, SBH_TEST_THREADS );
+	}
+	Shipping_Assert( heap.CountThreadCaches() == nThreadCaches );
+	Shipping_Assert( heap.CountAllocatedBlocks() == 0 );
+
+	heap.Compact();
+	Shipping_Assert( heap.CountAllocatedBlocks() == 0 );
+}
+
+DEFINE_TESTCASE( SmallBlockHeapTest, SmallBlockHeapTestSuite )
+{
+	Msg( "Running small block heap tests\n" );
+
+	SingleThreadTests();
+	MultiThreadTests();
+}
@@ -0,0 +1,78 @@
+#include "tier0/dbg.h"
+#include "unitlib/unitlib.h"
+#include "tier1/datamanager.h"
+
+DEFINE_TESTSUITE( DataManagerTestSuite )
+
+static int s_nDestroyed;
+
+struct TestResource_t
+{
+	static TestResource_t *CreateResource( int nId )	{ TestResource_t *p = new TestResource_t; p->m_nId = nId; return p; }
+	static unsigned int EstimatedSize( int nId )		{ return 1; }
+	void DestroyResource()								{ s_nDestroyed++; delete this; }
+	TestResource_t *GetData()							{ return this; }
+	unsigned int Size()									{ return 1; }
+
+	int m_nId;
+};
+
+typedef CDataManager<TestResource_t, int, TestResource_t *, CThreadFastMutex> CTestDataManager;
+
+static bool IsResident( CTestDataManager &manager, memhandle_t hResource )
+{
+	return manager.GetResource_NoLockNoLRUTouch( hResource ) != NULL;
+}
+
+static void ClockTests()
+{
+	s_nDestroyed = 0;
+	{
+		CTestDataManager manager( 3 );
+
+		memhandle_t h0 = manager.CreateResource( 0 );
+		memhandle_t h1 = manager.CreateResource( 1 );
+		memhandle_t h2 = manager.CreateResource( 2 );
+		Shipping_Assert( manager.UsedSize() == 3 );
+
+		// h0 is the oldest, but it was referenced, so h1 goes first
+		manager.TouchResource( h0 );
+		memhandle_t h3 = manager.CreateResource( 3 );
+		Shipping_Assert( IsResident( manager, h0 ) );
+		Shipping_Assert( !IsResident( manager, h1 ) );
+		Shipping_Assert( manager.SecondChanceCount() == 1 );
+		Shipping_Assert( manager.EvictionCount() == 1 );
+
+		// h0's second chance used up its reference bit; h2 is now next
+		memhandle_t h4 = manager.CreateResource( 4 );
+		Shipping_Assert( !IsResident( manager, h2 ) );
+		Shipping_Assert( IsResident( manager, h0 ) && IsResident( manager, h3 ) && IsResident( manager, h4 ) );
+
+		// Locked resources are never evicted, even unreferenced
+		Shipping_Assert( manager.LockResource( h0 )->m_nId == 0 );
+		manager.CreateResource( 5 );
+		manager.CreateResource( 6 );
+		Shipping_Assert( IsResident( manager, h0 ) );
+		Shipping_Assert( !IsResident( manager, h3 ) && !IsResident( manager, h4 ) );
+		Shipping_Assert( manager.UnlockResource( h0 ) == 0 );
+
+		// Aged resources go before everything else, and lose their reference bit
+		manager.TouchResource( h0 );
+		manager.MarkAsStale( h0 );
+		manager.CreateResource( 7 );
+		Shipping_Assert( !IsResident( manager, h0 ) );
+
+		// Stale handles are harmless to touch
+		manager.TouchResource( h1 );
+		manager.TouchResource( INVALID_MEMHANDLE );
+		Shipping_Assert( s_nDestroyed == 5 );
+	}
+	Shipping_Assert( s_nDestroyed == 8 );
+}
+
+DEFINE_TESTCASE( DataManagerTest, DataManagerTestSuite )
+{
+	Msg( "Running CDataManager tests\n" );
+
+	ClockTests();
+}
@@ -0,0 +1,64 @@
+#include "tier0/dbg.h"
+#include "unitlib/unitlib.h"
+#include "tier1/memorymappedfile.h"
+#include "tier1/strtools.h"
+
+#include <stdio.h>
+
+DEFINE_TESTSUITE( MemoryMappedFileTestSuite )
+
+static void MappingTests()
+{
+	char szPath[MAX_PATH];
+	V_snprintf( szPath, sizeof( szPath ), "memorymappedfiletest_%d.bin", rand() );
+
+	const char data[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+	FILE *fp = fopen( szPath, "wb" );
+	Shipping_Assert( fp );
+	fwrite( data, 1, sizeof( data ), fp );
+	fclose( fp );
+
+	CMemoryMappedFile file;
+	Shipping_Assert( !file.IsOpen() );
+	Shipping_Assert( !file.Open( "this_file_does_not_exist.bin" ) );
+
+	Shipping_Assert( file.Open( szPath ) );
+	Shipping_Assert( file.IsOpen() );
+	Shipping_Assert( file.Size() == sizeof( data ) );
+	Shipping_Assert( memcmp( file.Base(), data, sizeof( data ) ) == 0 );
+
+	// in range views
+	CMemoryMappedFileView view = file.View( 10, 6 );
+	Shipping_Assert( view.IsValid() );
+	Shipping_Assert( view.Count() == 6 );
+	Shipping_Assert( memcmp( view.Base(), "abcdef", 6 ) == 0 );
+
+	CMemoryMappedFileView slice = view.Slice( 2, 3 );
+	Shipping_Assert( slice.IsValid() && memcmp( slice.Base(), "cde", 3 ) == 0 );
+	Shipping_Assert( !view.Slice( 4, 3 ).IsValid() );
+
+	Shipping_Assert( file.View( 0, file.Size() ).IsValid() );
+	Shipping_Assert( !file.View( 1, file.Size() ).IsValid() );
+	Shipping_Assert( !file.View( -1, 2 ).IsValid() );
+
+	// writes land in private pages and never reach the file
+	file.Base()[0] = 'X';
+	file.DontNeed( 0, file.Size() );
+	file.WillNeed( 0, file.Size() );
+	file.Close();
+	Shipping_Assert( !file.IsOpen() );
+	Shipping_Assert( !file.View( 0, 1 ).IsValid() );
+
+	Shipping_Assert( file.Open( szPath ) );
+	Shipping_Assert( file.Base()[0] == '0' );
+	file.Close();
+
+	remove( szPath );
+}
+
+DEFINE_TESTCASE( MemoryMappedFileTest, MemoryMappedFileTestSuite )
+{
+	Msg( "Running CMemoryMappedFile tests\n" );
+
+	MappingTests();
+}
@@ -0,0 +1,217 @@
+#include "tier0/dbg.h"
+#include "tier0/fasttimer.h"
+#include "unitlib/unitlib.h"
+#include "tier1/utlhashedstringdict.h"
+#include "tier1/utlhashtable.h"
+#include "tier1/utlstring.h"
+#include "tier1/utldict.h"
+#include "tier1/fmtstr.h"
+
+DEFINE_TESTSUITE( UtlHashedStringDictTestSuite )
+
+// Entries of the modelprecache and soundprecache tables on a cstrike server
+static const char *s_pPrecacheList[] =
+{
+	"maps/de_dust2.bsp",
+	"models/player/ct_gign.mdl",
+	"models/player/ct_gsg9.mdl",
+	"models/player/ct_sas.mdl",
+	"models/player/ct_urban.mdl",
+	"models/player/t_arctic.mdl",
+	"models/player/t_guerilla.mdl",
+	"models/player/t_leet.mdl",
+	"models/player/t_phoenix.mdl",
+	"models/weapons/v_rif_ak47.mdl",
+	"models/weapons/w_rif_ak47.mdl",
+	"models/weapons/v_rif_m4a1.mdl",
+	"models/weapons/w_rif_m4a1.mdl",
+	"models/weapons/w_rif_m4a1_silencer.mdl",
+	"models/weapons/v_snip_awp.mdl",
+	"models/weapons/w_snip_awp.mdl",
+	"models/weapons/v_pist_deagle.mdl",
+	"models/weapons/w_pist_deagle.mdl",
+	"models/weapons/v_pist_glock18.mdl",
+	"models/weapons/w_pist_glock18.mdl",
+	"models/weapons/v_pist_usp.mdl",
+	"models/weapons/w_pist_usp.mdl",
+	"models/weapons/v_knife_t.mdl",
+	"models/weapons/w_knife_t.mdl",
+	"models/weapons/v_eq_flashbang.mdl",
+	"models/weapons/w_eq_flashbang.mdl",
+	"models/weapons/v_eq_fraggrenade.mdl",
+	"models/weapons/w_eq_fraggrenade_thrown.mdl",
+	"models/weapons/v_eq_smokegrenade.mdl",
+	"models/weapons/w_c4_planted.mdl",
+	"models/weapons/shell.mdl",
+	"models/weapons/rifleshell.mdl",
+	"models/weapons/shotgun_shell.mdl",
+	"models/gibs/hgibs.mdl",
+	"models/props/cs_office/vending_machine.mdl",
+	"models/props/de_dust/du_crate_64x64.mdl",
+	"models/props/de_dust/stoneblocks48.mdl",
+	"models/props_junk/wood_crate001a.mdl",
+	"models/props_c17/oildrum001.mdl",
+	"sprites/glow01.vmt",
+	"sprites/laserbeam.vmt",
+	"sprites/smoke.vmt",
+	"player/footsteps/concrete1.wav",
+	"player/footsteps/concrete2.wav",
+	"player/footsteps/dirt1.wav",
+	"player/footsteps/tile1.wav",
+	"player/kevlar1.wav",
+	"player/headshot1.wav",
+	"player/death1.wav",
+	"weapons/ak47/ak47-1.wav",
+	"weapons/m4a1/m4a1_unsil-1.wav",
+	"weapons/m4a1/m4a1-1.wav",
+	"weapons/awp/awp1.wav",
+	"weapons/deagle/deagle-1.wav",
+	"weapons/glock/glock18-1.wav",
+	"weapons/usp/usp_unsil-1.wav",
+	"weapons/knife/knife_hit1.wav",
+	"weapons/flashbang/flashbang_explode1.wav",
+	"weapons/hegrenade/explode3.wav",
+	"weapons/c4/c4_beep1.wav",
+	"radio/go.wav",
+	"radio/ctwin.wav",
+	"radio/terwin.wav",
+	"ambient/wind/wind_snippet2.wav",
+	"physics/concrete/concrete_impact_bullet1.wav",
+	"physics/metal/metal_solid_impact_bullet1.wav",
+	"physics/wood/wood_box_impact_bullet1.wav",
+};
+
+// A map adds a few thousand props, decals and sounds on top of the common ones
+static void BuildPrecacheList( CUtlVector< CUtlString > &list )
+{
+	for ( int i = 0; i < ARRAYSIZE( s_pPrecacheList ); i++ )
+	{
+		list.AddToTail( s_pPrecacheList[i] );
+	}
+
+	for ( int i = 0; i < 4000; i++ )
+	{
+		const char *pBase = s_pPrecacheList[ i % ARRAYSIZE( s_pPrecacheList ) ];
+		char szExt[16];
+		V_strncpy( szExt, V_GetFileExtension( pBase ) ? V_GetFileExtension( pBase ) : "mdl", sizeof( szExt ) );
+
+		char szName[MAX_PATH];
+		V_StripExtension( pBase, szName, sizeof( szName ) );
+		list.AddToTail( CUtlString( CFmtStr( "%s_%03d.%s", szName, i / ARRAYSIZE( s_pPrecacheList ), szExt ).Get() ) );
+	}
+}
+
+static void BasicTests()
+{
+	CUtlHashedStringDict< int > dict;
+	Shipping_Assert( dict.Count() == 0 );
+	Shipping_Assert( dict.Find( "anything" ) == dict.InvalidIndex() );
+	Shipping_Assert( dict.Find( NULL ) == dict.InvalidIndex() );
+
+	// indices are handed out in insertion order
+	Shipping_Assert( dict.Insert( "first" ) == 0 );
+	Shipping_Assert( dict.Insert( "second" ) == 1 );
+	Shipping_Assert( dict.Insert( "FIRST" ) == 0 );
+	Shipping_Assert( dict.Count() == 2 );
+
+	dict.Element( 1 ) = 42;
+	Shipping_Assert( dict.Find( "Second" ) == 1 );
+	Shipping_Assert( dict[ dict.Find( "second" ) ] == 42 );
+	Shipping_Assert( !V_strcmp( dict.String( 0 ), "first" ) );
+
+	// addresses survive growing the table
+	const char *pString = dict.String( 1 );
+	int *pElement = &dict.Element( 1 );
+	for ( int i = 0; i < 1000; i++ )
+	{
+		Shipping_Assert( dict.Insert( CFmtStr( "string%d", i ) ) == i + 2 );
+	}
+	Shipping_Assert( dict.String( 1 ) == pString && &dict.Element( 1 ) == pElement && *pElement == 42 );
+
+	for ( int i = 0; i < 1000; i++ )
+	{
+		Shipping_Assert( dict.Find( CFmtStr( "STRING%d", i ) ) == i + 2 );
+	}
+	Shipping_Assert( dict.Find( "string1000" ) == dict.InvalidIndex() );
+
+	dict.RemoveAll();
+	Shipping_Assert( dict.Count() == 0 && dict.Find( "first" ) == dict.InvalidIndex() );
+	Shipping_Assert( dict.Insert( "second" ) == 0 );
+}
+
+static void FilenameTests()
+{
+	CUtlHashedStringDict< int > dict( true );
+
+	Shipping_Assert( dict.Insert( "models\\Player\\ct_gign.mdl" ) == 0 );
+	Shipping_Assert( !V_strcmp( dict.String( 0 ), "models/Player/ct_gign.mdl" ) );
+	Shipping_Assert( dict.Find( "models/player/ct_gign.mdl" ) == 0 );
+	Shipping_Assert( dict.Find( "./models/player/./ct_gign.mdl" ) == 0 );
+	Shipping_Assert( dict.Insert( "models/player\\CT_GIGN.mdl" ) == 0 );
+	Shipping_Assert( dict.Find( "models/player/ct_gsg9.mdl" ) == dict.InvalidIndex() );
+
+	// only filename dictionaries fold slashes
+	CUtlHashedStringDict< int > plain;
+	plain.Insert( "a/b" );
+	Shipping_Assert( plain.Find( "a\\b" ) == plain.InvalidIndex() );
+}
+
+static void PrecacheBenchmark()
+{
+	CUtlVector< CUtlString > list;
+	BuildPrecacheList( list );
+
+	const int nLookups = 200000;
+
+	CUtlHashedStringDict< int > dict( true );
+	CUtlStableHashtable< CUtlConstString, int, CaselessStringHashFunctor, UTLConstStringCaselessStringEqualFunctor<char> > stable;
+	CUtlDict< int, int > tree( k_eDictCompareTypeCaseInsensitive );
+
+	for ( int i = 0; i < list.Count(); i++ )
+	{
+		Shipping_Assert( dict.Insert( list[i] ) == i );
+		stable.Insert( list[i].Get(), i );
+		tree.Insert( list[i], i );
+	}
+
+	CFastTimer timer;
+	int nFound = 0;
+
+	timer.Start();
+	for ( int i = 0; i < nLookups; i++ )
+	{
+		nFound += dict.Find( list[ ( i * 7919 ) % list.Count() ] ) >= 0;
+	}
+	timer.End();
+	float flHashed = timer.GetDuration().GetMillisecondsF();
+
+	timer.Start();
+	for ( int i = 0; i < nLookups; i++ )
+	{
+		nFound += stable.Find( list[ ( i * 7919 ) % list.Count() ].Get() ) != stable.InvalidHandle();
+	}
+	timer.End();
+	float flStable = timer.GetDuration().GetMillisecondsF();
+
+	timer.Start();
+	for ( int i = 0; i < nLookups; i++ )
+	{
+		nFound += tree.Find( list[ ( i * 7919 ) % list.Count() ] ) != tree.InvalidIndex();
+	}
+	timer.End();
+	float flTree = timer.GetDuration().GetMillisecondsF();
+
+	Shipping_Assert( nFound == nLookups * 3 );
+
+	Msg( "%d strings, %d lookups: CUtlHashedStringDict %.2fms (%.2f probes), CUtlStableHashtable %.2fms, CUtlDict %.2fms\n",
+		list.Count(), nLookups, flHashed, dict.AverageProbeLength(), flStable, flTree );
+}
+
+DEFINE_TESTCASE( UtlHashedStringDictTest, UtlHashedStringDictTestSuite )
+{
+	Msg( "Running CUtlHashedStringDict tests\n" );
+
+	BasicTests();
+	FilenameTests();
+	PrecacheBenchmark();
+}
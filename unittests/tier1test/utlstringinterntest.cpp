@@ -0,0 +1,207 @@
+//========= Copyright Valve Corporation, All rights reserved. ============//
+//
+// Purpose: Unit test program for CUtlStringInternTable
+//
+//=============================================================================//
+
+#include "tier0/dbg.h"
+#include "tier0/fasttimer.h"
+#include "tier0/threadtools.h"
+#include "unitlib/unitlib.h"
+#include "tier1/utlstringintern.h"
+#include "tier1/utlhashtable.h"
+#include "tier1/utlstring.h"
+#include "tier1/fmtstr.h"
+
+DEFINE_TESTSUITE( UtlStringInternTestSuite )
+
+static void BasicTests()
+{
+	CUtlStringInternTable table;
+	Shipping_Assert( table.Count() == 0 );
+	Shipping_Assert( table.Find( "anything" ) == NULL );
+	Shipping_Assert( table.Intern( NULL ) == NULL );
+
+	char szBuf[32];
+	V_strncpy( szBuf, "info_player_start", sizeof( szBuf ) );
+
+	const char *pString = table.Intern( szBuf );
+	Shipping_Assert( pString != szBuf && !V_strcmp( pString, "info_player_start" ) );
+	Shipping_Assert( table.Intern( "info_player_start" ) == pString );
+	Shipping_Assert( table.Find( "info_player_start" ) == pString );
+	Shipping_Assert( table.Count() == 1 );
+
+	// case sensitive, but the caseless hash ignores case
+	Shipping_Assert( table.Find( "INFO_PLAYER_START" ) == NULL );
+	const char *pUpper = table.Intern( "INFO_PLAYER_START" );
+	Shipping_Assert( pUpper != pString );
+	Shipping_Assert( table.Count() == 2 );
+	Shipping_Assert( CUtlStringInternTable::GetCaselessHash( pUpper ) == CUtlStringInternTable::GetCaselessHash( pString ) );
+	Shipping_Assert( CUtlStringInternTable::GetCaselessHash( pString ) == CUtlStringInternTable::HashStringCaseless( "Info_Player_Start" ) );
+
+	int nLength;
+	Shipping_Assert( CUtlStringInternTable::GetHash( pString ) == CUtlStringInternTable::HashString( "info_player_start", &nLength ) );
+	Shipping_Assert( CUtlStringInternTable::GetLength( pString ) == nLength && nLength == V_strlen( "info_player_start" ) );
+
+	const char *pEmpty = table.Intern( "" );
+	Shipping_Assert( pEmpty && !*pEmpty && table.Find( "" ) == pEmpty && CUtlStringInternTable::GetLength( pEmpty ) == 0 );
+
+	// addresses survive growing the table
+	for ( int i = 0; i < 10000; i++ )
+	{
+		table.Intern( CFmtStr( "prop_physics_%d", i ) );
+	}
+	Shipping_Assert( table.Count() == 10003 );
+	Shipping_Assert( table.Find( "info_player_start" ) == pString );
+
+	for ( int i = 0; i < 10000; i++ )
+	{
+		CFmtStr name( "prop_physics_%d", i );
+		const char *pFound = table.Find( name );
+		Shipping_Assert( pFound && !V_strcmp( pFound, name ) && CUtlStringInternTable::GetHash( pFound ) == CUtlStringInternTable::HashString( name ) );
+	}
+	Shipping_Assert( table.Find( "prop_physics_10000" ) == NULL );
+
+	// long strings get a block of their own
+	char szLong[40000];
+	memset( szLong, 'x', sizeof( szLong ) - 1 );
+	szLong[ sizeof( szLong ) - 1 ] = 0;
+	const char *pLong = table.Intern( szLong );
+	Shipping_Assert( pLong && CUtlStringInternTable::GetLength( pLong ) == sizeof( szLong ) - 1 && table.Find( szLong ) == pLong );
+
+	CUtlVector< const char * > strings;
+	table.GetStrings( strings );
+	Shipping_Assert( strings.Count() == table.Count() );
+	Shipping_Assert( strings.Find( pString ) != strings.InvalidIndex() && strings.Find( pLong ) != strings.InvalidIndex() );
+
+	table.Purge();
+	Shipping_Assert( table.Count() == 0 && table.Find( "info_player_start" ) == NULL );
+	Shipping_Assert( !V_strcmp( table.Intern( "info_player_start" ), "info_player_start" ) );
+}
+
+//-----------------------------------------------------------------------------
+// Readers look up strings that are known to be in the table while the main
+// thread keeps inserting, which grows the table several times under them
+//-----------------------------------------------------------------------------
+struct ConcurrentTest_t
+{
+	CUtlStringInternTable	*m_pTable;
+	const char				*m_pKnown[64];
+	volatile bool			m_bDone;
+	CInterlockedInt			m_nErrors;
+	CInterlockedInt			m_nLookups;
+};
+
+static uintp ConcurrentReader( void *pParam )
+{
+	ConcurrentTest_t *pTest = (ConcurrentTest_t *)pParam;
+
+	int i = 0;
+	while ( !pTest->m_bDone )
+	{
+		int iKnown = i++ % ARRAYSIZE( pTest->m_pKnown );
+		if ( pTest->m_pTable->Find( CFmtStr( "known_%d", iKnown ) ) != pTest->m_pKnown[iKnown] )
+		{
+			pTest->m_nErrors++;
+		}
+		pTest->m_nLookups++;
+	}
+	return 0;
+}
+
+static void ConcurrentTests()
+{
+	CUtlStringInternTable table;
+
+	ConcurrentTest_t test;
+	test.m_pTable = &table;
+	test.m_bDone = false;
+	test.m_nErrors = 0;
+	test.m_nLookups = 0;
+	for ( int i = 0; i < ARRAYSIZE( test.m_pKnown ); i++ )
+	{
+		test.m_pKnown[i] = table.Intern( CFmtStr( "known_%d", i ) );
+	}
+
+	ThreadHandle_t hThreads[2];
+	for ( int i = 0; i < ARRAYSIZE( hThreads ); i++ )
+	{
+		hThreads[i] = CreateSimpleThread( ConcurrentReader, &test );
+	}
+
+	for ( int i = 0; i < 50000; i++ )
+	{
+		table.Intern( CFmtStr( "npc_%d", i ) );
+		if ( !( i & 1023 ) )
+		{
+			ThreadSleep( 0 );
+		}
+	}
+
+	test.m_bDone = true;
+	for ( int i = 0; i < ARRAYSIZE( hThreads ); i++ )
+	{
+		ThreadJoin( hThreads[i] );
+		ReleaseThreadHandle( hThreads[i] );
+	}
+
+	Shipping_Assert( test.m_nErrors == 0 );
+	Shipping_Assert( table.Count() == 50000 + ARRAYSIZE( test.m_pKnown ) );
+	Msg( "%d concurrent lookups while interning\n", (int)test.m_nLookups );
+}
+
+static void SpawnBenchmark()
+{
+	// A map spawn interns a few thousand names and classnames, most of them repeats
+	CUtlVector< CUtlString > list;
+	for ( int i = 0; i < 20000; i++ )
+	{
+		list.AddToTail( CUtlString( CFmtStr( "entity_name_%d", ( i * 7919 ) % 3000 ).Get() ) );
+	}
+
+	CFastTimer timer;
+
+	// Both sides count their hits, so the compiler can't drop the inlined lookups
+	int nInternFound = 0;
+	CUtlStringInternTable table;
+	timer.Start();
+	for ( int i = 0; i < list.Count(); i++ )
+	{
+		table.Intern( list[i] );
+	}
+	for ( int i = 0; i < list.Count(); i++ )
+	{
+		nInternFound += ( table.Find( list[i] ) != NULL );
+	}
+	timer.End();
+	float flIntern = timer.GetDuration().GetMillisecondsF();
+
+	int nHashtableFound = 0;
+	CUtlHashtable< CUtlConstString > hashtable( 256 );
+	timer.Start();
+	for ( int i = 0; i < list.Count(); i++ )
+	{
+		hashtable.Insert( list[i].Get() );
+	}
+	for ( int i = 0; i < list.Count(); i++ )
+	{
+		nHashtableFound += ( hashtable.Find( list[i].Get() ) != hashtable.InvalidHandle() );
+	}
+	timer.End();
+	float flHashtable = timer.GetDuration().GetMillisecondsF();
+
+	Shipping_Assert( table.Count() == hashtable.Count() );
+	Shipping_Assert( nInternFound == list.Count() && nHashtableFound == list.Count() );
+
+	Msg( "%d strings, %d unique: CUtlStringInternTable %.2fms, CUtlHashtable %.2fms\n",
+		list.Count(), table.Count(), flIntern, flHashtable );
+}
+
+DEFINE_TESTCASE( UtlStringInternTest, UtlStringInternTestSuite )
+{
+	Msg( "Running CUtlStringInternTable tests\n" );
+
+	BasicTests();
+	ConcurrentTests();
+	SpawnBenchmark();
+}
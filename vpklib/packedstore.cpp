@@ -13,6 +13,7 @@
 #include "tier1/utldict.h"
 #include "tier2/fileutils.h"
 #include "tier1/utlbuffer.h"
+#include "tier0/icommandline.h"
 
 #ifdef VPK_ENABLE_SIGNING
 	#include "crypto.h"
@@ -212,6 +213,8 @@ void CPackedStore::Init( void )
 {
 	m_nHighestChunkFileIndex = -1;
 	m_bUseDirFile = false;
+	m_bMapChunkFiles = false;
+	m_pFileTracker = NULL;
 	m_pszFileBaseName[0] = 0;
 	m_pszFullPathName[0] = 0;
 	memset( m_pExtensionData, 0, sizeof( m_pExtensionData ) );
@@ -277,6 +280,12 @@ CPackedStore::CPackedStore( char const *pFileBasename, char *pszFName, IBaseFile
 	Init();
 	m_pFileSystem = pFS;
 	m_PackedStoreReadCache.m_pPackedStore = this;
+
+#ifdef PLATFORM_64BITS
+	// Chunk files are up to k_nVPKDefaultChunkSize each, only map them when we have the address space.
+	// Stores opened for writing append to their chunks, so they keep going through file handles.
+	m_bMapChunkFiles = !bOpenForWrite && !CommandLine()->FindParm( "-vpk_nommap" );
+#endif
 	m_DirectoryData.AddToTail( 0 );
 
 	if ( pFileBasename )
@@ -870,16 +879,25 @@ bool CPackedStoreReadCache::BCanSatisfyFromReadCache( uint8 *pOutData, CPackedSt
 bool CPackedStoreReadCache::ReadCacheLine( FileHandleTracker_t &fHandle, CachedVPKRead_t &cachedVPKRead )
 {
 	cachedVPKRead.m_cubBuffer = 0;
+	if ( fHandle.m_MappedFile.IsOpen() )
+	{
+		int64 nAvailable = fHandle.m_MappedFile.Size() - cachedVPKRead.m_nFileFraction;
+		cachedVPKRead.m_cubBuffer = (int)MAX( 0, MIN( nAvailable, (int64)k_cubCacheBufferSize ) );
+		memcpy( cachedVPKRead.m_pubBuffer, fHandle.m_MappedFile.Base() + cachedVPKRead.m_nFileFraction, cachedVPKRead.m_cubBuffer );
+	}
+	else
+	{
 #ifdef IS_WINDOWS_PC
-	if ( cachedVPKRead.m_nFileFraction != fHandle.m_nCurOfs )
-		SetFilePointer ( fHandle.m_hFileHandle, cachedVPKRead.m_nFileFraction, NULL,  FILE_BEGIN); 
-	ReadFile( fHandle.m_hFileHandle, cachedVPKRead.m_pubBuffer, k_cubCacheBufferSize, (LPDWORD) &cachedVPKRead.m_cubBuffer, NULL );
-	SetFilePointer ( fHandle.m_hFileHandle, fHandle.m_nCurOfs, NULL,  FILE_BEGIN); 
+		if ( cachedVPKRead.m_nFileFraction != fHandle.m_nCurOfs )
+			SetFilePointer ( fHandle.m_hFileHandle, cachedVPKRead.m_nFileFraction, NULL,  FILE_BEGIN);
+		ReadFile( fHandle.m_hFileHandle, cachedVPKRead.m_pubBuffer, k_cubCacheBufferSize, (LPDWORD) &cachedVPKRead.m_cubBuffer, NULL );
+		SetFilePointer ( fHandle.m_hFileHandle, fHandle.m_nCurOfs, NULL,  FILE_BEGIN);
 #else
-	m_pFileSystem->Seek( fHandle.m_hFileHandle, cachedVPKRead.m_nFileFraction, FILESYSTEM_SEEK_HEAD );
-	cachedVPKRead.m_cubBuffer = m_pFileSystem->Read( cachedVPKRead.m_pubBuffer, k_cubCacheBufferSize, fHandle.m_hFileHandle );
-	m_pFileSystem->Seek( fHandle.m_hFileHandle, fHandle.m_nCurOfs, FILESYSTEM_SEEK_HEAD );
+		m_pFileSystem->Seek( fHandle.m_hFileHandle, cachedVPKRead.m_nFileFraction, FILESYSTEM_SEEK_HEAD );
+		cachedVPKRead.m_cubBuffer = m_pFileSystem->Read( cachedVPKRead.m_pubBuffer, k_cubCacheBufferSize, fHandle.m_hFileHandle );
+		m_pFileSystem->Seek( fHandle.m_hFileHandle, fHandle.m_nCurOfs, FILESYSTEM_SEEK_HEAD );
 #endif
+	}
 	Assert( cachedVPKRead.m_hMD5RequestHandle == 0 );
 	if ( m_pFileTracker ) // file tracker doesn't exist in the VPK command line tool
 	{
@@ -1179,33 +1197,44 @@ int CPackedStore::ReadData( CPackedStoreFileHandle &handle, void *pOutData, int
 			FileHandleTracker_t &fHandle = GetFileHandle( handle.m_nFileNumber );
 			int nDesiredPos = handle.m_nFileOffset + handle.m_nCurrentFileOffset - handle.m_nMetaDataSize;
 			int nRead;
-			fHandle.m_Mutex.Lock();
 			if ( handle.m_nFileNumber == VPKFILENUMBER_EMBEDDED_IN_DIR_FILE )
 			{
 				// for file data in the directory header, all offsets are relative to the size of the dir header.
 				nDesiredPos += m_nDirectoryDataSize + sizeof( VPKDirHeader_t );
 			}
 
-			if ( m_PackedStoreReadCache.BCanSatisfyFromReadCache( (uint8 *)pOutData, handle, fHandle, nDesiredPos, nNumBytes, nRead ) )
+			// Mapped chunks are read-only and need no seek position, so no lock either. We still
+			// go through the read cache when it has chunk hashes to verify the data against.
+			if ( fHandle.m_MappedFile.IsOpen() && !BReadsNeedHashing() )
 			{
+				nRead = (int)MAX( 0, MIN( (int64)nNumBytes, fHandle.m_MappedFile.Size() - nDesiredPos ) );
+				memcpy( pOutData, fHandle.m_MappedFile.Base() + nDesiredPos, nRead );
 				handle.m_nCurrentFileOffset += nRead;
 			}
 			else
 			{
+				fHandle.m_Mutex.Lock();
+				if ( m_PackedStoreReadCache.BCanSatisfyFromReadCache( (uint8 *)pOutData, handle, fHandle, nDesiredPos, nNumBytes, nRead ) )
+				{
+					handle.m_nCurrentFileOffset += nRead;
+				}
+				else
+				{
 #ifdef IS_WINDOWS_PC
-				if ( nDesiredPos != fHandle.m_nCurOfs )
-					SetFilePointer ( fHandle.m_hFileHandle, nDesiredPos, NULL,  FILE_BEGIN); 
-				ReadFile( fHandle.m_hFileHandle, pOutData, nNumBytes, (LPDWORD) &nRead, NULL );
+					if ( nDesiredPos != fHandle.m_nCurOfs )
+						SetFilePointer ( fHandle.m_hFileHandle, nDesiredPos, NULL,  FILE_BEGIN); 
+					ReadFile( fHandle.m_hFileHandle, pOutData, nNumBytes, (LPDWORD) &nRead, NULL );
 #else
-				m_pFileSystem->Seek( fHandle.m_hFileHandle, nDesiredPos, FILESYSTEM_SEEK_HEAD );
-				nRead = m_pFileSystem->Read( pOutData, nNumBytes, fHandle.m_hFileHandle );
+					m_pFileSystem->Seek( fHandle.m_hFileHandle, nDesiredPos, FILESYSTEM_SEEK_HEAD );
+					nRead = m_pFileSystem->Read( pOutData, nNumBytes, fHandle.m_hFileHandle );
 #endif
-				handle.m_nCurrentFileOffset += nRead;
-				fHandle.m_nCurOfs = nRead + nDesiredPos;
+					handle.m_nCurrentFileOffset += nRead;
+					fHandle.m_nCurOfs = nRead + nDesiredPos;
+				}
+				fHandle.m_Mutex.Unlock();
 			}
 			Assert( nRead == nNumBytes );
 			nRet += nRead;
-			fHandle.m_Mutex.Unlock();
 		}
 	}
 	m_PackedStoreReadCache.RetryAllBadCacheLines();
@@ -1461,6 +1490,11 @@ FileHandleTracker_t & CPackedStore::GetFileHandle( int nFileNumber )
 			m_FileHandles[nFileHandleIdx].m_nFileNumber = nFileNumber;
 		}
 #endif
+		if ( m_bMapChunkFiles && m_FileHandles[nFileHandleIdx].m_nFileNumber == nFileNumber )
+		{
+			// Falls back to the file handle if this fails
+			m_FileHandles[nFileHandleIdx].m_MappedFile.Open( pszDataFileName );
+		}
 		return m_FileHandles[nFileHandleIdx];
 	}
 	Error( "Exceeded limit of number of vpk files supported (%d)!\n", MAX_ARCHIVE_FILES_TO_KEEP_OPEN_AT_ONCE );
@@ -51,7 +51,8 @@ class ALIGN16 CJobQueue
 public:
 	CJobQueue() :
 		m_nItems( 0 ),
-		m_nMaxItems( INT_MAX )
+		m_nMaxItems( INT_MAX ),
+		m_bSignaled( false )
 	{
 
 	}
@@ -113,6 +114,11 @@ public:
 		m_mutex.Lock();
 		if ( !m_nItems )
 		{
+			if ( m_bSignaled )
+			{
+				m_bSignaled = false;
+				m_JobAvailableEvent.Reset();
+			}
 			m_mutex.Unlock();
 			*ppJob = NULL;
 			return false;
@@ -142,6 +148,19 @@ public:
 		return m_JobAvailableEvent;
 	}
 
+	// Wakes the threads waiting on the queue without adding a job, the
+	// next Pop() that finds the queue empty clears it again
+	void Signal()
+	{
+		m_mutex.Lock();
+		if ( !m_nItems && !m_bSignaled )
+		{
+			m_bSignaled = true;
+			m_JobAvailableEvent.Set();
+		}
+		m_mutex.Unlock();
+	}
+
 	void Flush()
 	{
 		// Only safe to call when system is suspended
@@ -164,11 +183,107 @@ private:
 	CTSQueue<CJob *>	m_Queues[JP_HIGH + 1];
 	int					m_nItems;
 	int					m_nMaxItems;
+	bool				m_bSignaled;
 	CThreadMutex		m_mutex;
 	CThreadManualEvent	m_JobAvailableEvent;
 
 } ALIGN16_POST;
 
+//-----------------------------------------------------------------------------
+// ParallelFor tasks. These are plain values copied in and out of the task
+// deques: no allocation and no reference counting. Everything they point
+// at is owned by the ParallelFor call that made them, which doesn't return
+// until its pending count drops to zero.
+//-----------------------------------------------------------------------------
+
+struct ThreadPoolTask_t
+{
+	ThreadPoolTaskFunc_t	m_pfnTask;
+	void *					m_pContext;
+	int						m_iBegin;
+	int						m_iEnd;
+	int						m_nGrain;
+	CInterlockedInt *		m_pnPending;
+};
+
+//-----------------------------------------------------------------------------
+// Fixed size task deque, one per worker. The owning thread pushes and pops
+// at the bottom so it keeps working on the pieces it just split off, other
+// threads steal from the top where the largest ranges are. Each deque has
+// its own spin lock, so threads only contend when stealing from the same
+// victim.
+//-----------------------------------------------------------------------------
+
+class CTaskDeque
+{
+public:
+	enum
+	{
+		MAX_TASKS = 256,	// power of two
+	};
+
+	CTaskDeque() :
+		m_iTop( 0 ),
+		m_iBottom( 0 )
+	{
+	}
+
+	bool IsEmpty() const
+	{
+		return m_iTop == m_iBottom;
+	}
+
+	bool Push( const ThreadPoolTask_t &task )
+	{
+		AUTO_LOCK( m_mutex );
+		if ( m_iBottom - m_iTop == MAX_TASKS )
+		{
+			return false;
+		}
+		m_Tasks[ m_iBottom & ( MAX_TASKS - 1 ) ] = task;
+		m_iBottom++;
+		return true;
+	}
+
+	bool Pop( ThreadPoolTask_t *pTask )
+	{
+		if ( IsEmpty() )
+		{
+			return false;
+		}
+		AUTO_LOCK( m_mutex );
+		if ( IsEmpty() )
+		{
+			return false;
+		}
+		m_iBottom--;
+		*pTask = m_Tasks[ m_iBottom & ( MAX_TASKS - 1 ) ];
+		return true;
+	}
+
+	bool Steal( ThreadPoolTask_t *pTask )
+	{
+		if ( IsEmpty() )
+		{
+			return false;
+		}
+		AUTO_LOCK( m_mutex );
+		if ( IsEmpty() )
+		{
+			return false;
+		}
+		*pTask = m_Tasks[ m_iTop & ( MAX_TASKS - 1 ) ];
+		m_iTop++;
+		return true;
+	}
+
+private:
+	CThreadFastMutex	m_mutex;
+	volatile unsigned	m_iTop;
+	volatile unsigned	m_iBottom;
+	ThreadPoolTask_t	m_Tasks[MAX_TASKS];
+};
+
 //-----------------------------------------------------------------------------
 //
 // CThreadPool
@@ -242,7 +357,10 @@ public:
 	int ExecuteToPriority( JobPriority_t toPriority, JobFilter_t pfnFilter = NULL  );
 	int AbortAll();
 
-	virtual void Reserved1() {}
+	//-----------------------------------------------------
+	// Work stealing loops (any thread)
+	//-----------------------------------------------------
+	virtual void ParallelFor( ThreadPoolTaskFunc_t pfnTask, void *pContext, int iBegin, int iEnd, int nGrain = 0 );
 
 private:
 	enum
@@ -257,6 +375,14 @@ private:
 	CJob *PeekJob();
 	CJob *GetDummyJob();
 
+	//-----------------------------------------------------
+	// ParallelFor tasks
+	//-----------------------------------------------------
+	CTaskDeque *GetThreadTaskDeque( int *piThread );
+	bool PushTask( CTaskDeque *pDeque, const ThreadPoolTask_t &task );
+	bool GetTask( CTaskDeque *pDeque, int iThread, ThreadPoolTask_t *pTask );
+	void RunTask( CTaskDeque *pDeque, ThreadPoolTask_t &task );
+
 	//-----------------------------------------------------
 	// Thread functions
 	//-----------------------------------------------------
@@ -274,6 +400,9 @@ private:
 	int						m_nSuspend;
 	CInterlockedInt			m_nJobs;
 
+	CTaskDeque				m_ExternalTasks;	// ParallelFor tasks of threads not in the pool
+	CInterlockedInt			m_nQueuedTasks;
+
 	// Some jobs should only be executed on the threadpool thread(s). Ie: the rendering thread has the GL context
 	//	and the main thread coming in and "helping" with jobs breaks that pretty nicely. This flag states that
 	//	only the threadpool threads should execute these jobs.
@@ -343,6 +472,21 @@ public:
 		return m_DirectQueue;
 	}
 
+	CTaskDeque &AccessTaskDeque()
+	{
+		return m_TaskDeque;
+	}
+
+	CThreadPool *GetOwner()
+	{
+		return m_pOwner;
+	}
+
+	int GetThreadIndex()
+	{
+		return m_iThread;
+	}
+
 private:
 	unsigned Wait()
 	{
@@ -404,6 +548,8 @@ private:
 
 		tmZone( TELEMETRY_LEVEL0, TMZF_NONE, "%s", __FUNCTION__ );
 
+		s_pCurrentJobThread = this;
+
 		m_pOwner->m_nIdleThreads++;
 		m_IdleEvent.Set();
 		while (!bExit && ( ( waitResult = Wait() ) != WAIT_FAILED ) )
@@ -449,6 +595,7 @@ private:
 				tmZone( TELEMETRY_LEVEL0, TMZF_NONE, "%s !PeekCall()", __FUNCTION__ );
 
 				CJob *pJob;
+				ThreadPoolTask_t task;
 				bool bTookJob = false;
 				do
 				{
@@ -456,8 +603,11 @@ private:
 					{
 						if ( !m_SharedQueue.Pop( &pJob ) )
 						{
-							// Nothing to process, return to wait state
-							break;
+							if ( !m_pOwner->GetTask( &m_TaskDeque, m_iThread, &task ) )
+							{
+								// Nothing to process, return to wait state
+								break;
+							}
 						}
 					}
 					if ( !bTookJob )
@@ -466,8 +616,15 @@ private:
 						m_pOwner->m_nIdleThreads--;
 						bTookJob = true;
 					}
-					ServiceJobAndRelease( pJob, m_iThread );
-					m_pOwner->m_nJobs--;
+					if ( pJob )
+					{
+						ServiceJobAndRelease( pJob, m_iThread );
+						m_pOwner->m_nJobs--;
+					}
+					else
+					{
+						m_pOwner->RunTask( &m_TaskDeque, task );
+					}
 				} while ( !PeekCall() );
 
 				if ( bTookJob )
@@ -487,8 +644,14 @@ private:
 	CThreadPool *		m_pOwner;
 	CThreadManualEvent	m_IdleEvent;
 	int					m_iThread;
+	CTaskDeque			m_TaskDeque;
+
+public:
+	static CTHREADLOCALPTR( CJobThread ) s_pCurrentJobThread;
 };
 
+CTHREADLOCALPTR( CJobThread ) CJobThread::s_pCurrentJobThread;
+
 //-----------------------------------------------------------------------------
 
 CGlobalThreadPool g_ThreadPool;
@@ -503,7 +666,8 @@ IThreadPool *g_pThreadPool = &g_ThreadPool;
 CThreadPool::CThreadPool() :
 	m_nIdleThreads( 0 ),
 	m_nJobs( 0 ),
-	m_nSuspend( 0 )
+	m_nSuspend( 0 ),
+	m_nQueuedTasks( 0 )
 {
 }
 
@@ -889,6 +1053,157 @@ int CThreadPool::AbortAll()
 	return iAborted;
 }
 
+//---------------------------------------------------------
+// Work stealing loops
+//---------------------------------------------------------
+
+void CThreadPool::ParallelFor( ThreadPoolTaskFunc_t pfnTask, void *pContext, int iBegin, int iEnd, int nGrain )
+{
+	if ( iEnd <= iBegin )
+	{
+		return;
+	}
+
+	int nThreads = m_Threads.Count();
+	if ( nGrain <= 0 )
+	{
+		// A few tasks per thread, so stealing can even out uneven items
+		nGrain = MAX( 1, ( iEnd - iBegin ) / ( 4 * ( nThreads + 1 ) ) );
+	}
+
+	if ( !nThreads || iEnd - iBegin <= nGrain )
+	{
+		(*pfnTask)( pContext, iBegin, iEnd );
+		return;
+	}
+
+	tmZone( TELEMETRY_LEVEL0, TMZF_NONE, "%s %d", __FUNCTION__, iEnd - iBegin );
+
+	int iThread;
+	CTaskDeque *pDeque = GetThreadTaskDeque( &iThread );
+
+	CInterlockedInt nPending( 1 );
+	ThreadPoolTask_t task = { pfnTask, pContext, iBegin, iEnd, nGrain, &nPending };
+	RunTask( pDeque, task );
+
+	// Help with whatever is queued until the rest of this loop is done. That
+	// can include tasks of other loops, which is what makes nesting safe: a
+	// thread waiting on an inner loop never stops the outer one progressing.
+	// With nothing left to take, the last tasks run elsewhere: spin a while,
+	// then yield. This can run inside the server tick, so never sleep on a
+	// timer, that can hold the frame up for a millisecond or more.
+	const int nSpins = 1024;
+	int nIdle = 0;
+	while ( nPending > 0 )
+	{
+		if ( GetTask( pDeque, iThread, &task ) )
+		{
+			RunTask( pDeque, task );
+			nIdle = 0;
+		}
+		else
+		{
+			ThreadPause();
+			++nIdle;
+			if ( nIdle > nSpins )
+			{
+				ThreadSleep( 0 );
+			}
+		}
+	}
+}
+
+//---------------------------------------------------------
+
+CTaskDeque *CThreadPool::GetThreadTaskDeque( int *piThread )
+{
+	CJobThread *pThread = CJobThread::s_pCurrentJobThread;
+	if ( pThread && pThread->GetOwner() == this )
+	{
+		*piThread = pThread->GetThreadIndex();
+		return &pThread->AccessTaskDeque();
+	}
+
+	// All other threads share one deque, it's indexed after the workers
+	*piThread = m_Threads.Count();
+	return &m_ExternalTasks;
+}
+
+//---------------------------------------------------------
+
+bool CThreadPool::PushTask( CTaskDeque *pDeque, const ThreadPoolTask_t &task )
+{
+	++m_nQueuedTasks;
+	if ( !pDeque->Push( task ) )
+	{
+		--m_nQueuedTasks;
+		return false;
+	}
+
+	if ( m_nIdleThreads > 0 )
+	{
+		m_SharedQueue.Signal();
+	}
+	return true;
+}
+
+//---------------------------------------------------------
+
+bool CThreadPool::GetTask( CTaskDeque *pDeque, int iThread, ThreadPoolTask_t *pTask )
+{
+	if ( pDeque->Pop( pTask ) )
+	{
+		--m_nQueuedTasks;
+		return true;
+	}
+
+	if ( m_nQueuedTasks <= 0 )
+	{
+		return false;
+	}
+
+	// Steal, starting after ourselves so thieves spread over the victims
+	int nDeques = m_Threads.Count() + 1;
+	for ( int i = 1; i < nDeques; i++ )
+	{
+		int iVictim = ( iThread + i ) % nDeques;
+		CTaskDeque &victim = ( iVictim < m_Threads.Count() ) ? m_Threads[iVictim]->AccessTaskDeque() : m_ExternalTasks;
+		if ( victim.Steal( pTask ) )
+		{
+			--m_nQueuedTasks;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//---------------------------------------------------------
+
+void CThreadPool::RunTask( CTaskDeque *pDeque, ThreadPoolTask_t &task )
+{
+	// Split off the upper half until one grain is left, leaving the halves
+	// on our deque for idle threads to steal
+	while ( task.m_iEnd - task.m_iBegin > task.m_nGrain )
+	{
+		ThreadPoolTask_t upper = task;
+		upper.m_iBegin = task.m_iBegin + ( task.m_iEnd - task.m_iBegin ) / 2;
+
+		++(*task.m_pnPending);
+		if ( !PushTask( pDeque, upper ) )
+		{
+			// Deque is full, do the rest here
+			--(*task.m_pnPending);
+			break;
+		}
+		task.m_iEnd = upper.m_iBegin;
+	}
+
+	(*task.m_pfnTask)( task.m_pContext, task.m_iBegin, task.m_iEnd );
+
+	--(*task.m_pnPending);
+}
+
 //---------------------------------------------------------
 // CThreadPool thread functions
 //---------------------------------------------------------
@@ -1349,6 +1664,73 @@ void TestForcedExecute()
 	Msg( "TestForcedExecute DONE\n" );
 }
 
+
+CInterlockedInt g_nParallelForVisits[4096];
+
+void ParallelForVisit( void *pContext, int iBegin, int iEnd )
+{
+	int nInner = (int)(intp)pContext;
+	for ( int i = iBegin; i < iEnd; i++ )
+	{
+		if ( nInner )
+		{
+			// nested loop over a slice of its own
+			g_pTestThreadPool->ParallelFor( &ParallelForVisit, NULL, i * nInner, ( i + 1 ) * nInner, 1 );
+		}
+		else
+		{
+			++g_nParallelForVisits[i];
+		}
+	}
+}
+
+void TestParallelFor()
+{
+	Msg( "TestParallelFor\n" );
+	for ( int nThreads = 0; nThreads <= 4; nThreads++ )
+	{
+		ThreadPoolStartParams_t params;
+		params.nThreads = nThreads;
+		g_pTestThreadPool->Start( params, "Tst" );
+
+		for ( int nGrain = 0; nGrain <= 64; nGrain = nGrain * 4 + 1 )
+		{
+			for ( int bNested = 0; bNested < 2; bNested++ )
+			{
+				for ( int i = 0; i < (int)ARRAYSIZE( g_nParallelForVisits ); i++ )
+				{
+					g_nParallelForVisits[i] = 0;
+				}
+
+				CFastTimer timer;
+				timer.Start();
+				if ( bNested )
+				{
+					g_pTestThreadPool->ParallelFor( &ParallelForVisit, (void *)64, 0, ARRAYSIZE( g_nParallelForVisits ) / 64, nGrain );
+				}
+				else
+				{
+					g_pTestThreadPool->ParallelFor( &ParallelForVisit, NULL, 0, ARRAYSIZE( g_nParallelForVisits ), nGrain );
+				}
+				timer.End();
+
+				int nBad = 0;
+				for ( int i = 0; i < (int)ARRAYSIZE( g_nParallelForVisits ); i++ )
+				{
+					nBad += ( g_nParallelForVisits[i] != 1 );
+				}
+
+				Msg( "TestParallelFor: %d threads, grain %d%s: %fms%s\n", nThreads, nGrain, bNested ? ", nested" : "", 
+					timer.GetDuration().GetMillisecondsF(), nBad ? " FAILED" : "" );
+				Assert( !nBad );
+			}
+		}
+
+		g_pTestThreadPool->Stop();
+	}
+	Msg( "TestParallelFor DONE\n" );
+}
+
 } // namespace ThreadPoolTest
 
 void RunThreadPoolTests()
@@ -1431,4 +1813,5 @@ void RunThreadPoolTests()
 #endif
 
 	ThreadPoolTest::TestForcedExecute();
+	ThreadPoolTest::TestParallelFor();
 }